@@ -22,6 +22,7 @@
 #include <endian.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <unistd.h>
 #include <stdarg.h>
 #include <stdlib.h>
@@ -32,10 +33,13 @@
 #include <seccomp.h>
 
 #include "arch.h"
+#include "cache.h"
+#include "cost.h"
 #include "db.h"
 #include "gen_pfc.h"
 #include "gen_bpf.h"
 #include "helper.h"
+#include "notify.h"
 #include "system.h"
 
 #define API	__attribute__((visibility("default")))
@@ -47,6 +51,7 @@ const struct scmp_version library_version = {
 };
 
 unsigned int seccomp_api_level = 0;
+static pthread_once_t _seccomp_api_once = PTHREAD_ONCE_INIT;
 
 /**
  * Filter the error codes we send back to callers
@@ -83,6 +88,8 @@ static int _rc_filter(int err)
 	 *       requested operation */
 	case -EOPNOTSUPP:
 	/* NOTE: operation is not supported */
+	case -ERANGE:
+	/* NOTE: the caller's buffer is too small */
 	case -ESRCH:
 		/* NOTE: operation failed due to multi-threading */
 		return err;
@@ -146,22 +153,21 @@ static int _syscall_valid(const struct db_filter_col *col, int syscall)
 }
 
 /**
- * Update the API level
+ * Detect the API level
  *
  * This function performs a series of tests to determine what functionality is
- * supported given the current running environment (kernel, etc.).  It is
- * important to note that this function only does meaningful checks the first
- * time it is run, the resulting API level is cached after this first run and
- * used for all subsequent calls.  The API level value is returned.
+ * supported given the current running environment (kernel, etc.).  It is run
+ * once by _seccomp_api_update() and does nothing if the API level has already
+ * been set by the caller.
  *
  */
-static unsigned int _seccomp_api_update(void)
+static void _seccomp_api_detect(void)
 {
 	unsigned int level = 1;
 
 	/* if seccomp_api_level > 0 then it's already been set, we're done */
 	if (seccomp_api_level >= 1)
-		return seccomp_api_level;
+		return;
 
 	/* NOTE: level 1 is the base level, start checking at 2 */
 
@@ -188,8 +194,22 @@ static unsigned int _seccomp_api_update(void)
 	    sys_chk_seccomp_flag(SECCOMP_FILTER_FLAG_TSYNC_ESRCH) == 1)
 		level = 6;
 
-	/* update the stored api level and return */
+	/* update the stored api level */
 	seccomp_api_level = level;
+}
+
+/**
+ * Update the API level
+ *
+ * This function makes sure the API level has been determined, the kernel is
+ * only probed the first time this function is run and the resulting API level
+ * is cached and used for all subsequent calls.  It is safe to call this
+ * function from multiple threads at once.  The API level value is returned.
+ *
+ */
+static unsigned int _seccomp_api_update(void)
+{
+	pthread_once(&_seccomp_api_once, _seccomp_api_detect);
 	return seccomp_api_level;
 }
 
@@ -314,6 +334,17 @@ API void seccomp_release(scmp_filter_ctx ctx)
 	db_col_release((struct db_filter_col *)ctx);
 }
 
+/* NOTE - function header comment in include/seccomp.h */
+API scmp_filter_ctx seccomp_dup(const scmp_filter_ctx ctx)
+{
+	struct db_filter_col *col = (struct db_filter_col *)ctx;
+
+	if (db_col_valid(col))
+		return NULL;
+
+	return db_col_dup(col);
+}
+
 /* NOTE - function header comment in include/seccomp.h */
 API int seccomp_merge(scmp_filter_ctx ctx_dst, scmp_filter_ctx ctx_src)
 {
@@ -415,6 +446,25 @@ API int seccomp_load(const scmp_filter_ctx ctx)
 	return _rc_filter(sys_filter_load(col, rawrc));
 }
 
+/* NOTE - function header comment in include/seccomp.h */
+API int seccomp_load_raw(const void *buf, size_t len, uint32_t flags)
+{
+	struct bpf_program prgm;
+
+	if (buf == NULL || len == 0 || (len % sizeof(*prgm.blks)) != 0 ||
+	    (len / sizeof(*prgm.blks)) > UINT16_MAX)
+		return _rc_filter(-EINVAL);
+	if (flags & ~(SCMP_LOAD_NNP | SCMP_LOAD_TSYNC | SCMP_LOAD_LOG |
+		      SCMP_LOAD_SSB | SCMP_LOAD_NEW_LISTENER |
+		      SCMP_LOAD_SYSRAWRC))
+		return _rc_filter(-EINVAL);
+
+	prgm.blk_cnt = len / sizeof(*prgm.blks);
+	prgm.blks = (bpf_instr_raw *)buf;
+
+	return _rc_filter(sys_filter_load_raw(&prgm, flags));
+}
+
 /* NOTE - function header comment in include/seccomp.h */
 API int seccomp_attr_get(const scmp_filter_ctx ctx,
 			 enum scmp_filter_attr attr, uint32_t *value)
@@ -527,6 +577,18 @@ API int seccomp_syscall_priority(scmp_filter_ctx ctx,
 	return _rc_filter(db_col_syscall_priority(col, syscall, priority));
 }
 
+/* NOTE - function header comment in include/seccomp.h */
+API int seccomp_syscall_weight(scmp_filter_ctx ctx,
+			       int syscall, uint32_t weight)
+{
+	struct db_filter_col *col = (struct db_filter_col *)ctx;
+
+	if (db_col_valid(col) || _syscall_valid(col, syscall))
+		return _rc_filter(-EINVAL);
+
+	return _rc_filter(db_col_syscall_weight(col, syscall, weight));
+}
+
 /* NOTE - function header comment in include/seccomp.h */
 API int seccomp_rule_add_array(scmp_filter_ctx ctx,
 			       uint32_t action, int syscall,
@@ -631,6 +693,97 @@ API int seccomp_rule_add_exact(scmp_filter_ctx ctx,
 	return _rc_filter(rc);
 }
 
+/* NOTE - function header comment in include/seccomp.h */
+API int seccomp_rule_add_batch(scmp_filter_ctx ctx,
+			       struct scmp_rule *rules, unsigned int rule_cnt)
+{
+	int rc = 0, rc_tmp;
+	unsigned int iter;
+	struct scmp_rule *entry;
+	struct db_filter_col *col = (struct db_filter_col *)ctx;
+
+	if (db_col_valid(col))
+		return _rc_filter(-EINVAL);
+	if (rule_cnt > 0 && rules == NULL)
+		return _rc_filter(-EINVAL);
+
+	/* validate every rule before we touch the filter */
+	for (iter = 0; iter < rule_cnt; iter++) {
+		entry = &rules[iter];
+
+		if (entry->arg_cnt > ARG_COUNT_MAX ||
+		    (entry->arg_cnt > 0 && entry->arg_array == NULL) ||
+		    _syscall_valid(col, entry->syscall))
+			rc_tmp = -EINVAL;
+		else
+			rc_tmp = db_col_action_valid(col, entry->action);
+		if (rc_tmp == 0 && entry->action == col->attr.act_default)
+			rc_tmp = -EACCES;
+
+		entry->rc = _rc_filter(rc_tmp);
+		if (rc_tmp < 0 && rc == 0)
+			rc = rc_tmp;
+	}
+	if (rc < 0)
+		return _rc_filter(rc);
+
+	rc = db_col_rule_add_batch(col, 0, rules, rule_cnt);
+	for (iter = 0; iter < rule_cnt; iter++)
+		rules[iter].rc = _rc_filter(rules[iter].rc);
+
+	return _rc_filter(rc);
+}
+
+/* NOTE - function header comment in include/seccomp.h */
+API int seccomp_rule_remove_array(scmp_filter_ctx ctx,
+				  uint32_t action, int syscall,
+				  unsigned int arg_cnt,
+				  const struct scmp_arg_cmp *arg_array)
+{
+	int rc;
+	struct db_filter_col *col = (struct db_filter_col *)ctx;
+
+	if (arg_cnt > ARG_COUNT_MAX)
+		return _rc_filter(-EINVAL);
+	if (arg_cnt > 0 && arg_array == NULL)
+		return _rc_filter(-EINVAL);
+
+	if (db_col_valid(col) || _syscall_valid(col, syscall))
+		return _rc_filter(-EINVAL);
+
+	rc = db_col_action_valid(col, action);
+	if (rc < 0)
+		return _rc_filter(rc);
+	if (action == col->attr.act_default)
+		return _rc_filter(-EACCES);
+
+	return _rc_filter(db_col_rule_remove(col, action,
+					     syscall, arg_cnt, arg_array));
+}
+
+/* NOTE - function header comment in include/seccomp.h */
+API int seccomp_rule_remove(scmp_filter_ctx ctx,
+			    uint32_t action, int syscall,
+			    unsigned int arg_cnt, ...)
+{
+	int rc;
+	int iter;
+	struct scmp_arg_cmp arg_array[ARG_COUNT_MAX];
+	va_list arg_list;
+
+	/* arg_cnt is unsigned, so no need to check the lower bound */
+	if (arg_cnt > ARG_COUNT_MAX)
+		return _rc_filter(-EINVAL);
+
+	va_start(arg_list, arg_cnt);
+	for (iter = 0; iter < arg_cnt; ++iter)
+		arg_array[iter] = va_arg(arg_list, struct scmp_arg_cmp);
+	rc = seccomp_rule_remove_array(ctx, action, syscall, arg_cnt, arg_array);
+	va_end(arg_list);
+
+	return _rc_filter(rc);
+}
+
 /* NOTE - function header comment in include/seccomp.h */
 API int seccomp_notify_alloc(struct seccomp_notif **req,
 			     struct seccomp_notif_resp **resp)
@@ -687,6 +840,58 @@ API int seccomp_notify_fd(const scmp_filter_ctx ctx)
 	return _rc_filter(col->notify_fd);
 }
 
+/* NOTE - function header comment in include/seccomp.h */
+API int seccomp_notify_dispatch_start(int fd, unsigned int threads,
+				      scmp_notify_cb cb, void *data,
+				      scmp_notify_ctx *disp)
+{
+	struct notify_dispatch *disp_new;
+	int rc;
+
+	/* force a runtime api level detection */
+	_seccomp_api_update();
+
+	if (disp == NULL)
+		return _rc_filter(-EINVAL);
+
+	rc = notify_dispatch_start(fd, threads, cb, data, &disp_new);
+	if (rc < 0)
+		return _rc_filter(rc);
+	*disp = disp_new;
+
+	return 0;
+}
+
+/* NOTE - function header comment in include/seccomp.h */
+API int seccomp_notify_dispatch_stats(const scmp_notify_ctx disp,
+				      unsigned int worker,
+				      struct scmp_notify_stats *stats)
+{
+	if (disp == NULL || stats == NULL)
+		return _rc_filter(-EINVAL);
+
+	return _rc_filter(notify_dispatch_stats((struct notify_dispatch *)disp,
+						worker, stats));
+}
+
+/* NOTE - function header comment in include/seccomp.h */
+API void seccomp_notify_dispatch_stop(scmp_notify_ctx disp)
+{
+	if (disp == NULL)
+		return;
+
+	notify_dispatch_stop((struct notify_dispatch *)disp);
+}
+
+/* NOTE - function header comment in include/seccomp.h */
+API void seccomp_notify_dispatch_release(scmp_notify_ctx disp)
+{
+	if (disp == NULL)
+		return;
+
+	notify_dispatch_release((struct notify_dispatch *)disp);
+}
+
 /* NOTE - function header comment in include/seccomp.h */
 API int seccomp_export_pfc(const scmp_filter_ctx ctx, int fd)
 {
@@ -712,7 +917,7 @@ API int seccomp_export_bpf(const scmp_filter_ctx ctx, int fd)
 		return _rc_filter(-EINVAL);
 	col = (struct db_filter_col *)ctx;
 
-	rc = gen_bpf_generate(col, &program);
+	rc = cache_bpf_generate(col, &program);
 	if (rc < 0)
 		return _rc_filter(rc);
 	rc = write(fd, program->blks, BPF_PGM_SIZE(program));
@@ -722,3 +927,89 @@ API int seccomp_export_bpf(const scmp_filter_ctx ctx, int fd)
 
 	return 0;
 }
+
+/* NOTE - function header comment in include/seccomp.h */
+API int seccomp_export_pfc_mem(const scmp_filter_ctx ctx,
+			       void *buf, size_t *len)
+{
+	int rc;
+	struct db_filter_col *col;
+	char *pfc;
+	size_t pfc_len;
+
+	if (_ctx_valid(ctx) || len == NULL)
+		return _rc_filter(-EINVAL);
+	col = (struct db_filter_col *)ctx;
+
+	rc = gen_pfc_generate_mem(col, &pfc, &pfc_len);
+	if (rc < 0)
+		return _rc_filter_sys(col, rc);
+	if (buf != NULL && *len < pfc_len)
+		rc = -ERANGE;
+	else if (buf != NULL)
+		memcpy(buf, pfc, pfc_len);
+	*len = pfc_len;
+	free(pfc);
+
+	return _rc_filter(rc);
+}
+
+/* NOTE - function header comment in include/seccomp.h */
+API int seccomp_export_bpf_mem(const scmp_filter_ctx ctx,
+			       void *buf, size_t *len)
+{
+	int rc = 0;
+	struct db_filter_col *col;
+	struct bpf_program *program;
+
+	if (_ctx_valid(ctx) || len == NULL)
+		return _rc_filter(-EINVAL);
+	col = (struct db_filter_col *)ctx;
+
+	rc = cache_bpf_generate(col, &program);
+	if (rc < 0)
+		return _rc_filter(rc);
+	if (buf != NULL && *len < BPF_PGM_SIZE(program))
+		rc = -ERANGE;
+	else if (buf != NULL)
+		memcpy(buf, program->blks, BPF_PGM_SIZE(program));
+	*len = BPF_PGM_SIZE(program);
+	gen_bpf_release(program);
+
+	return _rc_filter(rc);
+}
+
+/* NOTE - function header comment in include/seccomp.h */
+API int seccomp_cache_stats(struct scmp_cache_stats *stats)
+{
+	if (stats == NULL)
+		return _rc_filter(-EINVAL);
+
+	cache_stats(stats);
+	return 0;
+}
+
+/* NOTE - function header comment in include/seccomp.h */
+API void seccomp_cache_flush(void)
+{
+	cache_flush();
+}
+
+/* NOTE - function header comment in include/seccomp.h */
+API int seccomp_cost_estimate(const scmp_filter_ctx ctx,
+			      struct scmp_cost **cost)
+{
+	struct db_filter_col *col;
+
+	if (_ctx_valid(ctx) || cost == NULL)
+		return _rc_filter(-EINVAL);
+	col = (struct db_filter_col *)ctx;
+
+	return _rc_filter(cost_estimate(col, cost));
+}
+
+/* NOTE - function header comment in include/seccomp.h */
+API void seccomp_cost_free(struct scmp_cost *cost)
+{
+	free(cost);
+}
@@ -23,6 +23,7 @@
 #include <errno.h>
 #include <linux/audit.h>
 
+#include "syscalls.h"
 #include "arch.h"
 #include "arch-aarch64.h"
 
@@ -31,6 +32,7 @@ const struct arch_def arch_def_aarch64 = {
 	.token_bpf = AUDIT_ARCH_AARCH64,
 	.size = ARCH_SIZE_64,
 	.endian = ARCH_ENDIAN_LITTLE,
+	.syscall_table = OFFSET_ARCH(aarch64),
 	.syscall_resolve_name = aarch64_syscall_resolve_name,
 	.syscall_resolve_num = aarch64_syscall_resolve_num,
 	.syscall_rewrite = NULL,
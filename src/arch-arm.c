@@ -76,6 +76,7 @@ const struct arch_def arch_def_arm = {
 	.token_bpf = AUDIT_ARCH_ARM,
 	.size = ARCH_SIZE_32,
 	.endian = ARCH_ENDIAN_LITTLE,
+	.syscall_table = -1,
 	.syscall_resolve_name = arm_syscall_resolve_name_munge,
 	.syscall_resolve_num = arm_syscall_resolve_num_munge,
 	.syscall_rewrite = NULL,
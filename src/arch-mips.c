@@ -69,6 +69,7 @@ const struct arch_def arch_def_mips = {
 	.token_bpf = AUDIT_ARCH_MIPS,
 	.size = ARCH_SIZE_32,
 	.endian = ARCH_ENDIAN_BIG,
+	.syscall_table = -1,
 	.syscall_resolve_name = mips_syscall_resolve_name_munge,
 	.syscall_resolve_num = mips_syscall_resolve_num_munge,
 	.syscall_rewrite = NULL,
@@ -80,6 +81,7 @@ const struct arch_def arch_def_mipsel = {
 	.token_bpf = AUDIT_ARCH_MIPSEL,
 	.size = ARCH_SIZE_32,
 	.endian = ARCH_ENDIAN_LITTLE,
+	.syscall_table = -1,
 	.syscall_resolve_name = mips_syscall_resolve_name_munge,
 	.syscall_resolve_num = mips_syscall_resolve_num_munge,
 	.syscall_rewrite = NULL,
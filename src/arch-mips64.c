@@ -67,6 +67,7 @@ const struct arch_def arch_def_mips64 = {
 	.token_bpf = AUDIT_ARCH_MIPS64,
 	.size = ARCH_SIZE_64,
 	.endian = ARCH_ENDIAN_BIG,
+	.syscall_table = -1,
 	.syscall_resolve_name = mips64_syscall_resolve_name_munge,
 	.syscall_resolve_num = mips64_syscall_resolve_num_munge,
 	.syscall_rewrite = NULL,
@@ -78,6 +79,7 @@ const struct arch_def arch_def_mipsel64 = {
 	.token_bpf = AUDIT_ARCH_MIPSEL64,
 	.size = ARCH_SIZE_64,
 	.endian = ARCH_ENDIAN_LITTLE,
+	.syscall_table = -1,
 	.syscall_resolve_name = mips64_syscall_resolve_name_munge,
 	.syscall_resolve_num = mips64_syscall_resolve_num_munge,
 	.syscall_rewrite = NULL,
@@ -69,6 +69,7 @@ const struct arch_def arch_def_mips64n32 = {
 	.token_bpf = AUDIT_ARCH_MIPS64N32,
 	.size = ARCH_SIZE_32,
 	.endian = ARCH_ENDIAN_BIG,
+	.syscall_table = -1,
 	.syscall_resolve_name = mips64n32_syscall_resolve_name_munge,
 	.syscall_resolve_num = mips64n32_syscall_resolve_num_munge,
 	.syscall_rewrite = NULL,
@@ -80,6 +81,7 @@ const struct arch_def arch_def_mipsel64n32 = {
 	.token_bpf = AUDIT_ARCH_MIPSEL64N32,
 	.size = ARCH_SIZE_32,
 	.endian = ARCH_ENDIAN_LITTLE,
+	.syscall_table = -1,
 	.syscall_resolve_name = mips64n32_syscall_resolve_name_munge,
 	.syscall_resolve_num = mips64n32_syscall_resolve_num_munge,
 	.syscall_rewrite = NULL,
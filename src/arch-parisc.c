@@ -7,6 +7,7 @@
 #include <errno.h>
 #include <linux/audit.h>
 
+#include "syscalls.h"
 #include "arch.h"
 #include "arch-parisc.h"
 
@@ -15,6 +16,7 @@ const struct arch_def arch_def_parisc = {
 	.token_bpf = AUDIT_ARCH_PARISC,
 	.size = ARCH_SIZE_32,
 	.endian = ARCH_ENDIAN_BIG,
+	.syscall_table = OFFSET_ARCH(parisc),
 	.syscall_resolve_name = parisc_syscall_resolve_name,
 	.syscall_resolve_num = parisc_syscall_resolve_num,
 	.syscall_rewrite = NULL,
@@ -7,6 +7,7 @@
 #include <errno.h>
 #include <linux/audit.h>
 
+#include "syscalls.h"
 #include "arch.h"
 #include "arch-parisc64.h"
 
@@ -15,6 +16,7 @@ const struct arch_def arch_def_parisc64 = {
 	.token_bpf = AUDIT_ARCH_PARISC64,
 	.size = ARCH_SIZE_64,
 	.endian = ARCH_ENDIAN_BIG,
+	.syscall_table = OFFSET_ARCH(parisc64),
 	.syscall_resolve_name = parisc64_syscall_resolve_name,
 	.syscall_resolve_num = parisc64_syscall_resolve_num,
 	.syscall_rewrite = NULL,
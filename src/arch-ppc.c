@@ -22,6 +22,7 @@
 
 #include <linux/audit.h>
 
+#include "syscalls.h"
 #include "arch.h"
 #include "arch-ppc.h"
 
@@ -30,6 +31,7 @@ const struct arch_def arch_def_ppc = {
 	.token_bpf = AUDIT_ARCH_PPC,
 	.size = ARCH_SIZE_32,
 	.endian = ARCH_ENDIAN_BIG,
+	.syscall_table = OFFSET_ARCH(ppc),
 	.syscall_resolve_name = ppc_syscall_resolve_name,
 	.syscall_resolve_num = ppc_syscall_resolve_num,
 	.syscall_rewrite = NULL,
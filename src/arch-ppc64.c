@@ -26,6 +26,7 @@
 #include <linux/audit.h>
 
 #include "db.h"
+#include "syscalls.h"
 #include "arch.h"
 #include "arch-ppc64.h"
 
@@ -121,68 +122,9 @@ int ppc64_syscall_resolve_name_munge(const char *name)
  */
 const char *ppc64_syscall_resolve_num_munge(int num)
 {
-	if (num == __PNR_accept)
-		return "accept";
-	else if (num == __PNR_accept4)
-		return "accept4";
-	else if (num == __PNR_bind)
-		return "bind";
-	else if (num == __PNR_connect)
-		return "connect";
-	else if (num == __PNR_getpeername)
-		return "getpeername";
-	else if (num == __PNR_getsockname)
-		return "getsockname";
-	else if (num == __PNR_getsockopt)
-		return "getsockopt";
-	else if (num == __PNR_listen)
-		return "listen";
-	else if (num == __PNR_msgctl)
-		return "msgctl";
-	else if (num == __PNR_msgget)
-		return "msgget";
-	else if (num == __PNR_msgrcv)
-		return "msgrcv";
-	else if (num == __PNR_msgsnd)
-		return "msgsnd";
-	else if (num == __PNR_recv)
-		return "recv";
-	else if (num == __PNR_recvfrom)
-		return "recvfrom";
-	else if (num == __PNR_recvmsg)
-		return "recvmsg";
-	else if (num == __PNR_recvmmsg)
-		return "recvmmsg";
-	else if (num == __PNR_semctl)
-		return "semctl";
-	else if (num == __PNR_semget)
-		return "semget";
-	else if (num == __PNR_semtimedop)
-		return "semtimedop";
-	else if (num == __PNR_send)
-		return "send";
-	else if (num == __PNR_sendmsg)
-		return "sendmsg";
-	else if (num == __PNR_sendmmsg)
-		return "sendmmsg";
-	else if (num == __PNR_sendto)
-		return "sendto";
-	else if (num == __PNR_setsockopt)
-		return "setsockopt";
-	else if (num == __PNR_shmat)
-		return "shmat";
-	else if (num == __PNR_shmdt)
-		return "shmdt";
-	else if (num == __PNR_shmget)
-		return "shmget";
-	else if (num == __PNR_shmctl)
-		return "shmctl";
-	else if (num == __PNR_shutdown)
-		return "shutdown";
-	else if (num == __PNR_socket)
-		return "socket";
-	else if (num == __PNR_socketpair)
-		return "socketpair";
+	/* the multiplexed socket and ipc pseudo syscalls */
+	if (num <= __PNR_socket && num >= __PNR_shmctl)
+		return syscall_resolve_pnr(num);
 
 	return ppc64_syscall_resolve_num(num);
 }
@@ -628,6 +570,7 @@ const struct arch_def arch_def_ppc64 = {
 	.token_bpf = AUDIT_ARCH_PPC64,
 	.size = ARCH_SIZE_64,
 	.endian = ARCH_ENDIAN_BIG,
+	.syscall_table = -1,
 	.syscall_resolve_name = ppc64_syscall_resolve_name_munge,
 	.syscall_resolve_num = ppc64_syscall_resolve_num_munge,
 	.syscall_rewrite = ppc64_syscall_rewrite,
@@ -639,6 +582,7 @@ const struct arch_def arch_def_ppc64le = {
 	.token_bpf = AUDIT_ARCH_PPC64LE,
 	.size = ARCH_SIZE_64,
 	.endian = ARCH_ENDIAN_LITTLE,
+	.syscall_table = -1,
 	.syscall_resolve_name = ppc64_syscall_resolve_name_munge,
 	.syscall_resolve_num = ppc64_syscall_resolve_num_munge,
 	.syscall_rewrite = ppc64_syscall_rewrite,
@@ -16,6 +16,7 @@
 #include <errno.h>
 #include <linux/audit.h>
 
+#include "syscalls.h"
 #include "arch.h"
 #include "arch-riscv64.h"
 
@@ -24,6 +25,7 @@ const struct arch_def arch_def_riscv64 = {
 	.token_bpf = AUDIT_ARCH_RISCV64,
 	.size = ARCH_SIZE_64,
 	.endian = ARCH_ENDIAN_LITTLE,
+	.syscall_table = OFFSET_ARCH(riscv64),
 	.syscall_resolve_name = riscv64_syscall_resolve_name,
 	.syscall_resolve_num = riscv64_syscall_resolve_num,
 	.syscall_rewrite = NULL,
@@ -66,6 +66,7 @@ const struct arch_def arch_def_x32 = {
 	.token_bpf = AUDIT_ARCH_X86_64,
 	.size = ARCH_SIZE_32,
 	.endian = ARCH_ENDIAN_LITTLE,
+	.syscall_table = -1,
 	.syscall_resolve_name = x32_syscall_resolve_name_munge,
 	.syscall_resolve_num = x32_syscall_resolve_num_munge,
 	.syscall_rewrite = NULL,
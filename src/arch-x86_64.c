@@ -23,6 +23,7 @@
 #include <errno.h>
 #include <linux/audit.h>
 
+#include "syscalls.h"
 #include "arch.h"
 #include "arch-x86_64.h"
 
@@ -31,6 +32,7 @@ const struct arch_def arch_def_x86_64 = {
 	.token_bpf = AUDIT_ARCH_X86_64,
 	.size = ARCH_SIZE_64,
 	.endian = ARCH_ENDIAN_LITTLE,
+	.syscall_table = OFFSET_ARCH(x86_64),
 	.syscall_resolve_name = x86_64_syscall_resolve_name,
 	.syscall_resolve_num = x86_64_syscall_resolve_num,
 	.syscall_rewrite = NULL,
@@ -46,6 +46,7 @@
 #include "arch-s390.h"
 #include "arch-s390x.h"
 #include "db.h"
+#include "syscalls.h"
 #include "system.h"
 
 #define default_arg_offset(x)		(offsetof(struct seccomp_data, args[x]))
@@ -337,23 +338,31 @@ int arch_syscall_translate(const struct arch_def *arch, int *syscall)
 {
 	int sc_num;
 	const char *sc_name;
+	int off_native, off_arch;
 
 	/* special handling for syscall -1 */
 	if (*syscall == -1)
 		return 0;
 
-	if (arch->token != arch_def_native->token) {
+	if (arch->token == arch_def_native->token)
+		return 0;
+
+	off_native = arch_def_native->syscall_table;
+	off_arch = arch->syscall_table;
+	if (off_native >= 0 && off_arch >= 0)
+		/* translate directly using the generated syscall tables */
+		sc_num = syscall_translate(*syscall, off_native, off_arch);
+	else {
+		/* go through the syscall name so the resolvers can munge */
 		sc_name = arch_syscall_resolve_num(arch_def_native, *syscall);
 		if (sc_name == NULL)
 			return -EFAULT;
-
 		sc_num = arch_syscall_resolve_name(arch, sc_name);
-		if (sc_num == __NR_SCMP_ERROR)
-			return -EFAULT;
-
-		*syscall = sc_num;
 	}
+	if (sc_num == __NR_SCMP_ERROR)
+		return -EFAULT;
 
+	*syscall = sc_num;
 	return 0;
 }
 
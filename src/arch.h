@@ -48,6 +48,8 @@ struct arch_def {
 		ARCH_ENDIAN_LITTLE,
 		ARCH_ENDIAN_BIG,
 	} endian;
+	/* offset in the generated syscall tables, -1 if the resolvers munge */
+	int syscall_table;
 
 	/* arch specific functions */
 	int (*syscall_resolve_name)(const char *name);
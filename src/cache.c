@@ -0,0 +1,412 @@
+/**
+ * Seccomp BPF Program Cache
+ *
+ * Copyright (c) 2026 The libseccomp Authors
+ * Author: The libseccomp Authors <libseccomp@googlegroups.com>
+ */
+
+/*
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of version 2.1 of the GNU Lesser General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses>.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arch.h"
+#include "cache.h"
+#include "db.h"
+#include "gen_bpf.h"
+#include "hash.h"
+#include "helper.h"
+
+/* maximum number of cached programs */
+#define CACHE_ENTRIES			16
+
+struct cache_entry {
+	struct cache_key *key;
+	struct bpf_program *prgm;
+	/* last use, for eviction */
+	unsigned long stamp;
+};
+
+struct cache_state {
+	pthread_mutex_t lock;
+	struct cache_entry entries[CACHE_ENTRIES];
+	unsigned long stamp;
+
+	/* statistics */
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t hash_probes;
+	uint64_t hash_collisions;
+};
+
+static struct cache_state cache = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+struct key_buf {
+	unsigned char *data;
+	size_t len;
+};
+
+/**
+ * Add a value to a cache key buffer
+ * @param kb the key buffer
+ * @param val the value
+ * @param len the length of the value
+ *
+ * Copy the value into the key buffer if the buffer has been allocated, in all
+ * cases the length of the key is updated.
+ *
+ */
+static void _key_put(struct key_buf *kb, const void *val, size_t len)
+{
+	if (kb->data != NULL)
+		memcpy(&kb->data[kb->len], val, len);
+	kb->len += len;
+}
+
+#define _key_put_u8(kb,val) \
+	do { \
+		uint8_t __v = (val); \
+		_key_put(kb, &__v, sizeof(__v)); \
+	} while (0)
+#define _key_put_u32(kb,val) \
+	do { \
+		uint32_t __v = (val); \
+		_key_put(kb, &__v, sizeof(__v)); \
+	} while (0)
+#define _key_put_u64(kb,val) \
+	do { \
+		uint64_t __v = (val); \
+		_key_put(kb, &__v, sizeof(__v)); \
+	} while (0)
+
+/**
+ * Serialize the parts of a filter collection which affect the BPF program
+ * @param kb the key buffer
+ * @param col the filter collection
+ *
+ * Write the attributes, architectures, rules and syscall hints of the filter
+ * collection to the key buffer.  Every field is written with a fixed size and
+ * each list is terminated so that two collections only serialize to the same
+ * key if they generate the same BPF program.
+ *
+ */
+static void _key_build(struct key_buf *kb, const struct db_filter_col *col)
+{
+	unsigned int iter, pos, a_iter;
+	const struct db_filter *filter;
+	const struct db_api_rule_list *rule;
+	const struct db_api_arg *arg;
+	const struct db_sys_list *s_iter;
+
+	_key_put_u32(kb, col->attr.act_default);
+	_key_put_u32(kb, col->attr.act_badarch);
+	_key_put_u32(kb, col->attr.api_tskip);
+	_key_put_u32(kb, col->attr.optimize);
+	_key_put_u32(kb, col->endian);
+	_key_put_u32(kb, col->filter_cnt);
+
+	for (iter = 0; iter < col->filter_cnt; iter++) {
+		filter = col->filters[iter];
+		_key_put_u32(kb, filter->arch->token);
+
+		db_rule_foreach(rule, pos, filter) {
+			_key_put_u8(kb, 1);
+			_key_put_u32(kb, rule->action);
+			_key_put_u32(kb, rule->syscall);
+			_key_put_u8(kb, rule->strict);
+			for (a_iter = 0; a_iter < ARG_COUNT_MAX; a_iter++) {
+				arg = &rule->args[a_iter];
+				_key_put_u8(kb, arg->valid);
+				if (!arg->valid)
+					continue;
+				_key_put_u32(kb, arg->arg);
+				_key_put_u32(kb, arg->op);
+				_key_put_u64(kb, arg->mask);
+				_key_put_u64(kb, arg->datum);
+				if (arg->op == SCMP_CMP_IN_RANGE)
+					_key_put_u64(kb, arg->datum_max);
+				else if (arg->op == SCMP_CMP_IN_SET) {
+					_key_put_u32(kb, arg->set_cnt);
+					_key_put(kb, arg->set,
+						 arg->set_cnt * sizeof(*arg->set));
+				}
+			}
+		}
+		_key_put_u8(kb, 0);
+
+		/* the syscall hints aren't part of the rules */
+		db_syscall_foreach(s_iter, pos, filter) {
+			_key_put_u8(kb, 1);
+			_key_put_u32(kb, s_iter->num);
+			_key_put_u32(kb, s_iter->priority);
+			_key_put_u32(kb, s_iter->weight);
+			_key_put_u8(kb, s_iter->valid);
+		}
+		_key_put_u8(kb, 0);
+	}
+}
+
+/**
+ * Get the cache key of a filter collection
+ * @param col the filter collection
+ *
+ * Return the cache key of the filter collection, generating it if the filter
+ * collection has changed since the key was last generated.  Returns a pointer
+ * to the key on success, NULL on failure.
+ *
+ */
+static const struct cache_key *_key_get(struct db_filter_col *col)
+{
+	struct key_buf kb;
+	struct cache_key *key;
+
+	if (col->cache_key != NULL)
+		return col->cache_key;
+
+	memset(&kb, 0, sizeof(kb));
+	_key_build(&kb, col);
+	key = zmalloc(sizeof(*key) + kb.len);
+	if (key == NULL)
+		return NULL;
+	kb.data = key->data;
+	kb.len = 0;
+	_key_build(&kb, col);
+	key->len = kb.len;
+	key->hash = hash(key->data, key->len);
+
+	col->cache_key = key;
+	return key;
+}
+
+/**
+ * Duplicate a BPF program
+ * @param prgm the BPF program
+ *
+ * Returns a pointer to a copy of the BPF program on success, NULL on failure.
+ * The copy should be released with gen_bpf_release().
+ *
+ */
+static struct bpf_program *_prgm_dup(const struct bpf_program *prgm)
+{
+	struct bpf_program *new;
+
+	new = zmalloc(sizeof(*new));
+	if (new == NULL)
+		return NULL;
+	new->blk_cnt = prgm->blk_cnt;
+	new->blks = zmalloc(BPF_PGM_SIZE(prgm));
+	if (new->blks == NULL) {
+		free(new);
+		return NULL;
+	}
+	memcpy(new->blks, prgm->blks, BPF_PGM_SIZE(prgm));
+
+	return new;
+}
+
+/**
+ * Release a cache entry
+ * @param entry the cache entry
+ */
+static void _entry_release(struct cache_entry *entry)
+{
+	free(entry->key);
+	gen_bpf_release(entry->prgm);
+	memset(entry, 0, sizeof(*entry));
+}
+
+/**
+ * Find a cache entry
+ * @param key the cache key
+ *
+ * Search the cache for the given key, the cache lock must be held by the
+ * caller.  Returns a pointer to the cache entry if found, NULL otherwise.
+ *
+ */
+static struct cache_entry *_entry_find(const struct cache_key *key)
+{
+	unsigned int iter;
+	struct cache_entry *entry;
+
+	for (iter = 0; iter < CACHE_ENTRIES; iter++) {
+		entry = &cache.entries[iter];
+		if (entry->key != NULL && entry->key->hash == key->hash &&
+		    entry->key->len == key->len &&
+		    memcmp(entry->key->data, key->data, key->len) == 0)
+			return entry;
+	}
+
+	return NULL;
+}
+
+/**
+ * Add a BPF program to the cache
+ * @param key the cache key
+ * @param prgm the BPF program
+ *
+ * Add a copy of the BPF program to the cache, evicting the least recently
+ * used entry if the cache is full.  Failing to add the program is not an
+ * error, the program simply isn't cached.
+ *
+ */
+static void _entry_add(const struct cache_key *key,
+		       const struct bpf_program *prgm)
+{
+	unsigned int iter;
+	struct cache_entry *entry, *victim = NULL;
+	struct cache_key *key_new;
+	struct bpf_program *prgm_new;
+
+	key_new = zmalloc(sizeof(*key_new) + key->len);
+	if (key_new == NULL)
+		return;
+	memcpy(key_new, key, sizeof(*key_new) + key->len);
+	prgm_new = _prgm_dup(prgm);
+	if (prgm_new == NULL) {
+		free(key_new);
+		return;
+	}
+
+	pthread_mutex_lock(&cache.lock);
+	if (_entry_find(key) != NULL) {
+		/* someone else beat us to it */
+		pthread_mutex_unlock(&cache.lock);
+		free(key_new);
+		gen_bpf_release(prgm_new);
+		return;
+	}
+	for (iter = 0; iter < CACHE_ENTRIES; iter++) {
+		entry = &cache.entries[iter];
+		if (entry->key == NULL) {
+			victim = entry;
+			break;
+		}
+		if (victim == NULL || entry->stamp < victim->stamp)
+			victim = entry;
+	}
+	if (victim->key != NULL)
+		_entry_release(victim);
+	victim->key = key_new;
+	victim->prgm = prgm_new;
+	victim->stamp = ++cache.stamp;
+	pthread_mutex_unlock(&cache.lock);
+}
+
+/**
+ * Generate a BPF representation of the filter DB using the cache
+ * @param col the seccomp filter collection
+ * @param prgm_ptr the bpf program pointer
+ *
+ * This function returns the BPF representation of the given filter collection
+ * from the program cache, only calling gen_bpf_generate() if an identical
+ * filter collection hasn't been generated recently.  The caller owns the
+ * returned program and should release it with gen_bpf_release().  Returns
+ * zero on success, negative values on failure.
+ *
+ */
+int cache_bpf_generate(struct db_filter_col *col,
+		       struct bpf_program **prgm_ptr)
+{
+	int rc;
+	const struct cache_key *key;
+	struct cache_entry *entry;
+	struct bpf_program *prgm = NULL;
+	struct gen_bpf_stats gen_stats;
+
+	key = _key_get(col);
+	if (key == NULL)
+		return -ENOMEM;
+
+	pthread_mutex_lock(&cache.lock);
+	entry = _entry_find(key);
+	if (entry != NULL) {
+		cache.hits++;
+		entry->stamp = ++cache.stamp;
+		prgm = _prgm_dup(entry->prgm);
+	} else
+		cache.misses++;
+	pthread_mutex_unlock(&cache.lock);
+	if (entry != NULL) {
+		if (prgm == NULL)
+			return -ENOMEM;
+		*prgm_ptr = prgm;
+		return 0;
+	}
+
+	rc = gen_bpf_generate(col, &prgm, &gen_stats);
+	if (rc < 0)
+		return rc;
+	pthread_mutex_lock(&cache.lock);
+	cache.hash_probes += gen_stats.hash_probes;
+	cache.hash_collisions += gen_stats.hash_collisions;
+	pthread_mutex_unlock(&cache.lock);
+	_entry_add(key, prgm);
+
+	*prgm_ptr = prgm;
+	return 0;
+}
+
+/**
+ * Get the program cache statistics
+ * @param stats the cache statistics
+ *
+ * Populate @stats with the cache hits and misses, the number of cached
+ * programs, and the block hash table statistics of the generated programs.
+ *
+ */
+void cache_stats(struct scmp_cache_stats *stats)
+{
+	unsigned int iter;
+
+	pthread_mutex_lock(&cache.lock);
+	stats->hits = cache.hits;
+	stats->misses = cache.misses;
+	stats->entries = 0;
+	for (iter = 0; iter < CACHE_ENTRIES; iter++) {
+		if (cache.entries[iter].key != NULL)
+			stats->entries++;
+	}
+	stats->hash_probes = cache.hash_probes;
+	stats->hash_collisions = cache.hash_collisions;
+	pthread_mutex_unlock(&cache.lock);
+}
+
+/**
+ * Flush the program cache
+ *
+ * Release all of the cached programs and reset the cache statistics.
+ *
+ */
+void cache_flush(void)
+{
+	unsigned int iter;
+
+	pthread_mutex_lock(&cache.lock);
+	for (iter = 0; iter < CACHE_ENTRIES; iter++) {
+		if (cache.entries[iter].key != NULL)
+			_entry_release(&cache.entries[iter]);
+	}
+	cache.stamp = 0;
+	cache.hits = 0;
+	cache.misses = 0;
+	cache.hash_probes = 0;
+	cache.hash_collisions = 0;
+	pthread_mutex_unlock(&cache.lock);
+}
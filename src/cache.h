@@ -0,0 +1,45 @@
+/**
+ * Seccomp BPF Program Cache
+ *
+ * Copyright (c) 2026 The libseccomp Authors
+ * Author: The libseccomp Authors <libseccomp@googlegroups.com>
+ */
+
+/*
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of version 2.1 of the GNU Lesser General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses>.
+ */
+
+#ifndef _CACHE_H
+#define _CACHE_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include <seccomp.h>
+
+#include "db.h"
+#include "gen_bpf.h"
+
+struct cache_key {
+	uint32_t hash;
+	size_t len;
+	unsigned char data[];
+};
+
+int cache_bpf_generate(struct db_filter_col *col,
+		       struct bpf_program **prgm_ptr);
+
+void cache_stats(struct scmp_cache_stats *stats);
+void cache_flush(void);
+
+#endif
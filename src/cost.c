@@ -0,0 +1,413 @@
+/**
+ * Seccomp BPF Program Cost Estimation
+ *
+ * Copyright (c) 2026 The libseccomp Authors
+ * Author: The libseccomp Authors <libseccomp@googlegroups.com>
+ */
+
+/*
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of version 2.1 of the GNU Lesser General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses>.
+ */
+
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _BSD_SOURCE
+#define _BSD_SOURCE
+#endif
+#include <endian.h>
+
+#include <seccomp.h>
+
+#include "arch.h"
+#include "cache.h"
+#include "cost.h"
+#include "db.h"
+#include "gen_bpf.h"
+#include "helper.h"
+#include "system.h"
+
+struct cost_reg {
+	bool known;
+	uint32_t val;
+};
+
+#define _COST_REG_EQ(r1,r2) \
+	((r1).known == (r2).known && (!(r1).known || (r1).val == (r2).val))
+
+struct cost_state {
+	struct cost_reg a;
+	struct cost_reg x;
+};
+#define _COST_STATE_EQ(s1,s2) \
+	(_COST_REG_EQ((s1).a,(s2).a) && _COST_REG_EQ((s1).x,(s2).x))
+
+struct cost_memo {
+	bool valid;
+	struct cost_state state;
+	unsigned int min;
+	unsigned int max;
+};
+
+struct cost_prg {
+	/* host endian copy of the BPF program */
+	struct sock_filter *blks;
+	unsigned int blk_cnt;
+
+	/* the syscall being walked */
+	uint32_t nr;
+	uint32_t arch;
+
+	/* results for the most recent state seen at each instruction */
+	struct cost_memo *memo;
+};
+
+/**
+ * Decode a BPF program into host endianness
+ * @param prgm the BPF program
+ * @param endian the BPF program endianness
+ * @param blks the decoded instructions
+ *
+ * Copy the BPF program into @blks, converting each instruction into host
+ * endianness.  The @blks array must be large enough to hold the program.
+ *
+ */
+static void _cost_decode(const struct bpf_program *prgm, int endian,
+			 struct sock_filter *blks)
+{
+	unsigned int iter;
+	const bpf_instr_raw *i_raw;
+
+	for (iter = 0; iter < prgm->blk_cnt; iter++) {
+		i_raw = &prgm->blks[iter];
+		blks[iter].jt = i_raw->jt;
+		blks[iter].jf = i_raw->jf;
+		if (endian == ARCH_ENDIAN_BIG) {
+			blks[iter].code = be16toh(i_raw->code);
+			blks[iter].k = be32toh(i_raw->k);
+		} else {
+			blks[iter].code = le16toh(i_raw->code);
+			blks[iter].k = le32toh(i_raw->k);
+		}
+	}
+}
+
+/**
+ * Perform a BPF ALU operation on a known value
+ * @param code the BPF instruction code
+ * @param a the accumulator value
+ * @param src the source operand value
+ * @param res the result
+ *
+ * Returns true if the operation could be performed, false otherwise.
+ *
+ */
+static bool _cost_alu(uint16_t code, uint32_t a, uint32_t src, uint32_t *res)
+{
+	switch (BPF_OP(code)) {
+	case BPF_ADD:
+		*res = a + src;
+		break;
+	case BPF_SUB:
+		*res = a - src;
+		break;
+	case BPF_MUL:
+		*res = a * src;
+		break;
+	case BPF_DIV:
+		if (src == 0)
+			return false;
+		*res = a / src;
+		break;
+	case BPF_AND:
+		*res = a & src;
+		break;
+	case BPF_OR:
+		*res = a | src;
+		break;
+	case BPF_LSH:
+		if (src >= 32)
+			return false;
+		*res = a << src;
+		break;
+	case BPF_RSH:
+		if (src >= 32)
+			return false;
+		*res = a >> src;
+		break;
+	case BPF_NEG:
+		*res = -a;
+		break;
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Walk the BPF program and count the instructions executed
+ * @param prg the BPF program
+ * @param pc the first instruction
+ * @param state the register state at the first instruction
+ * @param min the fewest instructions executed
+ * @param max the most instructions executed
+ *
+ * Execute the BPF program starting at @pc, following both branches of any
+ * conditional jump which depends on an unknown value, e.g. a syscall argument.
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int _cost_walk(struct cost_prg *prg, unsigned int pc,
+		      struct cost_state state,
+		      unsigned int *min, unsigned int *max)
+{
+	int rc;
+	bool taken;
+	unsigned int cnt = 0, pc_start = pc;
+	unsigned int t_min, t_max, f_min, f_max;
+	uint32_t src;
+	const struct sock_filter *ins;
+	struct cost_memo *memo;
+	struct cost_state state_start = state;
+
+	while (pc < prg->blk_cnt) {
+		memo = &prg->memo[pc];
+		if (memo->valid && _COST_STATE_EQ(memo->state, state)) {
+			*min = cnt + memo->min;
+			*max = cnt + memo->max;
+			goto done;
+		}
+
+		ins = &prg->blks[pc];
+		cnt++;
+		switch (BPF_CLASS(ins->code)) {
+		case BPF_LD:
+			if (ins->code == (BPF_LD | BPF_W | BPF_IMM)) {
+				state.a.known = true;
+				state.a.val = ins->k;
+			} else if (ins->code == (BPF_LD | BPF_W | BPF_ABS) &&
+				   ins->k ==
+				   offsetof(struct seccomp_data, nr)) {
+				state.a.known = true;
+				state.a.val = prg->nr;
+			} else if (ins->code == (BPF_LD | BPF_W | BPF_ABS) &&
+				   ins->k ==
+				   offsetof(struct seccomp_data, arch)) {
+				state.a.known = true;
+				state.a.val = prg->arch;
+			} else
+				state.a.known = false;
+			pc++;
+			break;
+		case BPF_LDX:
+			if (ins->code == (BPF_LDX | BPF_W | BPF_IMM)) {
+				state.x.known = true;
+				state.x.val = ins->k;
+			} else
+				state.x.known = false;
+			pc++;
+			break;
+		case BPF_ALU:
+			if (BPF_SRC(ins->code) == BPF_X) {
+				src = state.x.val;
+				if (!state.x.known)
+					state.a.known = false;
+			} else
+				src = ins->k;
+			if (state.a.known)
+				state.a.known = _cost_alu(ins->code,
+							  state.a.val, src,
+							  &state.a.val);
+			pc++;
+			break;
+		case BPF_MISC:
+			if (BPF_MISCOP(ins->code) == BPF_TAX)
+				state.x = state.a;
+			else
+				state.a = state.x;
+			pc++;
+			break;
+		case BPF_RET:
+			*min = cnt;
+			*max = cnt;
+			goto done;
+		case BPF_JMP:
+			if (BPF_OP(ins->code) == BPF_JA) {
+				pc += 1 + ins->k;
+				break;
+			}
+			if (BPF_SRC(ins->code) == BPF_X) {
+				src = state.x.val;
+				if (!state.x.known)
+					goto branch;
+			} else
+				src = ins->k;
+			if (!state.a.known)
+				goto branch;
+			switch (BPF_OP(ins->code)) {
+			case BPF_JEQ:
+				taken = (state.a.val == src);
+				break;
+			case BPF_JGT:
+				taken = (state.a.val > src);
+				break;
+			case BPF_JGE:
+				taken = (state.a.val >= src);
+				break;
+			case BPF_JSET:
+				taken = ((state.a.val & src) != 0);
+				break;
+			default:
+				return -EFAULT;
+			}
+			pc += 1 + (taken ? ins->jt : ins->jf);
+			break;
+branch:
+			/* the outcome depends on an unknown value */
+			rc = _cost_walk(prg, pc + 1 + ins->jt, state,
+					&t_min, &t_max);
+			if (rc < 0)
+				return rc;
+			rc = _cost_walk(prg, pc + 1 + ins->jf, state,
+					&f_min, &f_max);
+			if (rc < 0)
+				return rc;
+			*min = cnt + (t_min < f_min ? t_min : f_min);
+			*max = cnt + (t_max > f_max ? t_max : f_max);
+			goto done;
+		default:
+			/* we don't expect any of the scratch memory ops */
+			return -EFAULT;
+		}
+	}
+
+	/* we ran off the end of the program */
+	return -EFAULT;
+
+done:
+	memo = &prg->memo[pc_start];
+	memo->valid = true;
+	memo->state = state_start;
+	memo->min = *min;
+	memo->max = *max;
+	return 0;
+}
+
+/**
+ * Estimate the runtime cost of a filter collection
+ * @param col the seccomp filter collection
+ * @param cost_ptr the cost estimate
+ *
+ * Generate the BPF program for the filter collection and count the number of
+ * instructions executed for each syscall in each of the architecture filters.
+ * The cost estimate is allocated as a single block and should be released with
+ * free().  Returns zero on success, negative values on failure.
+ *
+ */
+int cost_estimate(struct db_filter_col *col, struct scmp_cost **cost_ptr)
+{
+	int rc;
+	unsigned int iter, pos, entry_cnt = 0;
+	struct bpf_program *prgm = NULL;
+	struct cost_prg prg;
+	struct cost_state state;
+	struct scmp_cost *cost = NULL;
+	struct scmp_cost_entry *entry, *arch_entry;
+	const struct db_filter *filter;
+	const struct db_sys_list *s_iter;
+
+	memset(&prg, 0, sizeof(prg));
+
+	rc = cache_bpf_generate(col, &prgm);
+	if (rc < 0)
+		return rc;
+
+	for (iter = 0; iter < col->filter_cnt; iter++) {
+		entry_cnt++;
+		db_syscall_foreach(s_iter, pos, col->filters[iter]) {
+			if (s_iter->valid)
+				entry_cnt++;
+		}
+	}
+
+	cost = zmalloc(sizeof(*cost) + entry_cnt * sizeof(*cost->entries));
+	prg.blks = zmalloc(prgm->blk_cnt * sizeof(*prg.blks));
+	prg.memo = zmalloc(prgm->blk_cnt * sizeof(*prg.memo));
+	if (cost == NULL || prg.blks == NULL || prg.memo == NULL) {
+		rc = -ENOMEM;
+		goto out;
+	}
+	prg.blk_cnt = prgm->blk_cnt;
+	_cost_decode(prgm, col->endian, prg.blks);
+
+	cost->instr_cnt = prgm->blk_cnt;
+	cost->entries = (struct scmp_cost_entry *)&cost[1];
+	for (iter = 0; iter < col->filter_cnt; iter++) {
+		filter = col->filters[iter];
+		arch_entry = &cost->entries[cost->entry_cnt++];
+		arch_entry->arch = filter->arch->token;
+		arch_entry->syscall = __NR_SCMP_ERROR;
+
+		prg.arch = filter->arch->token_bpf;
+		db_syscall_foreach(s_iter, pos, filter) {
+			if (!s_iter->valid)
+				continue;
+
+			entry = &cost->entries[cost->entry_cnt++];
+			entry->arch = filter->arch->token;
+			entry->syscall = s_iter->num;
+
+			/* the results depend on the syscall number */
+			prg.nr = s_iter->num;
+			memset(prg.memo, 0, prg.blk_cnt * sizeof(*prg.memo));
+			memset(&state, 0, sizeof(state));
+			rc = _cost_walk(&prg, 0, state,
+					&entry->instr_min, &entry->instr_max);
+			if (rc < 0)
+				goto out;
+
+			if (entry == &arch_entry[1] ||
+			    entry->instr_min < arch_entry->instr_min)
+				arch_entry->instr_min = entry->instr_min;
+			if (entry->instr_max > arch_entry->instr_max)
+				arch_entry->instr_max = entry->instr_max;
+		}
+
+		/* architectures without any syscalls don't count */
+		if (arch_entry == &cost->entries[cost->entry_cnt - 1])
+			continue;
+		if (cost->instr_max == 0 ||
+		    arch_entry->instr_min < cost->instr_min)
+			cost->instr_min = arch_entry->instr_min;
+		if (arch_entry->instr_max > cost->instr_max)
+			cost->instr_max = arch_entry->instr_max;
+	}
+
+	*cost_ptr = cost;
+	cost = NULL;
+
+out:
+	if (prg.memo != NULL)
+		free(prg.memo);
+	if (prg.blks != NULL)
+		free(prg.blks);
+	if (cost != NULL)
+		free(cost);
+	gen_bpf_release(prgm);
+	return rc;
+}
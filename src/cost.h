@@ -0,0 +1,32 @@
+/**
+ * Seccomp BPF Program Cost Estimation
+ *
+ * Copyright (c) 2026 The libseccomp Authors
+ * Author: The libseccomp Authors <libseccomp@googlegroups.com>
+ */
+
+/*
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of version 2.1 of the GNU Lesser General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses>.
+ */
+
+
+#ifndef _COST_H
+#define _COST_H
+
+#include <seccomp.h>
+
+#include "db.h"
+
+int cost_estimate(struct db_filter_col *col, struct scmp_cost **cost_ptr);
+
+#endif
@@ -31,10 +31,14 @@
 
 #include "arch.h"
 #include "db.h"
+#include "hash.h"
 #include "system.h"
 #include "helper.h"
 
 /* state values */
+/* argument chain tree node slabs, must be a power of two */
+#define _DB_NODE_SLAB_SIZE		4096
+
 #define _DB_STA_VALID			0xA1B2C3D4
 #define _DB_STA_FREED			0x1A2B3C4D
 
@@ -63,7 +67,144 @@ struct db_iter_state {
 	struct db_sys_list *sx;
 };
 
+/* NOTE: slabs are aligned to their size so a node can find its pool */
+struct db_node_slab {
+	struct db_node_pool *pool;
+	struct db_node_slab *next;
+	struct db_arg_chain_tree nodes[];
+};
+#define _DB_NODE_SLAB_CNT \
+	((_DB_NODE_SLAB_SIZE - sizeof(struct db_node_slab)) / \
+	 sizeof(struct db_arg_chain_tree))
+
+/* map of the tree nodes copied by _db_tree_copy_lvl(), open addressed */
+struct db_node_map {
+	const struct db_arg_chain_tree **src;
+	struct db_arg_chain_tree **dst;
+	unsigned int size;
+	unsigned int cnt;
+};
+
 static unsigned int _db_node_put(struct db_arg_chain_tree **node);
+static int _db_col_rule_add(struct db_filter *filter,
+			    struct db_api_rule_list *rule);
+
+/**
+ * Create a new node pool
+ *
+ * This function creates a new, empty, node pool for a filter; the filter
+ * holds the initial reference to the pool.  Returns a pointer to the pool on
+ * success, NULL on failure.
+ *
+ */
+static struct db_node_pool *_db_pool_new(void)
+{
+	struct db_node_pool *pool;
+
+	pool = zmalloc(sizeof(*pool));
+	if (pool == NULL)
+		return NULL;
+	pool->refcnt = 1;
+
+	return pool;
+}
+
+/**
+ * Release a node pool reference
+ * @param pool the node pool
+ *
+ * This function drops either the owning filter's reference to the pool or the
+ * reference held by a node, and frees all of the slabs in the pool if this
+ * was the last reference.
+ *
+ */
+static void _db_pool_put(struct db_node_pool *pool)
+{
+	struct db_node_slab *slab;
+
+	if (__atomic_sub_fetch(&pool->refcnt, 1, __ATOMIC_ACQ_REL) > 0)
+		return;
+
+	while (pool->slabs != NULL) {
+		slab = pool->slabs;
+		pool->slabs = slab->next;
+		free(slab);
+	}
+	free(pool);
+}
+
+/**
+ * Allocate a new tree node
+ * @param pool the node pool
+ *
+ * This function allocates a new, zeroed, tree node from the given pool,
+ * adding a new slab to the pool if needed.  Nodes from the same filter are
+ * kept close together in memory, and without the per-allocation overhead of
+ * malloc().  Only the filter which owns the pool may allocate from it.
+ * Returns a pointer to the node on success, NULL on failure.
+ *
+ */
+static struct db_arg_chain_tree *_db_node_alloc(struct db_node_pool *pool)
+{
+	unsigned int iter;
+	struct db_node_slab *slab;
+	struct db_arg_chain_tree *node;
+
+	/* reuse the nodes freed since we last ran out */
+	if (pool->free == NULL)
+		pool->free = __atomic_exchange_n(&pool->freed, NULL,
+						 __ATOMIC_ACQUIRE);
+
+	if (pool->free == NULL) {
+		if (posix_memalign((void **)&slab,
+				   _DB_NODE_SLAB_SIZE, _DB_NODE_SLAB_SIZE))
+			return NULL;
+		slab->pool = pool;
+		slab->next = pool->slabs;
+		pool->slabs = slab;
+
+		/* hand out the nodes in address order */
+		for (iter = _DB_NODE_SLAB_CNT; iter > 0; iter--) {
+			slab->nodes[iter - 1].nxt_t = pool->free;
+			pool->free = &slab->nodes[iter - 1];
+		}
+	}
+
+	node = pool->free;
+	pool->free = node->nxt_t;
+	memset(node, 0, sizeof(*node));
+	__atomic_add_fetch(&pool->refcnt, 1, __ATOMIC_RELAXED);
+
+	return node;
+}
+
+/**
+ * Free a tree node
+ * @param node the tree node
+ *
+ * This function returns the node to the pool it was allocated from.  The
+ * trees can be shared between filters, so this may be called by a filter
+ * other than the pool's owner, and from a different thread.
+ *
+ */
+static void _db_node_free(struct db_arg_chain_tree *node)
+{
+	struct db_node_slab *slab;
+	struct db_node_pool *pool;
+
+	slab = (struct db_node_slab *)((uintptr_t)node &
+				       ~((uintptr_t)_DB_NODE_SLAB_SIZE - 1));
+	pool = slab->pool;
+	if (node->op == SCMP_CMP_IN_SET)
+		free(node->set);
+
+	node->nxt_t = __atomic_load_n(&pool->freed, __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(&pool->freed, &node->nxt_t, node,
+					    true, __ATOMIC_RELEASE,
+					    __ATOMIC_RELAXED))
+		;
+	_db_pool_put(pool);
+}
 
 /**
  * Define the syscall argument priority for nodes on the same level of the tree
@@ -97,6 +238,8 @@ static unsigned int __db_chain_op_priority(enum scmp_compare op)
 	case SCMP_CMP_MASKED_EQ:
 	case SCMP_CMP_EQ:
 	case SCMP_CMP_NE:
+	case SCMP_CMP_IN_SET:
+	case SCMP_CMP_IN_RANGE:
 		return 3;
 	case SCMP_CMP_LE:
 	case SCMP_CMP_LT:
@@ -109,6 +252,32 @@ static unsigned int __db_chain_op_priority(enum scmp_compare op)
 	}
 }
 
+/**
+ * Compare the set or range values of two tree nodes
+ * @param a tree node
+ * @param b tree node
+ *
+ * Compare the SCMP_CMP_IN_RANGE upper bounds or the SCMP_CMP_IN_SET values of
+ * two nodes with the same comparison operator.  Returns a negative value,
+ * zero, or a positive value if the values of node "a" are less than, equal
+ * to, or greater than those of node "b".
+ *
+ */
+static int _db_chain_ext_cmp(const struct db_arg_chain_tree *a,
+			     const struct db_arg_chain_tree *b)
+{
+	unsigned int iter;
+
+	if (a->datum_ext != b->datum_ext)
+		return (a->datum_ext < b->datum_ext ? -1 : 1);
+	if (a->op != SCMP_CMP_IN_SET)
+		return 0;
+	for (iter = 0; iter < a->datum_ext; iter++)
+		if (a->set[iter] != b->set[iter])
+			return (a->set[iter] < b->set[iter] ? -1 : 1);
+	return 0;
+}
+
 /**
  * Determine if node "a" is less than node "b"
  * @param a tree node
@@ -155,6 +324,11 @@ static bool _db_chain_lt(const struct db_arg_chain_tree *a,
 		break;
 	}
 
+	/* order the sets and ranges which share their lowest value */
+	if (a->op == b->op && a->datum == b->datum &&
+	    (a->op == SCMP_CMP_IN_SET || a->op == SCMP_CMP_IN_RANGE))
+		return (_db_chain_ext_cmp(a, b) < 0);
+
 	return false;
 }
 
@@ -164,7 +338,7 @@ static bool _db_chain_lt(const struct db_arg_chain_tree *a,
  * @param b tree node
  *
  * In order to return true the nodes must have the same datum and mask for the
- * same argument.
+ * same argument, as well as the same set or range values.
  *
  */
 static bool _db_chain_eq(const struct db_arg_chain_tree *a,
@@ -176,7 +350,8 @@ static bool _db_chain_eq(const struct db_arg_chain_tree *a,
 	b_arg = __db_chain_arg_priority(b);
 
 	return ((a_arg == b_arg) && (a->op == b->op) &&
-		(a->datum == b->datum) && (a->mask == b->mask));
+		(a->datum == b->datum) && (a->mask == b->mask) &&
+		(_db_chain_ext_cmp(a, b) == 0));
 }
 
 /**
@@ -204,6 +379,123 @@ static bool _db_chain_zombie(const struct db_arg_chain_tree *iter)
 		!(iter->act_t_flg) && !(iter->act_f_flg));
 }
 
+/**
+ * Generate a structural hash of a tree level
+ * @param lvl a node on the tree level
+ *
+ * Generate a hash value of the tree level, and the levels beneath it, using
+ * the node fields which determine the generated filter code.  Structurally
+ * equal tree levels have the same hash value.
+ *
+ */
+static uint32_t _db_chain_hash(const struct db_arg_chain_tree *lvl)
+{
+	struct {
+		uint32_t h_lvl;
+		uint32_t h_t, h_f;
+		uint32_t mask, datum, datum_ext;
+		uint32_t act_t, act_f;
+		uint16_t arg_offset;
+		uint8_t op;
+		uint8_t flags;
+	} h_data;
+
+	if (lvl == NULL)
+		return 0;
+	while (lvl->lvl_prv != NULL)
+		lvl = lvl->lvl_prv;
+
+	memset(&h_data, 0, sizeof(h_data));
+	do {
+		h_data.h_t = _db_chain_hash(lvl->nxt_t);
+		h_data.h_f = _db_chain_hash(lvl->nxt_f);
+		h_data.mask = lvl->mask;
+		h_data.datum = lvl->datum;
+		h_data.datum_ext = lvl->datum_ext;
+		h_data.act_t = (lvl->act_t_flg ? lvl->act_t : 0);
+		h_data.act_f = (lvl->act_f_flg ? lvl->act_f : 0);
+		h_data.arg_offset = lvl->arg_offset;
+		h_data.op = lvl->op;
+		h_data.flags = (lvl->act_t_flg ? 1 : 0) |
+			       (lvl->act_f_flg ? 2 : 0);
+		h_data.h_lvl = hash(&h_data, sizeof(h_data));
+
+		lvl = lvl->lvl_nxt;
+	} while (lvl != NULL);
+
+	return h_data.h_lvl;
+}
+
+/**
+ * Determine if two tree levels are structurally equal
+ * @param a a node on the first tree level
+ * @param b a node on the second tree level
+ *
+ * Compare the two tree levels, and the levels beneath them, using the node
+ * fields which determine the generated filter code.
+ *
+ */
+static bool _db_chain_lvl_eq(const struct db_arg_chain_tree *a,
+			     const struct db_arg_chain_tree *b)
+{
+	if (a == NULL || b == NULL)
+		return (a == b);
+	while (a->lvl_prv != NULL)
+		a = a->lvl_prv;
+	while (b->lvl_prv != NULL)
+		b = b->lvl_prv;
+
+	while (a != NULL && b != NULL) {
+		if (a == b)
+			/* shared nodes, the rest of the level is equal */
+			return true;
+		if (a->arg_offset != b->arg_offset || a->op != b->op ||
+		    a->mask != b->mask || a->datum != b->datum ||
+		    _db_chain_ext_cmp(a, b) != 0 ||
+		    a->act_t_flg != b->act_t_flg ||
+		    a->act_f_flg != b->act_f_flg ||
+		    (a->act_t_flg && a->act_t != b->act_t) ||
+		    (a->act_f_flg && a->act_f != b->act_f))
+			return false;
+		if (!_db_chain_lvl_eq(a->nxt_t, b->nxt_t) ||
+		    !_db_chain_lvl_eq(a->nxt_f, b->nxt_f))
+			return false;
+
+		a = a->lvl_nxt;
+		b = b->lvl_nxt;
+	}
+
+	return (a == b);
+}
+
+/**
+ * Generate a structural hash of an argument chain tree
+ * @param chains the argument chain tree
+ *
+ * Return a hash value of the argument chain tree, structurally equal trees
+ * have the same hash value, see db_chain_lvl_eq().
+ *
+ */
+uint32_t db_chain_hash(const struct db_arg_chain_tree *chains)
+{
+	return _db_chain_hash(chains);
+}
+
+/**
+ * Determine if two argument chain levels are structurally equal
+ * @param a the first argument chain level
+ * @param b the second argument chain level
+ *
+ * Returns true if both argument chain levels, including all of the nodes below
+ * them, generate the same filter code, false otherwise.
+ *
+ */
+bool db_chain_lvl_eq(const struct db_arg_chain_tree *a,
+		     const struct db_arg_chain_tree *b)
+{
+	return _db_chain_lvl_eq(a, b);
+}
+
 /**
  * Get a node reference
  * @param node pointer to a node
@@ -334,7 +626,7 @@ static unsigned int _db_node_put(struct db_arg_chain_tree **node)
 		cnt += _db_tree_put(&nxt_f);
 
 		/* cleanup and accounting */
-		free(n);
+		_db_node_free(n);
 		cnt++;
 	}
 
@@ -405,6 +697,63 @@ remove:
 	return cnt;
 }
 
+/**
+ * Remove a node from a level of an argument chain tree
+ * @param tree the pointer to the tree
+ * @param node the node to remove
+ *
+ * This function unlinks the node from its level, handing the node's level
+ * links and, if needed, the tree pointer over to its neighbors, and then drops
+ * the node along with any sub-trees beneath it.  Returns the number of nodes
+ * freed.
+ *
+ */
+static unsigned int _db_tree_lvl_remove(struct db_arg_chain_tree **tree,
+					struct db_arg_chain_tree *node)
+{
+	unsigned int rc, cnt = 0;
+	unsigned int refs = 0;
+	struct db_arg_chain_tree *lvl_p = node->lvl_prv;
+	struct db_arg_chain_tree *lvl_n = node->lvl_nxt;
+	struct db_arg_chain_tree *n_tmp;
+
+	/* move the tree pointer off of the node */
+	if (*tree == node) {
+		*tree = _db_node_get(lvl_p != NULL ? lvl_p : lvl_n);
+		refs++;
+	}
+
+	/* link the neighbors together */
+	if (lvl_p != NULL) {
+		lvl_p->lvl_nxt = _db_node_get(lvl_n);
+		refs++;
+	}
+	if (lvl_n != NULL) {
+		lvl_n->lvl_prv = _db_node_get(lvl_p);
+		refs++;
+	}
+
+	/* drop the node's references to its neighbors */
+	node->lvl_prv = NULL;
+	node->lvl_nxt = NULL;
+	if (lvl_p != NULL)
+		cnt += _db_node_put(&lvl_p);
+	if (lvl_n != NULL)
+		cnt += _db_node_put(&lvl_n);
+
+	/* drop the references to the node and free it */
+	/* NOTE: the node is unlinked so a non-zero count means it is gone */
+	while (refs-- > 0) {
+		n_tmp = node;
+		rc = _db_node_put(&n_tmp);
+		cnt += rc;
+		if (rc > 0)
+			break;
+	}
+
+	return cnt;
+}
+
 /**
  * Traverse a tree checking the action values
  * @param tree the pointer to the tree
@@ -815,890 +1164,2039 @@ static int _db_tree_add(struct db_arg_chain_tree **existing,
 }
 
 /**
- * Free and reset the seccomp filter DB
- * @param db the seccomp filter DB
+ * Find the copy of a tree node
+ * @param map the tree node map
+ * @param node the original tree node
  *
- * This function frees any existing filters and resets the filter DB to a
- * default state; only the DB architecture is preserved.
+ * Returns a pointer to the copy of @node, NULL if @node has not been copied.
  *
  */
-static void _db_reset(struct db_filter *db)
+static struct db_arg_chain_tree *_db_node_map_find(
+				const struct db_node_map *map,
+				const struct db_arg_chain_tree *node)
 {
-	struct db_sys_list *s_iter;
-	struct db_api_rule_list *r_iter;
+	unsigned int iter;
 
-	if (db == NULL)
-		return;
+	if (map->size == 0)
+		return NULL;
 
-	/* free any filters */
-	if (db->syscalls != NULL) {
-		s_iter = db->syscalls;
-		while (s_iter != NULL) {
-			db->syscalls = s_iter->next;
-			_db_tree_put(&s_iter->chains);
-			free(s_iter);
-			s_iter = db->syscalls;
-		}
-		db->syscalls = NULL;
+	iter = hash(&node, sizeof(node)) & (map->size - 1);
+	while (map->src[iter] != NULL) {
+		if (map->src[iter] == node)
+			return map->dst[iter];
+		iter = (iter + 1) & (map->size - 1);
 	}
-	db->syscall_cnt = 0;
 
-	/* free any rules */
-	if (db->rules != NULL) {
-		/* split the loop first then loop and free */
-		db->rules->prev->next = NULL;
-		r_iter = db->rules;
-		while (r_iter != NULL) {
-			db->rules = r_iter->next;
-			free(r_iter);
-			r_iter = db->rules;
+	return NULL;
+}
+
+/**
+ * Add a tree node and its copy to the tree node map
+ * @param map the tree node map
+ * @param node the original tree node
+ * @param copy the copy of the tree node
+ *
+ * This function records @copy as the copy of @node, growing the map if
+ * needed.  Returns zero on success, negative values on failure.
+ *
+ */
+static int _db_node_map_add(struct db_node_map *map,
+			    const struct db_arg_chain_tree *node,
+			    struct db_arg_chain_tree *copy)
+{
+	unsigned int iter, size;
+	struct db_node_map map_new;
+
+	if ((map->cnt + 1) * 2 > map->size) {
+		size = (map->size == 0 ? 64 : map->size * 2);
+		map_new.src = zmalloc(sizeof(*map_new.src) * size);
+		map_new.dst = zmalloc(sizeof(*map_new.dst) * size);
+		if (map_new.src == NULL || map_new.dst == NULL) {
+			free(map_new.src);
+			free(map_new.dst);
+			return -ENOMEM;
+		}
+		map_new.size = size;
+		map_new.cnt = 0;
+		for (iter = 0; iter < map->size; iter++) {
+			if (map->src[iter] != NULL)
+				_db_node_map_add(&map_new, map->src[iter],
+						 map->dst[iter]);
 		}
-		db->rules = NULL;
+		free(map->src);
+		free(map->dst);
+		*map = map_new;
 	}
+
+	iter = hash(&node, sizeof(node)) & (map->size - 1);
+	while (map->src[iter] != NULL)
+		iter = (iter + 1) & (map->size - 1);
+	map->src[iter] = node;
+	map->dst[iter] = copy;
+	map->cnt++;
+
+	return 0;
 }
 
 /**
- * Intitalize a seccomp filter DB
- * @param arch the architecture definition
+ * Copy a level of an argument chain tree
+ * @param pool the node pool for the copy
+ * @param map the tree nodes copied so far
+ * @param node a node on the level
  *
- * This function initializes a seccomp filter DB and readies it for use.
- * Returns a pointer to the DB on success, NULL on failure.
+ * This function copies the level on which @node resides and everything
+ * beneath it.  The sub-trees which are shared by several nodes are only
+ * copied once, so the copy has the same shape as the original and the node
+ * reference counts carry over unchanged.  The original tree is not modified.
+ * Returns a pointer to the copy of @node on success, NULL on failure; in
+ * either case the nodes copied so far are recorded in @map.
  *
  */
-static struct db_filter *_db_init(const struct arch_def *arch)
+static struct db_arg_chain_tree *_db_tree_copy_lvl(
+				struct db_node_pool *pool,
+				struct db_node_map *map,
+				const struct db_arg_chain_tree *node)
 {
-	struct db_filter *db;
+	const struct db_arg_chain_tree *n_iter;
+	struct db_arg_chain_tree *c_iter, *c_prev = NULL;
 
-	db = zmalloc(sizeof(*db));
-	if (db == NULL)
-		return NULL;
+	/* the level may be shared with another part of the tree */
+	c_iter = _db_node_map_find(map, node);
+	if (c_iter != NULL)
+		return c_iter;
 
-	/* set the arch and reset the DB to a known state */
-	db->arch = arch;
-	_db_reset(db);
+	n_iter = node;
+	while (n_iter->lvl_prv != NULL)
+		n_iter = n_iter->lvl_prv;
 
-	return db;
+	/* copy the nodes on this level */
+	for (; n_iter != NULL; n_iter = n_iter->lvl_nxt) {
+		c_iter = _db_node_alloc(pool);
+		if (c_iter == NULL)
+			return NULL;
+		*c_iter = *n_iter;
+		c_iter->lvl_prv = c_prev;
+		c_iter->lvl_nxt = NULL;
+		c_iter->nxt_t = NULL;
+		c_iter->nxt_f = NULL;
+		if (n_iter->op == SCMP_CMP_IN_SET) {
+			c_iter->set = malloc(sizeof(*c_iter->set) *
+					     n_iter->datum_ext);
+			if (c_iter->set != NULL)
+				memcpy(c_iter->set, n_iter->set,
+				       sizeof(*c_iter->set) *
+				       n_iter->datum_ext);
+		}
+		if (_db_node_map_add(map, n_iter, c_iter) < 0) {
+			_db_node_free(c_iter);
+			return NULL;
+		}
+		if (n_iter->op == SCMP_CMP_IN_SET && c_iter->set == NULL)
+			return NULL;
+		if (c_prev != NULL)
+			c_prev->lvl_nxt = c_iter;
+		c_prev = c_iter;
+	}
+
+	/* copy the levels beneath this one */
+	n_iter = node;
+	while (n_iter->lvl_prv != NULL)
+		n_iter = n_iter->lvl_prv;
+	for (; n_iter != NULL; n_iter = n_iter->lvl_nxt) {
+		c_iter = _db_node_map_find(map, n_iter);
+		if (n_iter->nxt_t != NULL) {
+			c_iter->nxt_t = _db_tree_copy_lvl(pool, map,
+							  n_iter->nxt_t);
+			if (c_iter->nxt_t == NULL)
+				return NULL;
+		}
+		if (n_iter->nxt_f != NULL) {
+			c_iter->nxt_f = _db_tree_copy_lvl(pool, map,
+							  n_iter->nxt_f);
+			if (c_iter->nxt_f == NULL)
+				return NULL;
+		}
+	}
+
+	return _db_node_map_find(map, node);
 }
 
 /**
- * Destroy a seccomp filter DB
- * @param db the seccomp filter DB
+ * Get a reference to a syscall entry
+ * @param sys the syscall entry
  *
- * This function destroys a seccomp filter DB.  After calling this function,
- * the filter should no longer be referenced.
+ * This function gets a reference to a syscall entry so that it can be shared
+ * with another filter.  Returns a pointer to the syscall entry.
  *
  */
-static void _db_release(struct db_filter *db)
+static struct db_sys_list *_db_sys_get(struct db_sys_list *sys)
 {
-	if (db == NULL)
-		return;
-
-	/* free and reset the DB */
-	_db_reset(db);
-	free(db);
+	__atomic_add_fetch(&sys->refcnt, 1, __ATOMIC_RELAXED);
+	return sys;
 }
 
 /**
- * Destroy a seccomp filter snapshot
- * @param snap the seccomp filter snapshot
+ * Release a syscall entry reference
+ * @param sys the syscall entry
  *
- * This function destroys a seccomp filter snapshot.  After calling this
- * function, the snapshot should no longer be referenced.
+ * This function drops a reference to the syscall entry and frees it, along
+ * with its argument chain tree, if this was the last reference.
  *
  */
-static void _db_snap_release(struct db_filter_snap *snap)
+static void _db_sys_put(struct db_sys_list *sys)
 {
-	unsigned int iter;
-
-	if (snap == NULL)
+	if (__atomic_sub_fetch(&sys->refcnt, 1, __ATOMIC_ACQ_REL) > 0)
 		return;
 
-	if (snap->filter_cnt > 0) {
-		for (iter = 0; iter < snap->filter_cnt; iter++) {
-			if (snap->filters[iter])
-				_db_release(snap->filters[iter]);
-		}
-		free(snap->filters);
-	}
-	free(snap);
+	_db_tree_put(&sys->chains);
+	free(sys);
 }
 
 /**
- * Update the user specified portion of the syscall priority
- * @param db the seccomp filter db
- * @param syscall the syscall number
- * @param priority the syscall priority
+ * Copy a syscall entry
+ * @param db the seccomp filter DB
+ * @param sys the syscall entry
  *
- * This function sets, or updates, the syscall priority; the highest priority
- * value between the existing and specified value becomes the new syscall
- * priority.  If the syscall entry does not already exist, a new phantom
- * syscall entry is created as a placeholder.  Returns zero on success,
- * negative values on failure.
+ * This function makes a private copy of the syscall entry, including its
+ * argument chain tree, using the node pool of the given filter DB.  Returns
+ * a pointer to the new syscall entry on success, NULL on failure.
  *
  */
-static int _db_syscall_priority(struct db_filter *db,
-				int syscall, uint8_t priority)
+static struct db_sys_list *_db_sys_copy(struct db_filter *db,
+					const struct db_sys_list *sys)
 {
-	unsigned int sys_pri = _DB_PRI_USER(priority);
-	struct db_sys_list *s_new, *s_iter, *s_prev = NULL;
-
-	assert(db != NULL);
-
-	s_iter = db->syscalls;
-	while (s_iter != NULL && s_iter->num < syscall) {
-		s_prev = s_iter;
-		s_iter = s_iter->next;
-	}
-
-	/* matched an existing syscall entry */
-	if (s_iter != NULL && s_iter->num == syscall) {
-		if (sys_pri > (s_iter->priority & _DB_PRI_MASK_USER)) {
-			s_iter->priority &= (~_DB_PRI_MASK_USER);
-			s_iter->priority |= sys_pri;
-		}
-		return 0;
-	}
+	unsigned int iter;
+	struct db_sys_list *s_new;
+	struct db_node_map map;
 
-	/* no existing syscall entry - create a phantom entry */
 	s_new = zmalloc(sizeof(*s_new));
 	if (s_new == NULL)
-		return -ENOMEM;
-	s_new->num = syscall;
-	s_new->priority = sys_pri;
-	s_new->valid = false;
-
-	/* add it before s_iter */
-	if (s_prev != NULL) {
-		s_new->next = s_prev->next;
-		s_prev->next = s_new;
-	} else {
-		s_new->next = db->syscalls;
-		db->syscalls = s_new;
+		return NULL;
+	/* NOTE: the source entry is shared, so leave its refcnt alone */
+	s_new->num = sys->num;
+	s_new->refcnt = 1;
+	s_new->priority = sys->priority;
+	s_new->weight = sys->weight;
+	s_new->chains = sys->chains;
+	s_new->node_cnt = sys->node_cnt;
+	s_new->action = sys->action;
+	s_new->valid = sys->valid;
+	if (sys->chains == NULL)
+		return s_new;
+
+	memset(&map, 0, sizeof(map));
+	s_new->chains = _db_tree_copy_lvl(db->node_pool, &map, sys->chains);
+	if (s_new->chains == NULL) {
+		/* the partial copy isn't a proper tree, free the nodes */
+		for (iter = 0; iter < map.size; iter++) {
+			if (map.dst[iter] != NULL)
+				_db_node_free(map.dst[iter]);
+		}
+		free(s_new);
+		s_new = NULL;
 	}
+	free(map.src);
+	free(map.dst);
 
-	return 0;
+	return s_new;
 }
 
 /**
- * Create a new rule
- * @param strict the strict value
- * @param action the rule's action
- * @param syscall the syscall number
- * @param chain the syscall argument filter
+ * Get a private syscall entry
+ * @param db the seccomp filter DB
+ * @param pos the syscall index position
  *
- * This function creates a new rule structure based on the given arguments.
- * Returns a pointer to the new rule on success, NULL on failure.
+ * This function makes sure the syscall entry at the given position in the
+ * syscall index can be modified, replacing it with a private copy if it is
+ * shared with another filter.  Only the modified syscall entries are ever
+ * copied.  Returns a pointer to the syscall entry on success, NULL on
+ * failure.
  *
  */
-static struct db_api_rule_list *_db_rule_new(bool strict,
-					     uint32_t action, int syscall,
-					     struct db_api_arg *chain)
+static struct db_sys_list *_db_sys_own(struct db_filter *db, unsigned int pos)
 {
-	struct db_api_rule_list *rule;
+	struct db_sys_list *s_iter = db->sys_idx[pos];
+	struct db_sys_list *s_new;
 
-	rule = zmalloc(sizeof(*rule));
-	if (rule == NULL)
+	/* NOTE: only the filters using the entry can share it further */
+	if (__atomic_load_n(&s_iter->refcnt, __ATOMIC_ACQUIRE) == 1)
+		return s_iter;
+
+	s_new = _db_sys_copy(db, s_iter);
+	if (s_new == NULL)
 		return NULL;
-	rule->action = action;
-	rule->syscall = syscall;
-	rule->strict = strict;
-	memcpy(rule->args, chain, sizeof(*chain) * ARG_COUNT_MAX);
+	db->sys_idx[pos] = s_new;
+	_db_sys_put(s_iter);
 
-	return rule;
+	return s_new;
 }
 
 /**
- * Duplicate an existing filter rule
- * @param src the rule to duplicate
+ * Get a reference to a filter rule
+ * @param rule the filter rule
  *
- * This function makes an exact copy of the given rule, but does not add it
- * to any lists.  Returns a pointer to the new rule on success, NULL on
- * failure.
+ * Returns a pointer to the filter rule.
  *
  */
-struct db_api_rule_list *db_rule_dup(const struct db_api_rule_list *src)
+static struct db_api_rule_list *_db_rule_get(struct db_api_rule_list *rule)
 {
-	struct db_api_rule_list *dest;
+	__atomic_add_fetch(&rule->refcnt, 1, __ATOMIC_RELAXED);
+	return rule;
+}
 
-	dest = malloc(sizeof(*dest));
-	if (dest == NULL)
-		return NULL;
-	memcpy(dest, src, sizeof(*dest));
-	dest->prev = NULL;
-	dest->next = NULL;
+/**
+ * Release a filter rule reference
+ * @param rule the filter rule
+ *
+ * This function drops a reference to the rule and frees it if this was the
+ * last reference.
+ *
+ */
+static void _db_rule_put(struct db_api_rule_list *rule)
+{
+	if (rule == NULL)
+		return;
 
-	return dest;
+	if (__atomic_sub_fetch(&rule->refcnt, 1, __ATOMIC_ACQ_REL) > 0)
+		return;
+	free(rule);
 }
 
 /**
- * Free and reset the seccomp filter collection
- * @param col the seccomp filter collection
- * @param def_action the default filter action
+ * Release a rule vector reference
+ * @param vec the rule vector
  *
- * This function frees any existing filter DBs and resets the collection to a
- * default state.  In the case of failure the filter collection may be in an
- * unknown state and should be released.  Returns zero on success, negative
- * values on failure.
+ * This function drops a reference to the rule vector and frees it, along with
+ * its references to the rules, if this was the last reference.
  *
  */
-int db_col_reset(struct db_filter_col *col, uint32_t def_action)
+static void _db_rule_vec_put(struct db_rule_vec *vec)
 {
 	unsigned int iter;
-	struct db_filter *db;
-	struct db_filter_snap *snap;
-
-	if (col == NULL)
-		return -EINVAL;
-
-	/* free any filters */
-	for (iter = 0; iter < col->filter_cnt; iter++)
-		_db_release(col->filters[iter]);
-	col->filter_cnt = 0;
-	if (col->filters)
-		free(col->filters);
-	col->filters = NULL;
-	col->notify_fd = -1;
 
-	/* set the endianess to undefined */
-	col->endian = 0;
+	if (vec == NULL)
+		return;
 
-	/* set the default attribute values */
-	col->attr.act_default = def_action;
-	col->attr.act_badarch = SCMP_ACT_KILL;
-	col->attr.nnp_enable = 1;
-	col->attr.tsync_enable = 0;
-	col->attr.api_tskip = 0;
-	col->attr.log_enable = 0;
-	col->attr.spec_allow = 0;
-	col->attr.optimize = 1;
-	col->attr.api_sysrawrc = 0;
+	if (__atomic_sub_fetch(&vec->refcnt, 1, __ATOMIC_ACQ_REL) > 0)
+		return;
 
-	/* set the state */
-	col->state = _DB_STA_VALID;
-	if (def_action == SCMP_ACT_NOTIFY)
-		col->notify_used = true;
-	else
-		col->notify_used = false;
+	/* NOTE: slots which were claimed but never used are empty */
+	for (iter = 0; iter < vec->cnt; iter++)
+		_db_rule_put(vec->rules[iter]);
+	free(vec);
+}
 
-	/* reset the initial db */
-	db = _db_init(arch_def_native);
-	if (db == NULL)
-		return -ENOMEM;
-	if (db_col_db_add(col, db) < 0) {
-		_db_release(db);
+/**
+ * Copy the rules of the seccomp filter DB to a new rule vector
+ * @param db the seccomp filter DB
+ * @param skip the position of a rule to leave out, or the rule count
+ * @param cnt the number of empty slots to claim at the end of the vector
+ *
+ * This function replaces the DB's rule vector with a private copy, leaving
+ * out the rule at position @skip.  Returns zero on success, negative values
+ * on failure.
+ *
+ */
+static int _db_rule_vec_copy(struct db_filter *db,
+			     unsigned int skip, unsigned int cnt)
+{
+	unsigned int iter, r_cnt = 0, size;
+	struct db_rule_vec *vec;
+
+	size = (db->rule_cnt + cnt) * 2;
+	if (size < 16)
+		size = 16;
+	vec = malloc(sizeof(*vec) + sizeof(*vec->rules) * size);
+	if (vec == NULL)
 		return -ENOMEM;
-	}
+	vec->refcnt = 1;
+	vec->size = size;
 
-	/* reset the transactions */
-	while (col->snapshots) {
-		snap = col->snapshots;
-		col->snapshots = snap->next;
-		for (iter = 0; iter < snap->filter_cnt; iter++)
-			_db_release(snap->filters[iter]);
-		free(snap->filters);
-		free(snap);
+	for (iter = 0; iter < db->rule_cnt; iter++) {
+		if (iter != skip)
+			vec->rules[r_cnt++] =
+				_db_rule_get(db->rules->rules[iter]);
 	}
+	db->rule_cnt = r_cnt;
+	for (iter = 0; iter < cnt; iter++)
+		vec->rules[r_cnt++] = NULL;
+	vec->cnt = r_cnt;
+
+	_db_rule_vec_put(db->rules);
+	db->rules = vec;
 
 	return 0;
 }
 
 /**
- * Intitalize a seccomp filter collection
- * @param def_action the default filter action
+ * Trim the rule vector of the seccomp filter DB
+ * @param db the seccomp filter DB
  *
- * This function initializes a seccomp filter collection and readies it for
- * use.  Returns a pointer to the collection on success, NULL on failure.
+ * This function drops the rules past the end of the DB's rule list, which
+ * were added by other filters that have since released the rule vector.  The
+ * rule vector must not be shared.
  *
  */
-struct db_filter_col *db_col_init(uint32_t def_action)
+static void _db_rule_vec_trim(struct db_filter *db)
 {
-	struct db_filter_col *col;
+	struct db_rule_vec *vec = db->rules;
 
-	col = zmalloc(sizeof(*col));
-	if (col == NULL)
-		return NULL;
+	while (vec->cnt > db->rule_cnt)
+		_db_rule_put(vec->rules[--vec->cnt]);
+}
 
-	/* reset the DB to a known state */
-	if (db_col_reset(col, def_action) < 0)
-		goto init_failure;
+/**
+ * Make room for new rules in the seccomp filter DB
+ * @param db the seccomp filter DB
+ * @param cnt the number of new rules
+ *
+ * This function claims @cnt empty slots at the end of the DB's rule list so
+ * that the new rules can be added with _db_rule_vec_append() without failing.
+ * The rule vector is shared between filters with a common rule history, each
+ * filter using the start of the vector, so a filter may claim slots in a
+ * shared vector as long as no other filter has added rules to the vector;
+ * otherwise the rules are copied to a new vector.  Returns zero on success,
+ * negative values on failure.
+ *
+ */
+static int _db_rule_vec_reserve(struct db_filter *db, unsigned int cnt)
+{
+	unsigned int iter, used, size;
+	struct db_rule_vec *vec = db->rules;
+
+	if (vec == NULL)
+		return _db_rule_vec_copy(db, db->rule_cnt, cnt);
+
+	if (__atomic_load_n(&vec->refcnt, __ATOMIC_ACQUIRE) == 1) {
+		_db_rule_vec_trim(db);
+		if (vec->cnt + cnt > vec->size) {
+			size = (vec->cnt + cnt) * 2;
+			vec = realloc(vec,
+				      sizeof(*vec) + sizeof(*vec->rules) * size);
+			if (vec == NULL)
+				return -ENOMEM;
+			vec->size = size;
+			db->rules = vec;
+		}
+		for (iter = 0; iter < cnt; iter++)
+			vec->rules[vec->cnt++] = NULL;
+		return 0;
+	}
 
-	return col;
+	used = db->rule_cnt;
+	if (used + cnt <= vec->size &&
+	    __atomic_compare_exchange_n(&vec->cnt, &used, used + cnt, false,
+					__ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+		for (iter = 0; iter < cnt; iter++)
+			vec->rules[db->rule_cnt + iter] = NULL;
+		return 0;
+	}
 
-init_failure:
-	db_col_release(col);
-	return NULL;
+	return _db_rule_vec_copy(db, db->rule_cnt, cnt);
 }
 
 /**
- * Destroy a seccomp filter collection
- * @param col the seccomp filter collection
+ * Add a rule to the end of the seccomp filter DB's rule list
+ * @param db the seccomp filter DB
+ * @param rule the filter rule
  *
- * This function destroys a seccomp filter collection.  After calling this
- * function, the filter should no longer be referenced.
+ * This function stores the rule in a slot claimed by _db_rule_vec_reserve(),
+ * the DB takes over the caller's reference to the rule.
  *
  */
-void db_col_release(struct db_filter_col *col)
+static void _db_rule_vec_append(struct db_filter *db,
+				struct db_api_rule_list *rule)
 {
-	unsigned int iter;
-	struct db_filter_snap *snap;
-
-	if (col == NULL)
-		return;
+	db->rules->rules[db->rule_cnt++] = rule;
+}
 
-	/* set the state, just in case */
-	col->state = _DB_STA_FREED;
+/**
+ * Remove a rule from the seccomp filter DB's rule list
+ * @param db the seccomp filter DB
+ * @param pos the rule position
+ *
+ * This function removes the rule at the given position from the DB's rule
+ * list, the rule vector is copied first if it is shared with another filter.
+ * The caller must hold its own reference if the rule is still needed.
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int _db_rule_vec_remove(struct db_filter *db, unsigned int pos)
+{
+	struct db_rule_vec *vec = db->rules;
 
-	/* free any snapshots */
-	while (col->snapshots != NULL) {
-		snap = col->snapshots;
-		col->snapshots = snap->next;
-		_db_snap_release(snap);
-	}
+	if (__atomic_load_n(&vec->refcnt, __ATOMIC_ACQUIRE) > 1)
+		return _db_rule_vec_copy(db, pos, 0);
 
-	/* free any filters */
-	for (iter = 0; iter < col->filter_cnt; iter++)
-		_db_release(col->filters[iter]);
-	col->filter_cnt = 0;
-	if (col->filters)
-		free(col->filters);
-	col->filters = NULL;
+	_db_rule_vec_trim(db);
+	_db_rule_put(vec->rules[pos]);
+	memmove(&vec->rules[pos], &vec->rules[pos + 1],
+		sizeof(*vec->rules) * (db->rule_cnt - pos - 1));
+	vec->cnt--;
+	db->rule_cnt--;
 
-	/* free the collection */
-	free(col);
+	return 0;
 }
 
 /**
- * Validate a filter collection
- * @param col the seccomp filter collection
+ * Free the syscall filters in the seccomp filter DB
+ * @param db the seccomp filter DB
  *
- * This function validates a seccomp filter collection.  Returns zero if the
- * collection is valid, negative values on failure.
+ * This function frees the syscall filters, but not the rules used to build
+ * them.
  *
  */
-int db_col_valid(struct db_filter_col *col)
+static void _db_syscalls_free(struct db_filter *db)
 {
-	if (col != NULL && col->state == _DB_STA_VALID && col->filter_cnt > 0)
-		return 0;
-	return -EINVAL;
+	unsigned int iter;
+
+	for (iter = 0; iter < db->sys_idx_cnt; iter++)
+		_db_sys_put(db->sys_idx[iter]);
+	db->syscall_cnt = 0;
+	free(db->sys_idx);
+	db->sys_idx = NULL;
+	db->sys_idx_cnt = 0;
+	db->sys_idx_size = 0;
 }
 
 /**
- * Validate the seccomp action
- * @param col the seccomp filter collection
- * @param action the seccomp action
+ * Free and reset the seccomp filter DB
+ * @param db the seccomp filter DB
+ *
+ * This function frees any existing filters and resets the filter DB to a
+ * default state; only the DB architecture and node pool are preserved.
  *
- * Verify that the given action is a valid seccomp action; return zero if
- * valid, -EINVAL if invalid.
  */
-int db_col_action_valid(const struct db_filter_col *col, uint32_t action)
+static void _db_reset(struct db_filter *db)
 {
-	if (col != NULL) {
-		/* NOTE: in some cases we don't have a filter collection yet,
-		 *       but when we do we need to do the following checks */
+	if (db == NULL)
+		return;
 
-		/* kernel disallows TSYNC and NOTIFY in one filter unless we
-		 * have the TSYNC_ESRCH flag */
-		if (sys_chk_seccomp_flag(SECCOMP_FILTER_FLAG_TSYNC_ESRCH) < 1 &&
-		    col->attr.tsync_enable && action == SCMP_ACT_NOTIFY)
-			return -EINVAL;
-	}
+	/* free any filters */
+	_db_syscalls_free(db);
 
-	if (sys_chk_seccomp_action(action) == 1)
-		return 0;
-	return -EINVAL;
+	/* free any rules */
+	_db_rule_vec_put(db->rules);
+	db->rules = NULL;
+	db->rule_cnt = 0;
 }
 
 /**
- * Merge two filter collections
- * @param col_dst the destination filter collection
- * @param col_src the source filter collection
+ * Intitalize a seccomp filter DB
+ * @param arch the architecture definition
  *
- * This function merges two filter collections into the given destination
- * collection.  The source filter collection is no longer valid if the function
- * returns successfully.  Returns zero on success, negative values on failure.
+ * This function initializes a seccomp filter DB and readies it for use.
+ * Returns a pointer to the DB on success, NULL on failure.
  *
  */
-int db_col_merge(struct db_filter_col *col_dst, struct db_filter_col *col_src)
+static struct db_filter *_db_init(const struct arch_def *arch)
 {
-	unsigned int iter_a, iter_b;
-	struct db_filter **dbs;
-
-	/* verify that the endianess is a match */
-	if (col_dst->endian != col_src->endian)
-		return -EDOM;
-
-	/* make sure we don't have any arch/filter collisions */
-	for (iter_a = 0; iter_a < col_dst->filter_cnt; iter_a++) {
-		for (iter_b = 0; iter_b < col_src->filter_cnt; iter_b++) {
-			if (col_dst->filters[iter_a]->arch->token ==
-			    col_src->filters[iter_b]->arch->token)
-				return -EEXIST;
-		}
-	}
-
-	/* expand the destination */
-	dbs = realloc(col_dst->filters,
-		      sizeof(struct db_filter *) *
-		      (col_dst->filter_cnt + col_src->filter_cnt));
-	if (dbs == NULL)
-		return -ENOMEM;
-	col_dst->filters = dbs;
+	struct db_filter *db;
 
-	/* transfer the architecture filters */
-	for (iter_a = col_dst->filter_cnt, iter_b = 0;
-	     iter_b < col_src->filter_cnt; iter_a++, iter_b++) {
-		col_dst->filters[iter_a] = col_src->filters[iter_b];
-		col_dst->filter_cnt++;
+	db = zmalloc(sizeof(*db));
+	if (db == NULL)
+		return NULL;
+	db->node_pool = _db_pool_new();
+	if (db->node_pool == NULL) {
+		free(db);
+		return NULL;
 	}
 
-	/* free the source */
-	col_src->filter_cnt = 0;
-	db_col_release(col_src);
+	/* set the arch and reset the DB to a known state */
+	db->arch = arch;
+	db->refcnt = 1;
+	_db_reset(db);
 
-	return 0;
+	return db;
 }
 
 /**
- * Check to see if an architecture filter exists in the filter collection
- * @param col the seccomp filter collection
- * @param arch_token the architecture token
+ * Get a reference to a seccomp filter DB
+ * @param db the seccomp filter DB
  *
- * Iterate through the given filter collection checking to see if a filter
- * exists for the specified architecture.  Returns -EEXIST if a filter is found,
- * zero if a matching filter does not exist.
+ * This function increments the reference count of the filter DB; a filter DB
+ * with more than one reference is shared and must not be modified.  The
+ * reference count is updated atomically as the collections sharing the filter
+ * DB may be used from different threads.  Returns a pointer to the DB.
  *
  */
-int db_col_arch_exist(struct db_filter_col *col, uint32_t arch_token)
+static struct db_filter *_db_get(struct db_filter *db)
 {
-	unsigned int iter;
-
-	for (iter = 0; iter < col->filter_cnt; iter++)
-		if (col->filters[iter]->arch->token == arch_token)
-			return -EEXIST;
-
-	return 0;
+	__atomic_add_fetch(&db->refcnt, 1, __ATOMIC_RELAXED);
+	return db;
 }
 
 /**
- * Get a filter attribute
- * @param col the seccomp filter collection
- * @param attr the filter attribute
- * @param value the filter attribute value
+ * Determine if a seccomp filter DB is shared
+ * @param db the seccomp filter DB
  *
- * Get the requested filter attribute and provide it via @value.  Returns zero
- * on success, negative values on failure.
+ * Returns true if the filter DB is referenced by more than one collection or
+ * snapshot, false otherwise.  A filter DB which is not shared is only
+ * reachable through the caller's collection, so it is safe to modify.
  *
  */
-int db_col_attr_get(const struct db_filter_col *col,
-		    enum scmp_filter_attr attr, uint32_t *value)
+static bool _db_shared(const struct db_filter *db)
 {
-	int rc = 0;
-
-	switch (attr) {
-	case SCMP_FLTATR_ACT_DEFAULT:
-		*value = col->attr.act_default;
-		break;
-	case SCMP_FLTATR_ACT_BADARCH:
-		*value = col->attr.act_badarch;
-		break;
-	case SCMP_FLTATR_CTL_NNP:
-		*value = col->attr.nnp_enable;
-		break;
-	case SCMP_FLTATR_CTL_TSYNC:
-		*value = col->attr.tsync_enable;
-		break;
-	case SCMP_FLTATR_API_TSKIP:
-		*value = col->attr.api_tskip;
-		break;
-	case SCMP_FLTATR_CTL_LOG:
-		*value = col->attr.log_enable;
-		break;
-	case SCMP_FLTATR_CTL_SSB:
-		*value = col->attr.spec_allow;
-		break;
-	case SCMP_FLTATR_CTL_OPTIMIZE:
-		*value = col->attr.optimize;
-		break;
-	case SCMP_FLTATR_API_SYSRAWRC:
-		*value = col->attr.api_sysrawrc;
-		break;
-	default:
-		rc = -EINVAL;
-		break;
-	}
-
-	return rc;
-}
+	return (__atomic_load_n(&db->refcnt, __ATOMIC_ACQUIRE) > 1);
+}
 
 /**
- * Get a filter attribute
- * @param col the seccomp filter collection
- * @param attr the filter attribute
+ * Destroy a seccomp filter DB
+ * @param db the seccomp filter DB
  *
- * Returns the requested filter attribute value with zero on any error.
- * Special care must be given with this function as error conditions can be
- * hidden from the caller.
+ * This function drops a reference to the seccomp filter DB and destroys it if
+ * this was the last reference.  After calling this function, the filter should
+ * no longer be referenced by the caller.
  *
  */
-uint32_t db_col_attr_read(const struct db_filter_col *col,
-			  enum scmp_filter_attr attr)
+static void _db_release(struct db_filter *db)
 {
-	uint32_t value = 0;
+	if (db == NULL)
+		return;
 
-	db_col_attr_get(col, attr, &value);
-	return value;
+	/* the filter is still in use elsewhere */
+	if (__atomic_sub_fetch(&db->refcnt, 1, __ATOMIC_ACQ_REL) > 0)
+		return;
+
+	/* free and reset the DB */
+	_db_reset(db);
+
+	/* NOTE: the pool lives on if any of its nodes are still in use */
+	_db_pool_put(db->node_pool);
+	free(db);
 }
 
 /**
- * Set a filter attribute
- * @param col the seccomp filter collection
- * @param attr the filter attribute
- * @param value the filter attribute value
+ * Destroy a seccomp filter snapshot
+ * @param snap the seccomp filter snapshot
  *
- * Set the requested filter attribute with the given value.  Returns zero on
- * success, negative values on failure.
+ * This function destroys a seccomp filter snapshot.  After calling this
+ * function, the snapshot should no longer be referenced.
  *
  */
-int db_col_attr_set(struct db_filter_col *col,
-		    enum scmp_filter_attr attr, uint32_t value)
+static void _db_snap_release(struct db_filter_snap *snap)
 {
-	int rc = 0;
+	unsigned int iter;
 
-	switch (attr) {
-	case SCMP_FLTATR_ACT_DEFAULT:
-		/* read only */
-		return -EACCES;
-		break;
-	case SCMP_FLTATR_ACT_BADARCH:
-		if (db_col_action_valid(col, value) == 0)
-			col->attr.act_badarch = value;
-		else
-			return -EINVAL;
-		break;
-	case SCMP_FLTATR_CTL_NNP:
-		col->attr.nnp_enable = (value ? 1 : 0);
-		break;
-	case SCMP_FLTATR_CTL_TSYNC:
-		rc = sys_chk_seccomp_flag(SECCOMP_FILTER_FLAG_TSYNC);
-		if (rc == 1) {
-			/* supported */
-			rc = 0;
-			/* kernel disallows TSYNC and NOTIFY in one filter
-			 * unless we have TSYNC_ESRCH */
-			if (sys_chk_seccomp_flag(SECCOMP_FILTER_FLAG_TSYNC_ESRCH) < 1 &&
-			    value && col->notify_used)
-				return -EINVAL;
-			col->attr.tsync_enable = (value ? 1 : 0);
-		} else if (rc == 0)
-			/* unsupported */
-			rc = -EOPNOTSUPP;
-		break;
-	case SCMP_FLTATR_API_TSKIP:
-		col->attr.api_tskip = (value ? 1 : 0);
-		break;
-	case SCMP_FLTATR_CTL_LOG:
-		rc = sys_chk_seccomp_flag(SECCOMP_FILTER_FLAG_LOG);
-		if (rc == 1) {
-			/* supported */
-			rc = 0;
-			col->attr.log_enable = (value ? 1 : 0);
-		} else if (rc == 0) {
-			/* unsupported */
-			rc = -EOPNOTSUPP;
-		}
-		break;
-	case SCMP_FLTATR_CTL_SSB:
-		rc = sys_chk_seccomp_flag(SECCOMP_FILTER_FLAG_SPEC_ALLOW);
-		if (rc == 1) {
-			/* supported */
-			rc = 0;
-			col->attr.spec_allow = (value ? 1 : 0);
-		} else if (rc == 0) {
-			/* unsupported */
-			rc = -EOPNOTSUPP;
-		}
-		break;
-	case SCMP_FLTATR_CTL_OPTIMIZE:
-		switch (value) {
-		case 1:
-		case 2:
-			col->attr.optimize = value;
-			break;
-		default:
-			rc = -EOPNOTSUPP;
-			break;
+	if (snap == NULL)
+		return;
+
+	if (snap->filter_cnt > 0) {
+		for (iter = 0; iter < snap->filter_cnt; iter++) {
+			if (snap->filters[iter])
+				_db_release(snap->filters[iter]);
 		}
-		break;
-	case SCMP_FLTATR_API_SYSRAWRC:
-		col->attr.api_sysrawrc = (value ? 1 : 0);
-		break;
-	default:
-		rc = -EINVAL;
-		break;
+		free(snap->filters);
 	}
-
-	return rc;
+	free(snap);
 }
 
 /**
- * Add a new architecture filter to a filter collection
- * @param col the seccomp filter collection
- * @param arch the architecture
+ * Drop the shadow transaction of a filter collection
+ * @param col the filter collection
  *
- * This function adds a new architecture filter DB to an existing seccomp
- * filter collection assuming there isn't a filter DB already present with the
- * same architecture.  Returns zero on success, negative values on failure.
+ * The shadow transaction is only kept up to date with newly added rules, this
+ * function drops it when the filters are changed in any other way.
  *
  */
-int db_col_db_new(struct db_filter_col *col, const struct arch_def *arch)
+static void _db_col_shadow_drop(struct db_filter_col *col)
 {
-	int rc;
-	struct db_filter *db;
+	struct db_filter_snap *snap = col->snapshots;
 
-	db = _db_init(arch);
-	if (db == NULL)
-		return -ENOMEM;
-	rc = db_col_db_add(col, db);
-	if (rc < 0)
-		_db_release(db);
+	if (snap == NULL || !snap->shadow)
+		return;
 
-	return rc;
+	col->snapshots = snap->next;
+	_db_snap_release(snap);
 }
 
 /**
- * Add a new filter DB to a filter collection
- * @param col the seccomp filter collection
- * @param db the seccomp filter DB
+ * Search the syscall index
+ * @param db the seccomp filter db
+ * @param num the syscall number
+ * @param pos the index position
  *
- * This function adds an existing seccomp filter DB to an existing seccomp
- * filter collection assuming there isn't a filter DB already present with the
- * same architecture.  Returns zero on success, negative values on failure.
+ * This function performs a binary search of the syscall index for the given
+ * syscall number.  If the syscall is found @pos is set to its position in the
+ * index, otherwise @pos is set to the position where it should be inserted.
+ * Returns true if the syscall was found, false otherwise.
  *
  */
-int db_col_db_add(struct db_filter_col *col, struct db_filter *db)
+static bool _db_sys_idx_find(const struct db_filter *db,
+			     unsigned int num, unsigned int *pos)
 {
-	struct db_filter **dbs;
+	unsigned int lo = 0, hi = db->sys_idx_cnt, mid;
 
-	if (col->endian != 0 && col->endian != db->arch->endian)
-		return -EDOM;
-
-	if (db_col_arch_exist(col, db->arch->token))
-		return -EEXIST;
-
-	dbs = realloc(col->filters,
-		      sizeof(struct db_filter *) * (col->filter_cnt + 1));
-	if (dbs == NULL)
-		return -ENOMEM;
-	col->filters = dbs;
-	col->filter_cnt++;
-	col->filters[col->filter_cnt - 1] = db;
-	if (col->endian == 0)
-		col->endian = db->arch->endian;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (db->sys_idx[mid]->num < num)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	*pos = lo;
 
-	return 0;
+	return (lo < db->sys_idx_cnt && db->sys_idx[lo]->num == num);
 }
 
 /**
- * Remove a filter DB from a filter collection
- * @param col the seccomp filter collection
- * @param arch_token the architecture token
+ * Make room for a new entry in the syscall index
+ * @param db the seccomp filter db
  *
- * This function removes an existing seccomp filter DB from an existing seccomp
- * filter collection.  Returns zero on success, negative values on failure.
+ * This function grows the syscall index, if needed, so that a new syscall can
+ * be inserted without failing.  Returns zero on success, negative values on
+ * failure.
  *
  */
-int db_col_db_remove(struct db_filter_col *col, uint32_t arch_token)
+static int _db_sys_idx_reserve(struct db_filter *db)
 {
-	unsigned int iter;
-	unsigned int found;
-	struct db_filter **dbs;
-
-	if ((col->filter_cnt <= 0) || (db_col_arch_exist(col, arch_token) == 0))
-		return -EINVAL;
+	unsigned int size;
+	struct db_sys_list **idx;
 
-	for (found = 0, iter = 0; iter < col->filter_cnt; iter++) {
-		if (found)
-			col->filters[iter - 1] = col->filters[iter];
-		else if (col->filters[iter]->arch->token == arch_token) {
-			_db_release(col->filters[iter]);
-			found = 1;
-		}
-	}
-	col->filters[--col->filter_cnt] = NULL;
+	if (db->sys_idx_cnt < db->sys_idx_size)
+		return 0;
 
-	if (col->filter_cnt > 0) {
-		/* NOTE: if we can't do the realloc it isn't fatal, we just
-		 *       have some extra space allocated */
-		dbs = realloc(col->filters,
-			      sizeof(struct db_filter *) * col->filter_cnt);
-		if (dbs != NULL)
-			col->filters = dbs;
-	} else {
-		/* this was the last filter so free all the associated memory
-		 * and reset the endian token */
-		free(col->filters);
-		col->filters = NULL;
-		col->endian = 0;
-	}
+	size = (db->sys_idx_size == 0 ? 64 : db->sys_idx_size * 2);
+	idx = realloc(db->sys_idx, sizeof(*idx) * size);
+	if (idx == NULL)
+		return -ENOMEM;
+	db->sys_idx = idx;
+	db->sys_idx_size = size;
 
 	return 0;
 }
 
 /**
- * Test if the argument filter can be skipped because it's a tautology
- * @param arg argument filter
+ * Insert a new syscall entry into the syscall index
+ * @param db the seccomp filter db
+ * @param s_new the new syscall entry
+ * @param pos the index position
  *
- * If this argument filter applied to the lower 32 bit can be skipped this
- * function returns false.
+ * This function inserts the new syscall entry at the given position in the
+ * syscall index, the index takes over the caller's reference to the entry.
+ * The caller must ensure there is room in the index, see
+ * _db_sys_idx_reserve().
  *
  */
-static bool _db_arg_cmp_need_lo(const struct db_api_arg *arg)
+static void _db_sys_idx_insert(struct db_filter *db,
+			       struct db_sys_list *s_new, unsigned int pos)
 {
-	if (arg->op == SCMP_CMP_MASKED_EQ && D64_LO(arg->mask) == 0)
-		return false;
+	assert(db->sys_idx_cnt < db->sys_idx_size);
 
-	return true;
+	memmove(&db->sys_idx[pos + 1], &db->sys_idx[pos],
+		sizeof(*db->sys_idx) * (db->sys_idx_cnt - pos));
+	db->sys_idx[pos] = s_new;
+	db->sys_idx_cnt++;
 }
 
 /**
- * Test if the argument filter can be skipped because it's a tautology
- * @param arg argument filter
+ * Remove a syscall entry from the syscall index
+ * @param db the seccomp filter db
+ * @param pos the index position
  *
- * If this argument filter applied to the upper 32 bit can be skipped this
- * function returns false.
+ * This function removes the syscall entry at the given position from the
+ * syscall index and drops the index's reference to the entry.
  *
  */
-static bool _db_arg_cmp_need_hi(const struct db_api_arg *arg)
+static void _db_sys_idx_remove(struct db_filter *db, unsigned int pos)
 {
-	if (arg->op == SCMP_CMP_MASKED_EQ && D64_HI(arg->mask) == 0)
-		return false;
+	struct db_sys_list *s_iter = db->sys_idx[pos];
 
-	return true;
+	memmove(&db->sys_idx[pos], &db->sys_idx[pos + 1],
+		sizeof(*db->sys_idx) * (db->sys_idx_cnt - pos - 1));
+	db->sys_idx_cnt--;
+	_db_sys_put(s_iter);
 }
 
 /**
- * Fixup the node based on the op/mask
- * @param node the chain node
+ * Find a syscall entry, creating a phantom entry if needed
+ * @param db the seccomp filter db
+ * @param syscall the syscall number
  *
- * Ensure the datum is masked as well.
+ * This function returns the syscall entry for the given syscall so that it can
+ * be modified, see _db_sys_own().  If the syscall entry does not already
+ * exist, a new phantom syscall entry is created as a placeholder.  Returns a
+ * pointer to the syscall entry on success, NULL on failure.
  *
  */
-static void _db_node_mask_fixup(struct db_arg_chain_tree *node)
+static struct db_sys_list *_db_syscall_entry(struct db_filter *db, int syscall)
 {
-	node->datum &= node->mask;
+	unsigned int pos;
+	struct db_sys_list *s_new;
+
+	assert(db != NULL);
+
+	/* matched an existing syscall entry */
+	if (_db_sys_idx_find(db, syscall, &pos))
+		return _db_sys_own(db, pos);
+
+	/* no existing syscall entry - create a phantom entry */
+	if (_db_sys_idx_reserve(db) < 0)
+		return NULL;
+	s_new = zmalloc(sizeof(*s_new));
+	if (s_new == NULL)
+		return NULL;
+	s_new->num = syscall;
+	s_new->refcnt = 1;
+	s_new->valid = false;
+	_db_sys_idx_insert(db, s_new, pos);
+
+	return s_new;
 }
 
 /**
- * Generate a new filter rule for a 64 bit system
- * @param arch the architecture definition
- * @param rule the new filter rule
+ * Update the user specified portion of the syscall priority
+ * @param db the seccomp filter db
+ * @param syscall the syscall number
+ * @param priority the syscall priority
  *
- * This function generates a new syscall filter for a 64 bit system. Returns
- * zero on success, negative values on failure.
+ * This function sets, or updates, the syscall priority; the highest priority
+ * value between the existing and specified value becomes the new syscall
+ * priority.  If the syscall entry does not already exist, a new phantom
+ * syscall entry is created as a placeholder.  Returns zero on success,
+ * negative values on failure.
  *
  */
-static struct db_sys_list *_db_rule_gen_64(const struct arch_def *arch,
-					   const struct db_api_rule_list *rule)
+static int _db_syscall_priority(struct db_filter *db,
+				int syscall, uint8_t priority)
+{
+	unsigned int sys_pri = _DB_PRI_USER(priority);
+	struct db_sys_list *s_iter;
+
+	s_iter = _db_syscall_entry(db, syscall);
+	if (s_iter == NULL)
+		return -ENOMEM;
+
+	if (sys_pri > (s_iter->priority & _DB_PRI_MASK_USER)) {
+		s_iter->priority &= (~_DB_PRI_MASK_USER);
+		s_iter->priority |= sys_pri;
+	}
+
+	return 0;
+}
+
+/**
+ * Update the syscall weight
+ * @param db the seccomp filter db
+ * @param syscall the syscall number
+ * @param weight the syscall weight
+ *
+ * This function sets, or updates, the syscall weight; unlike the priority the
+ * new weight always replaces the existing weight.  If the syscall entry does
+ * not already exist, a new phantom syscall entry is created as a placeholder.
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int _db_syscall_weight(struct db_filter *db,
+			      int syscall, uint32_t weight)
+{
+	struct db_sys_list *s_iter;
+
+	s_iter = _db_syscall_entry(db, syscall);
+	if (s_iter == NULL)
+		return -ENOMEM;
+
+	s_iter->weight = weight;
+
+	return 0;
+}
+
+/**
+ * Duplicate a seccomp filter DB
+ * @param src the seccomp filter DB
+ *
+ * This function creates a copy of the given filter DB which shares the syscall
+ * entries and the rules with the original.  The shared syscall entries are
+ * copied one at a time as they are modified, see _db_sys_own(), and the rules
+ * are only copied once the rule lists of the two DBs diverge, see
+ * _db_rule_vec_reserve(), so the cost of the duplicate is proportional to the
+ * number of syscalls in the filter and not the number of rules.  Returns a
+ * pointer to the new DB on success, NULL on failure.
+ *
+ */
+static struct db_filter *_db_dup(const struct db_filter *src)
 {
 	unsigned int iter;
-	struct db_sys_list *s_new;
-	const struct db_api_arg *chain = rule->args;
-	struct db_arg_chain_tree *c_iter[3] = { NULL, NULL, NULL };
-	struct db_arg_chain_tree *c_prev[3] = { NULL, NULL, NULL };
-	enum scmp_compare op_prev = _SCMP_CMP_MIN;
-	unsigned int arg;
-	scmp_datum_t mask;
-	scmp_datum_t datum;
+	struct db_filter *db;
 
-	s_new = zmalloc(sizeof(*s_new));
-	if (s_new == NULL)
+	db = _db_init(src->arch);
+	if (db == NULL)
 		return NULL;
-	s_new->num = rule->syscall;
-	s_new->valid = true;
-	/* run through the argument chain */
+
+	if (src->sys_idx_cnt > 0) {
+		db->sys_idx = malloc(sizeof(*db->sys_idx) * src->sys_idx_size);
+		if (db->sys_idx == NULL) {
+			_db_release(db);
+			return NULL;
+		}
+		db->sys_idx_size = src->sys_idx_size;
+		for (iter = 0; iter < src->sys_idx_cnt; iter++)
+			db->sys_idx[iter] = _db_sys_get(src->sys_idx[iter]);
+		db->sys_idx_cnt = src->sys_idx_cnt;
+	}
+	db->syscall_cnt = src->syscall_cnt;
+
+	if (src->rules != NULL) {
+		__atomic_add_fetch(&src->rules->refcnt, 1, __ATOMIC_RELAXED);
+		db->rules = src->rules;
+	}
+	db->rule_cnt = src->rule_cnt;
+
+	return db;
+}
+
+/**
+ * Duplicate any shared filters in a filter collection
+ * @param col the filter collection
+ *
+ * This function replaces any filters the collection shares with another
+ * collection with private copies so that they can be modified.  Returns zero
+ * on success, negative values on failure.
+ *
+ */
+static int _db_col_unshare(struct db_filter_col *col)
+{
+	unsigned int iter;
+	struct db_filter *db;
+
+	for (iter = 0; iter < col->filter_cnt; iter++) {
+		if (!_db_shared(col->filters[iter]))
+			continue;
+
+		db = _db_dup(col->filters[iter]);
+		if (db == NULL)
+			return -ENOMEM;
+		_db_release(col->filters[iter]);
+		col->filters[iter] = db;
+	}
+
+	return 0;
+}
+
+/**
+ * Compare two argument values
+ * @param a pointer to the first value
+ * @param b pointer to the second value
+ *
+ * This is a qsort() comparison function for scmp_datum_t values.
+ *
+ */
+static int _db_datum_cmp(const void *a, const void *b)
+{
+	scmp_datum_t a_val = *(const scmp_datum_t *)a;
+	scmp_datum_t b_val = *(const scmp_datum_t *)b;
+
+	if (a_val < b_val)
+		return -1;
+	return (a_val > b_val ? 1 : 0);
+}
+
+/**
+ * Create a new rule
+ * @param strict the strict value
+ * @param action the rule's action
+ * @param syscall the syscall number
+ * @param chain the syscall argument filter
+ *
+ * This function creates a new rule structure based on the given arguments.
+ * Returns a pointer to the new rule on success, NULL on failure.
+ *
+ */
+static struct db_api_rule_list *_db_rule_new(bool strict,
+					     uint32_t action, int syscall,
+					     struct db_api_arg *chain)
+{
+	unsigned int iter, s_iter;
+	unsigned int set_len = 0;
+	scmp_datum_t *set;
+	struct db_api_rule_list *rule;
+
+	for (iter = 0; iter < ARG_COUNT_MAX; iter++)
+		if (chain[iter].valid && chain[iter].op == SCMP_CMP_IN_SET)
+			set_len += chain[iter].set_cnt;
+
+	rule = zmalloc(sizeof(*rule) + set_len * sizeof(*rule->set));
+	if (rule == NULL)
+		return NULL;
+	rule->action = action;
+	rule->syscall = syscall;
+	rule->strict = strict;
+	rule->refcnt = 1;
+	memcpy(rule->args, chain, sizeof(*chain) * ARG_COUNT_MAX);
+
+	/* copy the sets into the rule, sorted and without duplicates */
+	set = rule->set;
 	for (iter = 0; iter < ARG_COUNT_MAX; iter++) {
-		if (chain[iter].valid == 0)
+		if (!rule->args[iter].valid ||
+		    rule->args[iter].op != SCMP_CMP_IN_SET)
 			continue;
+		memcpy(set, chain[iter].set,
+		       chain[iter].set_cnt * sizeof(*set));
+		qsort(set, chain[iter].set_cnt, sizeof(*set), _db_datum_cmp);
+		rule->args[iter].set_cnt = 1;
+		for (s_iter = 1; s_iter < chain[iter].set_cnt; s_iter++)
+			if (set[s_iter] != set[rule->args[iter].set_cnt - 1])
+				set[rule->args[iter].set_cnt++] = set[s_iter];
+		rule->args[iter].set = set;
+		rule->args[iter].datum = set[0];
+		set += rule->args[iter].set_cnt;
+	}
+	rule->set_len = set - rule->set;
 
-		/* TODO: handle the case were either hi or lo isn't needed */
+	return rule;
+}
 
-		/* skip generating instruction which are no-ops */
-		if (!_db_arg_cmp_need_hi(&chain[iter]) &&
-		    !_db_arg_cmp_need_lo(&chain[iter]))
+/**
+ * Duplicate an existing filter rule
+ * @param src the rule to duplicate
+ *
+ * This function makes an exact copy of the given rule, but does not add it
+ * to any lists.  Returns a pointer to the new rule on success, NULL on
+ * failure.
+ *
+ */
+struct db_api_rule_list *db_rule_dup(const struct db_api_rule_list *src)
+{
+	unsigned int iter;
+	size_t size;
+	struct db_api_rule_list *dest;
+
+	size = sizeof(*dest) + src->set_len * sizeof(*src->set);
+	dest = malloc(size);
+	if (dest == NULL)
+		return NULL;
+	/* NOTE: the source rule may be shared, so leave its refcnt alone */
+	dest->action = src->action;
+	dest->syscall = src->syscall;
+	dest->strict = src->strict;
+	memcpy(dest->args, src->args, sizeof(dest->args));
+	dest->refcnt = 1;
+	dest->prev = NULL;
+	dest->next = NULL;
+	dest->set_len = src->set_len;
+	memcpy(dest->set, src->set, src->set_len * sizeof(*src->set));
+
+	/* point the sets at our own copy */
+	for (iter = 0; iter < ARG_COUNT_MAX; iter++)
+		if (dest->args[iter].set != NULL)
+			dest->args[iter].set = dest->set +
+					       (src->args[iter].set - src->set);
+
+	return dest;
+}
+
+/**
+ * Determine if two rules have equal argument comparisons
+ * @param a the first rule
+ * @param b the second rule
+ *
+ * Returns true if the argument comparisons of both rules are the same, false
+ * otherwise.
+ *
+ */
+static bool _db_rule_args_eq(const struct db_api_rule_list *a,
+			     const struct db_api_rule_list *b)
+{
+	unsigned int iter;
+	const struct db_api_arg *a_arg, *b_arg;
+
+	for (iter = 0; iter < ARG_COUNT_MAX; iter++) {
+		a_arg = &a->args[iter];
+		b_arg = &b->args[iter];
+		if (a_arg->valid != b_arg->valid)
+			return false;
+		if (!a_arg->valid)
 			continue;
+		if (a_arg->arg != b_arg->arg || a_arg->op != b_arg->op ||
+		    a_arg->mask != b_arg->mask ||
+		    a_arg->datum != b_arg->datum ||
+		    a_arg->datum_max != b_arg->datum_max ||
+		    a_arg->set_cnt != b_arg->set_cnt)
+			return false;
+		if (a_arg->set_cnt > 0 &&
+		    memcmp(a_arg->set, b_arg->set,
+			   a_arg->set_cnt * sizeof(*a_arg->set)) != 0)
+			return false;
+	}
 
-		c_iter[0] = zmalloc(sizeof(*c_iter[0]));
-		if (c_iter[0] == NULL)
-			goto gen_64_failure;
-		c_iter[1] = zmalloc(sizeof(*c_iter[1]));
-		if (c_iter[1] == NULL) {
-			free(c_iter[0]);
-			goto gen_64_failure;
-		}
-		c_iter[2] = NULL;
+	return true;
+}
 
-		arg = chain[iter].arg;
-		mask = chain[iter].mask;
-		datum = chain[iter].datum;
+/**
+ * Invalidate the program cache key of a filter collection
+ * @param col the filter collection
+ *
+ * This function must be called whenever the filter collection is changed in
+ * a way that could change the generated BPF program.
+ *
+ */
+static void _db_col_key_reset(struct db_filter_col *col)
+{
+	free(col->cache_key);
+	col->cache_key = NULL;
+}
 
-		/* NOTE: with the idea that a picture is worth a thousand
-		 *       words, i'm presenting the following diagrams which
-		 *       show how we should compare 64-bit syscall arguments
-		 *       using 32-bit comparisons.
-		 *
-		 *       in the diagrams below "A(x)" is the syscall argument
-		 *       being evaluated and "R(x)" is the syscall argument
-		 *       value specified in the libseccomp rule.  the "ACCEPT"
-		 *       verdict indicates a rule match and processing should
-		 *       continue on to the rest of the rule, or the final rule
-		 *       action should be triggered.  the "REJECT" verdict
-		 *       indicates that the rule does not match and processing
-		 *       should continue to the next rule or the default
-		 *       action.
-		 *
-		 * SCMP_CMP_GT:
-		 *                   +------------------+
-		 *                +--|  Ah(x) >  Rh(x)  |------+
-		 *                |  +------------------+      |
-		 *              FALSE                         TRUE     A
-		 *                |                            |       C
-		 *                +-----------+                +---->  C
-		 *                            v                +---->  E
-		 *                   +------------------+      |       P
-		 *                +--|  Ah(x) == Rh(x)  |--+   |       T
-		 *        R       |  +------------------+  |   |
-		 *        E     FALSE                     TRUE |
-		 *        J  <----+                        |   |
-		 *        E  <----+           +------------+   |
-		 *        C     FALSE         v                |
-		 *        T       |  +------------------+      |
-		 *                +--|  Al(x) >  Rl(x)  |------+
-		 *                   +------------------+
-		 *
-		 * SCMP_CMP_GE:
-		 *                   +------------------+
-		 *                +--|  Ah(x) >  Rh(x)  |------+
-		 *                |  +------------------+      |
-		 *              FALSE                         TRUE     A
-		 *                |                            |       C
-		 *                +-----------+                +---->  C
-		 *                            v                +---->  E
-		 *                   +------------------+      |       P
-		 *                +--|  Ah(x) == Rh(x)  |--+   |       T
-		 *        R       |  +------------------+  |   |
-		 *        E     FALSE                     TRUE |
-		 *        J  <----+                        |   |
-		 *        E  <----+           +------------+   |
-		 *        C     FALSE         v                |
-		 *        T       |  +------------------+      |
-		 *                +--|  Al(x) >= Rl(x)  |------+
-		 *                   +------------------+
-		 *
-		 * SCMP_CMP_LT:
-		 *                   +------------------+
-		 *                +--|  Ah(x) >  Rh(x)  |------+
-		 *                |  +------------------+      |
-		 *              FALSE                         TRUE     R
+/**
+ * Free and reset the seccomp filter collection
+ * @param col the seccomp filter collection
+ * @param def_action the default filter action
+ *
+ * This function frees any existing filter DBs and resets the collection to a
+ * default state.  In the case of failure the filter collection may be in an
+ * unknown state and should be released.  Returns zero on success, negative
+ * values on failure.
+ *
+ */
+int db_col_reset(struct db_filter_col *col, uint32_t def_action)
+{
+	unsigned int iter;
+	struct db_filter *db;
+	struct db_filter_snap *snap;
+
+	if (col == NULL)
+		return -EINVAL;
+
+	_db_col_key_reset(col);
+
+	/* free any filters */
+	for (iter = 0; iter < col->filter_cnt; iter++)
+		_db_release(col->filters[iter]);
+	col->filter_cnt = 0;
+	if (col->filters)
+		free(col->filters);
+	col->filters = NULL;
+	col->notify_fd = -1;
+
+	/* set the endianess to undefined */
+	col->endian = 0;
+
+	/* set the default attribute values */
+	col->attr.act_default = def_action;
+	col->attr.act_badarch = SCMP_ACT_KILL;
+	col->attr.nnp_enable = 1;
+	col->attr.tsync_enable = 0;
+	col->attr.api_tskip = 0;
+	col->attr.log_enable = 0;
+	col->attr.spec_allow = 0;
+	col->attr.optimize = 1;
+	col->attr.api_sysrawrc = 0;
+	col->attr.threads = 1;
+
+	/* set the state */
+	col->state = _DB_STA_VALID;
+	if (def_action == SCMP_ACT_NOTIFY)
+		col->notify_used = true;
+	else
+		col->notify_used = false;
+
+	/* reset the initial db */
+	db = _db_init(arch_def_native);
+	if (db == NULL)
+		return -ENOMEM;
+	if (db_col_db_add(col, db) < 0) {
+		_db_release(db);
+		return -ENOMEM;
+	}
+
+	/* reset the transactions */
+	while (col->snapshots) {
+		snap = col->snapshots;
+		col->snapshots = snap->next;
+		for (iter = 0; iter < snap->filter_cnt; iter++)
+			_db_release(snap->filters[iter]);
+		free(snap->filters);
+		free(snap);
+	}
+
+	return 0;
+}
+
+/**
+ * Intitalize a seccomp filter collection
+ * @param def_action the default filter action
+ *
+ * This function initializes a seccomp filter collection and readies it for
+ * use.  Returns a pointer to the collection on success, NULL on failure.
+ *
+ */
+struct db_filter_col *db_col_init(uint32_t def_action)
+{
+	struct db_filter_col *col;
+
+	col = zmalloc(sizeof(*col));
+	if (col == NULL)
+		return NULL;
+
+	/* reset the DB to a known state */
+	if (db_col_reset(col, def_action) < 0)
+		goto init_failure;
+
+	return col;
+
+init_failure:
+	db_col_release(col);
+	return NULL;
+}
+
+/**
+ * Destroy a seccomp filter collection
+ * @param col the seccomp filter collection
+ *
+ * This function destroys a seccomp filter collection.  After calling this
+ * function, the filter should no longer be referenced.
+ *
+ */
+void db_col_release(struct db_filter_col *col)
+{
+	unsigned int iter;
+	struct db_filter_snap *snap;
+
+	if (col == NULL)
+		return;
+
+	/* set the state, just in case */
+	col->state = _DB_STA_FREED;
+	_db_col_key_reset(col);
+
+	/* free any snapshots */
+	while (col->snapshots != NULL) {
+		snap = col->snapshots;
+		col->snapshots = snap->next;
+		_db_snap_release(snap);
+	}
+
+	/* free any filters */
+	for (iter = 0; iter < col->filter_cnt; iter++)
+		_db_release(col->filters[iter]);
+	col->filter_cnt = 0;
+	if (col->filters)
+		free(col->filters);
+	col->filters = NULL;
+
+	/* free the collection */
+	free(col);
+}
+
+/**
+ * Duplicate a seccomp filter collection
+ * @param col the seccomp filter collection
+ *
+ * This function creates a new filter collection with the same attributes,
+ * architectures, and rules as the given collection.  The filters are shared
+ * between the two collections until one of them is modified, and even then
+ * only the syscall entries which are touched by the change are copied, see
+ * _db_sys_own(); either collection may be used from a different thread than
+ * the other.  Returns a pointer to the new collection on success, NULL on
+ * failure.
+ *
+ */
+struct db_filter_col *db_col_dup(const struct db_filter_col *col)
+{
+	unsigned int iter;
+	struct db_filter_col *col_new;
+
+	col_new = zmalloc(sizeof(*col_new));
+	if (col_new == NULL)
+		return NULL;
+	col_new->filters = zmalloc(sizeof(struct db_filter *) *
+				   col->filter_cnt);
+	if (col_new->filters == NULL) {
+		free(col_new);
+		return NULL;
+	}
+
+	/* NOTE: the original collection is left untouched so that it can be
+	 *       duplicated by several threads at once, the shared filters are
+	 *       replaced with private copies when they are first modified */
+	col_new->state = col->state;
+	col_new->attr = col->attr;
+	col_new->endian = col->endian;
+	for (iter = 0; iter < col->filter_cnt; iter++)
+		col_new->filters[iter] = _db_get(col->filters[iter]);
+	col_new->filter_cnt = col->filter_cnt;
+	col_new->snapshots = NULL;
+
+	/* the notification fd belongs to the filter loaded by the original */
+	col_new->notify_fd = -1;
+	col_new->notify_used = col->notify_used;
+	col_new->cache_key = NULL;
+
+	return col_new;
+}
+
+/**
+ * Validate a filter collection
+ * @param col the seccomp filter collection
+ *
+ * This function validates a seccomp filter collection.  Returns zero if the
+ * collection is valid, negative values on failure.
+ *
+ */
+int db_col_valid(struct db_filter_col *col)
+{
+	if (col != NULL && col->state == _DB_STA_VALID && col->filter_cnt > 0)
+		return 0;
+	return -EINVAL;
+}
+
+/**
+ * Validate the seccomp action
+ * @param col the seccomp filter collection
+ * @param action the seccomp action
+ *
+ * Verify that the given action is a valid seccomp action; return zero if
+ * valid, -EINVAL if invalid.
+ */
+int db_col_action_valid(const struct db_filter_col *col, uint32_t action)
+{
+	if (col != NULL) {
+		/* NOTE: in some cases we don't have a filter collection yet,
+		 *       but when we do we need to do the following checks */
+
+		/* kernel disallows TSYNC and NOTIFY in one filter unless we
+		 * have the TSYNC_ESRCH flag */
+		if (sys_chk_seccomp_flag(SECCOMP_FILTER_FLAG_TSYNC_ESRCH) < 1 &&
+		    col->attr.tsync_enable && action == SCMP_ACT_NOTIFY)
+			return -EINVAL;
+	}
+
+	if (sys_chk_seccomp_action(action) == 1)
+		return 0;
+	return -EINVAL;
+}
+
+/**
+ * Merge one filter DB into another
+ * @param dst the destination filter DB
+ * @param src the source filter DB
+ *
+ * This function merges @src into @dst as if the rules of @src were added to
+ * @dst.  Unless the architecture rewrites the rules across multiple syscalls,
+ * only the rules for syscalls filtered by both DBs are added again; the syscall
+ * entries which are only filtered by @src are shared with @dst and the rules
+ * are appended to the rule list of @dst.  The syscall priorities and weights of
+ * both DBs are merged.  The source filter DB is not modified.  Returns zero on
+ * success, negative values on failure.
+ *
+ * It is important to note that in the case of failure the destination DB may
+ * be corrupted, the caller must use the transaction mechanism.
+ *
+ */
+static int _db_merge(struct db_filter *dst, const struct db_filter *src)
+{
+	int rc;
+	int syscall;
+	unsigned int pos, s_pos, r_pos;
+	unsigned int priority;
+	uint32_t weight;
+	bool movable = (src->arch->rule_add == NULL);
+	struct db_sys_list *s_iter, *s_dst, *s_new;
+	struct db_api_rule_list *r_iter;
+
+	if (!movable) {
+		/* replay every rule */
+		db_rule_foreach(r_iter, r_pos, src) {
+			rc = _db_col_rule_add(dst, _db_rule_get(r_iter));
+			if (rc != 0) {
+				_db_rule_put(r_iter);
+				return rc;
+			}
+		}
+	} else {
+		rc = _db_rule_vec_reserve(dst, src->rule_cnt);
+		if (rc < 0)
+			return rc;
+
+		/* only replay the rules for syscalls in both DBs */
+		db_rule_foreach(r_iter, r_pos, src) {
+			syscall = r_iter->syscall;
+			rc = arch_syscall_translate(dst->arch, &syscall);
+			if (rc < 0)
+				return rc;
+			if (_db_sys_idx_find(dst, syscall, &pos) &&
+			    dst->sys_idx[pos]->valid) {
+				rc = arch_filter_rule_add(dst, r_iter);
+				if (rc < 0)
+					return rc;
+			}
+		}
+	}
+
+	db_syscall_foreach(s_iter, s_pos, src) {
+		s_dst = NULL;
+		if (_db_sys_idx_find(dst, s_iter->num, &pos))
+			s_dst = dst->sys_idx[pos];
+
+		/* the higher priority wins, a new weight replaces the old */
+		priority = s_iter->priority & _DB_PRI_MASK_USER;
+		weight = s_iter->weight;
+		if (s_dst != NULL) {
+			if ((s_dst->priority & _DB_PRI_MASK_USER) > priority)
+				priority = s_dst->priority & _DB_PRI_MASK_USER;
+			if (weight == 0)
+				weight = s_dst->weight;
+		}
+
+		if (s_dst == NULL && !s_iter->valid &&
+		    priority == 0 && weight == 0)
+			continue;
+
+		if (s_dst == NULL || (movable && s_iter->valid &&
+				      !s_dst->valid)) {
+			/* the syscall is only filtered by the source, so share
+			 * its syscall entry unless the priority or weight
+			 * differ */
+			if (priority == (s_iter->priority & _DB_PRI_MASK_USER) &&
+			    weight == s_iter->weight)
+				s_new = _db_sys_get(s_iter);
+			else {
+				s_new = _db_sys_copy(dst, s_iter);
+				if (s_new == NULL)
+					return -ENOMEM;
+				s_new->priority &= (~_DB_PRI_MASK_USER);
+				s_new->priority |= priority;
+				s_new->weight = weight;
+			}
+
+			if (s_dst != NULL) {
+				dst->sys_idx[pos] = s_new;
+				_db_sys_put(s_dst);
+			} else if (_db_sys_idx_reserve(dst) == 0)
+				_db_sys_idx_insert(dst, s_new, pos);
+			else {
+				_db_sys_put(s_new);
+				return -ENOMEM;
+			}
+			if (s_new->valid)
+				dst->syscall_cnt++;
+			continue;
+		}
+
+		if (priority == (s_dst->priority & _DB_PRI_MASK_USER) &&
+		    weight == s_dst->weight)
+			continue;
+		s_dst = _db_sys_own(dst, pos);
+		if (s_dst == NULL)
+			return -ENOMEM;
+		s_dst->priority &= (~_DB_PRI_MASK_USER);
+		s_dst->priority |= priority;
+		s_dst->weight = weight;
+	}
+
+	/* add the rules to the end of the rule list */
+	if (movable) {
+		db_rule_foreach(r_iter, r_pos, src)
+			_db_rule_vec_append(dst, _db_rule_get(r_iter));
+	}
+
+	return 0;
+}
+
+/**
+ * Find the filter for an architecture in a filter collection
+ * @param col the filter collection
+ * @param arch_token the architecture token
+ *
+ * Returns a pointer to the filter on success, NULL if the architecture is not
+ * part of the collection.
+ *
+ */
+static struct db_filter *_db_col_filter(const struct db_filter_col *col,
+					uint32_t arch_token)
+{
+	unsigned int iter;
+
+	for (iter = 0; iter < col->filter_cnt; iter++) {
+		if (col->filters[iter]->arch->token == arch_token)
+			return col->filters[iter];
+	}
+
+	return NULL;
+}
+
+/**
+ * Merge two filter collections
+ * @param col_dst the destination filter collection
+ * @param col_src the source filter collection
+ *
+ * This function merges two filter collections into the given destination
+ * collection.  The filters for architectures which only exist in the source
+ * collection are transferred as-is, the filters for architectures which exist
+ * in both collections are merged as if the source rules were added to the
+ * destination.  Syscalls which are only filtered by the source are merged by
+ * sharing their syscall entries, only the rules for syscalls filtered by both
+ * are added again.  The source filter collection is no longer valid if
+ * the function returns successfully.  Returns zero on success, negative values
+ * on failure.
+ *
+ */
+int db_col_merge(struct db_filter_col *col_dst, struct db_filter_col *col_src)
+{
+	int rc;
+	unsigned int iter, cnt = 0;
+	struct db_filter **dbs;
+	struct db_filter *db_dst, *db_src;
+	struct db_filter_snap *snap;
+
+	/* verify that the endianess is a match */
+	if (col_dst->endian != col_src->endian)
+		return -EDOM;
+
+	_db_col_key_reset(col_dst);
+
+	/* expand the destination */
+	for (iter = 0; iter < col_src->filter_cnt; iter++) {
+		if (_db_col_filter(col_dst,
+				   col_src->filters[iter]->arch->token) == NULL)
+			cnt++;
+	}
+	dbs = realloc(col_dst->filters,
+		      sizeof(struct db_filter *) * (col_dst->filter_cnt + cnt));
+	if (dbs == NULL)
+		return -ENOMEM;
+	col_dst->filters = dbs;
+
+	if (cnt < col_src->filter_cnt) {
+		/* create a checkpoint */
+		rc = db_col_transaction_start(col_dst);
+		if (rc != 0)
+			return rc;
+
+		/* merge the architectures in both collections */
+		for (iter = 0; iter < col_src->filter_cnt; iter++) {
+			db_src = col_src->filters[iter];
+			db_dst = _db_col_filter(col_dst, db_src->arch->token);
+			if (db_dst == NULL)
+				continue;
+			rc = _db_merge(db_dst, db_src);
+			if (rc != 0) {
+				db_col_transaction_abort(col_dst);
+				return rc;
+			}
+		}
+
+		/* NOTE: the shadow transaction can only track newly added
+		 *       rules, so we drop the snapshot instead of committing
+		 *       the transaction */
+		snap = col_dst->snapshots;
+		col_dst->snapshots = snap->next;
+		_db_snap_release(snap);
+	}
+
+	/* transfer the remaining architecture filters */
+	cnt = col_dst->filter_cnt;
+	for (iter = 0; iter < col_src->filter_cnt; iter++) {
+		db_src = col_src->filters[iter];
+		if (_db_col_filter(col_dst, db_src->arch->token) != NULL)
+			_db_release(db_src);
+		else
+			col_dst->filters[cnt++] = db_src;
+	}
+	col_dst->filter_cnt = cnt;
+	col_dst->notify_used |= col_src->notify_used;
+
+	/* free the source */
+	col_src->filter_cnt = 0;
+	db_col_release(col_src);
+
+	return 0;
+}
+
+/**
+ * Check to see if an architecture filter exists in the filter collection
+ * @param col the seccomp filter collection
+ * @param arch_token the architecture token
+ *
+ * Iterate through the given filter collection checking to see if a filter
+ * exists for the specified architecture.  Returns -EEXIST if a filter is found,
+ * zero if a matching filter does not exist.
+ *
+ */
+int db_col_arch_exist(struct db_filter_col *col, uint32_t arch_token)
+{
+	unsigned int iter;
+
+	for (iter = 0; iter < col->filter_cnt; iter++)
+		if (col->filters[iter]->arch->token == arch_token)
+			return -EEXIST;
+
+	return 0;
+}
+
+/**
+ * Get a filter attribute
+ * @param col the seccomp filter collection
+ * @param attr the filter attribute
+ * @param value the filter attribute value
+ *
+ * Get the requested filter attribute and provide it via @value.  Returns zero
+ * on success, negative values on failure.
+ *
+ */
+int db_col_attr_get(const struct db_filter_col *col,
+		    enum scmp_filter_attr attr, uint32_t *value)
+{
+	int rc = 0;
+
+	switch (attr) {
+	case SCMP_FLTATR_ACT_DEFAULT:
+		*value = col->attr.act_default;
+		break;
+	case SCMP_FLTATR_ACT_BADARCH:
+		*value = col->attr.act_badarch;
+		break;
+	case SCMP_FLTATR_CTL_NNP:
+		*value = col->attr.nnp_enable;
+		break;
+	case SCMP_FLTATR_CTL_TSYNC:
+		*value = col->attr.tsync_enable;
+		break;
+	case SCMP_FLTATR_API_TSKIP:
+		*value = col->attr.api_tskip;
+		break;
+	case SCMP_FLTATR_CTL_LOG:
+		*value = col->attr.log_enable;
+		break;
+	case SCMP_FLTATR_CTL_SSB:
+		*value = col->attr.spec_allow;
+		break;
+	case SCMP_FLTATR_CTL_OPTIMIZE:
+		*value = col->attr.optimize;
+		break;
+	case SCMP_FLTATR_API_SYSRAWRC:
+		*value = col->attr.api_sysrawrc;
+		break;
+	case SCMP_FLTATR_CTL_THREADS:
+		*value = col->attr.threads;
+		break;
+	default:
+		rc = -EINVAL;
+		break;
+	}
+
+	return rc;
+}
+
+/**
+ * Get a filter attribute
+ * @param col the seccomp filter collection
+ * @param attr the filter attribute
+ *
+ * Returns the requested filter attribute value with zero on any error.
+ * Special care must be given with this function as error conditions can be
+ * hidden from the caller.
+ *
+ */
+uint32_t db_col_attr_read(const struct db_filter_col *col,
+			  enum scmp_filter_attr attr)
+{
+	uint32_t value = 0;
+
+	db_col_attr_get(col, attr, &value);
+	return value;
+}
+
+/**
+ * Set a filter attribute
+ * @param col the seccomp filter collection
+ * @param attr the filter attribute
+ * @param value the filter attribute value
+ *
+ * Set the requested filter attribute with the given value.  Returns zero on
+ * success, negative values on failure.
+ *
+ */
+int db_col_attr_set(struct db_filter_col *col,
+		    enum scmp_filter_attr attr, uint32_t value)
+{
+	int rc = 0;
+
+	_db_col_key_reset(col);
+
+	switch (attr) {
+	case SCMP_FLTATR_ACT_DEFAULT:
+		/* read only */
+		return -EACCES;
+		break;
+	case SCMP_FLTATR_ACT_BADARCH:
+		if (db_col_action_valid(col, value) == 0)
+			col->attr.act_badarch = value;
+		else
+			return -EINVAL;
+		break;
+	case SCMP_FLTATR_CTL_NNP:
+		col->attr.nnp_enable = (value ? 1 : 0);
+		break;
+	case SCMP_FLTATR_CTL_TSYNC:
+		rc = sys_chk_seccomp_flag(SECCOMP_FILTER_FLAG_TSYNC);
+		if (rc == 1) {
+			/* supported */
+			rc = 0;
+			/* kernel disallows TSYNC and NOTIFY in one filter
+			 * unless we have TSYNC_ESRCH */
+			if (sys_chk_seccomp_flag(SECCOMP_FILTER_FLAG_TSYNC_ESRCH) < 1 &&
+			    value && col->notify_used)
+				return -EINVAL;
+			col->attr.tsync_enable = (value ? 1 : 0);
+		} else if (rc == 0)
+			/* unsupported */
+			rc = -EOPNOTSUPP;
+		break;
+	case SCMP_FLTATR_API_TSKIP:
+		col->attr.api_tskip = (value ? 1 : 0);
+		break;
+	case SCMP_FLTATR_CTL_LOG:
+		rc = sys_chk_seccomp_flag(SECCOMP_FILTER_FLAG_LOG);
+		if (rc == 1) {
+			/* supported */
+			rc = 0;
+			col->attr.log_enable = (value ? 1 : 0);
+		} else if (rc == 0) {
+			/* unsupported */
+			rc = -EOPNOTSUPP;
+		}
+		break;
+	case SCMP_FLTATR_CTL_SSB:
+		rc = sys_chk_seccomp_flag(SECCOMP_FILTER_FLAG_SPEC_ALLOW);
+		if (rc == 1) {
+			/* supported */
+			rc = 0;
+			col->attr.spec_allow = (value ? 1 : 0);
+		} else if (rc == 0) {
+			/* unsupported */
+			rc = -EOPNOTSUPP;
+		}
+		break;
+	case SCMP_FLTATR_CTL_OPTIMIZE:
+		switch (value) {
+		case 1:
+		case 2:
+		case 3:
+		case 4:
+			col->attr.optimize = value;
+			break;
+		default:
+			rc = -EOPNOTSUPP;
+			break;
+		}
+		break;
+	case SCMP_FLTATR_API_SYSRAWRC:
+		col->attr.api_sysrawrc = (value ? 1 : 0);
+		break;
+	case SCMP_FLTATR_CTL_THREADS:
+		if (value >= 1 && value <= DB_THREADS_MAX)
+			col->attr.threads = value;
+		else
+			rc = -EINVAL;
+		break;
+	default:
+		rc = -EINVAL;
+		break;
+	}
+
+	return rc;
+}
+
+/**
+ * Add a new architecture filter to a filter collection
+ * @param col the seccomp filter collection
+ * @param arch the architecture
+ *
+ * This function adds a new architecture filter DB to an existing seccomp
+ * filter collection assuming there isn't a filter DB already present with the
+ * same architecture.  Returns zero on success, negative values on failure.
+ *
+ */
+int db_col_db_new(struct db_filter_col *col, const struct arch_def *arch)
+{
+	int rc;
+	struct db_filter *db;
+
+	db = _db_init(arch);
+	if (db == NULL)
+		return -ENOMEM;
+	rc = db_col_db_add(col, db);
+	if (rc < 0)
+		_db_release(db);
+
+	return rc;
+}
+
+/**
+ * Add a new filter DB to a filter collection
+ * @param col the seccomp filter collection
+ * @param db the seccomp filter DB
+ *
+ * This function adds an existing seccomp filter DB to an existing seccomp
+ * filter collection assuming there isn't a filter DB already present with the
+ * same architecture.  Returns zero on success, negative values on failure.
+ *
+ */
+int db_col_db_add(struct db_filter_col *col, struct db_filter *db)
+{
+	struct db_filter **dbs;
+
+	if (col->endian != 0 && col->endian != db->arch->endian)
+		return -EDOM;
+
+	if (db_col_arch_exist(col, db->arch->token))
+		return -EEXIST;
+
+	_db_col_key_reset(col);
+
+	dbs = realloc(col->filters,
+		      sizeof(struct db_filter *) * (col->filter_cnt + 1));
+	if (dbs == NULL)
+		return -ENOMEM;
+	col->filters = dbs;
+	col->filter_cnt++;
+	col->filters[col->filter_cnt - 1] = db;
+	if (col->endian == 0)
+		col->endian = db->arch->endian;
+
+	return 0;
+}
+
+/**
+ * Remove a filter DB from a filter collection
+ * @param col the seccomp filter collection
+ * @param arch_token the architecture token
+ *
+ * This function removes an existing seccomp filter DB from an existing seccomp
+ * filter collection.  Returns zero on success, negative values on failure.
+ *
+ */
+int db_col_db_remove(struct db_filter_col *col, uint32_t arch_token)
+{
+	unsigned int iter;
+	unsigned int found;
+	struct db_filter **dbs;
+
+	if ((col->filter_cnt <= 0) || (db_col_arch_exist(col, arch_token) == 0))
+		return -EINVAL;
+
+	_db_col_key_reset(col);
+
+	for (found = 0, iter = 0; iter < col->filter_cnt; iter++) {
+		if (found)
+			col->filters[iter - 1] = col->filters[iter];
+		else if (col->filters[iter]->arch->token == arch_token) {
+			_db_release(col->filters[iter]);
+			found = 1;
+		}
+	}
+	col->filters[--col->filter_cnt] = NULL;
+
+	if (col->filter_cnt > 0) {
+		/* NOTE: if we can't do the realloc it isn't fatal, we just
+		 *       have some extra space allocated */
+		dbs = realloc(col->filters,
+			      sizeof(struct db_filter *) * col->filter_cnt);
+		if (dbs != NULL)
+			col->filters = dbs;
+	} else {
+		/* this was the last filter so free all the associated memory
+		 * and reset the endian token */
+		free(col->filters);
+		col->filters = NULL;
+		col->endian = 0;
+	}
+
+	return 0;
+}
+
+/**
+ * Test if the argument filter can be skipped because it's a tautology
+ * @param arg argument filter
+ *
+ * If this argument filter applied to the lower 32 bit can be skipped this
+ * function returns false.
+ *
+ */
+static bool _db_arg_cmp_need_lo(const struct db_api_arg *arg)
+{
+	if (arg->op == SCMP_CMP_MASKED_EQ && D64_LO(arg->mask) == 0)
+		return false;
+
+	return true;
+}
+
+/**
+ * Test if the argument filter can be skipped because it's a tautology
+ * @param arg argument filter
+ *
+ * If this argument filter applied to the upper 32 bit can be skipped this
+ * function returns false.
+ *
+ */
+static bool _db_arg_cmp_need_hi(const struct db_api_arg *arg)
+{
+	if (arg->op == SCMP_CMP_MASKED_EQ && D64_HI(arg->mask) == 0)
+		return false;
+
+	return true;
+}
+
+/**
+ * Set the range or set values of a node
+ * @param node the chain node
+ * @param arg argument filter
+ *
+ * Store the lower 32 bits of the SCMP_CMP_IN_RANGE upper bound or of the
+ * SCMP_CMP_IN_SET values in the node, the set values replace the node's
+ * full datum value.  Returns zero on success, negative values on failure.
+ *
+ */
+static int _db_node_ext_set(struct db_arg_chain_tree *node,
+			    const struct db_api_arg *arg)
+{
+	unsigned int iter;
+
+	switch (arg->op) {
+	case SCMP_CMP_IN_RANGE:
+		node->datum_ext = D64_LO(arg->datum_max);
+		break;
+	case SCMP_CMP_IN_SET:
+		node->set = malloc(arg->set_cnt * sizeof(*node->set));
+		if (node->set == NULL)
+			return -ENOMEM;
+		/* NOTE: the values share the upper 32 bits so the lower 32
+		 *       bits are still sorted and unique */
+		for (iter = 0; iter < arg->set_cnt; iter++)
+			node->set[iter] = D64_LO(arg->set[iter]);
+		node->datum_ext = arg->set_cnt;
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+/**
+ * Fixup the node based on the op/mask
+ * @param node the chain node
+ *
+ * Ensure the datum is masked as well.
+ *
+ */
+static void _db_node_mask_fixup(struct db_arg_chain_tree *node)
+{
+	node->datum &= node->mask;
+}
+
+/**
+ * Generate a new filter rule for a 64 bit system
+ * @param db the seccomp filter db
+ * @param rule the new filter rule
+ *
+ * This function generates a new syscall filter for a 64 bit system. Returns
+ * zero on success, negative values on failure.
+ *
+ */
+static struct db_sys_list *_db_rule_gen_64(struct db_filter *db,
+					   const struct db_api_rule_list *rule)
+{
+	const struct arch_def *arch = db->arch;
+	unsigned int iter;
+	struct db_sys_list *s_new;
+	const struct db_api_arg *chain = rule->args;
+	struct db_arg_chain_tree *c_iter[3] = { NULL, NULL, NULL };
+	struct db_arg_chain_tree *c_prev[3] = { NULL, NULL, NULL };
+	enum scmp_compare op_prev = _SCMP_CMP_MIN;
+	unsigned int arg;
+	scmp_datum_t mask;
+	scmp_datum_t datum;
+
+	s_new = zmalloc(sizeof(*s_new));
+	if (s_new == NULL)
+		return NULL;
+	s_new->num = rule->syscall;
+	s_new->valid = true;
+	/* run through the argument chain */
+	for (iter = 0; iter < ARG_COUNT_MAX; iter++) {
+		if (chain[iter].valid == 0)
+			continue;
+
+		/* TODO: handle the case were either hi or lo isn't needed */
+
+		/* skip generating instruction which are no-ops */
+		if (!_db_arg_cmp_need_hi(&chain[iter]) &&
+		    !_db_arg_cmp_need_lo(&chain[iter]))
+			continue;
+
+		c_iter[0] = _db_node_alloc(db->node_pool);
+		if (c_iter[0] == NULL)
+			goto gen_64_failure;
+		c_iter[1] = _db_node_alloc(db->node_pool);
+		if (c_iter[1] == NULL) {
+			_db_node_free(c_iter[0]);
+			goto gen_64_failure;
+		}
+		c_iter[2] = NULL;
+
+		arg = chain[iter].arg;
+		mask = chain[iter].mask;
+		datum = chain[iter].datum;
+
+		/* NOTE: with the idea that a picture is worth a thousand
+		 *       words, i'm presenting the following diagrams which
+		 *       show how we should compare 64-bit syscall arguments
+		 *       using 32-bit comparisons.
+		 *
+		 *       in the diagrams below "A(x)" is the syscall argument
+		 *       being evaluated and "R(x)" is the syscall argument
+		 *       value specified in the libseccomp rule.  the "ACCEPT"
+		 *       verdict indicates a rule match and processing should
+		 *       continue on to the rest of the rule, or the final rule
+		 *       action should be triggered.  the "REJECT" verdict
+		 *       indicates that the rule does not match and processing
+		 *       should continue to the next rule or the default
+		 *       action.
+		 *
+		 * SCMP_CMP_GT:
+		 *                   +------------------+
+		 *                +--|  Ah(x) >  Rh(x)  |------+
+		 *                |  +------------------+      |
+		 *              FALSE                         TRUE     A
+		 *                |                            |       C
+		 *                +-----------+                +---->  C
+		 *                            v                +---->  E
+		 *                   +------------------+      |       P
+		 *                +--|  Ah(x) == Rh(x)  |--+   |       T
+		 *        R       |  +------------------+  |   |
+		 *        E     FALSE                     TRUE |
+		 *        J  <----+                        |   |
+		 *        E  <----+           +------------+   |
+		 *        C     FALSE         v                |
+		 *        T       |  +------------------+      |
+		 *                +--|  Al(x) >  Rl(x)  |------+
+		 *                   +------------------+
+		 *
+		 * SCMP_CMP_GE:
+		 *                   +------------------+
+		 *                +--|  Ah(x) >  Rh(x)  |------+
+		 *                |  +------------------+      |
+		 *              FALSE                         TRUE     A
+		 *                |                            |       C
+		 *                +-----------+                +---->  C
+		 *                            v                +---->  E
+		 *                   +------------------+      |       P
+		 *                +--|  Ah(x) == Rh(x)  |--+   |       T
+		 *        R       |  +------------------+  |   |
+		 *        E     FALSE                     TRUE |
+		 *        J  <----+                        |   |
+		 *        E  <----+           +------------+   |
+		 *        C     FALSE         v                |
+		 *        T       |  +------------------+      |
+		 *                +--|  Al(x) >= Rl(x)  |------+
+		 *                   +------------------+
+		 *
+		 * SCMP_CMP_LT:
+		 *                   +------------------+
+		 *                +--|  Ah(x) >  Rh(x)  |------+
+		 *                |  +------------------+      |
+		 *              FALSE                         TRUE     R
 		 *                |                            |       E
 		 *                +-----------+                +---->  J
 		 *                            v                +---->  E
@@ -1758,630 +3256,1299 @@ static struct db_sys_list *_db_rule_gen_64(const struct arch_def *arch,
 		 *
 		 */
 
-		/* setup the level */
-		switch (chain[iter].op) {
-		case SCMP_CMP_GT:
-		case SCMP_CMP_GE:
-		case SCMP_CMP_LE:
-		case SCMP_CMP_LT:
-			c_iter[2] = zmalloc(sizeof(*c_iter[2]));
-			if (c_iter[2] == NULL) {
-				free(c_iter[0]);
-				free(c_iter[1]);
-				goto gen_64_failure;
-			}
+		/* setup the level */
+		switch (chain[iter].op) {
+		case SCMP_CMP_GT:
+		case SCMP_CMP_GE:
+		case SCMP_CMP_LE:
+		case SCMP_CMP_LT:
+			c_iter[2] = _db_node_alloc(db->node_pool);
+			if (c_iter[2] == NULL) {
+				_db_node_free(c_iter[0]);
+				_db_node_free(c_iter[1]);
+				goto gen_64_failure;
+			}
+
+			c_iter[0]->arg = arg;
+			c_iter[1]->arg = arg;
+			c_iter[2]->arg = arg;
+			c_iter[0]->arg_h_flg = true;
+			c_iter[1]->arg_h_flg = true;
+			c_iter[2]->arg_h_flg = false;
+			c_iter[0]->arg_offset = arch_arg_offset_hi(arch, arg);
+			c_iter[1]->arg_offset = arch_arg_offset_hi(arch, arg);
+			c_iter[2]->arg_offset = arch_arg_offset_lo(arch, arg);
+
+			c_iter[0]->mask = D64_HI(mask);
+			c_iter[1]->mask = D64_HI(mask);
+			c_iter[2]->mask = D64_LO(mask);
+			c_iter[0]->datum = D64_HI(datum);
+			c_iter[1]->datum = D64_HI(datum);
+			c_iter[2]->datum = D64_LO(datum);
+			c_iter[0]->datum_full = datum;
+			c_iter[1]->datum_full = datum;
+			c_iter[2]->datum_full = datum;
+
+			_db_node_mask_fixup(c_iter[0]);
+			_db_node_mask_fixup(c_iter[1]);
+			_db_node_mask_fixup(c_iter[2]);
+
+			c_iter[0]->op = SCMP_CMP_GT;
+			c_iter[1]->op = SCMP_CMP_EQ;
+			switch (chain[iter].op) {
+			case SCMP_CMP_GT:
+			case SCMP_CMP_LE:
+				c_iter[2]->op = SCMP_CMP_GT;
+				break;
+			case SCMP_CMP_GE:
+			case SCMP_CMP_LT:
+				c_iter[2]->op = SCMP_CMP_GE;
+				break;
+			default:
+				/* we should never get here */
+				goto gen_64_failure;
+			}
+			c_iter[0]->op_orig = chain[iter].op;
+			c_iter[1]->op_orig = chain[iter].op;
+			c_iter[2]->op_orig = chain[iter].op;
+
+			c_iter[0]->nxt_f = _db_node_get(c_iter[1]);
+			c_iter[1]->nxt_t = _db_node_get(c_iter[2]);
+			break;
+		case SCMP_CMP_EQ:
+		case SCMP_CMP_MASKED_EQ:
+		case SCMP_CMP_NE:
+		case SCMP_CMP_IN_SET:
+		case SCMP_CMP_IN_RANGE:
+			c_iter[0]->arg = arg;
+			c_iter[1]->arg = arg;
+			c_iter[0]->arg_h_flg = true;
+			c_iter[1]->arg_h_flg = false;
+			c_iter[0]->arg_offset = arch_arg_offset_hi(arch, arg);
+			c_iter[1]->arg_offset = arch_arg_offset_lo(arch, arg);
+
+			c_iter[0]->mask = D64_HI(mask);
+			c_iter[1]->mask = D64_LO(mask);
+			c_iter[0]->datum = D64_HI(datum);
+			c_iter[1]->datum = D64_LO(datum);
+			c_iter[0]->datum_full = datum;
+			c_iter[1]->datum_full = datum;
+
+			_db_node_mask_fixup(c_iter[0]);
+			_db_node_mask_fixup(c_iter[1]);
+
+			switch (chain[iter].op) {
+			case SCMP_CMP_MASKED_EQ:
+				c_iter[0]->op = SCMP_CMP_MASKED_EQ;
+				c_iter[1]->op = SCMP_CMP_MASKED_EQ;
+				break;
+			case SCMP_CMP_IN_SET:
+			case SCMP_CMP_IN_RANGE:
+				/* the upper 32 bits are shared by all of the
+				 * values so only the lower 32 bits need the
+				 * set/range comparison */
+				c_iter[0]->op = SCMP_CMP_EQ;
+				c_iter[1]->op = chain[iter].op;
+				if (_db_node_ext_set(c_iter[1],
+						     &chain[iter]) < 0) {
+					_db_node_free(c_iter[0]);
+					_db_node_free(c_iter[1]);
+					goto gen_64_failure;
+				}
+				break;
+			default:
+				c_iter[0]->op = SCMP_CMP_EQ;
+				c_iter[1]->op = SCMP_CMP_EQ;
+			}
+			c_iter[0]->op_orig = chain[iter].op;
+			c_iter[1]->op_orig = chain[iter].op;
+
+			c_iter[0]->nxt_t = _db_node_get(c_iter[1]);
+			break;
+		default:
+			/* we should never get here */
+			goto gen_64_failure;
+		}
+
+		/* link this level to the previous level */
+		if (c_prev[0] != NULL) {
+			switch (op_prev) {
+			case SCMP_CMP_GT:
+			case SCMP_CMP_GE:
+				c_prev[0]->nxt_t = _db_node_get(c_iter[0]);
+				c_prev[2]->nxt_t = _db_node_get(c_iter[0]);
+				break;
+			case SCMP_CMP_EQ:
+			case SCMP_CMP_MASKED_EQ:
+			case SCMP_CMP_IN_SET:
+			case SCMP_CMP_IN_RANGE:
+				c_prev[1]->nxt_t = _db_node_get(c_iter[0]);
+				break;
+			case SCMP_CMP_LE:
+			case SCMP_CMP_LT:
+				c_prev[1]->nxt_f = _db_node_get(c_iter[0]);
+				c_prev[2]->nxt_f = _db_node_get(c_iter[0]);
+				break;
+			case SCMP_CMP_NE:
+				c_prev[0]->nxt_f = _db_node_get(c_iter[0]);
+				c_prev[1]->nxt_f = _db_node_get(c_iter[0]);
+				break;
+			default:
+				/* we should never get here */
+				goto gen_64_failure;
+			}
+		} else
+			s_new->chains = _db_node_get(c_iter[0]);
+
+		/* update the node count */
+		switch (chain[iter].op) {
+		case SCMP_CMP_NE:
+		case SCMP_CMP_EQ:
+		case SCMP_CMP_MASKED_EQ:
+		case SCMP_CMP_IN_SET:
+		case SCMP_CMP_IN_RANGE:
+			s_new->node_cnt += 2;
+			break;
+		default:
+			s_new->node_cnt += 3;
+		}
+
+		/* keep pointers to this level */
+		c_prev[0] = c_iter[0];
+		c_prev[1] = c_iter[1];
+		c_prev[2] = c_iter[2];
+		op_prev = chain[iter].op;
+	}
+	if (c_iter[0] != NULL) {
+		/* set the actions on the last layer */
+		switch (op_prev) {
+		case SCMP_CMP_GT:
+		case SCMP_CMP_GE:
+			c_iter[0]->act_t_flg = true;
+			c_iter[0]->act_t = rule->action;
+			c_iter[2]->act_t_flg = true;
+			c_iter[2]->act_t = rule->action;
+			break;
+		case SCMP_CMP_LE:
+		case SCMP_CMP_LT:
+			c_iter[1]->act_f_flg = true;
+			c_iter[1]->act_f = rule->action;
+			c_iter[2]->act_f_flg = true;
+			c_iter[2]->act_f = rule->action;
+			break;
+		case SCMP_CMP_EQ:
+		case SCMP_CMP_MASKED_EQ:
+		case SCMP_CMP_IN_SET:
+		case SCMP_CMP_IN_RANGE:
+			c_iter[1]->act_t_flg = true;
+			c_iter[1]->act_t = rule->action;
+			break;
+		case SCMP_CMP_NE:
+			c_iter[0]->act_f_flg = true;
+			c_iter[0]->act_f = rule->action;
+			c_iter[1]->act_f_flg = true;
+			c_iter[1]->act_f = rule->action;
+			break;
+		default:
+			/* we should never get here */
+			goto gen_64_failure;
+		}
+	} else
+		s_new->action = rule->action;
+
+	return s_new;
+
+gen_64_failure:
+	/* free the new chain and its syscall struct */
+	_db_tree_put(&s_new->chains);
+	free(s_new);
+	return NULL;
+}
+
+/**
+ * Generate a new filter rule for a 32 bit system
+ * @param db the seccomp filter db
+ * @param rule the new filter rule
+ *
+ * This function generates a new syscall filter for a 32 bit system. Returns
+ * zero on success, negative values on failure.
+ *
+ */
+static struct db_sys_list *_db_rule_gen_32(struct db_filter *db,
+					   const struct db_api_rule_list *rule)
+{
+	const struct arch_def *arch = db->arch;
+	unsigned int iter;
+	struct db_sys_list *s_new;
+	const struct db_api_arg *chain = rule->args;
+	struct db_arg_chain_tree *c_iter = NULL, *c_prev = NULL;
+	bool tf_flag;
+
+	s_new = zmalloc(sizeof(*s_new));
+	if (s_new == NULL)
+		return NULL;
+	s_new->num = rule->syscall;
+	s_new->valid = true;
+	/* run through the argument chain */
+	for (iter = 0; iter < ARG_COUNT_MAX; iter++) {
+		if (chain[iter].valid == 0)
+			continue;
+
+		/* skip generating instructions which are no-ops */
+		if (!_db_arg_cmp_need_lo(&chain[iter]))
+			continue;
+
+		c_iter = _db_node_alloc(db->node_pool);
+		if (c_iter == NULL)
+			goto gen_32_failure;
+		c_iter->arg = chain[iter].arg;
+		c_iter->arg_h_flg = false;
+		c_iter->arg_offset = arch_arg_offset(arch, c_iter->arg);
+		c_iter->op = chain[iter].op;
+		c_iter->op_orig = chain[iter].op;
+		/* implicitly strips off the upper 32 bit */
+		c_iter->mask = chain[iter].mask;
+		c_iter->datum = chain[iter].datum;
+		c_iter->datum_full = chain[iter].datum;
+		if (_db_node_ext_set(c_iter, &chain[iter]) < 0) {
+			_db_node_free(c_iter);
+			goto gen_32_failure;
+		}
+
+		/* link in the new node and update the chain */
+		if (c_prev != NULL) {
+			if (tf_flag)
+				c_prev->nxt_t = _db_node_get(c_iter);
+			else
+				c_prev->nxt_f = _db_node_get(c_iter);
+		} else
+			s_new->chains = _db_node_get(c_iter);
+		s_new->node_cnt++;
+
+		/* rewrite the op to reduce the op/datum combos */
+		switch (c_iter->op) {
+		case SCMP_CMP_NE:
+			c_iter->op = SCMP_CMP_EQ;
+			tf_flag = false;
+			break;
+		case SCMP_CMP_LT:
+			c_iter->op = SCMP_CMP_GE;
+			tf_flag = false;
+			break;
+		case SCMP_CMP_LE:
+			c_iter->op = SCMP_CMP_GT;
+			tf_flag = false;
+			break;
+		default:
+			tf_flag = true;
+		}
+
+		/* fixup the mask/datum */
+		_db_node_mask_fixup(c_iter);
+
+		c_prev = c_iter;
+	}
+	if (c_iter != NULL) {
+		/* set the leaf node */
+		if (tf_flag) {
+			c_iter->act_t_flg = true;
+			c_iter->act_t = rule->action;
+		} else {
+			c_iter->act_f_flg = true;
+			c_iter->act_f = rule->action;
+		}
+	} else
+		s_new->action = rule->action;
+
+	return s_new;
+
+gen_32_failure:
+	/* free the new chain and its syscall struct */
+	_db_tree_put(&s_new->chains);
+	free(s_new);
+	return NULL;
+}
+
+/**
+ * Add a new rule to the seccomp filter DB
+ * @param db the seccomp filter db
+ * @param rule the filter rule
+ *
+ * This function adds a new syscall filter to the seccomp filter DB, adding to
+ * the existing filters for the syscall, unless no argument specific filters
+ * are present (filtering only on the syscall).  When adding new chains, the
+ * shortest chain, or most inclusive filter match, will be entered into the
+ * filter DB. Returns zero on success, negative values on failure.
+ *
+ * It is important to note that in the case of failure the db may be corrupted,
+ * the caller must use the transaction mechanism if the db integrity is
+ * important.
+ *
+ */
+int db_rule_add(struct db_filter *db, const struct db_api_rule_list *rule)
+{
+	int rc = -ENOMEM;
+	unsigned int pos;
+	struct db_sys_list *s_new, *s_iter = NULL;
+	struct db_iter_state state;
+	bool rm_flag = false;
+
+	assert(db != NULL);
+
+	/* find a matching syscall/chain or reserve room for a new one */
+	if (_db_sys_idx_find(db, rule->syscall, &pos)) {
+		s_iter = _db_sys_own(db, pos);
+		if (s_iter == NULL)
+			return -ENOMEM;
+	} else if (_db_sys_idx_reserve(db) < 0)
+		return -ENOMEM;
+
+	/* do all our possible memory allocation up front so we don't have to
+	 * worry about failure once we get to the point where we start updating
+	 * the filter db */
+	if (db->arch->size == ARCH_SIZE_64)
+		s_new = _db_rule_gen_64(db, rule);
+	else if (db->arch->size == ARCH_SIZE_32)
+		s_new = _db_rule_gen_32(db, rule);
+	else
+		return -EFAULT;
+	if (s_new == NULL)
+		return -ENOMEM;
+
+	s_new->priority = _DB_PRI_MASK_CHAIN - s_new->node_cnt;
+add_reset:
+	if (s_iter == NULL) {
+		/* new syscall, add it in order */
+		s_new->refcnt = 1;
+		_db_sys_idx_insert(db, s_new, pos);
+		db->syscall_cnt++;
+		return 0;
+	} else if (s_iter->chains == NULL) {
+		if (rm_flag || !s_iter->valid) {
+			/* we are here because our previous pass cleared the
+			 * entire syscall chain when searching for a subtree
+			 * match or the existing syscall entry is a phantom,
+			 * so either way add the new chain */
+			s_iter->chains = s_new->chains;
+			s_iter->action = s_new->action;
+			s_iter->node_cnt = s_new->node_cnt;
+			if (s_iter->valid)
+				s_iter->priority = s_new->priority;
+			s_iter->valid = true;
+			free(s_new);
+			rc = 0;
+			goto add_priority_update;
+		} else {
+			/* syscall exists without any chains - existing filter
+			 * is at least as large as the new entry so cleanup and
+			 * exit */
+			_db_tree_put(&s_new->chains);
+			free(s_new);
+			goto add_free_ok;
+		}
+	} else if (s_iter->chains != NULL && s_new->chains == NULL) {
+		/* syscall exists with chains but the new filter has no chains
+		 * so we need to clear the existing chains and exit */
+		_db_tree_put(&s_iter->chains);
+		s_iter->chains = NULL;
+		s_iter->node_cnt = 0;
+		s_iter->action = rule->action;
+
+		/* cleanup the new tree and return */
+		_db_tree_put(&s_new->chains);
+		free(s_new);
+		goto add_free_ok;
+	}
+
+	/* prune any sub-trees that are no longer required */
+	memset(&state, 0, sizeof(state));
+	state.sx = s_iter;
+	state.action = rule->action;
+	rc = _db_tree_prune(&s_iter->chains, s_new->chains, &state);
+	if (rc > 0) {
+		/* we pruned at least some of the existing tree */
+		rm_flag = true;
+		s_iter->node_cnt -= rc;
+		if (s_iter->chains == NULL)
+			/* we pruned the entire tree */
+			goto add_reset;
+	} else if ((state.flags & _DB_IST_M_REDUNDANT) == _DB_IST_M_REDUNDANT) {
+		/* the existing tree is "shorter", drop the new one */
+		_db_tree_put(&s_new->chains);
+		free(s_new);
+		goto add_free_ok;
+	}
+
+	/* add the new rule to the existing filter and cleanup */
+	memset(&state, 0, sizeof(state));
+	state.sx = s_iter;
+	rc = _db_tree_add(&s_iter->chains, s_new->chains, &state);
+	if (rc < 0)
+		goto add_failure;
+	s_iter->node_cnt += s_new->node_cnt;
+	s_iter->node_cnt -= _db_tree_put(&s_new->chains);
+	free(s_new);
+
+add_free_ok:
+	rc = 0;
+add_priority_update:
+	/* update the priority */
+	if (s_iter != NULL) {
+		s_iter->priority &= (~_DB_PRI_MASK_CHAIN);
+		s_iter->priority |= (_DB_PRI_MASK_CHAIN - s_iter->node_cnt);
+	}
+	return rc;
+
+add_failure:
+	/* NOTE: another reminder that we don't do any db error recovery here,
+	 * use the transaction mechanism as previously mentioned */
+	_db_tree_put(&s_new->chains);
+	free(s_new);
+	return rc;
+}
+
+/**
+ * Set the priority of a given syscall
+ * @param col the filter collection
+ * @param syscall the syscall number
+ * @param priority priority value, higher value == higher priority
+ *
+ * This function sets the priority of the given syscall; this value is used
+ * when generating the seccomp filter code such that higher priority syscalls
+ * will incur less filter code overhead than the lower priority syscalls in the
+ * filter.  Returns zero on success, negative values on failure.
+ *
+ */
+int db_col_syscall_priority(struct db_filter_col *col,
+			    int syscall, uint8_t priority)
+{
+	int rc = 0, rc_tmp;
+	unsigned int iter;
+	int sc_tmp;
+	struct db_filter *filter;
+
+	_db_col_key_reset(col);
+	_db_col_shadow_drop(col);
+	rc = _db_col_unshare(col);
+	if (rc < 0)
+		return rc;
+
+	for (iter = 0; iter < col->filter_cnt; iter++) {
+		filter = col->filters[iter];
+		sc_tmp = syscall;
+
+		rc_tmp = arch_syscall_translate(filter->arch, &sc_tmp);
+		if (rc_tmp < 0)
+			goto priority_failure;
+
+		/* if this is a pseudo syscall then we need to rewrite the
+		 * syscall for some arch specific reason, don't forget the
+		 * special handling for syscall -1 */
+		if (sc_tmp < -1) {
+			/* we set this as a strict op - we don't really care
+			 * since priorities are a "best effort" thing - as we
+			 * want to catch the -EDOM error and bail on this
+			 * architecture */
+			rc_tmp = arch_syscall_rewrite(filter->arch, &sc_tmp);
+			if (rc_tmp == -EDOM)
+				continue;
+			if (rc_tmp < 0)
+				goto priority_failure;
+		}
+
+		rc_tmp = _db_syscall_priority(filter, sc_tmp, priority);
+
+priority_failure:
+		if (rc == 0 && rc_tmp < 0)
+			rc = rc_tmp;
+	}
+
+	return rc;
+}
+
+/**
+ * Set the weight of a given syscall
+ * @param col the filter collection
+ * @param syscall the syscall number
+ * @param weight the relative frequency of the syscall
+ *
+ * This function sets the weight of the given syscall; this value is used by
+ * the search tree based optimization levels when generating the seccomp filter
+ * code such that more frequent syscalls are checked with fewer instructions
+ * than less frequent syscalls.  Returns zero on success, negative values on
+ * failure.
+ *
+ */
+int db_col_syscall_weight(struct db_filter_col *col,
+			  int syscall, uint32_t weight)
+{
+	int rc = 0, rc_tmp;
+	unsigned int iter;
+	int sc_tmp;
+	struct db_filter *filter;
+
+	_db_col_key_reset(col);
+	_db_col_shadow_drop(col);
+	rc = _db_col_unshare(col);
+	if (rc < 0)
+		return rc;
 
-			c_iter[0]->arg = arg;
-			c_iter[1]->arg = arg;
-			c_iter[2]->arg = arg;
-			c_iter[0]->arg_h_flg = true;
-			c_iter[1]->arg_h_flg = true;
-			c_iter[2]->arg_h_flg = false;
-			c_iter[0]->arg_offset = arch_arg_offset_hi(arch, arg);
-			c_iter[1]->arg_offset = arch_arg_offset_hi(arch, arg);
-			c_iter[2]->arg_offset = arch_arg_offset_lo(arch, arg);
+	for (iter = 0; iter < col->filter_cnt; iter++) {
+		filter = col->filters[iter];
+		sc_tmp = syscall;
 
-			c_iter[0]->mask = D64_HI(mask);
-			c_iter[1]->mask = D64_HI(mask);
-			c_iter[2]->mask = D64_LO(mask);
-			c_iter[0]->datum = D64_HI(datum);
-			c_iter[1]->datum = D64_HI(datum);
-			c_iter[2]->datum = D64_LO(datum);
-			c_iter[0]->datum_full = datum;
-			c_iter[1]->datum_full = datum;
-			c_iter[2]->datum_full = datum;
+		rc_tmp = arch_syscall_translate(filter->arch, &sc_tmp);
+		if (rc_tmp < 0)
+			goto weight_failure;
 
-			_db_node_mask_fixup(c_iter[0]);
-			_db_node_mask_fixup(c_iter[1]);
-			_db_node_mask_fixup(c_iter[2]);
+		/* as with the priority, weights are a "best effort" thing so
+		 * skip any architectures where the pseudo syscall can't be
+		 * rewritten */
+		if (sc_tmp < -1) {
+			rc_tmp = arch_syscall_rewrite(filter->arch, &sc_tmp);
+			if (rc_tmp == -EDOM)
+				continue;
+			if (rc_tmp < 0)
+				goto weight_failure;
+		}
 
-			c_iter[0]->op = SCMP_CMP_GT;
-			c_iter[1]->op = SCMP_CMP_EQ;
-			switch (chain[iter].op) {
-			case SCMP_CMP_GT:
-			case SCMP_CMP_LE:
-				c_iter[2]->op = SCMP_CMP_GT;
-				break;
-			case SCMP_CMP_GE:
-			case SCMP_CMP_LT:
-				c_iter[2]->op = SCMP_CMP_GE;
-				break;
-			default:
-				/* we should never get here */
-				goto gen_64_failure;
-			}
-			c_iter[0]->op_orig = chain[iter].op;
-			c_iter[1]->op_orig = chain[iter].op;
-			c_iter[2]->op_orig = chain[iter].op;
+		rc_tmp = _db_syscall_weight(filter, sc_tmp, weight);
 
-			c_iter[0]->nxt_f = _db_node_get(c_iter[1]);
-			c_iter[1]->nxt_t = _db_node_get(c_iter[2]);
-			break;
-		case SCMP_CMP_EQ:
-		case SCMP_CMP_MASKED_EQ:
-		case SCMP_CMP_NE:
-			c_iter[0]->arg = arg;
-			c_iter[1]->arg = arg;
-			c_iter[0]->arg_h_flg = true;
-			c_iter[1]->arg_h_flg = false;
-			c_iter[0]->arg_offset = arch_arg_offset_hi(arch, arg);
-			c_iter[1]->arg_offset = arch_arg_offset_lo(arch, arg);
+weight_failure:
+		if (rc == 0 && rc_tmp < 0)
+			rc = rc_tmp;
+	}
 
-			c_iter[0]->mask = D64_HI(mask);
-			c_iter[1]->mask = D64_LO(mask);
-			c_iter[0]->datum = D64_HI(datum);
-			c_iter[1]->datum = D64_LO(datum);
-			c_iter[0]->datum_full = datum;
-			c_iter[1]->datum_full = datum;
+	return rc;
+}
 
-			_db_node_mask_fixup(c_iter[0]);
-			_db_node_mask_fixup(c_iter[1]);
+/**
+ * Add a new rule to a single filter
+ * @param filter the filter
+ * @param rule the filter rule
+ *
+ * This is a helper function for db_col_rule_add() and similar functions, it
+ * isn't generally useful.  On success the filter takes over the caller's
+ * reference to the rule.  Returns zero on success, negative values on error.
+ *
+ */
+static int _db_col_rule_add(struct db_filter *filter,
+			    struct db_api_rule_list *rule)
+{
+	int rc;
 
-			switch (chain[iter].op) {
-			case SCMP_CMP_MASKED_EQ:
-				c_iter[0]->op = SCMP_CMP_MASKED_EQ;
-				c_iter[1]->op = SCMP_CMP_MASKED_EQ;
-				break;
-			default:
-				c_iter[0]->op = SCMP_CMP_EQ;
-				c_iter[1]->op = SCMP_CMP_EQ;
-			}
-			c_iter[0]->op_orig = chain[iter].op;
-			c_iter[1]->op_orig = chain[iter].op;
+	/* make sure we can add the rule to the rule list */
+	rc = _db_rule_vec_reserve(filter, 1);
+	if (rc < 0)
+		return rc;
 
-			c_iter[0]->nxt_t = _db_node_get(c_iter[1]);
-			break;
-		default:
-			/* we should never get here */
-			goto gen_64_failure;
-		}
+	/* add the rule to the filter */
+	rc = arch_filter_rule_add(filter, rule);
+	if (rc != 0)
+		return rc;
 
-		/* link this level to the previous level */
-		if (c_prev[0] != NULL) {
-			switch (op_prev) {
-			case SCMP_CMP_GT:
+	/* add the rule to the end of the rule list */
+	_db_rule_vec_append(filter, rule);
+
+	return 0;
+}
+
+/**
+ * Build the argument chain for a new rule
+ * @param arg_cnt the number of argument filters in the argument filter chain
+ * @param arg_array the argument filter chain, (uint, enum scmp_compare, ulong)
+ * @param chain the argument chain, ARG_COUNT_MAX zeroed entries
+ *
+ * This function converts the API argument comparisons into the argument chain
+ * used by the filter DB.  Returns zero on success, negative values on failure.
+ *
+ */
+static int _db_rule_chain(unsigned int arg_cnt,
+			  const struct scmp_arg_cmp *arg_array,
+			  struct db_api_arg *chain)
+{
+	unsigned int iter, s_iter;
+	unsigned int arg_num;
+	struct scmp_arg_cmp arg_data;
+	const scmp_datum_t *set;
+
+	for (iter = 0; iter < arg_cnt; iter++) {
+		arg_data = arg_array[iter];
+		arg_num = arg_data.arg;
+		if (arg_num < ARG_COUNT_MAX && chain[arg_num].valid == 0) {
+			chain[arg_num].valid = 1;
+			chain[arg_num].arg = arg_num;
+			chain[arg_num].op = arg_data.op;
+			/* TODO: we should check datum/mask size against the
+			 *	 arch definition, e.g. 64 bit datum on x86 */
+			switch (chain[arg_num].op) {
+			case SCMP_CMP_NE:
+			case SCMP_CMP_LT:
+			case SCMP_CMP_LE:
+			case SCMP_CMP_EQ:
 			case SCMP_CMP_GE:
-				c_prev[0]->nxt_t = _db_node_get(c_iter[0]);
-				c_prev[2]->nxt_t = _db_node_get(c_iter[0]);
+			case SCMP_CMP_GT:
+				chain[arg_num].mask = DATUM_MAX;
+				chain[arg_num].datum = arg_data.datum_a;
 				break;
-			case SCMP_CMP_EQ:
 			case SCMP_CMP_MASKED_EQ:
-				c_prev[1]->nxt_t = _db_node_get(c_iter[0]);
+				chain[arg_num].mask = arg_data.datum_a;
+				chain[arg_num].datum = arg_data.datum_b;
 				break;
-			case SCMP_CMP_LE:
-			case SCMP_CMP_LT:
-				c_prev[1]->nxt_f = _db_node_get(c_iter[0]);
-				c_prev[2]->nxt_f = _db_node_get(c_iter[0]);
+			case SCMP_CMP_IN_RANGE:
+				/* the range must be within a single 32-bit
+				 * high word */
+				if (arg_data.datum_a > arg_data.datum_b ||
+				    (arg_data.datum_a >> 32) !=
+				    (arg_data.datum_b >> 32))
+					return -EINVAL;
+				chain[arg_num].mask = DATUM_MAX;
+				chain[arg_num].datum = arg_data.datum_a;
+				chain[arg_num].datum_max = arg_data.datum_b;
 				break;
-			case SCMP_CMP_NE:
-				c_prev[0]->nxt_f = _db_node_get(c_iter[0]);
-				c_prev[1]->nxt_f = _db_node_get(c_iter[0]);
+			case SCMP_CMP_IN_SET:
+				set = (const scmp_datum_t *)
+				      (uintptr_t)arg_data.datum_a;
+				if (set == NULL || arg_data.datum_b == 0 ||
+				    arg_data.datum_b > ARG_SET_MAX)
+					return -EINVAL;
+				/* the values must share a 32-bit high word */
+				for (s_iter = 1; s_iter < arg_data.datum_b;
+				     s_iter++)
+					if ((set[s_iter] >> 32) != (set[0] >> 32))
+						return -EINVAL;
+				chain[arg_num].mask = DATUM_MAX;
+				chain[arg_num].datum = set[0];
+				chain[arg_num].set = set;
+				chain[arg_num].set_cnt = arg_data.datum_b;
 				break;
 			default:
-				/* we should never get here */
-				goto gen_64_failure;
+				return -EINVAL;
 			}
 		} else
-			s_new->chains = _db_node_get(c_iter[0]);
+			return -EINVAL;
+	}
 
-		/* update the node count */
-		switch (chain[iter].op) {
-		case SCMP_CMP_NE:
-		case SCMP_CMP_EQ:
-		case SCMP_CMP_MASKED_EQ:
-			s_new->node_cnt += 2;
-			break;
-		default:
-			s_new->node_cnt += 3;
-		}
+	return 0;
+}
 
-		/* keep pointers to this level */
-		c_prev[0] = c_iter[0];
-		c_prev[1] = c_iter[1];
-		c_prev[2] = c_iter[2];
-		op_prev = chain[iter].op;
-	}
-	if (c_iter[0] != NULL) {
-		/* set the actions on the last layer */
-		switch (op_prev) {
-		case SCMP_CMP_GT:
-		case SCMP_CMP_GE:
-			c_iter[0]->act_t_flg = true;
-			c_iter[0]->act_t = rule->action;
-			c_iter[2]->act_t_flg = true;
-			c_iter[2]->act_t = rule->action;
-			break;
-		case SCMP_CMP_LE:
-		case SCMP_CMP_LT:
-			c_iter[1]->act_f_flg = true;
-			c_iter[1]->act_f = rule->action;
-			c_iter[2]->act_f_flg = true;
-			c_iter[2]->act_f = rule->action;
-			break;
-		case SCMP_CMP_EQ:
-		case SCMP_CMP_MASKED_EQ:
-			c_iter[1]->act_t_flg = true;
-			c_iter[1]->act_t = rule->action;
-			break;
-		case SCMP_CMP_NE:
-			c_iter[0]->act_f_flg = true;
-			c_iter[0]->act_f = rule->action;
-			c_iter[1]->act_f_flg = true;
-			c_iter[1]->act_f = rule->action;
-			break;
-		default:
-			/* we should never get here */
-			goto gen_64_failure;
+/**
+ * Add a new rule to each filter in the collection
+ * @param col the filter collection
+ * @param strict the strict flag
+ * @param action the filter action
+ * @param syscall the syscall number
+ * @param chain the argument chain
+ *
+ * This function adds the rule to every filter in the collection, the caller
+ * is responsible for wrapping the call in a transaction.  Returns zero on
+ * success, negative values on failure.
+ *
+ */
+static int _db_col_rule_add_all(struct db_filter_col *col,
+				bool strict, uint32_t action, int syscall,
+				struct db_api_arg *chain)
+{
+	int rc = 0, rc_tmp;
+	unsigned int iter;
+	struct db_api_rule_list *rule;
+	struct db_filter *db;
+
+	for (iter = 0; iter < col->filter_cnt; iter++) {
+		db = col->filters[iter];
+
+		/* create the rule */
+		rule = _db_rule_new(strict, action, syscall, chain);
+		if (rule == NULL) {
+			rc_tmp = -ENOMEM;
+			goto add_arch_fail;
 		}
-	} else
-		s_new->action = rule->action;
 
-	return s_new;
+		/* add the rule */
+		rc_tmp = _db_col_rule_add(db, rule);
+		if (rc_tmp != 0)
+			free(rule);
+
+add_arch_fail:
+		if (rc_tmp != 0 && rc == 0)
+			rc = rc_tmp;
+	}
 
-gen_64_failure:
-	/* free the new chain and its syscall struct */
-	_db_tree_put(&s_new->chains);
-	free(s_new);
-	return NULL;
+	return rc;
 }
 
 /**
- * Generate a new filter rule for a 32 bit system
- * @param arch the architecture definition
- * @param rule the new filter rule
+ * Add a new rule to the current filter
+ * @param col the filter collection
+ * @param strict the strict flag
+ * @param action the filter action
+ * @param syscall the syscall number
+ * @param arg_cnt the number of argument filters in the argument filter chain
+ * @param arg_array the argument filter chain, (uint, enum scmp_compare, ulong)
  *
- * This function generates a new syscall filter for a 32 bit system. Returns
+ * This function adds a new argument/comparison/value to the seccomp filter for
+ * a syscall; multiple arguments can be specified and they will be chained
+ * together (essentially AND'd together) in the filter.  When the strict flag
+ * is true the function will fail if the exact rule can not be added to the
+ * filter, if the strict flag is false the function will not fail if the
+ * function needs to adjust the rule due to architecture specifics.  Returns
  * zero on success, negative values on failure.
  *
  */
-static struct db_sys_list *_db_rule_gen_32(const struct arch_def *arch,
-					   const struct db_api_rule_list *rule)
+int db_col_rule_add(struct db_filter_col *col,
+		    bool strict, uint32_t action, int syscall,
+		    unsigned int arg_cnt, const struct scmp_arg_cmp *arg_array)
+{
+	int rc = 0;
+	size_t chain_size;
+	struct db_api_arg *chain = NULL;
+
+	_db_col_key_reset(col);
+
+	/* collect the arguments for the filter rule */
+	chain_size = sizeof(*chain) * ARG_COUNT_MAX;
+	chain = zmalloc(chain_size);
+	if (chain == NULL)
+		return -ENOMEM;
+	rc = _db_rule_chain(arg_cnt, arg_array, chain);
+	if (rc != 0)
+		goto add_return;
+
+	/* create a checkpoint */
+	rc = db_col_transaction_start(col);
+	if (rc != 0)
+		goto add_return;
+
+	/* add the rule to the different filters in the collection */
+	rc = _db_col_rule_add_all(col, strict, action, syscall, chain);
+
+	/* commit the transaction or abort */
+	if (rc == 0)
+		db_col_transaction_commit(col);
+	else
+		db_col_transaction_abort(col);
+
+add_return:
+	/* update the misc state */
+	if (rc == 0 && action == SCMP_ACT_NOTIFY)
+		col->notify_used = true;
+	if (chain != NULL)
+		free(chain);
+	return rc;
+}
+
+/**
+ * Add a batch of new rules to the current filter
+ * @param col the filter collection
+ * @param strict the strict flag
+ * @param rules the array of rules
+ * @param rule_cnt the number of rules
+ *
+ * This function adds all of the given rules to the seccomp filter inside a
+ * single transaction; if any of the rules can not be added the entire batch
+ * is rolled back.  The result of each individual rule is stored in its @rc
+ * field.  See db_col_rule_add() for a description of the strict flag.
+ * Returns zero on success, the first failure otherwise.
+ *
+ */
+int db_col_rule_add_batch(struct db_filter_col *col, bool strict,
+			  struct scmp_rule *rules, unsigned int rule_cnt)
 {
+	int rc = 0;
 	unsigned int iter;
-	struct db_sys_list *s_new;
-	const struct db_api_arg *chain = rule->args;
-	struct db_arg_chain_tree *c_iter = NULL, *c_prev = NULL;
-	bool tf_flag;
+	size_t chain_size;
+	bool notify_used = false;
+	struct db_api_arg *chain = NULL;
+	struct scmp_rule *entry;
 
-	s_new = zmalloc(sizeof(*s_new));
-	if (s_new == NULL)
-		return NULL;
-	s_new->num = rule->syscall;
-	s_new->valid = true;
-	/* run through the argument chain */
-	for (iter = 0; iter < ARG_COUNT_MAX; iter++) {
-		if (chain[iter].valid == 0)
-			continue;
+	_db_col_key_reset(col);
 
-		/* skip generating instructions which are no-ops */
-		if (!_db_arg_cmp_need_lo(&chain[iter]))
-			continue;
+	chain_size = sizeof(*chain) * ARG_COUNT_MAX;
+	chain = malloc(chain_size);
+	if (chain == NULL)
+		return -ENOMEM;
 
-		c_iter = zmalloc(sizeof(*c_iter));
-		if (c_iter == NULL)
-			goto gen_32_failure;
-		c_iter->arg = chain[iter].arg;
-		c_iter->arg_h_flg = false;
-		c_iter->arg_offset = arch_arg_offset(arch, c_iter->arg);
-		c_iter->op = chain[iter].op;
-		c_iter->op_orig = chain[iter].op;
-		/* implicitly strips off the upper 32 bit */
-		c_iter->mask = chain[iter].mask;
-		c_iter->datum = chain[iter].datum;
-		c_iter->datum_full = chain[iter].datum;
+	/* create a single checkpoint for the entire batch */
+	rc = db_col_transaction_start(col);
+	if (rc != 0)
+		goto add_return;
 
-		/* link in the new node and update the chain */
-		if (c_prev != NULL) {
-			if (tf_flag)
-				c_prev->nxt_t = _db_node_get(c_iter);
-			else
-				c_prev->nxt_f = _db_node_get(c_iter);
-		} else
-			s_new->chains = _db_node_get(c_iter);
-		s_new->node_cnt++;
+	/* NOTE: we keep going after a failure so that the caller gets the
+	 *       result of every rule, the transaction is aborted anyway */
+	for (iter = 0; iter < rule_cnt; iter++) {
+		entry = &rules[iter];
+
+		memset(chain, 0, chain_size);
+		entry->rc = _db_rule_chain(entry->arg_cnt, entry->arg_array,
+					   chain);
+		if (entry->rc == 0)
+			entry->rc = _db_col_rule_add_all(col, strict,
+							 entry->action,
+							 entry->syscall,
+							 chain);
+		if (entry->rc == 0 && entry->action == SCMP_ACT_NOTIFY)
+			notify_used = true;
+		if (entry->rc != 0 && rc == 0)
+			rc = entry->rc;
+	}
 
-		/* rewrite the op to reduce the op/datum combos */
-		switch (c_iter->op) {
-		case SCMP_CMP_NE:
-			c_iter->op = SCMP_CMP_EQ;
-			tf_flag = false;
-			break;
-		case SCMP_CMP_LT:
-			c_iter->op = SCMP_CMP_GE;
-			tf_flag = false;
-			break;
-		case SCMP_CMP_LE:
-			c_iter->op = SCMP_CMP_GT;
-			tf_flag = false;
-			break;
-		default:
-			tf_flag = true;
-		}
+	/* commit the transaction or abort */
+	if (rc == 0)
+		db_col_transaction_commit(col);
+	else
+		db_col_transaction_abort(col);
 
-		/* fixup the mask/datum */
-		_db_node_mask_fixup(c_iter);
+add_return:
+	/* update the misc state */
+	if (rc == 0 && notify_used)
+		col->notify_used = true;
+	free(chain);
+	return rc;
+}
 
-		c_prev = c_iter;
+/**
+ * Rebuild a syscall filter from the rules in the seccomp filter DB
+ * @param db the seccomp filter db
+ * @param syscall the syscall number
+ *
+ * This function discards the filter for the given syscall and adds back only
+ * those rules in the DB's rule list which apply to the syscall; the syscall's
+ * priority and weight are preserved.  This must not be used on architectures
+ * which rewrite rules across multiple syscalls, see _db_rebuild().  Returns
+ * zero on success, negative values on failure.
+ *
+ */
+static int _db_syscall_rebuild(struct db_filter *db, int syscall)
+{
+	int rc;
+	int sc_tmp = syscall;
+	unsigned int pos, r_pos;
+	unsigned int priority = 0;
+	uint32_t weight = 0;
+	struct db_sys_list *s_iter;
+	struct db_api_rule_list *r_iter;
+
+	rc = arch_syscall_translate(db->arch, &sc_tmp);
+	if (rc < 0)
+		return rc;
+
+	/* remove the existing syscall filter */
+	if (_db_sys_idx_find(db, sc_tmp, &pos)) {
+		s_iter = db->sys_idx[pos];
+		priority = s_iter->priority & _DB_PRI_MASK_USER;
+		weight = s_iter->weight;
+		if (s_iter->valid && db->syscall_cnt > 0)
+			db->syscall_cnt--;
+		_db_sys_idx_remove(db, pos);
 	}
-	if (c_iter != NULL) {
-		/* set the leaf node */
-		if (tf_flag) {
-			c_iter->act_t_flg = true;
-			c_iter->act_t = rule->action;
-		} else {
-			c_iter->act_f_flg = true;
-			c_iter->act_f = rule->action;
+
+	/* add back the rules for this syscall */
+	/* NOTE: the syscall translation is one-to-one so we can match on the
+	 *       untranslated syscall numbers */
+	db_rule_foreach(r_iter, r_pos, db) {
+		if (r_iter->syscall == syscall) {
+			rc = arch_filter_rule_add(db, r_iter);
+			if (rc < 0)
+				return rc;
 		}
-	} else
-		s_new->action = rule->action;
+	}
 
-	return s_new;
+	/* restore the syscall priority and weight */
+	if (priority != 0 || weight != 0) {
+		s_iter = _db_syscall_entry(db, sc_tmp);
+		if (s_iter == NULL)
+			return -ENOMEM;
+		s_iter->priority |= priority;
+		s_iter->weight = weight;
+	}
 
-gen_32_failure:
-	/* free the new chain and its syscall struct */
-	_db_tree_put(&s_new->chains);
-	free(s_new);
-	return NULL;
+	return 0;
 }
 
 /**
- * Add a new rule to the seccomp filter DB
+ * Generate the argument chain of a filter rule
  * @param db the seccomp filter db
  * @param rule the filter rule
  *
- * This function adds a new syscall filter to the seccomp filter DB, adding to
- * the existing filters for the syscall, unless no argument specific filters
- * are present (filtering only on the syscall).  When adding new chains, the
- * shortest chain, or most inclusive filter match, will be entered into the
- * filter DB. Returns zero on success, negative values on failure.
- *
- * It is important to note that in the case of failure the db may be corrupted,
- * the caller must use the transaction mechanism if the db integrity is
- * important.
+ * This function generates the argument chain of the rule for the DB's
+ * architecture without adding it to the filter.  Returns a pointer to the new
+ * syscall entry on success, NULL on failure.
  *
  */
-int db_rule_add(struct db_filter *db, const struct db_api_rule_list *rule)
+static struct db_sys_list *_db_rule_gen(struct db_filter *db,
+					const struct db_api_rule_list *rule)
 {
-	int rc = -ENOMEM;
-	struct db_sys_list *s_new, *s_iter, *s_prev = NULL;
-	struct db_iter_state state;
-	bool rm_flag = false;
-
-	assert(db != NULL);
-
-	/* do all our possible memory allocation up front so we don't have to
-	 * worry about failure once we get to the point where we start updating
-	 * the filter db */
 	if (db->arch->size == ARCH_SIZE_64)
-		s_new = _db_rule_gen_64(db->arch, rule);
+		return _db_rule_gen_64(db, rule);
 	else if (db->arch->size == ARCH_SIZE_32)
-		s_new = _db_rule_gen_32(db->arch, rule);
-	else
-		return -EFAULT;
-	if (s_new == NULL)
-		return -ENOMEM;
+		return _db_rule_gen_32(db, rule);
+	return NULL;
+}
 
-	/* find a matching syscall/chain or insert a new one */
-	s_iter = db->syscalls;
-	while (s_iter != NULL && s_iter->num < rule->syscall) {
-		s_prev = s_iter;
-		s_iter = s_iter->next;
-	}
-	s_new->priority = _DB_PRI_MASK_CHAIN - s_new->node_cnt;
-add_reset:
-	if (s_iter == NULL || s_iter->num != rule->syscall) {
-		/* new syscall, add before s_iter */
-		if (s_prev != NULL) {
-			s_new->next = s_prev->next;
-			s_prev->next = s_new;
-		} else {
-			s_new->next = db->syscalls;
-			db->syscalls = s_new;
-		}
-		db->syscall_cnt++;
-		return 0;
-	} else if (s_iter->chains == NULL) {
-		if (rm_flag || !s_iter->valid) {
-			/* we are here because our previous pass cleared the
-			 * entire syscall chain when searching for a subtree
-			 * match or the existing syscall entry is a phantom,
-			 * so either way add the new chain */
-			s_iter->chains = s_new->chains;
-			s_iter->action = s_new->action;
-			s_iter->node_cnt = s_new->node_cnt;
-			if (s_iter->valid)
-				s_iter->priority = s_new->priority;
-			s_iter->valid = true;
-			free(s_new);
-			rc = 0;
-			goto add_priority_update;
-		} else {
-			/* syscall exists without any chains - existing filter
-			 * is at least as large as the new entry so cleanup and
-			 * exit */
-			_db_tree_put(&s_new->chains);
-			free(s_new);
-			goto add_free_ok;
-		}
-	} else if (s_iter->chains != NULL && s_new->chains == NULL) {
-		/* syscall exists with chains but the new filter has no chains
-		 * so we need to clear the existing chains and exit */
-		_db_tree_put(&s_iter->chains);
-		s_iter->chains = NULL;
-		s_iter->node_cnt = 0;
-		s_iter->action = rule->action;
+/**
+ * Check if two filter rules test any of the same syscall arguments
+ * @param a the first filter rule
+ * @param b the second filter rule
+ *
+ * Returns true if the rules test at least one common syscall argument, false
+ * otherwise.
+ *
+ */
+static bool _db_rule_args_overlap(const struct db_api_rule_list *a,
+				  const struct db_api_rule_list *b)
+{
+	unsigned int iter;
+	unsigned int args = 0;
+
+	for (iter = 0; iter < ARG_COUNT_MAX; iter++) {
+		if (a->args[iter].valid)
+			args |= 1 << a->args[iter].arg;
+	}
+	for (iter = 0; iter < ARG_COUNT_MAX; iter++) {
+		if (b->args[iter].valid && (args & (1 << b->args[iter].arg)))
+			return true;
+	}
 
-		/* cleanup the new tree and return */
-		_db_tree_put(&s_new->chains);
-		free(s_new);
-		goto add_free_ok;
+	return false;
+}
+
+/**
+ * Prune a removed rule from a syscall filter
+ * @param db the seccomp filter db
+ * @param rule the removed filter rule
+ *
+ * This function removes the given rule, which must already be unlinked from
+ * the DB's rule list, from its syscall filter without rebuilding the rest of
+ * the filter.  The argument chain tree only merges rules which start with the
+ * same comparison, and only prunes rules which test a common argument, so the
+ * top level branches which start with the comparison of the removed rule, or
+ * of any remaining rule which tests one of the removed rule's arguments, are
+ * dropped and the remaining rules which start with one of those comparisons
+ * are added back.  If nothing is left of the tree, or the removed rule had no
+ * argument comparisons, the syscall filter is rebuilt with
+ * _db_syscall_rebuild().  This must not be used on architectures which rewrite
+ * rules across multiple syscalls, see _db_rebuild().  Returns zero on success,
+ * negative values on failure.
+ *
+ */
+static int _db_syscall_prune(struct db_filter *db,
+			     const struct db_api_rule_list *rule)
+{
+	int rc;
+	int sc_tmp = rule->syscall;
+	unsigned int pos, r_pos, iter;
+	unsigned int top_cnt = 0;
+	bool top_match;
+	struct db_sys_list *s_iter, *s_gen;
+	struct db_sys_list **tops = NULL;
+	struct db_arg_chain_tree *c_iter;
+	struct db_api_rule_list *r_iter;
+
+	rc = arch_syscall_translate(db->arch, &sc_tmp);
+	if (rc < 0)
+		return rc;
+	if (!_db_sys_idx_find(db, sc_tmp, &pos))
+		return 0;
+	s_iter = _db_sys_own(db, pos);
+	if (s_iter == NULL)
+		return -ENOMEM;
+
+	s_gen = _db_rule_gen(db, rule);
+	if (s_gen == NULL)
+		return -ENOMEM;
+	if (s_gen->chains == NULL) {
+		/* the rule replaced all of the syscall's argument chains */
+		free(s_gen);
+		return _db_syscall_rebuild(db, rule->syscall);
+	}
+	if (s_iter->chains == NULL) {
+		/* a remaining rule without any argument comparisons covers
+		 * the syscall, the removed rule never made it into the tree */
+		_db_tree_put(&s_gen->chains);
+		free(s_gen);
+		return 0;
 	}
 
-	/* prune any sub-trees that are no longer required */
-	memset(&state, 0, sizeof(state));
-	state.sx = s_iter;
-	state.action = rule->action;
-	rc = _db_tree_prune(&s_iter->chains, s_new->chains, &state);
-	if (rc > 0) {
-		/* we pruned at least some of the existing tree */
-		rm_flag = true;
-		s_iter->node_cnt -= rc;
-		if (s_iter->chains == NULL)
-			/* we pruned the entire tree */
-			goto add_reset;
-	} else if ((state.flags & _DB_IST_M_REDUNDANT) == _DB_IST_M_REDUNDANT) {
-		/* the existing tree is "shorter", drop the new one */
-		_db_tree_put(&s_new->chains);
-		free(s_new);
-		goto add_free_ok;
+	/* collect the first comparison of the affected rules */
+	tops = malloc(sizeof(*tops) * (db->rule_cnt + 1));
+	if (tops == NULL) {
+		_db_tree_put(&s_gen->chains);
+		free(s_gen);
+		return -ENOMEM;
+	}
+	tops[top_cnt++] = s_gen;
+	/* NOTE: the syscall translation is one-to-one so we can match on the
+	 *       untranslated syscall numbers */
+	db_rule_foreach(r_iter, r_pos, db) {
+		if (r_iter->syscall == rule->syscall &&
+		    _db_rule_args_overlap(r_iter, rule)) {
+			s_gen = _db_rule_gen(db, r_iter);
+			if (s_gen == NULL) {
+				rc = -ENOMEM;
+				goto prune_return;
+			}
+			tops[top_cnt++] = s_gen;
+		}
 	}
 
-	/* add the new rule to the existing filter and cleanup */
-	memset(&state, 0, sizeof(state));
-	state.sx = s_iter;
-	rc = _db_tree_add(&s_iter->chains, s_new->chains, &state);
-	if (rc < 0)
-		goto add_failure;
-	s_iter->node_cnt += s_new->node_cnt;
-	s_iter->node_cnt -= _db_tree_put(&s_new->chains);
-	free(s_new);
+	/* drop the affected branches of the tree */
+	for (iter = 0; iter < top_cnt && s_iter->chains != NULL; iter++) {
+		if (tops[iter]->chains == NULL)
+			continue;
+		c_iter = s_iter->chains;
+		while (c_iter->lvl_prv != NULL)
+			c_iter = c_iter->lvl_prv;
+		while (c_iter != NULL &&
+		       !_db_chain_eq(c_iter, tops[iter]->chains))
+			c_iter = c_iter->lvl_nxt;
+		if (c_iter != NULL)
+			s_iter->node_cnt -= _db_tree_lvl_remove(&s_iter->chains,
+								c_iter);
+	}
+	if (s_iter->chains == NULL) {
+		/* the entire tree is gone */
+		rc = _db_syscall_rebuild(db, rule->syscall);
+		goto prune_return;
+	}
 
-add_free_ok:
-	rc = 0;
-add_priority_update:
-	/* update the priority */
-	if (s_iter != NULL) {
-		s_iter->priority &= (~_DB_PRI_MASK_CHAIN);
-		s_iter->priority |= (_DB_PRI_MASK_CHAIN - s_iter->node_cnt);
+	/* add back the remaining rules on the dropped branches */
+	db_rule_foreach(r_iter, r_pos, db) {
+		if (r_iter->syscall != rule->syscall)
+			continue;
+		s_gen = _db_rule_gen(db, r_iter);
+		if (s_gen == NULL) {
+			rc = -ENOMEM;
+			goto prune_return;
+		}
+		top_match = false;
+		for (iter = 0; iter < top_cnt && !top_match; iter++) {
+			if (s_gen->chains != NULL &&
+			    tops[iter]->chains != NULL &&
+			    _db_chain_eq(s_gen->chains, tops[iter]->chains))
+				top_match = true;
+		}
+		_db_tree_put(&s_gen->chains);
+		free(s_gen);
+		if (top_match) {
+			rc = arch_filter_rule_add(db, r_iter);
+			if (rc < 0)
+				goto prune_return;
+		}
 	}
-	return rc;
 
-add_failure:
-	/* NOTE: another reminder that we don't do any db error recovery here,
-	 * use the transaction mechanism as previously mentioned */
-	_db_tree_put(&s_new->chains);
-	free(s_new);
+	/* update the priority */
+	s_iter->priority &= (~_DB_PRI_MASK_CHAIN);
+	s_iter->priority |= (_DB_PRI_MASK_CHAIN - s_iter->node_cnt);
+
+prune_return:
+	for (iter = 0; iter < top_cnt; iter++) {
+		_db_tree_put(&tops[iter]->chains);
+		free(tops[iter]);
+	}
+	free(tops);
 	return rc;
 }
 
 /**
- * Set the priority of a given syscall
- * @param col the filter collection
- * @param syscall the syscall number
- * @param priority priority value, higher value == higher priority
+ * Rebuild all of the syscall filters in the seccomp filter DB
+ * @param db the seccomp filter db
  *
- * This function sets the priority of the given syscall; this value is used
- * when generating the seccomp filter code such that higher priority syscalls
- * will incur less filter code overhead than the lower priority syscalls in the
- * filter.  Returns zero on success, negative values on failure.
+ * This function discards all of the syscall filters and adds back every rule
+ * in the DB's rule list; the syscall priorities and weights are preserved.
+ * This is the fallback used to remove rules on architectures with their own
+ * rule_add() function, which can turn a single rule into several rules on
+ * different syscalls, e.g. the multiplexed socket and ipc syscalls, so the
+ * rule can't be pruned from one syscall filter.  Returns zero on success,
+ * negative values on failure.
  *
  */
-int db_col_syscall_priority(struct db_filter_col *col,
-			    int syscall, uint8_t priority)
+static int _db_rebuild(struct db_filter *db)
 {
-	int rc = 0, rc_tmp;
-	unsigned int iter;
-	int sc_tmp;
-	struct db_filter *filter;
+	int rc = 0;
+	unsigned int iter, pos, cnt = 0;
+	struct db_sys_list *s_iter, *s_saved = NULL;
+	struct db_api_rule_list *r_iter;
 
-	for (iter = 0; iter < col->filter_cnt; iter++) {
-		filter = col->filters[iter];
-		sc_tmp = syscall;
+	/* save the syscall priorities and weights */
+	if (db->sys_idx_cnt > 0) {
+		s_saved = malloc(sizeof(*s_saved) * db->sys_idx_cnt);
+		if (s_saved == NULL)
+			return -ENOMEM;
+	}
+	db_syscall_foreach(s_iter, pos, db) {
+		if ((s_iter->priority & _DB_PRI_MASK_USER) == 0 &&
+		    s_iter->weight == 0)
+			continue;
+		s_saved[cnt].num = s_iter->num;
+		s_saved[cnt].priority = s_iter->priority & _DB_PRI_MASK_USER;
+		s_saved[cnt].weight = s_iter->weight;
+		cnt++;
+	}
 
-		rc_tmp = arch_syscall_translate(filter->arch, &sc_tmp);
-		if (rc_tmp < 0)
-			goto priority_failure;
+	/* rebuild the filters from the rules */
+	_db_syscalls_free(db);
+	db_rule_foreach(r_iter, pos, db) {
+		rc = arch_filter_rule_add(db, r_iter);
+		if (rc < 0)
+			goto rebuild_return;
+	}
 
-		/* if this is a pseudo syscall then we need to rewrite the
-		 * syscall for some arch specific reason, don't forget the
-		 * special handling for syscall -1 */
-		if (sc_tmp < -1) {
-			/* we set this as a strict op - we don't really care
-			 * since priorities are a "best effort" thing - as we
-			 * want to catch the -EDOM error and bail on this
-			 * architecture */
-			rc_tmp = arch_syscall_rewrite(filter->arch, &sc_tmp);
-			if (rc_tmp == -EDOM)
-				continue;
-			if (rc_tmp < 0)
-				goto priority_failure;
+	/* restore the syscall priorities and weights */
+	for (iter = 0; iter < cnt; iter++) {
+		s_iter = _db_syscall_entry(db, s_saved[iter].num);
+		if (s_iter == NULL) {
+			rc = -ENOMEM;
+			goto rebuild_return;
 		}
-
-		rc_tmp = _db_syscall_priority(filter, sc_tmp, priority);
-
-priority_failure:
-		if (rc == 0 && rc_tmp < 0)
-			rc = rc_tmp;
+		s_iter->priority |= s_saved[iter].priority;
+		s_iter->weight = s_saved[iter].weight;
 	}
 
+rebuild_return:
+	free(s_saved);
 	return rc;
 }
 
 /**
- * Add a new rule to a single filter
- * @param filter the filter
- * @param rule the filter rule
+ * Remove a rule from a single filter
+ * @param db the seccomp filter db
+ * @param r_match the rule to match
  *
- * This is a helper function for db_col_rule_add() and similar functions, it
- * isn't generally useful.  Returns zero on success, negative values on error.
+ * This is a helper function for db_col_rule_remove(), it removes the most
+ * recently added rule which matches the action, syscall and argument filters
+ * of @r_match from the filter.  Returns zero on success, -ENOENT if no
+ * matching rule was found, and negative values on other failures.
  *
  */
-static int _db_col_rule_add(struct db_filter *filter,
-			    struct db_api_rule_list *rule)
+static int _db_col_rule_remove(struct db_filter *db,
+			       const struct db_api_rule_list *r_match)
 {
 	int rc;
-	struct db_api_rule_list *iter;
+	unsigned int pos;
+	struct db_api_rule_list *rule = NULL, *r_iter;
+
+	/* find the most recent matching rule */
+	for (pos = db->rule_cnt; pos > 0 && rule == NULL; pos--) {
+		r_iter = db->rules->rules[pos - 1];
+		if (r_iter->action == r_match->action &&
+		    r_iter->syscall == r_match->syscall &&
+		    _db_rule_args_eq(r_iter, r_match))
+			rule = r_iter;
+	}
+	if (rule == NULL)
+		return -ENOENT;
 
-	/* add the rule to the filter */
-	rc = arch_filter_rule_add(filter, rule);
-	if (rc != 0)
-		return rc;
+	/* remove the rule from the rule list */
+	rule = _db_rule_get(rule);
+	rc = _db_rule_vec_remove(db, pos);
+	if (rc < 0)
+		goto remove_return;
 
-	/* insert the chain to the end of the rule list */
-	iter = rule;
-	while (iter->next)
-		iter = iter->next;
-	if (filter->rules != NULL) {
-		rule->prev = filter->rules->prev;
-		iter->next = filter->rules;
-		filter->rules->prev->next = rule;
-		filter->rules->prev = iter;
-	} else {
-		rule->prev = iter;
-		iter->next = rule;
-		filter->rules = rule;
-	}
+	/* update the affected syscall filters */
+	if (db->arch->rule_add != NULL)
+		rc = _db_rebuild(db);
+	else
+		rc = _db_syscall_prune(db, rule);
 
-	return 0;
+remove_return:
+	_db_rule_put(rule);
+	return rc;
 }
 
 /**
- * Add a new rule to the current filter
+ * Remove a rule from the current filter
  * @param col the filter collection
- * @param strict the strict flag
  * @param action the filter action
  * @param syscall the syscall number
  * @param arg_cnt the number of argument filters in the argument filter chain
  * @param arg_array the argument filter chain, (uint, enum scmp_compare, ulong)
  *
- * This function adds a new argument/comparison/value to the seccomp filter for
- * a syscall; multiple arguments can be specified and they will be chained
- * together (essentially AND'd together) in the filter.  When the strict flag
- * is true the function will fail if the exact rule can not be added to the
- * filter, if the strict flag is false the function will not fail if the
- * function needs to adjust the rule due to architecture specifics.  Returns
- * zero on success, negative values on failure.
+ * This function removes the most recently added rule which matches the given
+ * action, syscall and argument filters from each filter in the collection.
+ * The rule is pruned from its syscall's argument chain tree, unless the
+ * architecture rewrites rules across multiple syscalls, e.g. the multiplexed
+ * socket and ipc syscalls, in which case the entire filter for that
+ * architecture is rebuilt from the remaining rules.  The rule is removed from
+ * the transaction snapshot as well so that it remains a valid shadow
+ * transaction.  Returns zero on success, -ENOENT if no matching rule was
+ * found, and negative values on other failures.
  *
  */
-int db_col_rule_add(struct db_filter_col *col,
-		    bool strict, uint32_t action, int syscall,
-		    unsigned int arg_cnt, const struct scmp_arg_cmp *arg_array)
+int db_col_rule_remove(struct db_filter_col *col,
+		       uint32_t action, int syscall,
+		       unsigned int arg_cnt, const struct scmp_arg_cmp *arg_array)
 {
 	int rc = 0, rc_tmp;
 	unsigned int iter;
-	unsigned int arg_num;
+	bool found = false;
 	size_t chain_size;
 	struct db_api_arg *chain = NULL;
-	struct scmp_arg_cmp arg_data;
-	struct db_api_rule_list *rule;
+	struct db_api_rule_list *r_match = NULL;
 	struct db_filter *db;
+	struct db_filter_snap *snap;
+
+	_db_col_key_reset(col);
 
 	/* collect the arguments for the filter rule */
 	chain_size = sizeof(*chain) * ARG_COUNT_MAX;
 	chain = zmalloc(chain_size);
 	if (chain == NULL)
 		return -ENOMEM;
-	for (iter = 0; iter < arg_cnt; iter++) {
-		arg_data = arg_array[iter];
-		arg_num = arg_data.arg;
-		if (arg_num < ARG_COUNT_MAX && chain[arg_num].valid == 0) {
-			chain[arg_num].valid = 1;
-			chain[arg_num].arg = arg_num;
-			chain[arg_num].op = arg_data.op;
-			/* TODO: we should check datum/mask size against the
-			 *	 arch definition, e.g. 64 bit datum on x86 */
-			switch (chain[arg_num].op) {
-			case SCMP_CMP_NE:
-			case SCMP_CMP_LT:
-			case SCMP_CMP_LE:
-			case SCMP_CMP_EQ:
-			case SCMP_CMP_GE:
-			case SCMP_CMP_GT:
-				chain[arg_num].mask = DATUM_MAX;
-				chain[arg_num].datum = arg_data.datum_a;
-				break;
-			case SCMP_CMP_MASKED_EQ:
-				chain[arg_num].mask = arg_data.datum_a;
-				chain[arg_num].datum = arg_data.datum_b;
-				break;
-			default:
-				rc = -EINVAL;
-				goto add_return;
-			}
-		} else {
-			rc = -EINVAL;
-			goto add_return;
-		}
+	rc = _db_rule_chain(arg_cnt, arg_array, chain);
+	if (rc != 0)
+		goto remove_return;
+	r_match = _db_rule_new(false, action, syscall, chain);
+	if (r_match == NULL) {
+		rc = -ENOMEM;
+		goto remove_return;
 	}
 
 	/* create a checkpoint */
 	rc = db_col_transaction_start(col);
 	if (rc != 0)
-		goto add_return;
+		goto remove_return;
 
-	/* add the rule to the different filters in the collection */
 	for (iter = 0; iter < col->filter_cnt; iter++) {
-		db = col->filters[iter];
+		rc_tmp = _db_col_rule_remove(col->filters[iter], r_match);
+		if (rc_tmp == 0)
+			found = true;
+		else if (rc_tmp != -ENOENT && rc == 0)
+			rc = rc_tmp;
+	}
+	if (!found && rc == 0)
+		rc = -ENOENT;
+	if (rc != 0) {
+		db_col_transaction_abort(col);
+		goto remove_return;
+	}
 
-		/* create the rule */
-		rule = _db_rule_new(strict, action, syscall, chain);
-		if (rule == NULL) {
-			rc_tmp = -ENOMEM;
-			goto add_arch_fail;
+	/* remove the rule from the snapshot so that it can become the shadow
+	 * transaction, the snapshot matched the filters before the removal */
+	snap = col->snapshots;
+	for (iter = 0; iter < snap->filter_cnt; iter++) {
+		db = snap->filters[iter];
+		if (_db_shared(db)) {
+			db = _db_dup(db);
+			if (db == NULL)
+				goto remove_drop;
+			_db_release(snap->filters[iter]);
+			snap->filters[iter] = db;
 		}
-
-		/* add the rule */
-		rc_tmp = _db_col_rule_add(db, rule);
-		if (rc_tmp != 0)
-			free(rule);
-
-add_arch_fail:
-		if (rc_tmp != 0 && rc == 0)
-			rc = rc_tmp;
+		rc_tmp = _db_col_rule_remove(db, r_match);
+		if (rc_tmp < 0 && rc_tmp != -ENOENT)
+			goto remove_drop;
 	}
+	db_col_transaction_commit(col);
+	goto remove_return;
 
-	/* commit the transaction or abort */
-	if (rc == 0)
-		db_col_transaction_commit(col);
-	else
-		db_col_transaction_abort(col);
+remove_drop:
+	/* the rule has been removed, we just lose the shadow */
+	col->snapshots = snap->next;
+	_db_snap_release(snap);
 
-add_return:
-	/* update the misc state */
-	if (rc == 0 && action == SCMP_ACT_NOTIFY)
-		col->notify_used = true;
-	if (chain != NULL)
-		free(chain);
+remove_return:
+	free(r_match);
+	free(chain);
 	return rc;
 }
 
@@ -2399,7 +4566,6 @@ int db_col_transaction_start(struct db_filter_col *col)
 	unsigned int iter;
 	struct db_filter_snap *snap;
 	struct db_filter *filter_o, *filter_s;
-	struct db_api_rule_list *rule_o, *rule_s = NULL;
 
 	/* check to see if a shadow snapshot exists */
 	if (col->snapshots && col->snapshots->shadow) {
@@ -2411,6 +4577,13 @@ int db_col_transaction_start(struct db_filter_col *col)
 		 *       will need to add a mechanism to verify that the shadow
 		 *       transaction is current/correct */
 
+		/* the filters are updated in place, so any filters shared
+		 * with a duplicate of the collection are replaced with private
+		 * copies which share the syscall entries and rules instead */
+		rc = _db_col_unshare(col);
+		if (rc < 0)
+			return rc;
+
 		col->snapshots->shadow = false;
 		return 0;
 	}
@@ -2431,32 +4604,19 @@ int db_col_transaction_start(struct db_filter_col *col)
 
 	/* create a snapshot of the current filter state */
 	for (iter = 0; iter < col->filter_cnt; iter++) {
-		/* allocate a new filter */
 		filter_o = col->filters[iter];
-		filter_s = _db_init(filter_o->arch);
+		filter_s = _db_dup(filter_o);
 		if (filter_s == NULL)
 			goto trans_start_failure;
-		snap->filters[iter] = filter_s;
-
-		/* create a filter snapshot from existing rules */
-		rule_o = filter_o->rules;
-		if (rule_o == NULL)
-			continue;
-		do {
-			/* duplicate the rule */
-			rule_s = db_rule_dup(rule_o);
-			if (rule_s == NULL)
-				goto trans_start_failure;
 
-			/* add the rule */
-			rc = _db_col_rule_add(filter_s, rule_s);
-			if (rc != 0)
-				goto trans_start_failure;
-			rule_s = NULL;
-
-			/* next rule */
-			rule_o = rule_o->next;
-		} while (rule_o != filter_o->rules);
+		if (_db_shared(filter_o)) {
+			/* the filter is shared with another collection, so
+			 * keep the shared filter as the snapshot and modify
+			 * the private copy from here on */
+			snap->filters[iter] = filter_o;
+			col->filters[iter] = filter_s;
+		} else
+			snap->filters[iter] = filter_s;
 	}
 
 	/* add the snapshot to the list */
@@ -2466,8 +4626,6 @@ int db_col_transaction_start(struct db_filter_col *col)
 	return 0;
 
 trans_start_failure:
-	if (rule_s != NULL)
-		free(rule_s);
 	_db_snap_release(snap);
 	return -ENOMEM;
 }
@@ -2489,6 +4647,8 @@ void db_col_transaction_abort(struct db_filter_col *col)
 	if (col->snapshots == NULL)
 		return;
 
+	_db_col_key_reset(col);
+
 	/* replace the current filter with the last snapshot */
 	snap = col->snapshots;
 	col->snapshots = snap->next;
@@ -2516,10 +4676,9 @@ void db_col_transaction_abort(struct db_filter_col *col)
 void db_col_transaction_commit(struct db_filter_col *col)
 {
 	int rc;
-	unsigned int iter;
+	unsigned int iter, pos;
 	struct db_filter_snap *snap;
 	struct db_filter *filter_o, *filter_s;
-	struct db_api_rule_list *rule_o, *rule_s;
 
 	snap = col->snapshots;
 	if (snap == NULL)
@@ -2572,41 +4731,36 @@ void db_col_transaction_commit(struct db_filter_col *col)
 		filter_o = col->filters[iter];
 		filter_s = snap->filters[iter];
 
-		/* skip ahead to the new rule(s) */
-		rule_o = filter_o->rules;
-		rule_s = filter_s->rules;
-		if (rule_o == NULL)
-			/* nothing to shadow */
+		/* did we actually add any rules? */
+		if (filter_o->rule_cnt <= filter_s->rule_cnt)
+			/* no, we are done in this case */
 			continue;
-		if (rule_s != NULL) {
-			do {
-				rule_o = rule_o->next;
-				rule_s = rule_s->next;
-			} while (rule_s != filter_s->rules);
-
-			/* did we actually add any rules? */
-			if (rule_o == filter_o->rules)
-				/* no, we are done in this case */
-				continue;
-		}
 
-		/* update the old snapshot to make it a shadow */
-		do {
-			/* duplicate the rule */
-			rule_s = db_rule_dup(rule_o);
-			if (rule_s == NULL)
+		/* a snapshot shared with another collection is replaced with
+		 * a private copy, only the touched syscalls are copied */
+		if (_db_shared(filter_s)) {
+			filter_s = _db_dup(filter_s);
+			if (filter_s == NULL)
 				goto shadow_err;
+			_db_release(snap->filters[iter]);
+			snap->filters[iter] = filter_s;
+		}
 
-			/* add the rule */
-			rc = _db_col_rule_add(filter_s, rule_s);
-			if (rc != 0) {
-				free(rule_s);
+		/* update the old snapshot to make it a shadow, the new rules
+		 * are at the end of the rule list */
+		for (pos = filter_s->rule_cnt; pos < filter_o->rule_cnt; pos++) {
+			rc = arch_filter_rule_add(filter_s,
+						  filter_o->rules->rules[pos]);
+			if (rc < 0)
 				goto shadow_err;
-			}
+		}
 
-			/* next rule */
-			rule_o = rule_o->next;
-		} while (rule_o != filter_o->rules);
+		/* share the rule list, the snapshot's rules are a prefix */
+		__atomic_add_fetch(&filter_o->rules->refcnt, 1,
+				   __ATOMIC_RELAXED);
+		_db_rule_vec_put(filter_s->rules);
+		filter_s->rules = filter_o->rules;
+		filter_s->rule_cnt = filter_o->rule_cnt;
 	}
 
 	/* success, mark the snapshot as a shadow and return */
@@ -36,6 +36,11 @@ struct db_api_arg {
 	enum scmp_compare op;
 	scmp_datum_t mask;
 	scmp_datum_t datum;
+	/* upper bound for SCMP_CMP_IN_RANGE */
+	scmp_datum_t datum_max;
+	/* values for SCMP_CMP_IN_SET, sorted and unique once in a rule */
+	const scmp_datum_t *set;
+	unsigned int set_cnt;
 
 	bool valid;
 };
@@ -46,48 +51,96 @@ struct db_api_rule_list {
 	bool strict;
 	struct db_api_arg args[ARG_COUNT_MAX];
 
+	/* number of filters using the rule, only accessed atomically */
+	unsigned int refcnt;
+
 	struct db_api_rule_list *prev, *next;
+
+	/* storage for the SCMP_CMP_IN_SET values of the arguments */
+	unsigned int set_len;
+	scmp_datum_t set[];
 };
 
+/* NOTE: the fields are ordered largest first to keep the nodes compact */
 struct db_arg_chain_tree {
-	/* argument number (a0 = 0, a1 = 1, etc.) */
-	unsigned int arg;
-	/* true to indicate this is the high 32-bit word of a 64-bit value */
-	bool arg_h_flg;
-	/* argument bpf offset */
-	unsigned int arg_offset;
+	/* list of nodes on this level */
+	struct db_arg_chain_tree *lvl_prv, *lvl_nxt;
+
+	/* next node in the chain */
+	struct db_arg_chain_tree *nxt_t;
+	struct db_arg_chain_tree *nxt_f;
 
-	/* comparison operator */
-	enum scmp_compare op;
-	enum scmp_compare op_orig;
 	/* syscall argument value */
+	union {
+		scmp_datum_t datum_full;
+		/* sorted low words for SCMP_CMP_IN_SET */
+		uint32_t *set;
+	};
 	uint32_t mask;
 	uint32_t datum;
-	scmp_datum_t datum_full;
 
 	/* actions */
-	bool act_t_flg;
-	bool act_f_flg;
 	uint32_t act_t;
 	uint32_t act_f;
 
-	/* list of nodes on this level */
-	struct db_arg_chain_tree *lvl_prv, *lvl_nxt;
+	unsigned int refcnt;
+	/* IN_RANGE upper bound or IN_SET value count */
+	uint32_t datum_ext;
 
-	/* next node in the chain */
-	struct db_arg_chain_tree *nxt_t;
-	struct db_arg_chain_tree *nxt_f;
+	/* argument bpf offset */
+	uint16_t arg_offset;
+	/* argument number (a0 = 0, a1 = 1, etc.) */
+	uint8_t arg;
+
+	/* comparison operator, enum scmp_compare */
+	uint8_t op;
+	uint8_t op_orig;
 
+	/* true to indicate this is the high 32-bit word of a 64-bit value */
+	bool arg_h_flg:1;
+	/* actions are valid */
+	bool act_t_flg:1;
+	bool act_f_flg:1;
+};
+
+struct db_node_slab;
+
+/* pool of argument chain tree nodes, one per filter */
+struct db_node_pool {
+	/* the owning filter plus each node in use, only accessed atomically,
+	 * the nodes can outlive the filter when their trees are shared */
 	unsigned int refcnt;
+	struct db_node_slab *slabs;
+	/* free nodes, only used by the owning filter */
+	struct db_arg_chain_tree *free;
+	/* nodes freed by any filter, only accessed atomically */
+	struct db_arg_chain_tree *freed;
 };
 #define ARG_MASK_MAX		((uint32_t)-1)
+#define ARG_SET_MAX		128
+
+/* rule storage, may be shared by filters with a common rule history */
+struct db_rule_vec {
+	/* number of filters using the vector, only accessed atomically */
+	unsigned int refcnt;
+	/* number of slots claimed, only accessed atomically */
+	unsigned int cnt;
+	unsigned int size;
+	struct db_api_rule_list *rules[];
+};
 
 struct db_sys_list {
 	/* native syscall number */
 	unsigned int num;
 
+	/* number of filters using the syscall entry, only accessed
+	 * atomically; a shared entry must not be modified */
+	unsigned int refcnt;
+
 	/* priority - higher is better */
 	unsigned int priority;
+	/* weight - relative frequency of the syscall */
+	uint32_t weight;
 
 	/* the argument chain heads */
 	struct db_arg_chain_tree *chains;
@@ -96,10 +149,6 @@ struct db_sys_list {
 	/* action in the case of no argument chains */
 	uint32_t action;
 
-	struct db_sys_list *next;
-	/* temporary use only by the BPF generator */
-	struct db_sys_list *pri_prv, *pri_nxt;
-
 	bool valid;
 };
 
@@ -122,18 +171,34 @@ struct db_filter_attr {
 	uint32_t optimize;
 	/* return the raw system return codes */
 	uint32_t api_sysrawrc;
+	/* SCMP_FLTATR_CTL_THREADS related attributes */
+	uint32_t threads;
 };
 
+/* maximum number of filter generation threads */
+#define DB_THREADS_MAX			16
+
 struct db_filter {
 	/* target architecture */
 	const struct arch_def *arch;
 
-	/* syscall filters, kept as a sorted single-linked list */
-	struct db_sys_list *syscalls;
+	/* number of filter collections and snapshots using this filter, only
+	 * accessed atomically, see _db_get() and _db_shared() */
+	unsigned int refcnt;
+
+	/* syscall filters, kept as a sorted index */
+	struct db_sys_list **sys_idx;
+	unsigned int sys_idx_cnt;
+	unsigned int sys_idx_size;
 	unsigned int syscall_cnt;
 
-	/* list of rules used to build the filters, kept in order */
-	struct db_api_rule_list *rules;
+	/* rules used to build the filters, kept in order; only the first
+	 * rule_cnt rules of the vector belong to this filter */
+	struct db_rule_vec *rules;
+	unsigned int rule_cnt;
+
+	/* argument chain tree node storage */
+	struct db_node_pool *node_pool;
 };
 
 struct db_filter_snap {
@@ -145,6 +210,8 @@ struct db_filter_snap {
 	struct db_filter_snap *next;
 };
 
+struct cache_key;
+
 struct db_filter_col {
 	/* verification / state */
 	int state;
@@ -163,25 +230,47 @@ struct db_filter_col {
 	/* notification fd that was returned from seccomp() */
 	int notify_fd;
 	bool notify_used;
+
+	/* program cache key, NULL if the collection has changed */
+	struct cache_key *cache_key;
 };
 
 /**
- * Iterate over each item in the DB list
+ * Iterate over each syscall in the DB
  * @param iter the iterator
- * @param list the list
+ * @param pos the index position
+ * @param db the filter DB
  *
  * This macro acts as for()/while() conditional and iterates the following
- * statement for each item in the given list.
+ * statement for each syscall entry in the given DB, in syscall number order.
  *
  */
-#define db_list_foreach(iter,list) \
-	for (iter = (list); iter != NULL; iter = iter->next)
+#define db_syscall_foreach(iter,pos,db) \
+	for (pos = 0; \
+	     pos < (db)->sys_idx_cnt && ((iter) = (db)->sys_idx[pos]); \
+	     pos++)
+
+/**
+ * Iterate over each rule in the DB
+ * @param iter the iterator
+ * @param pos the rule position
+ * @param db the filter DB
+ *
+ * This macro acts as for()/while() conditional and iterates the following
+ * statement for each rule in the given DB, in the order they were added.
+ *
+ */
+#define db_rule_foreach(iter,pos,db) \
+	for (pos = 0; \
+	     pos < (db)->rule_cnt && ((iter) = (db)->rules->rules[pos]); \
+	     pos++)
 
 struct db_api_rule_list *db_rule_dup(const struct db_api_rule_list *src);
 
 struct db_filter_col *db_col_init(uint32_t def_action);
 int db_col_reset(struct db_filter_col *col, uint32_t def_action);
 void db_col_release(struct db_filter_col *col);
+struct db_filter_col *db_col_dup(const struct db_filter_col *col);
 
 int db_col_valid(struct db_filter_col *col);
 
@@ -205,9 +294,16 @@ int db_col_db_remove(struct db_filter_col *col, uint32_t arch_token);
 int db_col_rule_add(struct db_filter_col *col,
 		    bool strict, uint32_t action, int syscall,
 		    unsigned int arg_cnt, const struct scmp_arg_cmp *arg_array);
+int db_col_rule_add_batch(struct db_filter_col *col, bool strict,
+			  struct scmp_rule *rules, unsigned int rule_cnt);
+int db_col_rule_remove(struct db_filter_col *col,
+		       uint32_t action, int syscall,
+		       unsigned int arg_cnt, const struct scmp_arg_cmp *arg_array);
 
 int db_col_syscall_priority(struct db_filter_col *col,
 			    int syscall, uint8_t priority);
+int db_col_syscall_weight(struct db_filter_col *col,
+			  int syscall, uint32_t weight);
 
 int db_col_transaction_start(struct db_filter_col *col);
 void db_col_transaction_abort(struct db_filter_col *col);
@@ -215,4 +311,8 @@ void db_col_transaction_commit(struct db_filter_col *col);
 
 int db_rule_add(struct db_filter *db, const struct db_api_rule_list *rule);
 
+uint32_t db_chain_hash(const struct db_arg_chain_tree *chains);
+bool db_chain_lvl_eq(const struct db_arg_chain_tree *a,
+		     const struct db_arg_chain_tree *b);
+
 #endif
@@ -22,6 +22,7 @@
 #include <errno.h>
 #include <inttypes.h>
 #include <limits.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -45,12 +46,43 @@
 /* allocation increments */
 #define AINC_BLK			2
 #define AINC_PROG			64
+#define AINC_ARENA			(32 * 1024)
+
+/* arena allocation alignment */
+#define ARENA_ALIGN			(sizeof(uint64_t))
 
 /* binary tree definitions */
 #define SYSCALLS_PER_NODE		(4)
 #define BTREE_HSH_INVALID		(UINT64_MAX)
 #define BTREE_SYSCALL_INVALID		(UINT_MAX)
 
+/* syscall range dispatch definitions */
+struct bpf_range {
+	uint32_t lo;
+	uint32_t hi;
+	uint64_t hsh;
+	uint64_t weight;
+};
+#define WTREE_RANGES_MAX		(512)
+#define BITMAP_BITS			(32)
+#define BITMAP_WINDOW(x)		((x) / BITMAP_BITS)
+#define BITMAP_INSTR_CNT		(5)
+
+/* peephole optimizer definitions */
+struct bpf_opt_instr {
+	uint16_t code;
+	uint32_t k;
+	/* absolute jump targets */
+	unsigned int jt;
+	unsigned int jf;
+	/* accumulator state on entry, see _OPT_ACC_* */
+	int64_t acc;
+	bool removed;
+};
+#define _OPT_ACC_NONE			(-2)
+#define _OPT_ACC_UNKNOWN		(-1)
+#define _OPT_PASSES_MAX			(8)
+
 struct acc_state {
 	int32_t offset;
 	uint32_t mask;
@@ -104,6 +136,9 @@ struct bpf_jump {
 #define _BPF_JMP_MAX			255
 #define _BPF_JMP_MAX_RET		255
 
+/* largest set which is searched linearly instead of split */
+#define _BPF_SET_LINEAR			3
+
 struct bpf_instr {
 	uint16_t op;
 	struct bpf_jump jt;
@@ -130,15 +165,12 @@ struct bpf_blk {
 
 	/* status flags */
 	bool flag_hash;			/* added to the hash table */
-	bool flag_dup;			/* duplicate block and in use */
-	bool flag_unique;		/* ->blks is unique to this block */
 
 	/* original db_arg_chain_tree node */
 	const struct db_arg_chain_tree *node;
 
 	/* used during block assembly */
 	uint64_t hash;
-	struct bpf_blk *hash_nxt;
 	struct bpf_blk *prev, *next;
 	struct bpf_blk *lvl_prv, *lvl_nxt;
 };
@@ -151,12 +183,74 @@ struct bpf_hash_bkt {
 	unsigned int found;
 };
 
-#define _BPF_HASH_BITS			8
-#define _BPF_HASH_SIZE			(1 << _BPF_HASH_BITS)
-#define _BPF_HASH_MASK			(_BPF_HASH_BITS - 1)
+/* the generator's private view of a syscall filter, see _gen_bpf_simplify() */
+struct bpf_sys {
+	unsigned int num;
+	unsigned int priority;
+	uint32_t weight;
+	bool valid;
+
+	/* the argument chains from the filter DB */
+	const struct db_arg_chain_tree *chains;
+	/* simplified argument chains and action */
+	const struct db_arg_chain_tree *gen_chains;
+	uint32_t gen_action;
+
+	/* sorted syscall list */
+	struct bpf_sys *pri_prv, *pri_nxt;
+};
+
+/* generated argument chains, indexed by the chain's structural hash */
+struct bpf_chain_memo {
+	const struct arch_def *arch;
+	const struct bpf_sys *sys;
+	uint32_t chains_hash;
+	struct acc_state acc;
+	uint64_t blk_hsh;
+	struct bpf_chain_memo *next;
+};
+#define _BPF_MEMO_BITS			8
+#define _BPF_MEMO_SIZE			((unsigned int)1 << _BPF_MEMO_BITS)
+#define _BPF_MEMO_MASK			(_BPF_MEMO_SIZE - 1)
+
+/* outcome of an argument chain branch after simplification */
+struct bpf_branch {
+	enum {
+		_BPF_BR_NXT = 0,	/* fall through to the next node */
+		_BPF_BR_ACT,		/* unconditional action */
+		_BPF_BR_LVL,		/* argument chain level */
+	} type;
+	uint32_t act;
+	struct db_arg_chain_tree *lvl;
+};
+
+struct bpf_arena {
+	struct bpf_arena *next;
+	size_t size;
+	size_t used;
+	unsigned char data[];
+};
+
+#define _BPF_HASH_BITS_MIN		8
+#define _BPF_HASH_BITS_MAX		24
+#define _BPF_HASH_SIZE(x)		((unsigned int)1 << (x))
+#define _BPF_HASH_MASK(x)		(_BPF_HASH_SIZE(x) - 1)
+/* grow the hash table once the load factor reaches 3/4 */
+#define _BPF_HASH_LOAD_MAX(x)		((_BPF_HASH_SIZE(x) >> 2) * 3)
 struct bpf_state {
 	/* block hash table */
-	struct bpf_hash_bkt *htbl[_BPF_HASH_SIZE];
+	struct bpf_hash_bkt **htbl;
+	unsigned int htbl_bits;
+	unsigned int htbl_cnt;
+	/* block hash table statistics */
+	uint64_t htbl_probes;
+	uint64_t htbl_collisions;
+
+	/* memory arena for blocks, instructions and hash buckets */
+	struct bpf_arena *arena;
+
+	/* generated argument chains, allocated in the arena */
+	struct bpf_chain_memo **chain_memo;
 
 	/* filter attributes */
 	const struct db_filter_attr *attr;
@@ -170,11 +264,38 @@ struct bpf_state {
 
 	/* WARNING - the following variables are temporary use only */
 	const struct arch_def *arch;
+	const unsigned int *range_root;
+	unsigned int range_cnt;
 	struct bpf_blk *b_head;
 	struct bpf_blk *b_tail;
 	struct bpf_blk *b_new;
 };
 
+struct bpf_arch_job {
+	/* filter DB(s) for the architecture */
+	const struct db_filter *db;
+	const struct db_filter *db_secondary;
+
+	/* generated instruction blocks */
+	struct bpf_blk *b_head;
+};
+
+struct bpf_worker {
+	pthread_t thread;
+	bool thread_valid;
+
+	/* per-thread BPF state */
+	struct bpf_state state;
+
+	/* every job_stride'th job, starting with job_first */
+	struct bpf_arch_job *jobs;
+	unsigned int job_cnt;
+	unsigned int job_first;
+	unsigned int job_stride;
+
+	int rc;
+};
+
 /**
  * Populate a BPF instruction
  * @param _ins the BPF instruction
@@ -196,14 +317,11 @@ struct bpf_state {
 	} while (0)
 
 static struct bpf_blk *_gen_bpf_chain(struct bpf_state *state,
-				      const struct db_sys_list *sys,
+				      const struct bpf_sys *sys,
 				      const struct db_arg_chain_tree *chain,
 				      const struct bpf_jump *nxt_jump,
 				      struct acc_state *a_state);
 
-static struct bpf_blk *_hsh_remove(struct bpf_state *state, uint64_t h_val);
-static struct bpf_blk *_hsh_find(const struct bpf_state *state, uint64_t h_val);
-
 /**
  * Convert a 16-bit host integer into the target's endianess
  * @param arch the architecture definition
@@ -237,97 +355,118 @@ static uint32_t _htot32(const struct arch_def *arch, uint32_t val)
 }
 
 /**
- * Free the BPF instruction block
- * @param state the BPF state
- * @param blk the BPF instruction block
+ * Convert a 16-bit target integer into the host's endianess
+ * @param arch the architecture definition
+ * @param val the 16-bit integer
  *
- * Free the BPF instruction block, any linked blocks are preserved and the hash
- * table is not modified.  In general, you probably want to use _blk_free()
- * instead.
+ * Convert the endianess of the supplied value and return it to the caller.
  *
  */
-static void __blk_free(struct bpf_state *state, struct bpf_blk *blk)
+static uint16_t _ttoh16(const struct arch_def *arch, uint16_t val)
 {
-	struct bpf_blk *b_tmp;
+	if (arch->endian == ARCH_ENDIAN_LITTLE)
+		return le16toh(val);
+	else
+		return be16toh(val);
+}
 
-	while (blk->hash_nxt != NULL) {
-		b_tmp = blk->hash_nxt;
-		blk->hash_nxt = b_tmp->hash_nxt;
-		if (!b_tmp->flag_dup)
-			free(b_tmp);
-	}
-	if (blk->blks != NULL && blk->flag_unique)
-		free(blk->blks);
-	free(blk);
+/**
+ * Convert a 32-bit target integer into the host's endianess
+ * @param arch the architecture definition
+ * @param val the 32-bit integer
+ *
+ * Convert the endianess of the supplied value and return it to the caller.
+ *
+ */
+static uint32_t _ttoh32(const struct arch_def *arch, uint32_t val)
+{
+	if (arch->endian == ARCH_ENDIAN_LITTLE)
+		return le32toh(val);
+	else
+		return be32toh(val);
 }
 
 /**
-* Free the BPF instruction block
+ * Allocate memory from the BPF state arena
  * @param state the BPF state
- * @param blk the BPF instruction block
+ * @param size the size of the allocation
  *
- * Free the BPF instruction block including any linked blocks.  The hash table
- * is updated to reflect the newly removed block(s).
+ * Allocate zeroed memory from the BPF state arena.  There is no way to free an
+ * individual allocation, all of the arena memory is released at once by
+ * _arena_release() when the BPF state is released.  Returns a pointer to the
+ * memory on success, NULL on failure.
  *
  */
-static void _blk_free(struct bpf_state *state, struct bpf_blk *blk)
+static void *_arena_alloc(struct bpf_state *state, size_t size)
 {
-	int iter;
-	struct bpf_blk *b_iter;
-	struct bpf_instr *i_iter;
+	size_t pad;
+	struct bpf_arena *chunk = state->arena;
+
+	/* NOTE: the chunks are zmalloc'd and memory is never reused so we
+	 *	 don't need to clear the memory we return */
+
+	if (chunk != NULL) {
+		pad = -(uintptr_t)(chunk->data + chunk->used) &
+		      (ARENA_ALIGN - 1);
+		if (chunk->used + pad + size <= chunk->size) {
+			chunk->used += pad + size;
+			return chunk->data + chunk->used - size;
+		}
+	}
 
-	if (blk == NULL)
-		return;
+	chunk = zmalloc(sizeof(*chunk) + ARENA_ALIGN +
+			(size > AINC_ARENA ? size : AINC_ARENA));
+	if (chunk == NULL)
+		return NULL;
+	chunk->size = ARENA_ALIGN + (size > AINC_ARENA ? size : AINC_ARENA);
+	pad = -(uintptr_t)chunk->data & (ARENA_ALIGN - 1);
+	chunk->used = pad + size;
+
+	/* large allocations get their own chunk, keep using the current one */
+	if (size > (AINC_ARENA / 4) && state->arena != NULL) {
+		chunk->next = state->arena->next;
+		state->arena->next = chunk;
+	} else {
+		chunk->next = state->arena;
+		state->arena = chunk;
+	}
 
-	/* remove this block from the hash table */
-	_hsh_remove(state, blk->hash);
+	return chunk->data + pad;
+}
 
-	/* run through the block freeing TGT_PTR_{BLK,HSH} jump targets */
-	for (iter = 0; iter < blk->blk_cnt; iter++) {
-		i_iter = &blk->blks[iter];
-		switch (i_iter->jt.type) {
-		case TGT_PTR_BLK:
-			_blk_free(state, i_iter->jt.tgt.blk);
-			break;
-		case TGT_PTR_HSH:
-			b_iter = _hsh_find(state, i_iter->jt.tgt.hash);
-			_blk_free(state, b_iter);
-			break;
-		default:
-			/* do nothing */
-			break;
-		}
-		switch (i_iter->jf.type) {
-		case TGT_PTR_BLK:
-			_blk_free(state, i_iter->jf.tgt.blk);
-			break;
-		case TGT_PTR_HSH:
-			b_iter = _hsh_find(state, i_iter->jf.tgt.hash);
-			_blk_free(state, b_iter);
-			break;
-		default:
-			/* do nothing */
-			break;
-		}
+/**
+ * Release the BPF state arena
+ * @param state the BPF state
+ *
+ * Release all of the memory allocated from the BPF state arena.
+ *
+ */
+static void _arena_release(struct bpf_state *state)
+{
+	struct bpf_arena *chunk;
+
+	while (state->arena != NULL) {
+		chunk = state->arena;
+		state->arena = chunk->next;
+		free(chunk);
 	}
-	__blk_free(state, blk);
 }
 
 /**
  * Allocate and initialize a new instruction block
+ * @param state the BPF state
  *
  * Allocate a new BPF instruction block and perform some very basic
  * initialization.  Returns a pointer to the block on success, NULL on failure.
  *
  */
-static struct bpf_blk *_blk_alloc(void)
+static struct bpf_blk *_blk_alloc(struct bpf_state *state)
 {
 	struct bpf_blk *blk;
 
-	blk = zmalloc(sizeof(*blk));
+	blk = _arena_alloc(state, sizeof(*blk));
 	if (blk == NULL)
 		return NULL;
-	blk->flag_unique = true;
 	blk->acc_start = _ACC_STATE_UNDEF;
 	blk->acc_end = _ACC_STATE_UNDEF;
 
@@ -349,22 +488,26 @@ static struct bpf_blk *_blk_resize(struct bpf_state *state,
 				   struct bpf_blk *blk,
 				   unsigned int size_add)
 {
-	unsigned int size_adj = (AINC_BLK > size_add ? AINC_BLK : size_add);
+	unsigned int alloc;
 	struct bpf_instr *new;
 
 	if (blk == NULL)
 		return NULL;
 
-	if ((blk->blk_cnt + size_adj) <= blk->blk_alloc)
+	if ((blk->blk_cnt + size_add) <= blk->blk_alloc)
 		return blk;
 
-	blk->blk_alloc += size_adj;
-	new = realloc(blk->blks, blk->blk_alloc * sizeof(*(blk->blks)));
-	if (new == NULL) {
-		_blk_free(state, blk);
+	/* the old instruction array stays in the arena, grow geometrically */
+	alloc = (blk->blk_alloc > 0 ? blk->blk_alloc * 2 : AINC_BLK);
+	while (alloc < (blk->blk_cnt + size_add))
+		alloc *= 2;
+	new = _arena_alloc(state, alloc * sizeof(*(blk->blks)));
+	if (new == NULL)
 		return NULL;
-	}
+	if (blk->blk_cnt > 0)
+		memcpy(new, blk->blks, _BLK_MSZE(blk));
 	blk->blks = new;
+	blk->blk_alloc = alloc;
 
 	return blk;
 }
@@ -377,8 +520,8 @@ static struct bpf_blk *_blk_resize(struct bpf_state *state,
  *
  * Add the new BPF instruction to the end of the given instruction block.  If
  * the given instruction block is NULL, a new block will be allocated.  Returns
- * a pointer to the block on success, NULL on failure, and in the case of
- * failure the instruction block is free'd.
+ * a pointer to the block on success, NULL on failure; the block's memory stays
+ * owned by the BPF state arena in either case.
  *
  */
 static struct bpf_blk *_blk_append(struct bpf_state *state,
@@ -386,7 +529,7 @@ static struct bpf_blk *_blk_append(struct bpf_state *state,
 				   const struct bpf_instr *instr)
 {
 	if (blk == NULL) {
-		blk = _blk_alloc();
+		blk = _blk_alloc(state);
 		if (blk == NULL)
 			return NULL;
 	}
@@ -406,8 +549,8 @@ static struct bpf_blk *_blk_append(struct bpf_state *state,
  *
  * Add the new BPF instruction to the start of the given instruction block.
  * If the given instruction block is NULL, a new block will be allocated.
- * Returns a pointer to the block on success, NULL on failure, and in the case
- * of failure the instruction block is free'd.
+ * Returns a pointer to the block on success, NULL on failure; the block's
+ * memory stays owned by the BPF state arena in either case.
  *
  */
 static struct bpf_blk *_blk_prepend(struct bpf_state *state,
@@ -530,24 +673,86 @@ static void _program_free(struct bpf_program *prg)
  */
 static void _state_release(struct bpf_state *state)
 {
-	unsigned int bkt;
-	struct bpf_hash_bkt *iter;
-
 	if (state == NULL)
 		return;
 
-	/* release all of the hash table entries */
-	for (bkt = 0; bkt < _BPF_HASH_SIZE; bkt++) {
-		while (state->htbl[bkt]) {
-			iter = state->htbl[bkt];
-			state->htbl[bkt] = iter->next;
-			__blk_free(state, iter->blk);
-			free(iter);
+	/* the blocks and hash table entries all live in the arena */
+	if (state->htbl != NULL)
+		free(state->htbl);
+	_arena_release(state);
+	_program_free(state->bpf);
+
+	memset(state, 0, sizeof(*state));
+}
+
+/**
+ * Resize the BPF state hash table
+ * @param state the BPF state
+ * @param bits the new size of the hash table, in bits
+ *
+ * Allocate a hash table with 2^@bits buckets and move any existing entries
+ * from the old hash table into the new one.  The hash table is left untouched
+ * on failure.  Returns zero on success, negative values on failure.
+ *
+ */
+static int _hsh_resize(struct bpf_state *state, unsigned int bits)
+{
+	unsigned int bkt, bkt_new;
+	struct bpf_hash_bkt **htbl;
+	struct bpf_hash_bkt *h_iter;
+
+	htbl = zmalloc(_BPF_HASH_SIZE(bits) * sizeof(*htbl));
+	if (htbl == NULL)
+		return -ENOMEM;
+
+	/* rehash the existing entries, the bucket order is not significant */
+	for (bkt = 0;
+	     state->htbl != NULL && bkt < _BPF_HASH_SIZE(state->htbl_bits);
+	     bkt++) {
+		while (state->htbl[bkt] != NULL) {
+			h_iter = state->htbl[bkt];
+			state->htbl[bkt] = h_iter->next;
+			bkt_new = h_iter->blk->hash & _BPF_HASH_MASK(bits);
+			h_iter->next = htbl[bkt_new];
+			htbl[bkt_new] = h_iter;
 		}
 	}
-	_program_free(state->bpf);
+	if (state->htbl != NULL)
+		free(state->htbl);
+	state->htbl = htbl;
+	state->htbl_bits = bits;
+
+	return 0;
+}
+
+/**
+ * Initialize the BPF state
+ * @param state the BPF state
+ * @param col the seccomp filter collection
+ *
+ * Initialize the BPF state for the given filter collection.  Returns zero on
+ * success, negative values on failure.
+ *
+ */
+static int _state_init(struct bpf_state *state,
+		       const struct db_filter_col *col)
+{
+	int rc;
 
 	memset(state, 0, sizeof(*state));
+	state->attr = &col->attr;
+
+	rc = _hsh_resize(state, _BPF_HASH_BITS_MIN);
+	if (rc < 0)
+		return rc;
+
+	state->bpf = zmalloc(sizeof(*(state->bpf)));
+	if (state->bpf == NULL) {
+		_state_release(state);
+		return -ENOMEM;
+	}
+
+	return 0;
 }
 
 /**
@@ -556,10 +761,11 @@ static void _state_release(struct bpf_state *state)
  * @param blk_p pointer to the BPF instruction block
  * @param found initial found value (see _hsh_find_once() for description)
  *
- * This function adds an instruction block to the hash table, and frees the
- * block if an identical instruction block already exists, returning a pointer
- * to the original block in place of the given block.  Returns zero on success
- * and negative values on failure.
+ * This function adds an instruction block to the hash table.  If an identical
+ * instruction block already exists a pointer to the original block is
+ * returned in place of the given block, the duplicate is simply abandoned as
+ * its memory stays owned by the BPF state arena.  Returns zero on success and
+ * negative values on failure.
  *
  */
 static int _hsh_add(struct bpf_state *state, struct bpf_blk **blk_p,
@@ -568,12 +774,16 @@ static int _hsh_add(struct bpf_state *state, struct bpf_blk **blk_p,
 	uint64_t h_val, h_val_tmp[3];
 	struct bpf_hash_bkt *h_new, *h_iter, *h_prev = NULL;
 	struct bpf_blk *blk = *blk_p;
-	struct bpf_blk *b_iter;
 
 	if (blk->flag_hash)
 		return 0;
 
-	h_new = zmalloc(sizeof(*h_new));
+	/* grow the hash table if needed, a failure here is not fatal */
+	if (state->htbl_cnt >= _BPF_HASH_LOAD_MAX(state->htbl_bits) &&
+	    state->htbl_bits < _BPF_HASH_BITS_MAX)
+		_hsh_resize(state, state->htbl_bits + 1);
+
+	h_new = _arena_alloc(state, sizeof(*h_new));
 	if (h_new == NULL)
 		return -ENOMEM;
 
@@ -590,9 +800,10 @@ static int _hsh_add(struct bpf_state *state, struct bpf_blk **blk_p,
 
 	/* insert the block into the hash table */
 hsh_add_restart:
-	h_iter = state->htbl[h_val & _BPF_HASH_MASK];
+	h_iter = state->htbl[h_val & _BPF_HASH_MASK(state->htbl_bits)];
 	if (h_iter != NULL) {
 		do {
+			state->htbl_probes++;
 			if ((h_iter->blk->hash == h_val) &&
 			    (_BLK_MSZE(h_iter->blk) == _BLK_MSZE(blk)) &&
 			    (memcmp(h_iter->blk->blks, blk->blks,
@@ -602,39 +813,25 @@ hsh_add_restart:
 			    _ACC_CMP_EQ(h_iter->blk->acc_end,
 					blk->acc_end)) {
 				/* duplicate block */
-				free(h_new);
-
-				/* store the duplicate block */
-				b_iter = h_iter->blk;
-				while (b_iter->hash_nxt != NULL)
-					b_iter = b_iter->hash_nxt;
-				b_iter->hash_nxt = blk;
 
 				/* in some cases we want to return the
 				 * duplicate block */
-				if (found) {
-					blk->flag_dup = true;
+				if (found)
 					return 0;
-				}
 
 				/* update the priority if needed */
 				if (h_iter->blk->priority < blk->priority)
 					h_iter->blk->priority = blk->priority;
 
-				/* try to save some memory */
-				free(blk->blks);
-				blk->blks = h_iter->blk->blks;
-				blk->flag_unique = false;
-
 				*blk_p = h_iter->blk;
 				return 0;
 			} else if (h_iter->blk->hash == h_val) {
 				/* hash collision */
+				state->htbl_collisions++;
 				if ((h_val >> 32) == 0xffffffff) {
 					/* overflow */
 					blk->flag_hash = false;
 					blk->hash = 0;
-					free(h_new);
 					return -EFAULT;
 				}
 				h_val += ((uint64_t)1 << 32);
@@ -650,67 +847,115 @@ hsh_add_restart:
 		} while (h_iter != NULL);
 		h_prev->next = h_new;
 	} else
-		state->htbl[h_val & _BPF_HASH_MASK] = h_new;
+		state->htbl[h_val & _BPF_HASH_MASK(state->htbl_bits)] = h_new;
+	state->htbl_cnt++;
 
 	return 0;
 }
 
 /**
- * Remove an entry from the hash table
+ * Find and return a hash bucket
  * @param state the BPF state
  * @param h_val the hash value
  *
- * Remove an entry from the hash table and return it to the caller, NULL is
- * returned if the entry can not be found.
+ * Find the entry associated with the given hash value and return it to the
+ * caller, NULL is returned if the entry can not be found.  This function
+ * should not be called directly; use _hsh_find_once() instead.
  *
  */
-static struct bpf_blk *_hsh_remove(struct bpf_state *state, uint64_t h_val)
+static struct bpf_hash_bkt *_hsh_find_bkt(struct bpf_state *state,
+					  uint64_t h_val)
 {
-	unsigned int bkt = h_val & _BPF_HASH_MASK;
-	struct bpf_blk *blk;
-	struct bpf_hash_bkt *h_iter, *h_prev = NULL;
+	struct bpf_hash_bkt *h_iter;
 
-	h_iter = state->htbl[bkt];
+	h_iter = state->htbl[h_val & _BPF_HASH_MASK(state->htbl_bits)];
 	while (h_iter != NULL) {
-		if (h_iter->blk->hash == h_val) {
-			if (h_prev != NULL)
-				h_prev->next = h_iter->next;
-			else
-				state->htbl[bkt] = h_iter->next;
-			blk = h_iter->blk;
-			free(h_iter);
-			return blk;
-		}
-		h_prev = h_iter;
-		h_iter =  h_iter->next;
+		state->htbl_probes++;
+		if (h_iter->blk->hash == h_val)
+			return h_iter;
+		h_iter = h_iter->next;
 	}
 
 	return NULL;
 }
 
 /**
- * Find and return a hash bucket
+ * Merge a BPF state hash table into another
  * @param state the BPF state
- * @param h_val the hash value
+ * @param src the BPF state to merge
  *
- * Find the entry associated with the given hash value and return it to the
- * caller, NULL is returned if the entry can not be found.  This function
- * should not be called directly; use _hsh_find() and _hsh_find_once() instead.
+ * Move all of the instruction blocks and hash table entries from @src into
+ * @state, dropping any blocks that already exist in @state.  The memory arena
+ * of @src is handed over to @state even on failure.  Returns zero on success,
+ * -EAGAIN if two different blocks share the same hash value, and negative
+ * values on other failures.
  *
  */
-static struct bpf_hash_bkt *_hsh_find_bkt(const struct bpf_state *state,
-					  uint64_t h_val)
+static int _hsh_merge(struct bpf_state *state, struct bpf_state *src)
 {
-	struct bpf_hash_bkt *h_iter;
+	int rc;
+	unsigned int bkt, bkt_new;
+	struct bpf_arena *chunk;
+	struct bpf_hash_bkt *h_new, *h_iter;
+	struct bpf_blk *blk;
 
-	h_iter = state->htbl[h_val & _BPF_HASH_MASK];
-	while (h_iter != NULL) {
-		if (h_iter->blk->hash == h_val)
-			return h_iter;
-		h_iter = h_iter->next;
+	/* the blocks and buckets live in the arena, take ownership first */
+	if (src->arena != NULL) {
+		chunk = src->arena;
+		while (chunk->next != NULL)
+			chunk = chunk->next;
+		if (state->arena != NULL) {
+			chunk->next = state->arena->next;
+			state->arena->next = src->arena;
+		} else
+			state->arena = src->arena;
+		src->arena = NULL;
 	}
 
-	return NULL;
+	state->htbl_probes += src->htbl_probes;
+	state->htbl_collisions += src->htbl_collisions;
+
+	for (bkt = 0; bkt < _BPF_HASH_SIZE(src->htbl_bits); bkt++) {
+		while (src->htbl[bkt] != NULL) {
+			h_new = src->htbl[bkt];
+			src->htbl[bkt] = h_new->next;
+			blk = h_new->blk;
+
+			if (state->htbl_cnt >=
+			    _BPF_HASH_LOAD_MAX(state->htbl_bits) &&
+			    state->htbl_bits < _BPF_HASH_BITS_MAX) {
+				rc = _hsh_resize(state, state->htbl_bits + 1);
+				if (rc < 0)
+					return rc;
+			}
+
+			h_iter = _hsh_find_bkt(state, blk->hash);
+			if (h_iter == NULL) {
+				bkt_new = blk->hash &
+					  _BPF_HASH_MASK(state->htbl_bits);
+				h_new->next = state->htbl[bkt_new];
+				state->htbl[bkt_new] = h_new;
+				state->htbl_cnt++;
+				continue;
+			}
+
+			/* the references to the block are by hash value so
+			 * we can't resolve a collision at this point */
+			if ((_BLK_MSZE(h_iter->blk) != _BLK_MSZE(blk)) ||
+			    (memcmp(h_iter->blk->blks, blk->blks,
+				    _BLK_MSZE(blk)) != 0) ||
+			    !_ACC_CMP_EQ(h_iter->blk->acc_start,
+					 blk->acc_start) ||
+			    !_ACC_CMP_EQ(h_iter->blk->acc_end, blk->acc_end))
+				return -EAGAIN;
+
+			/* duplicate block */
+			if (h_iter->blk->priority < blk->priority)
+				h_iter->blk->priority = blk->priority;
+		}
+	}
+
+	return 0;
 }
 
 /**
@@ -724,7 +969,7 @@ static struct bpf_hash_bkt *_hsh_find_bkt(const struct bpf_state *state,
  * call.
  *
  */
-static struct bpf_blk *_hsh_find_once(const struct bpf_state *state,
+static struct bpf_blk *_hsh_find_once(struct bpf_state *state,
 				      uint64_t h_val)
 {
 	struct bpf_hash_bkt *h_iter;
@@ -736,25 +981,6 @@ static struct bpf_blk *_hsh_find_once(const struct bpf_state *state,
 	return h_iter->blk;
 }
 
-/**
- * Finds an entry in the hash table
- * @param state the BPF state
- * @param h_val the hash value
- *
- * Find the entry associated with the given hash value and return it to the
- * caller, NULL is returned if the entry can not be found.
- *
- */
-static struct bpf_blk *_hsh_find(const struct bpf_state *state, uint64_t h_val)
-{
-	struct bpf_hash_bkt *h_iter;
-
-	h_iter = _hsh_find_bkt(state, h_val);
-	if (h_iter == NULL)
-		return NULL;
-	return h_iter->blk;
-}
-
 /**
  * Generate a BPF action instruction
  * @param state the BPF state
@@ -793,14 +1019,89 @@ static struct bpf_blk *_gen_bpf_action_hsh(struct bpf_state *state,
 	blk = _gen_bpf_action(state, NULL, action);
 	if (blk == NULL)
 		return NULL;
-	if (_hsh_add(state, &blk, 0) < 0) {
-		_blk_free(state, blk);
+	if (_hsh_add(state, &blk, 0) < 0)
 		return NULL;
-	}
 
 	return blk;
 }
 
+/**
+ * Determine the number of instructions in a set search
+ * @param cnt the number of values in the set
+ *
+ * Return the number of instructions generated by _gen_bpf_node_set() for a
+ * set of the given size.
+ *
+ */
+static unsigned int _gen_bpf_set_len(unsigned int cnt)
+{
+	if (cnt <= _BPF_SET_LINEAR)
+		return cnt;
+	return 1 + _gen_bpf_set_len(cnt - cnt / 2) + _gen_bpf_set_len(cnt / 2);
+}
+
+/**
+ * Generate a binary search over a set of values
+ * @param state the BPF state
+ * @param blk the instruction block
+ * @param set the sorted set values
+ * @param cnt the number of values in the set
+ * @param j_t the jump if the accumulator is in the set
+ * @param j_f the jump if the accumulator is not in the set
+ * @param last the final instruction of the search
+ *
+ * Append a binary search for the accumulator over the given set to the
+ * instruction block, the upper half of each split is placed directly after
+ * the JGE so that all of the internal jumps are short forward jumps.  The
+ * final instruction is returned in @last rather than appended to the block.
+ * Returns a pointer to the block on success, NULL on failure.
+ *
+ */
+static struct bpf_blk *_gen_bpf_node_set(struct bpf_state *state,
+					 struct bpf_blk *blk,
+					 const uint32_t *set, unsigned int cnt,
+					 struct bpf_jump j_t,
+					 struct bpf_jump j_f,
+					 struct bpf_instr *last)
+{
+	unsigned int iter;
+	unsigned int mid;
+	struct bpf_instr instr;
+
+	if (cnt <= _BPF_SET_LINEAR) {
+		/* a short linear search is cheaper than another split */
+		for (iter = 0; iter < cnt - 1; iter++) {
+			_BPF_INSTR(instr,
+				   _BPF_OP(state->arch, BPF_JMP + BPF_JEQ),
+				   j_t, _BPF_JMP_IMM(0),
+				   _BPF_K(state->arch, set[iter]));
+			blk = _blk_append(state, blk, &instr);
+			if (blk == NULL)
+				return NULL;
+		}
+		_BPF_INSTR(*last, _BPF_OP(state->arch, BPF_JMP + BPF_JEQ),
+			   j_t, j_f, _BPF_K(state->arch, set[cnt - 1]));
+		return blk;
+	}
+
+	mid = cnt / 2;
+	_BPF_INSTR(instr, _BPF_OP(state->arch, BPF_JMP + BPF_JGE),
+		   _BPF_JMP_IMM(0),
+		   _BPF_JMP_IMM(_gen_bpf_set_len(cnt - mid)),
+		   _BPF_K(state->arch, set[mid]));
+	blk = _blk_append(state, blk, &instr);
+	if (blk == NULL)
+		return NULL;
+	blk = _gen_bpf_node_set(state, blk, &set[mid], cnt - mid,
+				j_t, j_f, &instr);
+	if (blk == NULL)
+		return NULL;
+	blk = _blk_append(state, blk, &instr);
+	if (blk == NULL)
+		return NULL;
+	return _gen_bpf_node_set(state, blk, set, mid, j_t, j_f, last);
+}
+
 /**
  * Generate a BPF instruction block for a given chain node
  * @param state the BPF state
@@ -820,8 +1121,9 @@ static struct bpf_blk *_gen_bpf_node(struct bpf_state *state,
 	uint64_t act_t_hash = 0, act_f_hash = 0;
 	struct bpf_blk *blk, *b_act;
 	struct bpf_instr instr;
+	struct bpf_jump j_t, j_f;
 
-	blk = _blk_alloc();
+	blk = _blk_alloc(state);
 	if (blk == NULL)
 		return NULL;
 	blk->acc_start = *a_state;
@@ -877,23 +1179,54 @@ static struct bpf_blk *_gen_bpf_node(struct bpf_state *state,
 	 *       by blk->acc_end, it must be kept correct */
 	blk->acc_end = *a_state;
 
+	/* fixup the jump targets */
+	if (node->nxt_t != NULL)
+		j_t = _BPF_JMP_DB(node->nxt_t);
+	else if (node->act_t_flg)
+		j_t = _BPF_JMP_HSH(act_t_hash);
+	else
+		j_t = _BPF_JMP_NXT(0);
+	if (node->nxt_f != NULL)
+		j_f = _BPF_JMP_DB(node->nxt_f);
+	else if (node->act_f_flg)
+		j_f = _BPF_JMP_HSH(act_f_hash);
+	else
+		j_f = _BPF_JMP_NXT(0);
+
 	/* check the accumulator against the datum */
 	switch (node->op) {
 	case SCMP_CMP_MASKED_EQ:
 	case SCMP_CMP_EQ:
 		_BPF_INSTR(instr, _BPF_OP(state->arch, BPF_JMP + BPF_JEQ),
-			   _BPF_JMP_NO, _BPF_JMP_NO,
-			   _BPF_K(state->arch, node->datum));
+			   j_t, j_f, _BPF_K(state->arch, node->datum));
 		break;
 	case SCMP_CMP_GT:
 		_BPF_INSTR(instr, _BPF_OP(state->arch, BPF_JMP + BPF_JGT),
-			   _BPF_JMP_NO, _BPF_JMP_NO,
-			   _BPF_K(state->arch, node->datum));
+			   j_t, j_f, _BPF_K(state->arch, node->datum));
 		break;
 	case SCMP_CMP_GE:
 		_BPF_INSTR(instr, _BPF_OP(state->arch, BPF_JMP + BPF_JGE),
-			   _BPF_JMP_NO, _BPF_JMP_NO,
-			   _BPF_K(state->arch, node->datum));
+			   j_t, j_f, _BPF_K(state->arch, node->datum));
+		break;
+	case SCMP_CMP_IN_RANGE:
+		/* the lower bound check is a no-op when it is zero */
+		if (node->datum > 0) {
+			_BPF_INSTR(instr,
+				   _BPF_OP(state->arch, BPF_JMP + BPF_JGE),
+				   _BPF_JMP_IMM(0), j_f,
+				   _BPF_K(state->arch, node->datum));
+			blk = _blk_append(state, blk, &instr);
+			if (blk == NULL)
+				goto node_failure;
+		}
+		_BPF_INSTR(instr, _BPF_OP(state->arch, BPF_JMP + BPF_JGT),
+			   j_f, j_t, _BPF_K(state->arch, node->datum_ext));
+		break;
+	case SCMP_CMP_IN_SET:
+		blk = _gen_bpf_node_set(state, blk, node->set, node->datum_ext,
+					j_t, j_f, &instr);
+		if (blk == NULL)
+			goto node_failure;
 		break;
 	case SCMP_CMP_NE:
 	case SCMP_CMP_LT:
@@ -902,20 +1235,6 @@ static struct bpf_blk *_gen_bpf_node(struct bpf_state *state,
 		/* fatal error, we should never get here */
 		goto node_failure;
 	}
-
-	/* fixup the jump targets */
-	if (node->nxt_t != NULL)
-		instr.jt = _BPF_JMP_DB(node->nxt_t);
-	else if (node->act_t_flg)
-		instr.jt = _BPF_JMP_HSH(act_t_hash);
-	else
-		instr.jt = _BPF_JMP_NXT(0);
-	if (node->nxt_f != NULL)
-		instr.jf = _BPF_JMP_DB(node->nxt_f);
-	else if (node->act_f_flg)
-		instr.jf = _BPF_JMP_HSH(act_f_hash);
-	else
-		instr.jf = _BPF_JMP_NXT(0);
 	blk = _blk_append(state, blk, &instr);
 	if (blk == NULL)
 		goto node_failure;
@@ -924,7 +1243,6 @@ static struct bpf_blk *_gen_bpf_node(struct bpf_state *state,
 	return blk;
 
 node_failure:
-	_blk_free(state, blk);
 	return NULL;
 }
 
@@ -942,7 +1260,7 @@ node_failure:
  *
  */
 static struct bpf_blk *_gen_bpf_chain_lvl_res(struct bpf_state *state,
-					      const struct db_sys_list *sys,
+					      const struct bpf_sys *sys,
 					      struct bpf_blk *blk,
 					      const struct bpf_jump *nxt_jump)
 {
@@ -1043,7 +1361,7 @@ static struct bpf_blk *_gen_bpf_chain_lvl_res(struct bpf_state *state,
  *
  */
 static struct bpf_blk *_gen_bpf_chain(struct bpf_state *state,
-				      const struct db_sys_list *sys,
+				      const struct bpf_sys *sys,
 				      const struct db_arg_chain_tree *chain,
 				      const struct bpf_jump *nxt_jump,
 				      struct acc_state *a_state)
@@ -1057,7 +1375,7 @@ static struct bpf_blk *_gen_bpf_chain(struct bpf_state *state,
 	struct acc_state acc = *a_state;
 
 	if (chain == NULL) {
-		b_head = _gen_bpf_action(state, NULL, sys->action);
+		b_head = _gen_bpf_action(state, NULL, sys->gen_action);
 		if (b_head == NULL)
 			goto chain_failure;
 		b_tail = b_head;
@@ -1144,28 +1462,104 @@ static struct bpf_blk *_gen_bpf_chain(struct bpf_state *state,
 	return b_head;
 
 chain_failure:
-	while (b_head != NULL) {
-		b_iter = b_head;
-		b_head = b_iter->lvl_nxt;
-		_blk_free(state, b_iter);
-	}
 	return NULL;
 }
 
 /**
- * Sort the syscalls by syscall number
- * @param syscalls the linked list of syscalls to be sorted
- * @param s_head the head of the linked list to be returned to the caller
- * @param s_tail the tail of the linked list to be returned to the caller
+ * Generates the BPF instruction blocks for a syscall's argument chains
+ * @param state the BPF state
+ * @param sys the syscall filter
+ * @param a_state the accumulator state
+ * @param blk_hsh the hash value of the first block
+ *
+ * Generate the BPF instruction blocks for the syscall's argument chains, with
+ * the default action at the end of the chains, and return the hash value of
+ * the first block.  The blocks of a previously generated syscall with
+ * structurally equal argument chains are reused instead of generating and
+ * hashing the same blocks again.  Returns zero on success, negative values on
+ * failure.
+ *
  */
-static void _sys_num_sort(struct db_sys_list *syscalls,
-			  struct db_sys_list **s_head,
-			  struct db_sys_list **s_tail)
+static int _gen_bpf_sys_chain(struct bpf_state *state,
+			      const struct bpf_sys *sys,
+			      struct acc_state *a_state,
+			      uint64_t *blk_hsh)
 {
-	struct db_sys_list *s_iter, *s_iter_b;
-
-	db_list_foreach(s_iter, syscalls) {
-		if (*s_head != NULL) {
+	uint32_t chains_hash = 0;
+	struct acc_state acc = *a_state;
+	struct bpf_chain_memo *m_iter;
+	struct bpf_blk *blk;
+	struct bpf_jump def_jump;
+
+	/* we do the memset before the assignment to keep valgrind happy */
+	memset(&def_jump, 0, sizeof(def_jump));
+	def_jump = _BPF_JMP_HSH(state->def_hsh);
+
+	if (sys->chains == NULL)
+		goto chain_gen;
+
+	/* NOTE: the arena memory is already zeroed */
+	if (state->chain_memo == NULL) {
+		state->chain_memo = _arena_alloc(state,
+						 sizeof(*state->chain_memo) *
+						 _BPF_MEMO_SIZE);
+		if (state->chain_memo == NULL)
+			return -ENOMEM;
+	}
+	chains_hash = db_chain_hash(sys->chains);
+	for (m_iter = state->chain_memo[chains_hash & _BPF_MEMO_MASK];
+	     m_iter != NULL; m_iter = m_iter->next) {
+		if (m_iter->arch == state->arch &&
+		    m_iter->chains_hash == chains_hash &&
+		    _ACC_CMP_EQ(m_iter->acc, acc) &&
+		    db_chain_lvl_eq(m_iter->sys->chains, sys->chains)) {
+			*blk_hsh = m_iter->blk_hsh;
+			return 0;
+		}
+	}
+
+chain_gen:
+	blk = _gen_bpf_chain(state, sys, sys->gen_chains, &def_jump, a_state);
+	if (blk == NULL)
+		return -ENOMEM;
+	*blk_hsh = blk->hash;
+
+	if (sys->chains == NULL || state->chain_memo == NULL)
+		return 0;
+
+	/* a failure here is not fatal, we just lose the memo entry */
+	m_iter = _arena_alloc(state, sizeof(*m_iter));
+	if (m_iter == NULL)
+		return 0;
+	m_iter->arch = state->arch;
+	m_iter->sys = sys;
+	m_iter->chains_hash = chains_hash;
+	m_iter->acc = acc;
+	m_iter->blk_hsh = blk->hash;
+	m_iter->next = state->chain_memo[chains_hash & _BPF_MEMO_MASK];
+	state->chain_memo[chains_hash & _BPF_MEMO_MASK] = m_iter;
+
+	return 0;
+}
+
+/**
+ * Sort the syscalls by syscall number
+ * @param syscalls the array of syscalls to be sorted
+ * @param sys_cnt the number of syscalls in the array
+ * @param s_head the head of the linked list to be returned to the caller
+ * @param s_tail the tail of the linked list to be returned to the caller
+ */
+static void _sys_num_sort(struct bpf_sys *syscalls,
+			  unsigned int sys_cnt,
+			  struct bpf_sys **s_head,
+			  struct bpf_sys **s_tail)
+{
+	unsigned int iter;
+	struct bpf_sys *s_iter, *s_iter_b;
+
+	for (iter = 0; iter < sys_cnt; iter++) {
+		s_iter = &syscalls[iter];
+		if (*s_head != NULL) {
 			s_iter_b = *s_head;
 			while ((s_iter_b->pri_nxt != NULL) &&
 			       (s_iter->num <= s_iter_b->num))
@@ -1198,17 +1592,21 @@ static void _sys_num_sort(struct db_sys_list *syscalls,
 
 /**
  * Sort the syscalls by priority
- * @param syscalls the linked list of syscalls to be sorted
+ * @param syscalls the array of syscalls to be sorted
+ * @param sys_cnt the number of syscalls in the array
  * @param s_head the head of the linked list to be returned to the caller
  * @param s_tail the tail of the linked list to be returned to the caller
  */
-static void _sys_priority_sort(struct db_sys_list *syscalls,
-			       struct db_sys_list **s_head,
-			       struct db_sys_list **s_tail)
+static void _sys_priority_sort(struct bpf_sys *syscalls,
+			       unsigned int sys_cnt,
+			       struct bpf_sys **s_head,
+			       struct bpf_sys **s_tail)
 {
-	struct db_sys_list *s_iter, *s_iter_b;
+	unsigned int iter;
+	struct bpf_sys *s_iter, *s_iter_b;
 
-	db_list_foreach(s_iter, syscalls) {
+	for (iter = 0; iter < sys_cnt; iter++) {
+		s_iter = &syscalls[iter];
 		if (*s_head != NULL) {
 			s_iter_b = *s_head;
 			while ((s_iter_b->pri_nxt != NULL) &&
@@ -1242,23 +1640,24 @@ static void _sys_priority_sort(struct db_sys_list *syscalls,
 
 /**
  * Sort the syscalls
- * @param syscalls the linked list of syscalls to be sorted
+ * @param syscalls the array of syscalls to be sorted
+ * @param sys_cnt the number of syscalls in the array
  * @param s_head the head of the linked list to be returned to the caller
  * @param s_tail the tail of the linked list to be returned to the caller
  *
  * Wrapper function for sorting syscalls
  *
  */
-static void _sys_sort(struct db_sys_list *syscalls,
-		      struct db_sys_list **s_head,
-		      struct db_sys_list **s_tail,
+static void _sys_sort(struct bpf_sys *syscalls, unsigned int sys_cnt,
+		      struct bpf_sys **s_head,
+		      struct bpf_sys **s_tail,
 		      uint32_t optimize)
 {
-	if (optimize != 2)
-		_sys_priority_sort(syscalls, s_head, s_tail);
+	if (optimize < 2)
+		_sys_priority_sort(syscalls, sys_cnt, s_head, s_tail);
 	else
-		/* sort by number for the binary tree */
-		_sys_num_sort(syscalls, s_head, s_tail);
+		/* sort by number for the binary tree and range dispatch */
+		_sys_num_sort(syscalls, sys_cnt, s_head, s_tail);
 }
 
 /**
@@ -1291,6 +1690,299 @@ static int _gen_bpf_insert(struct bpf_state *state, struct bpf_instr *instr,
 	return rc;
 }
 
+/**
+ * Determine if an argument chain node always takes the same branch
+ * @param node the argument chain node
+ *
+ * Returns 1 if the comparison is true for every argument value, 0 if it is
+ * false for every argument value, and -1 if it depends on the argument value.
+ *
+ */
+static int _gen_bpf_node_const(const struct db_arg_chain_tree *node)
+{
+	/* NOTE: the argument is always masked before the comparison */
+	switch (node->op) {
+	case SCMP_CMP_EQ:
+	case SCMP_CMP_MASKED_EQ:
+		if ((node->datum & ~node->mask) != 0)
+			return 0;
+		if (node->mask == 0)
+			return 1;
+		break;
+	case SCMP_CMP_GT:
+		if (node->datum >= node->mask)
+			return 0;
+		break;
+	case SCMP_CMP_GE:
+		if (node->datum == 0)
+			return 1;
+		if (node->datum > node->mask)
+			return 0;
+		break;
+	case SCMP_CMP_IN_RANGE:
+		if (node->datum > node->mask)
+			return 0;
+		if (node->datum == 0 && node->datum_ext >= node->mask)
+			return 1;
+		break;
+	default:
+		break;
+	}
+
+	return -1;
+}
+
+/**
+ * Determine if two simplified branches are equal
+ * @param a the first branch
+ * @param b the second branch
+ */
+static bool _gen_bpf_branch_eq(const struct bpf_branch *a,
+			       const struct bpf_branch *b)
+{
+	if (a->type != b->type)
+		return false;
+	if (a->type == _BPF_BR_ACT)
+		return (a->act == b->act);
+	if (a->type == _BPF_BR_LVL)
+		return db_chain_lvl_eq(a->lvl, b->lvl);
+	return true;
+}
+
+/**
+ * Determine if an argument chain node always continues with the next node
+ * @param node the simplified argument chain node
+ * @param cont the action taken at the end of the level
+ */
+static bool _gen_bpf_node_cont(const struct db_arg_chain_tree *node,
+			       uint32_t cont)
+{
+	if (node->nxt_t != NULL || node->nxt_f != NULL)
+		return false;
+	if (node->act_t_flg && node->act_t != cont)
+		return false;
+	if (node->act_f_flg && node->act_f != cont)
+		return false;
+	return true;
+}
+
+static int _gen_bpf_simplify_lvl(struct bpf_state *state,
+				 const struct db_arg_chain_tree *chain,
+				 const uint32_t *cont,
+				 struct bpf_branch *branch);
+
+/**
+ * Simplify one branch of an argument chain node
+ * @param state the BPF state
+ * @param nxt the next argument chain level, NULL if none
+ * @param act_flg the action flag
+ * @param act the action
+ * @param cont the action taken at the end of the node's level, NULL if unknown
+ * @param branch the simplified branch
+ *
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int _gen_bpf_simplify_branch(struct bpf_state *state,
+				    const struct db_arg_chain_tree *nxt,
+				    bool act_flg, uint32_t act,
+				    const uint32_t *cont,
+				    struct bpf_branch *branch)
+{
+	memset(branch, 0, sizeof(*branch));
+	if (nxt != NULL)
+		return _gen_bpf_simplify_lvl(state, nxt, cont, branch);
+	if (act_flg) {
+		branch->type = _BPF_BR_ACT;
+		branch->act = act;
+	} else
+		branch->type = _BPF_BR_NXT;
+	return 0;
+}
+
+/**
+ * Simplify an argument chain level
+ * @param state the BPF state
+ * @param chain a node on the argument chain level
+ * @param cont the action taken at the end of the level, NULL if unknown
+ * @param branch the simplified level
+ *
+ * Build a simplified copy of the given argument chain level in the BPF state
+ * arena.  Nodes which always fall through to the next node are dropped, nodes
+ * whose branches are equal are replaced by the branch, and nodes after a node
+ * which always takes the same action are dropped.  Trailing nodes which only
+ * lead to the @cont action are dropped as well.  A level which always takes
+ * the same action is reduced to that action.  Returns zero on success,
+ * negative values on failure.
+ *
+ */
+static int _gen_bpf_simplify_lvl(struct bpf_state *state,
+				 const struct db_arg_chain_tree *chain,
+				 const uint32_t *cont,
+				 struct bpf_branch *branch)
+{
+	int rc, c_val;
+	const uint32_t *c_sub;
+	const struct db_arg_chain_tree *c_iter;
+	struct db_arg_chain_tree *n_head = NULL, *n_tail = NULL, *n_new;
+	struct bpf_branch b_t, b_f;
+
+	c_iter = chain;
+	while (c_iter->lvl_prv != NULL)
+		c_iter = c_iter->lvl_prv;
+
+	for (; c_iter != NULL; c_iter = c_iter->lvl_nxt) {
+		/* the end of the last node's branches is the end of the level */
+		c_sub = (c_iter->lvl_nxt == NULL ? cont : NULL);
+
+		c_val = _gen_bpf_node_const(c_iter);
+		if (c_val != 0) {
+			rc = _gen_bpf_simplify_branch(state, c_iter->nxt_t,
+						      c_iter->act_t_flg,
+						      c_iter->act_t,
+						      c_sub, &b_t);
+			if (rc < 0)
+				return rc;
+		}
+		if (c_val != 1) {
+			rc = _gen_bpf_simplify_branch(state, c_iter->nxt_f,
+						      c_iter->act_f_flg,
+						      c_iter->act_f,
+						      c_sub, &b_f);
+			if (rc < 0)
+				return rc;
+		}
+		if (c_val == 1)
+			b_f = b_t;
+		else if (c_val == 0)
+			b_t = b_f;
+
+		n_new = NULL;
+		if (_gen_bpf_branch_eq(&b_t, &b_f)) {
+			if (b_t.type == _BPF_BR_NXT)
+				/* the node is a no-op */
+				continue;
+			if (b_t.type == _BPF_BR_ACT && n_head == NULL) {
+				/* the level always takes the same action */
+				branch->type = _BPF_BR_ACT;
+				branch->act = b_t.act;
+				return 0;
+			}
+			if (b_t.type == _BPF_BR_LVL)
+				/* splice the branch into this level */
+				n_new = b_t.lvl;
+		}
+		if (n_new == NULL) {
+			n_new = _arena_alloc(state, sizeof(*n_new));
+			if (n_new == NULL)
+				return -ENOMEM;
+			*n_new = *c_iter;
+			n_new->lvl_prv = NULL;
+			n_new->lvl_nxt = NULL;
+			n_new->nxt_t = b_t.lvl;
+			n_new->act_t_flg = (b_t.type == _BPF_BR_ACT);
+			n_new->act_t = b_t.act;
+			n_new->nxt_f = b_f.lvl;
+			n_new->act_f_flg = (b_f.type == _BPF_BR_ACT);
+			n_new->act_f = b_f.act;
+		}
+		if (n_tail != NULL) {
+			n_tail->lvl_nxt = n_new;
+			n_new->lvl_prv = n_tail;
+		} else
+			n_head = n_new;
+		n_tail = n_new;
+		while (n_tail->lvl_nxt != NULL)
+			n_tail = n_tail->lvl_nxt;
+
+		/* the nodes after an unconditional action are unreachable */
+		if (n_tail->nxt_t == NULL && n_tail->nxt_f == NULL &&
+		    n_tail->act_t_flg && n_tail->act_f_flg &&
+		    n_tail->act_t == n_tail->act_f)
+			break;
+	}
+
+	/* drop the trailing nodes which end up at the end of the level */
+	while (cont != NULL && n_tail != NULL &&
+	       _gen_bpf_node_cont(n_tail, *cont)) {
+		n_tail = n_tail->lvl_prv;
+		if (n_tail != NULL)
+			n_tail->lvl_nxt = NULL;
+		else
+			n_head = NULL;
+	}
+
+	if (n_head != NULL) {
+		branch->type = _BPF_BR_LVL;
+		branch->lvl = n_head;
+	} else
+		branch->type = _BPF_BR_NXT;
+	return 0;
+}
+
+/**
+ * Simplify the argument chains of a filter's syscalls
+ * @param state the BPF state
+ * @param db the seccomp filter DB
+ * @param sys_p the generator's syscall array
+ * @param sys_cnt the number of syscalls in the array
+ *
+ * Build the generator's own array of the syscalls, in index order, with
+ * simplified copies of the syscalls' argument chains; the filter DB itself is
+ * left untouched.  Syscalls whose argument chains always take the same action
+ * are treated as syscalls without any argument chains.  Returns zero on
+ * success, negative values on failure.
+ *
+ */
+static int _gen_bpf_simplify(struct bpf_state *state,
+			     const struct db_filter *db,
+			     struct bpf_sys **sys_p, unsigned int *sys_cnt)
+{
+	int rc;
+	unsigned int pos, cnt = db->sys_idx_cnt;
+	const struct db_sys_list *s_iter;
+	struct bpf_sys *sys, *s_new;
+	struct bpf_branch branch;
+
+	*sys_p = NULL;
+	*sys_cnt = 0;
+	if (cnt == 0)
+		return 0;
+
+	/* NOTE: the arena memory is already zeroed */
+	sys = _arena_alloc(state, sizeof(*sys) * cnt);
+	if (sys == NULL)
+		return -ENOMEM;
+
+	s_new = sys;
+	db_syscall_foreach(s_iter, pos, db) {
+		s_new->num = s_iter->num;
+		s_new->priority = s_iter->priority;
+		s_new->weight = s_iter->weight;
+		s_new->valid = s_iter->valid;
+		s_new->chains = s_iter->chains;
+		s_new->gen_action = s_iter->action;
+		if (s_iter->chains != NULL && s_iter->valid) {
+			rc = _gen_bpf_simplify_lvl(state, s_iter->chains,
+						   &state->attr->act_default,
+						   &branch);
+			if (rc < 0)
+				return rc;
+			if (branch.type == _BPF_BR_LVL)
+				s_new->gen_chains = branch.lvl;
+			else if (branch.type == _BPF_BR_ACT)
+				s_new->gen_action = branch.act;
+			else
+				s_new->gen_action = state->attr->act_default;
+		}
+		s_new++;
+	}
+
+	*sys_p = sys;
+	*sys_cnt = cnt;
+	return 0;
+}
+
 /**
  * Decide if we need to omit the syscall from the BPF filter
  * @param state the BPF state
@@ -1298,11 +1990,16 @@ static int _gen_bpf_insert(struct bpf_state *state, struct bpf_instr *instr,
  * @return true if syscall is to be skipped, false otherwise
  */
 static inline bool _skip_syscall(struct bpf_state *state,
-				 struct db_sys_list *syscall)
+				 const struct bpf_sys *syscall)
 {
 	if (!syscall->valid)
 		return true;
 
+	/* syscalls which always take the default action are redundant */
+	if (syscall->gen_chains == NULL &&
+	    syscall->gen_action == state->attr->act_default)
+		return true;
+
 	/* psuedo-syscalls should not be added to the filter unless explicity
 	 * requested via SCMP_FLTATR_API_TSKIP
 	 */
@@ -1319,9 +2016,9 @@ static inline bool _skip_syscall(struct bpf_state *state,
  * @param s_tail the last syscall in the syscall linked list
  */
 static unsigned int _get_syscall_cnt(struct bpf_state *state,
-				     struct db_sys_list *s_tail)
+				     struct bpf_sys *s_tail)
 {
-	struct db_sys_list *s_iter;
+	struct bpf_sys *s_iter;
 	unsigned int syscall_cnt = 0;
 
 	for (s_iter = s_tail; s_iter != NULL; s_iter = s_iter->pri_prv) {
@@ -1334,6 +2031,27 @@ static unsigned int _get_syscall_cnt(struct bpf_state *state,
 	return syscall_cnt;
 }
 
+/**
+ * Determine if any of the syscalls in the BPF filter have a weight
+ * @param state the BPF state
+ * @param s_tail the last syscall in the syscall linked list
+ */
+static bool _get_syscall_weighted(struct bpf_state *state,
+				  struct bpf_sys *s_tail)
+{
+	struct bpf_sys *s_iter;
+
+	for (s_iter = s_tail; s_iter != NULL; s_iter = s_iter->pri_prv) {
+		if (_skip_syscall(state, s_iter))
+			continue;
+
+		if (s_iter->weight > 0)
+			return true;
+	}
+
+	return false;
+}
+
 /**
  * Calculate the number of levels in the binary tree
  * @param syscall_cnt the number of syscalls in this seccomp filter
@@ -1467,8 +2185,8 @@ out:
 /**
  * Generate the BPF instruction blocks for a given syscall
  * @param state the BPF state
- * @param sys the syscall filter DB entry
- * @param nxt_hash the hash value of the next syscall filter DB entry
+ * @param sys the syscall filter
+ * @param nxt_hash the hash value of the next syscall filter
  * @param acc_reset accumulator reset flag
  *
  * Generate the BPF instruction blocks for the given syscall filter and return
@@ -1479,21 +2197,17 @@ out:
  *
  */
 static struct bpf_blk *_gen_bpf_syscall(struct bpf_state *state,
-					const struct db_sys_list *sys,
+					const struct bpf_sys *sys,
 					uint64_t nxt_hash,
 					bool acc_reset)
 {
 	int rc;
+	uint64_t chain_hsh;
 	struct bpf_instr instr;
-	struct bpf_blk *blk_c, *blk_s;
-	struct bpf_jump def_jump;
+	struct bpf_blk *blk_s;
 	struct acc_state a_state;
 
-	/* we do the memset before the assignment to keep valgrind happy */
-	memset(&def_jump, 0, sizeof(def_jump));
-	def_jump = _BPF_JMP_HSH(state->def_hsh);
-
-	blk_s = _blk_alloc();
+	blk_s = _blk_alloc(state);
 	if (blk_s == NULL)
 		return NULL;
 
@@ -1517,15 +2231,12 @@ static struct bpf_blk *_gen_bpf_syscall(struct bpf_state *state,
 	}
 
 	/* generate the argument chains */
-	blk_c = _gen_bpf_chain(state, sys, sys->chains, &def_jump, &a_state);
-	if (blk_c == NULL) {
-		_blk_free(state, blk_s);
+	if (_gen_bpf_sys_chain(state, sys, &a_state, &chain_hsh) < 0)
 		return NULL;
-	}
 
 	/* syscall check */
 	_BPF_INSTR(instr, _BPF_OP(state->arch, BPF_JMP + BPF_JEQ),
-		   _BPF_JMP_HSH(blk_c->hash), _BPF_JMP_HSH(nxt_hash),
+		   _BPF_JMP_HSH(chain_hsh), _BPF_JMP_HSH(nxt_hash),
 		   _BPF_K(state->arch, sys->num));
 	blk_s = _blk_append(state, blk_s, &instr);
 	if (blk_s == NULL)
@@ -1534,14 +2245,525 @@ static struct bpf_blk *_gen_bpf_syscall(struct bpf_state *state,
 
 	/* add to the hash table */
 	rc = _hsh_add(state, &blk_s, 1);
-	if (rc < 0) {
-		_blk_free(state, blk_s);
+	if (rc < 0)
 		return NULL;
-	}
 
 	return blk_s;
 }
 
+/**
+ * Add a syscall range to the list of ranges
+ * @param ranges the list of syscall ranges
+ * @param range_cnt the number of syscall ranges in the list
+ * @param lo the lowest syscall number in the new range
+ * @param hi the highest syscall number in the new range
+ * @param hsh the hash value of the range's target block
+ * @param weight the weight of the new range
+ *
+ * Add a new syscall range to the end of the list, coalescing it with the last
+ * range in the list if they are adjacent and share the same target block.
+ *
+ */
+static void _gen_bpf_range_add(struct bpf_range *ranges,
+			       unsigned int *range_cnt,
+			       uint32_t lo, uint32_t hi, uint64_t hsh,
+			       uint64_t weight)
+{
+	struct bpf_range *r_last;
+
+	if (*range_cnt > 0) {
+		r_last = &ranges[*range_cnt - 1];
+		if (r_last->hsh == hsh && r_last->hi + 1 == lo) {
+			r_last->hi = hi;
+			r_last->weight += weight;
+			return;
+		}
+	}
+
+	ranges[*range_cnt].lo = lo;
+	ranges[*range_cnt].hi = hi;
+	ranges[*range_cnt].hsh = hsh;
+	ranges[*range_cnt].weight = weight;
+	(*range_cnt)++;
+}
+
+/**
+ * Test for a single syscall surrounded by a common target
+ * @param ranges the list of syscall ranges
+ * @param lo the first range in the set
+ * @param hi the last range in the set
+ *
+ * Returns true if the given set of syscall ranges can be checked with a single
+ * BPF_JEQ instruction, false otherwise.
+ *
+ */
+static bool _gen_bpf_range_single(const struct bpf_range *ranges,
+				  unsigned int lo, unsigned int hi)
+{
+	return ((hi - lo) == 2 && ranges[lo].hsh == ranges[hi].hsh &&
+		ranges[lo + 1].lo == ranges[lo + 1].hi);
+}
+
+/**
+ * Build the optimal weighted search tree for a set of syscall ranges
+ * @param state the BPF state
+ * @param ranges the list of syscall ranges
+ * @param range_cnt the number of syscall ranges
+ *
+ * Use Knuth's dynamic programming algorithm to find the search tree which
+ * minimizes the weighted number of checks needed to reach each range and
+ * record the root of each subtree in the BPF state for use by
+ * _gen_bpf_range_node().  Each range is given an equal share of the total
+ * weight on top of its own weight so that the rarely used syscalls are never
+ * pushed too far down the tree.  Returns zero on success, negative values on
+ * failure.
+ *
+ */
+static int _gen_bpf_range_weights(struct bpf_state *state,
+				  const struct bpf_range *ranges,
+				  unsigned int range_cnt)
+{
+	unsigned int iter, len, lo, hi, k, k_min;
+	uint64_t total = 0, share, cost, cost_min;
+	uint64_t *weights, *costs;
+	unsigned int *root;
+
+	weights = zmalloc(sizeof(*weights) * (range_cnt + 1));
+	costs = zmalloc(sizeof(*costs) * range_cnt * range_cnt);
+	root = _arena_alloc(state, sizeof(*root) * range_cnt * range_cnt);
+	if (weights == NULL || costs == NULL || root == NULL) {
+		free(weights);
+		free(costs);
+		return -ENOMEM;
+	}
+
+	/* prefix sums of the smoothed range weights */
+	for (iter = 0; iter < range_cnt; iter++)
+		total += ranges[iter].weight;
+	share = total / range_cnt + 1;
+	for (iter = 0; iter < range_cnt; iter++)
+		weights[iter + 1] = weights[iter] + ranges[iter].weight + share;
+
+	for (len = 1; len < range_cnt; len++) {
+		for (lo = 0; lo + len < range_cnt; lo++) {
+			hi = lo + len;
+
+			/* the root is monotonic in the subtree bounds */
+			if (len == 1) {
+				k = hi;
+				k_min = hi;
+			} else {
+				k = root[lo * range_cnt + (hi - 1)];
+				k_min = root[(lo + 1) * range_cnt + hi];
+				if (k > k_min) {
+					/* fallback to a full search */
+					k = lo + 1;
+					k_min = hi;
+				}
+			}
+			cost_min = UINT64_MAX;
+			for (; k <= k_min; k++) {
+				cost = costs[lo * range_cnt + (k - 1)] +
+				       costs[k * range_cnt + hi];
+				if (cost < cost_min) {
+					cost_min = cost;
+					root[lo * range_cnt + hi] = k;
+				}
+			}
+
+			cost = weights[hi + 1] - weights[lo];
+			if (_gen_bpf_range_single(ranges, lo, hi))
+				cost_min = 0;
+			costs[lo * range_cnt + hi] = cost_min + cost;
+		}
+	}
+
+	free(weights);
+	free(costs);
+	state->range_root = root;
+	state->range_cnt = range_cnt;
+	return 0;
+}
+
+static int _gen_bpf_range_tree(struct bpf_state *state,
+			       const struct bpf_range *ranges,
+			       unsigned int lo, unsigned int hi,
+			       uint64_t *hsh);
+
+/**
+ * Generate the check instruction for a set of syscall ranges
+ * @param state the BPF state
+ * @param ranges the list of syscall ranges
+ * @param lo the first range in the set
+ * @param hi the last range in the set
+ * @param instr the BPF instruction
+ *
+ * Generate the instruction which splits the given set of syscall ranges in
+ * two, generating the blocks for each half as needed.  The split point is
+ * taken from the weighted search tree if one was built, otherwise the set is
+ * split in half.  The set of ranges must contain at least two ranges.  Returns
+ * zero on success, negative values on failure.
+ *
+ */
+static int _gen_bpf_range_node(struct bpf_state *state,
+			       const struct bpf_range *ranges,
+			       unsigned int lo, unsigned int hi,
+			       struct bpf_instr *instr)
+{
+	int rc;
+	unsigned int mid;
+	uint64_t hsh_t, hsh_f;
+
+	if (_gen_bpf_range_single(ranges, lo, hi)) {
+		/* a single syscall surrounded by a common target */
+		_BPF_INSTR(*instr, _BPF_OP(state->arch, BPF_JMP + BPF_JEQ),
+			   _BPF_JMP_HSH(ranges[lo + 1].hsh),
+			   _BPF_JMP_HSH(ranges[lo].hsh),
+			   _BPF_K(state->arch, ranges[lo + 1].lo));
+		return 0;
+	}
+
+	if (state->range_root != NULL)
+		mid = state->range_root[lo * state->range_cnt + hi];
+	else
+		mid = lo + ((hi - lo + 1) / 2);
+	rc = _gen_bpf_range_tree(state, ranges, mid, hi, &hsh_t);
+	if (rc < 0)
+		return rc;
+	rc = _gen_bpf_range_tree(state, ranges, lo, mid - 1, &hsh_f);
+	if (rc < 0)
+		return rc;
+	_BPF_INSTR(*instr, _BPF_OP(state->arch, BPF_JMP + BPF_JGE),
+		   _BPF_JMP_HSH(hsh_t), _BPF_JMP_HSH(hsh_f),
+		   _BPF_K(state->arch, ranges[mid].lo));
+
+	return 0;
+}
+
+/**
+ * Generate the search tree for a set of syscall ranges
+ * @param state the BPF state
+ * @param ranges the list of syscall ranges
+ * @param lo the first range in the set
+ * @param hi the last range in the set
+ * @param hsh the hash value of the tree
+ *
+ * Generate the blocks for a search tree which dispatches a syscall number in
+ * the given set of ranges to the range's target block, the hash value of the
+ * top of the tree is returned in @hsh.  All of the blocks are added to the
+ * hash table.  Returns zero on success, negative values on failure.
+ *
+ */
+static int _gen_bpf_range_tree(struct bpf_state *state,
+			       const struct bpf_range *ranges,
+			       unsigned int lo, unsigned int hi,
+			       uint64_t *hsh)
+{
+	int rc;
+	struct bpf_instr instr;
+	struct bpf_blk *blk;
+
+	/* a single range needs no further checks */
+	if (lo == hi) {
+		*hsh = ranges[lo].hsh;
+		return 0;
+	}
+
+	rc = _gen_bpf_range_node(state, ranges, lo, hi, &instr);
+	if (rc < 0)
+		return rc;
+	blk = _blk_append(state, NULL, &instr);
+	if (blk == NULL)
+		return -ENOMEM;
+	blk->acc_start = _ACC_STATE_OFFSET(_BPF_OFFSET_SYSCALL);
+	blk->acc_end = _ACC_STATE_OFFSET(_BPF_OFFSET_SYSCALL);
+	rc = _hsh_add(state, &blk, 0);
+	if (rc < 0)
+		return rc;
+	*hsh = blk->hash;
+
+	return 0;
+}
+
+/**
+ * Generate the bitmap check for a window of syscalls
+ * @param state the BPF state
+ * @param sys the list of syscalls in the window
+ * @param sys_cnt the number of syscalls in the window
+ * @param tgt_hsh the hash value of the bitmap's target block
+ * @param hsh the hash value of the bitmap block
+ *
+ * Generate a block which checks if the syscall number is a member of the
+ * given window of BITMAP_BITS syscalls by shifting a bitmap of the syscalls
+ * which jump to @tgt_hsh and testing the result with a single BPF_JSET; any
+ * syscalls in the window with a different target are checked individually
+ * beforehand.  The window must be aligned on a BITMAP_BITS boundary and the
+ * block assumes the syscall number is already in the accumulator.  Returns
+ * zero on success, negative values on failure.
+ *
+ */
+static int _gen_bpf_bitmap(struct bpf_state *state,
+			   const struct bpf_range *sys, unsigned int sys_cnt,
+			   uint64_t tgt_hsh, uint64_t *hsh)
+{
+	int rc;
+	unsigned int iter;
+	uint32_t bitmap = 0;
+	struct bpf_instr instr;
+	struct bpf_blk *blk;
+
+	blk = _blk_alloc(state);
+	if (blk == NULL)
+		return -ENOMEM;
+	blk->acc_start = _ACC_STATE_OFFSET(_BPF_OFFSET_SYSCALL);
+	blk->acc_end = _ACC_STATE_UNDEF;
+
+	for (iter = 0; iter < sys_cnt; iter++) {
+		if (sys[iter].hsh == tgt_hsh) {
+			bitmap |= (uint32_t)1 << (sys[iter].lo % BITMAP_BITS);
+			continue;
+		}
+		_BPF_INSTR(instr, _BPF_OP(state->arch, BPF_JMP + BPF_JEQ),
+			   _BPF_JMP_HSH(sys[iter].hsh), _BPF_JMP_NO,
+			   _BPF_K(state->arch, sys[iter].lo));
+		blk = _blk_append(state, blk, &instr);
+		if (blk == NULL)
+			return -ENOMEM;
+	}
+
+	/* X = (syscall % BITMAP_BITS); A = (bitmap >> X); if (A & 1) ... */
+	_BPF_INSTR(instr, _BPF_OP(state->arch, BPF_ALU + BPF_AND),
+		   _BPF_JMP_NO, _BPF_JMP_NO,
+		   _BPF_K(state->arch, BITMAP_BITS - 1));
+	blk = _blk_append(state, blk, &instr);
+	if (blk == NULL)
+		return -ENOMEM;
+	_BPF_INSTR(instr, _BPF_OP(state->arch, BPF_MISC + BPF_TAX),
+		   _BPF_JMP_NO, _BPF_JMP_NO, _BPF_K(state->arch, 0));
+	blk = _blk_append(state, blk, &instr);
+	if (blk == NULL)
+		return -ENOMEM;
+	_BPF_INSTR(instr, _BPF_OP(state->arch, BPF_LD + BPF_IMM),
+		   _BPF_JMP_NO, _BPF_JMP_NO, _BPF_K(state->arch, bitmap));
+	blk = _blk_append(state, blk, &instr);
+	if (blk == NULL)
+		return -ENOMEM;
+	_BPF_INSTR(instr, _BPF_OP(state->arch, BPF_ALU + BPF_RSH + BPF_X),
+		   _BPF_JMP_NO, _BPF_JMP_NO, _BPF_K(state->arch, 0));
+	blk = _blk_append(state, blk, &instr);
+	if (blk == NULL)
+		return -ENOMEM;
+	_BPF_INSTR(instr, _BPF_OP(state->arch, BPF_JMP + BPF_JSET),
+		   _BPF_JMP_HSH(tgt_hsh), _BPF_JMP_HSH(state->def_hsh),
+		   _BPF_K(state->arch, 1));
+	blk = _blk_append(state, blk, &instr);
+	if (blk == NULL)
+		return -ENOMEM;
+
+	rc = _hsh_add(state, &blk, 0);
+	if (rc < 0)
+		return rc;
+	*hsh = blk->hash;
+
+	return 0;
+}
+
+/**
+ * Determine the best bitmap target for a window of syscalls
+ * @param state the BPF state
+ * @param sys the list of syscalls in the window
+ * @param sys_cnt the number of syscalls in the window
+ * @param tgt_hsh the hash value of the bitmap's target block
+ *
+ * Pick the most common target in the given window of syscalls and decide if
+ * a bitmap check would be smaller than the equivalent range checks.  Returns
+ * true and sets @tgt_hsh if a bitmap should be used, false otherwise.
+ *
+ */
+static bool _gen_bpf_bitmap_tgt(struct bpf_state *state,
+				const struct bpf_range *sys,
+				unsigned int sys_cnt, uint64_t *tgt_hsh)
+{
+	unsigned int iter, iter_b;
+	unsigned int cnt, cnt_max = 0;
+	unsigned int range_cnt = 0;
+	uint64_t nxt_num;
+	struct bpf_range ranges[BITMAP_BITS * 2 + 1];
+
+	for (iter = 0; iter < sys_cnt; iter++) {
+		cnt = 0;
+		for (iter_b = iter; iter_b < sys_cnt; iter_b++)
+			if (sys[iter_b].hsh == sys[iter].hsh)
+				cnt++;
+		if (cnt > cnt_max) {
+			cnt_max = cnt;
+			*tgt_hsh = sys[iter].hsh;
+		}
+	}
+
+	/* count the ranges we would need without the bitmap */
+	nxt_num = BITMAP_WINDOW(sys[0].lo) * BITMAP_BITS;
+	for (iter = 0; iter < sys_cnt; iter++) {
+		if (sys[iter].lo > nxt_num)
+			_gen_bpf_range_add(ranges, &range_cnt, nxt_num,
+					   sys[iter].lo - 1, state->def_hsh, 0);
+		_gen_bpf_range_add(ranges, &range_cnt,
+				   sys[iter].lo, sys[iter].lo, sys[iter].hsh, 0);
+		nxt_num = (uint64_t)sys[iter].lo + 1;
+	}
+	if (nxt_num % BITMAP_BITS)
+		range_cnt++;
+
+	/* each syscall which doesn't use the bitmap needs its own check */
+	return (BITMAP_INSTR_CNT + (sys_cnt - cnt_max) < range_cnt);
+}
+
+/**
+ * Generate the range based dispatch for the syscalls in the db_filter
+ * @param state the BPF state
+ * @param s_tail the last syscall in the syscall linked list
+ * @param acc_reset accumulator reset flag
+ * @param bitmap bitmap flag
+ * @param blks_added number of blocks added by this function
+ *
+ * Coalesce runs of adjacent syscall numbers which share the same target into
+ * ranges and generate a search tree of range checks to dispatch the syscall
+ * to the target.  If @bitmap is true, windows of syscalls which would result
+ * in too many ranges are replaced by a bitmap check.  If any of the syscalls
+ * have a weight the search tree is built to favor the heavier syscalls.  The
+ * syscall list must be sorted by syscall number.  Returns zero on success,
+ * negative values on failure.
+ *
+ */
+static int _gen_bpf_syscalls_range(struct bpf_state *state,
+				   struct bpf_sys *s_tail,
+				   bool acc_reset, bool bitmap,
+				   unsigned int *blks_added)
+{
+	int rc;
+	uint64_t nxt_num = 0, win_num, tgt_hsh = 0, win_hsh, win_weight;
+	unsigned int iter, iter_w;
+	bool weighted = false;
+	unsigned int sys_cnt = 0, range_cnt = 0;
+	struct bpf_range *sys, *ranges;
+	struct bpf_sys *s_iter;
+	struct bpf_instr instr;
+	struct bpf_blk *blk_r = NULL;
+	struct acc_state a_state;
+
+	/* each syscall can add at most two ranges, plus the final gap */
+	iter = _get_syscall_cnt(state, s_tail);
+	if (iter == 0)
+		return 0;
+	sys = _arena_alloc(state, sizeof(*sys) * iter);
+	ranges = _arena_alloc(state, sizeof(*ranges) * (iter * 2 + 1));
+	if (sys == NULL || ranges == NULL)
+		return -ENOMEM;
+
+	for (s_iter = s_tail; s_iter != NULL; s_iter = s_iter->pri_prv) {
+		if (_skip_syscall(state, s_iter))
+			continue;
+
+		/* the argument chains never depend on the accumulator */
+		a_state = _ACC_STATE_UNDEF;
+		rc = _gen_bpf_sys_chain(state, s_iter, &a_state,
+					&sys[sys_cnt].hsh);
+		if (rc < 0)
+			return rc;
+
+		sys[sys_cnt].lo = s_iter->num;
+		sys[sys_cnt].hi = s_iter->num;
+		sys[sys_cnt].weight = s_iter->weight;
+		if (s_iter->weight > 0)
+			weighted = true;
+		sys_cnt++;
+	}
+
+	for (iter = 0; iter < sys_cnt; iter = iter_w) {
+		/* find the end of the bitmap window */
+		iter_w = iter + 1;
+		while (iter_w < sys_cnt &&
+		       BITMAP_WINDOW(sys[iter_w].lo) == BITMAP_WINDOW(sys[iter].lo))
+			iter_w++;
+
+		if (bitmap &&
+		    _gen_bpf_bitmap_tgt(state, &sys[iter], iter_w - iter,
+					&tgt_hsh)) {
+			rc = _gen_bpf_bitmap(state, &sys[iter], iter_w - iter,
+					     tgt_hsh, &win_hsh);
+			if (rc < 0)
+				return rc;
+
+			/* the whole window jumps to the bitmap check */
+			win_num = BITMAP_WINDOW(sys[iter].lo) * BITMAP_BITS;
+			win_weight = 0;
+			for (; iter < iter_w; iter++)
+				win_weight += sys[iter].weight;
+			if (win_num > nxt_num)
+				_gen_bpf_range_add(ranges, &range_cnt, nxt_num,
+						   win_num - 1,
+						   state->def_hsh, 0);
+			_gen_bpf_range_add(ranges, &range_cnt, win_num,
+					   win_num + BITMAP_BITS - 1, win_hsh,
+					   win_weight);
+			nxt_num = win_num + BITMAP_BITS;
+			continue;
+		}
+
+		for (; iter < iter_w; iter++) {
+			/* any gaps fall through to the default action */
+			if (sys[iter].lo > nxt_num)
+				_gen_bpf_range_add(ranges, &range_cnt, nxt_num,
+						   sys[iter].lo - 1,
+						   state->def_hsh, 0);
+			_gen_bpf_range_add(ranges, &range_cnt,
+					   sys[iter].lo, sys[iter].hi,
+					   sys[iter].hsh, sys[iter].weight);
+			nxt_num = (uint64_t)sys[iter].hi + 1;
+		}
+	}
+	if (nxt_num <= UINT32_MAX)
+		_gen_bpf_range_add(ranges, &range_cnt, nxt_num, UINT32_MAX,
+				   state->def_hsh, 0);
+
+	/* very large sets of ranges fallback to a balanced tree */
+	state->range_root = NULL;
+	if (weighted && range_cnt <= WTREE_RANGES_MAX) {
+		rc = _gen_bpf_range_weights(state, ranges, range_cnt);
+		if (rc < 0)
+			return rc;
+	}
+
+	/* the top of the tree is the only block on the block list */
+	if (acc_reset) {
+		_BPF_INSTR(instr, _BPF_OP(state->arch, BPF_LD + BPF_ABS),
+			   _BPF_JMP_NO, _BPF_JMP_NO,
+			   _BPF_SYSCALL(state->arch));
+		blk_r = _blk_append(state, NULL, &instr);
+		if (blk_r == NULL)
+			return -ENOMEM;
+		blk_r->acc_start = _ACC_STATE_UNDEF;
+	} else {
+		blk_r = _blk_alloc(state);
+		if (blk_r == NULL)
+			return -ENOMEM;
+		blk_r->acc_start = _ACC_STATE_OFFSET(_BPF_OFFSET_SYSCALL);
+	}
+	blk_r->acc_end = _ACC_STATE_OFFSET(_BPF_OFFSET_SYSCALL);
+	rc = _gen_bpf_range_node(state, ranges, 0, range_cnt - 1, &instr);
+	state->range_root = NULL;
+	if (rc < 0)
+		return rc;
+	rc = _gen_bpf_insert(state, &instr, &state->b_new, &state->b_head,
+			     blk_r);
+	if (rc < 0)
+		return rc;
+	state->b_tail = state->b_head;
+	(*blks_added)++;
+
+	return 0;
+}
+
 /**
  * Loop through the syscalls in the db_filter and generate their bpf
  * @param state the BPF state
@@ -1555,7 +2777,9 @@ static int _gen_bpf_syscalls(struct bpf_state *state,
 			     unsigned int *blks_added, uint32_t optimize,
 			     unsigned int *bintree_levels)
 {
-	struct db_sys_list *s_head = NULL, *s_tail = NULL, *s_iter;
+	struct bpf_sys *s_head = NULL, *s_tail = NULL, *s_iter;
+	struct bpf_sys *sys, *sys_secondary = NULL;
+	unsigned int sys_cnt, sys_cnt_secondary = 0;
 	unsigned int syscall_cnt, empty_cnt = 0;
 	uint64_t *bintree_hashes = NULL, nxt_hsh;
 	unsigned int *bintree_syscalls = NULL;
@@ -1569,10 +2793,31 @@ static int _gen_bpf_syscalls(struct bpf_state *state,
 
 	*blks_added = 0;
 
+	/* simplify the argument chains */
+	rc = _gen_bpf_simplify(state, db, &sys, &sys_cnt);
+	if (rc < 0)
+		return rc;
+	if (db_secondary != NULL) {
+		rc = _gen_bpf_simplify(state, db_secondary,
+				       &sys_secondary, &sys_cnt_secondary);
+		if (rc < 0)
+			return rc;
+	}
+
 	/* sort the syscall list */
-	_sys_sort(db->syscalls, &s_head, &s_tail, optimize);
+	_sys_sort(sys, sys_cnt, &s_head, &s_tail, optimize);
 	if (db_secondary != NULL)
-		_sys_sort(db_secondary->syscalls, &s_head, &s_tail, optimize);
+		_sys_sort(sys_secondary, sys_cnt_secondary,
+			  &s_head, &s_tail, optimize);
+
+	/* the first syscall in the filter loads the syscall number */
+	while (s_head != NULL && _skip_syscall(state, s_head))
+		s_head = s_head->pri_nxt;
+
+	/* the binary tree can't take the syscall weights into account, use
+	 * the range based search tree instead */
+	if (optimize == 2 && _get_syscall_weighted(state, s_tail))
+		optimize = 3;
 
 	if (optimize == 2) {
 		syscall_cnt = _get_syscall_cnt(state, s_tail);
@@ -1595,6 +2840,12 @@ static int _gen_bpf_syscalls(struct bpf_state *state,
 		 */
 		acc_reset = false;
 
+	if (optimize >= 3) {
+		rc = _gen_bpf_syscalls_range(state, s_tail, acc_reset,
+					     (optimize == 4), blks_added);
+		goto out;
+	}
+
 	syscall_cnt = 0;
 
 	/* create the syscall filters and add them to block list group */
@@ -1675,7 +2926,7 @@ static struct bpf_blk *_gen_bpf_arch(struct bpf_state *state,
 	int rc;
 	unsigned int blk_cnt = 0, blks_added = 0, bintree_levels = 0;
 	struct bpf_instr instr;
-	struct bpf_blk *b_iter, *b_bintree;
+	struct bpf_blk *b_bintree;
 
 	state->arch = db->arch;
 
@@ -1780,16 +3031,8 @@ static struct bpf_blk *_gen_bpf_arch(struct bpf_state *state,
 	return state->b_head;
 
 arch_failure:
-	/* NOTE: we do the cleanup here and not just return an error as all of
-	 * the instruction blocks may not be added to the hash table when we
-	 * hit an error */
+	/* NOTE: the instruction blocks are released with the arena */
 	state->arch = NULL;
-	b_iter = state->b_head;
-	while (b_iter != NULL) {
-		state->b_new = b_iter->next;
-		_blk_free(state, b_iter);
-		b_iter = state->b_new;
-	}
 	return NULL;
 }
 
@@ -1868,8 +3111,7 @@ static int _gen_bpf_build_jmp_ret(struct bpf_state *state,
 	/* NOTE - we need to be careful here, we're giving the block a hash
 	 *	  value (this is a sneaky way to ensure we leverage the
 	 *	  inserted long jumps as much as possible) but we never add the
-	 *	  block to the hash table so it won't get cleaned up
-	 *	  automatically */
+	 *	  block to the hash table */
 	b_new->hash = tgt_hash;
 
 	/* insert the jump after the current jumping block */
@@ -1957,8 +3199,7 @@ static int _gen_bpf_build_jmp(struct bpf_state *state,
 	/* NOTE - we need to be careful here, we're giving the block a hash
 	 *	  value (this is a sneaky way to ensure we leverage the
 	 *	  inserted long jumps as much as possible) but we never add the
-	 *	  block to the hash table so it won't get cleaned up
-	 *	  automatically */
+	 *	  block to the hash table */
 	b_new->hash = tgt_hash;
 
 	/* insert the jump after the current jumping block */
@@ -1970,29 +3211,136 @@ static int _gen_bpf_build_jmp(struct bpf_state *state,
 	return 1;
 }
 
+/**
+ * Generate the BPF instruction blocks for a set of architecture jobs
+ * @param arg the BPF worker
+ *
+ * Thread entry point which generates the instruction blocks for each of the
+ * worker's jobs using the worker's private BPF state.  Always returns NULL,
+ * the result is stored in the worker.
+ *
+ */
+static void *_gen_bpf_worker(void *arg)
+{
+	unsigned int iter;
+	struct bpf_worker *worker = arg;
+	struct bpf_arch_job *job;
+
+	for (iter = worker->job_first;
+	     iter < worker->job_cnt;
+	     iter += worker->job_stride) {
+		job = &worker->jobs[iter];
+		job->b_head = _gen_bpf_arch(&worker->state, job->db,
+					    job->db_secondary,
+					    worker->state.attr->optimize);
+		if (job->b_head == NULL) {
+			worker->rc = -ENOMEM;
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Generate the BPF instruction blocks for all architectures using threads
+ * @param state the BPF state
+ * @param jobs the architecture jobs
+ * @param job_cnt the number of jobs
+ * @param threads the maximum number of threads
+ *
+ * Split the architecture jobs across a number of threads, each with its own
+ * BPF state, and then merge the per-thread hash tables into @state in thread
+ * order so that the result doesn't depend on the thread scheduling.  Returns
+ * zero on success, -EAGAIN if the per-thread states can not be merged, and
+ * negative values on other failures.
+ *
+ */
+static int _gen_bpf_arch_threads(struct bpf_state *state,
+				 struct bpf_arch_job *jobs,
+				 unsigned int job_cnt, unsigned int threads)
+{
+	int rc = 0;
+	unsigned int iter;
+	unsigned int worker_cnt;
+	struct bpf_worker *workers, *worker;
+
+	worker_cnt = (threads < job_cnt ? threads : job_cnt);
+	workers = zmalloc(worker_cnt * sizeof(*workers));
+	if (workers == NULL)
+		return -ENOMEM;
+
+	for (iter = 0; iter < worker_cnt; iter++) {
+		worker = &workers[iter];
+		worker->state.attr = state->attr;
+		worker->state.bad_arch_hsh = state->bad_arch_hsh;
+		worker->state.def_hsh = state->def_hsh;
+		worker->jobs = jobs;
+		worker->job_cnt = job_cnt;
+		worker->job_first = iter;
+		worker->job_stride = worker_cnt;
+		rc = _hsh_resize(&worker->state, _BPF_HASH_BITS_MIN);
+		if (rc < 0)
+			goto out;
+	}
+
+	/* the calling thread takes the first share of the jobs, if we can't
+	 * start a thread we simply do its share of the work ourselves */
+	for (iter = 1; iter < worker_cnt; iter++) {
+		worker = &workers[iter];
+		if (pthread_create(&worker->thread, NULL,
+				   _gen_bpf_worker, worker) == 0)
+			worker->thread_valid = true;
+	}
+	_gen_bpf_worker(&workers[0]);
+	for (iter = 1; iter < worker_cnt; iter++) {
+		worker = &workers[iter];
+		if (worker->thread_valid)
+			pthread_join(worker->thread, NULL);
+		else
+			_gen_bpf_worker(worker);
+	}
+
+	for (iter = 0; iter < worker_cnt && rc == 0; iter++) {
+		rc = workers[iter].rc;
+		if (rc == 0)
+			rc = _hsh_merge(state, &workers[iter].state);
+	}
+
+out:
+	for (iter = 0; iter < worker_cnt; iter++)
+		_state_release(&workers[iter].state);
+	free(workers);
+	return rc;
+}
+
 /**
  * Generate the BPF program for the given filter collection
  * @param state the BPF state
  * @param col the filter collection
+ * @param threads the maximum number of threads
  *
  * Generate the BPF program for the given filter collection.  Returns zero on
  * success, negative values on failure.
  *
  */
 static int _gen_bpf_build_bpf(struct bpf_state *state,
-			      const struct db_filter_col *col)
+			      const struct db_filter_col *col,
+			      unsigned int threads)
 {
 	int rc;
 	int iter;
 	uint64_t h_val;
 	unsigned int res_cnt;
 	unsigned int jmp_len;
+	unsigned int job_cnt = 0;
 	int arch_x86_64 = -1, arch_x32 = -1;
 	struct bpf_instr instr;
 	struct bpf_instr *i_iter;
 	struct bpf_blk *b_badarch, *b_default;
 	struct bpf_blk *b_head = NULL, *b_tail = NULL, *b_iter, *b_new, *b_jmp;
 	struct db_filter *db_secondary = NULL;
+	struct bpf_arch_job *jobs;
 	struct arch_def pseudo_arch;
 
 	/* create a fake architecture definition for use in the early stages */
@@ -2031,6 +3379,9 @@ static int _gen_bpf_build_bpf(struct bpf_state *state,
 	b_tail = b_head;
 
 	/* generate the per-architecture filters */
+	jobs = zmalloc(col->filter_cnt * sizeof(*jobs));
+	if (jobs == NULL)
+		return -ENOMEM;
 	for (iter = 0; iter < col->filter_cnt; iter++) {
 		if (col->filters[iter]->arch->token == SCMP_ARCH_X86_64)
 			arch_x86_64 = iter;
@@ -2052,17 +3403,40 @@ static int _gen_bpf_build_bpf(struct bpf_state *state,
 		} else
 			db_secondary = NULL;
 
-		/* create the filter for the architecture(s) */
-		b_new = _gen_bpf_arch(state, col->filters[iter], db_secondary,
-				      col->attr.optimize);
-		if (b_new == NULL)
-			return -ENOMEM;
+		jobs[job_cnt].db = col->filters[iter];
+		jobs[job_cnt].db_secondary = db_secondary;
+		job_cnt++;
+	}
+
+	/* create the filter for the architecture(s) */
+	if (threads > 1 && job_cnt > 1)
+		rc = _gen_bpf_arch_threads(state, jobs, job_cnt, threads);
+	else {
+		for (iter = 0; iter < job_cnt; iter++) {
+			jobs[iter].b_head = _gen_bpf_arch(state, jobs[iter].db,
+							  jobs[iter].db_secondary,
+							  col->attr.optimize);
+			if (jobs[iter].b_head == NULL) {
+				rc = -ENOMEM;
+				break;
+			}
+		}
+	}
+	if (rc < 0) {
+		free(jobs);
+		return rc;
+	}
+
+	/* stitch the architecture filters together in the original order */
+	for (iter = 0; iter < job_cnt; iter++) {
+		b_new = jobs[iter].b_head;
 		b_new->prev = b_tail;
 		b_tail->next = b_new;
 		b_tail = b_new;
 		while (b_tail->next != NULL)
 			b_tail = b_tail->next;
 	}
+	free(jobs);
 
 	/* add a badarch action to the end */
 	b_badarch->prev = b_tail;
@@ -2274,54 +3648,337 @@ static int _gen_bpf_build_bpf(struct bpf_state *state,
 		if (rc < 0)
 			goto build_bpf_free_blks;
 
-		/* we're done with the block, free it */
+		/* we're done with the block */
 		b_head = b_iter->next;
-		_blk_free(state, b_iter);
 	} while (b_head != NULL);
 
 	return 0;
 
 build_bpf_free_blks:
-	b_iter = b_head;
-	while (b_iter != NULL) {
-		b_jmp = b_iter->next;
-		_hsh_remove(state, b_iter->hash);
-		__blk_free(state, b_iter);
-		b_iter = b_jmp;
-	}
+	/* NOTE: the instruction blocks are released with the arena */
 	return rc;
 }
 
+/**
+ * Find the instruction which is executed when jumping to an instruction
+ * @param prg the decoded BPF program
+ * @param cnt the number of instructions in the program
+ * @param tgt the jump target
+ *
+ * Skip over any removed instructions, which always fallthrough to the next
+ * instruction, and return the index of the instruction which is executed
+ * when jumping to @tgt.
+ *
+ */
+static unsigned int _opt_resolve(const struct bpf_opt_instr *prg,
+				 unsigned int cnt, unsigned int tgt)
+{
+	while (tgt < cnt - 1 && prg[tgt].removed)
+		tgt++;
+	return tgt;
+}
+
+/**
+ * Thread a jump through any unconditional jumps and duplicate returns
+ * @param prg the decoded BPF program
+ * @param cnt the number of instructions in the program
+ * @param src the index of the jump instruction
+ * @param tgt the current jump target
+ * @param max the maximum jump length
+ *
+ * Follow the chain of unconditional jumps starting at @tgt and, if the final
+ * target is a return, look for an identical return further along the program
+ * so that the duplicates become unreachable.  Returns the new jump target,
+ * which is never further than @max instructions from @src.
+ *
+ */
+static unsigned int _opt_thread(const struct bpf_opt_instr *prg,
+				unsigned int cnt, unsigned int src,
+				unsigned int tgt, unsigned int max)
+{
+	unsigned int iter, nxt;
+
+	tgt = _opt_resolve(prg, cnt, tgt);
+	while (prg[tgt].code == BPF_JMP + BPF_JA) {
+		nxt = _opt_resolve(prg, cnt, prg[tgt].jt);
+		if (nxt - src - 1 > max)
+			break;
+		tgt = nxt;
+	}
+
+	if (BPF_CLASS(prg[tgt].code) == BPF_RET) {
+		iter = cnt - 1;
+		if (iter - src - 1 > max)
+			iter = src + 1 + max;
+		for (; iter > tgt; iter--) {
+			if (!prg[iter].removed &&
+			    prg[iter].code == prg[tgt].code &&
+			    prg[iter].k == prg[tgt].k)
+				return iter;
+		}
+	}
+
+	return tgt;
+}
+
+/**
+ * Merge the accumulator state of an edge into an instruction
+ * @param prg the decoded BPF program
+ * @param tgt the index of the instruction
+ * @param acc the accumulator state on the edge
+ */
+static void _opt_acc_merge(struct bpf_opt_instr *prg,
+			   unsigned int tgt, int64_t acc)
+{
+	if (prg[tgt].acc == _OPT_ACC_NONE)
+		prg[tgt].acc = acc;
+	else if (prg[tgt].acc != acc)
+		prg[tgt].acc = _OPT_ACC_UNKNOWN;
+}
+
+/**
+ * Perform a single optimization pass over the decoded BPF program
+ * @param prg the decoded BPF program
+ * @param cnt the number of instructions in the program
+ *
+ * Thread jumps through unconditional jumps, merge identical return
+ * instructions, replace conditional jumps with identical targets, remove jumps
+ * to the next instruction, remove loads of a seccomp_data field which is
+ * already in the accumulator and remove any unreachable instructions.  Returns
+ * true if the program was changed, false otherwise.
+ *
+ */
+static bool _opt_pass(struct bpf_opt_instr *prg, unsigned int cnt)
+{
+	bool change = false;
+	unsigned int iter, tgt;
+	int64_t acc;
+	struct bpf_opt_instr *i_iter;
+
+	/* jump threading and branch target merging */
+	for (iter = 0; iter < cnt; iter++) {
+		i_iter = &prg[iter];
+		if (i_iter->removed || BPF_CLASS(i_iter->code) != BPF_JMP)
+			continue;
+
+		if (i_iter->code == BPF_JMP + BPF_JA) {
+			tgt = _opt_thread(prg, cnt, iter, i_iter->jt, UINT_MAX);
+			if (BPF_CLASS(prg[tgt].code) == BPF_RET) {
+				/* jump to a return, just return */
+				i_iter->code = prg[tgt].code;
+				i_iter->k = prg[tgt].k;
+				change = true;
+			} else if (tgt == _opt_resolve(prg, cnt, iter + 1)) {
+				/* jump to the next instruction */
+				i_iter->jt = tgt;
+				i_iter->removed = true;
+				change = true;
+			} else if (tgt != i_iter->jt) {
+				i_iter->jt = tgt;
+				change = true;
+			}
+			continue;
+		}
+
+		tgt = _opt_thread(prg, cnt, iter, i_iter->jt, _BPF_JMP_MAX);
+		if (tgt != i_iter->jt) {
+			i_iter->jt = tgt;
+			change = true;
+		}
+		tgt = _opt_thread(prg, cnt, iter, i_iter->jf, _BPF_JMP_MAX);
+		if (tgt != i_iter->jf) {
+			i_iter->jf = tgt;
+			change = true;
+		}
+		if (i_iter->jt == i_iter->jf) {
+			/* both branches go to the same place */
+			i_iter->code = BPF_JMP + BPF_JA;
+			change = true;
+		}
+	}
+
+	/* accumulator tracking, the program only jumps forward so a single
+	 * pass is enough; this also finds the unreachable instructions */
+	for (iter = 0; iter < cnt; iter++)
+		prg[iter].acc = _OPT_ACC_NONE;
+	prg[0].acc = _OPT_ACC_UNKNOWN;
+	for (iter = 0; iter < cnt; iter++) {
+		i_iter = &prg[iter];
+		if (i_iter->acc == _OPT_ACC_NONE) {
+			/* unreachable */
+			if (!i_iter->removed) {
+				i_iter->removed = true;
+				change = true;
+			}
+			continue;
+		}
+
+		acc = i_iter->acc;
+		switch (BPF_CLASS(i_iter->code)) {
+		case BPF_LD:
+			if (i_iter->code != BPF_LD + BPF_W + BPF_ABS)
+				acc = _OPT_ACC_UNKNOWN;
+			else if (!i_iter->removed && acc == i_iter->k) {
+				/* the field is already in the accumulator */
+				i_iter->removed = true;
+				change = true;
+			} else
+				acc = i_iter->k;
+			break;
+		case BPF_ALU:
+			acc = _OPT_ACC_UNKNOWN;
+			break;
+		case BPF_MISC:
+			if (i_iter->code != BPF_MISC + BPF_TAX)
+				acc = _OPT_ACC_UNKNOWN;
+			break;
+		case BPF_RET:
+			continue;
+		case BPF_JMP:
+			_opt_acc_merge(prg, i_iter->jt, acc);
+			if (i_iter->code != BPF_JMP + BPF_JA)
+				_opt_acc_merge(prg, i_iter->jf, acc);
+			continue;
+		}
+		if (iter + 1 < cnt)
+			_opt_acc_merge(prg, iter + 1, acc);
+	}
+
+	return change;
+}
+
+/**
+ * Optimize the final BPF program
+ * @param state the BPF state
+ * @param col the seccomp filter collection
+ *
+ * Decode the generated BPF program, run the peephole optimization passes
+ * until the program stops changing and then reassemble the program with the
+ * removed instructions dropped; removing instructions only ever makes the
+ * jumps shorter.  Returns zero on success, negative values on failure.
+ *
+ */
+static int _gen_bpf_optimize(struct bpf_state *state,
+			     const struct db_filter_col *col)
+{
+	unsigned int iter, pass, cnt = state->bpf->blk_cnt, cnt_new = 0;
+	unsigned int jt, jf;
+	unsigned int *idx;
+	struct bpf_opt_instr *prg;
+	bpf_instr_raw *i_raw;
+	struct arch_def pseudo_arch;
+
+	if (cnt == 0)
+		return 0;
+
+	memset(&pseudo_arch, 0, sizeof(pseudo_arch));
+	pseudo_arch.endian = col->endian;
+
+	prg = _arena_alloc(state, sizeof(*prg) * cnt);
+	idx = _arena_alloc(state, sizeof(*idx) * cnt);
+	if (prg == NULL || idx == NULL)
+		return -ENOMEM;
+
+	/* decode the program, leave it untouched if the jumps look odd */
+	for (iter = 0; iter < cnt; iter++) {
+		i_raw = &state->bpf->blks[iter];
+		prg[iter].code = _ttoh16(&pseudo_arch, i_raw->code);
+		prg[iter].k = _ttoh32(&pseudo_arch, i_raw->k);
+		if (BPF_CLASS(prg[iter].code) != BPF_JMP)
+			continue;
+		if (prg[iter].code == BPF_JMP + BPF_JA) {
+			if (prg[iter].k >= cnt - iter - 1)
+				return 0;
+			prg[iter].jt = iter + 1 + prg[iter].k;
+			continue;
+		}
+		prg[iter].jt = iter + 1 + i_raw->jt;
+		prg[iter].jf = iter + 1 + i_raw->jf;
+		if (prg[iter].jt >= cnt || prg[iter].jf >= cnt)
+			return 0;
+	}
+
+	for (pass = 0; pass < _OPT_PASSES_MAX; pass++) {
+		if (!_opt_pass(prg, cnt))
+			break;
+	}
+
+	/* reassemble the program */
+	for (iter = 0; iter < cnt; iter++) {
+		idx[iter] = cnt_new;
+		if (!prg[iter].removed)
+			cnt_new++;
+	}
+	for (iter = 0; iter < cnt; iter++) {
+		if (prg[iter].removed)
+			continue;
+
+		i_raw = &state->bpf->blks[idx[iter]];
+		i_raw->code = _htot16(&pseudo_arch, prg[iter].code);
+		i_raw->jt = 0;
+		i_raw->jf = 0;
+		i_raw->k = _htot32(&pseudo_arch, prg[iter].k);
+		if (BPF_CLASS(prg[iter].code) != BPF_JMP)
+			continue;
+
+		jt = idx[_opt_resolve(prg, cnt, prg[iter].jt)];
+		if (prg[iter].code == BPF_JMP + BPF_JA) {
+			i_raw->k = _htot32(&pseudo_arch,
+					   jt - idx[iter] - 1);
+			continue;
+		}
+		jf = idx[_opt_resolve(prg, cnt, prg[iter].jf)];
+		i_raw->jt = jt - idx[iter] - 1;
+		i_raw->jf = jf - idx[iter] - 1;
+	}
+	state->bpf->blk_cnt = cnt_new;
+
+	return 0;
+}
+
 /**
  * Generate a BPF representation of the filter DB
  * @param col the seccomp filter collection
  * @param prgm_ptr the bpf program pointer
+ * @param stats the generator statistics, or NULL
  *
  * This function generates a BPF representation of the given filter collection.
- * Returns zero on success, negative values on failure.
+ * If @stats is not NULL it is populated with the block hash table statistics
+ * of the generation.  Returns zero on success, negative values on failure.
  *
  */
 int gen_bpf_generate(const struct db_filter_col *col,
-		     struct bpf_program **prgm_ptr)
+		     struct bpf_program **prgm_ptr,
+		     struct gen_bpf_stats *stats)
 {
 	int rc;
 	struct bpf_state state;
-	struct bpf_program *prgm;
 
 	if (col->filter_cnt == 0)
 		return -EINVAL;
 
-	memset(&state, 0, sizeof(state));
-	state.attr = &col->attr;
-
-	state.bpf = zmalloc(sizeof(*(prgm)));
-	if (state.bpf == NULL)
-		return -ENOMEM;
+	rc = _state_init(&state, col);
+	if (rc < 0)
+		return rc;
 
-	rc = _gen_bpf_build_bpf(&state, col);
+	rc = _gen_bpf_build_bpf(&state, col, col->attr.threads);
+	if (rc == -EAGAIN) {
+		/* the threads generated colliding blocks, start over */
+		_state_release(&state);
+		rc = _state_init(&state, col);
+		if (rc < 0)
+			return rc;
+		rc = _gen_bpf_build_bpf(&state, col, 1);
+	}
+	if (rc == 0 && col->attr.optimize >= 3)
+		rc = _gen_bpf_optimize(&state, col);
 	if (rc == 0) {
 		*prgm_ptr = state.bpf;
 		state.bpf = NULL;
+		if (stats != NULL) {
+			stats->hash_probes = state.htbl_probes;
+			stats->hash_collisions = state.htbl_collisions;
+		}
 	}
 	_state_release(&state);
 
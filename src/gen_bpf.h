@@ -36,8 +36,15 @@ struct bpf_program {
 #define BPF_PGM_SIZE(x) \
 	((x)->blk_cnt * sizeof(*((x)->blks)))
 
+/* block hash table statistics of a BPF generation */
+struct gen_bpf_stats {
+	uint64_t hash_probes;
+	uint64_t hash_collisions;
+};
+
 int gen_bpf_generate(const struct db_filter_col *col,
-		     struct bpf_program **prgm_ptr);
+		     struct bpf_program **prgm_ptr,
+		     struct gen_bpf_stats *stats);
 void gen_bpf_release(struct bpf_program *program);
 
 #endif
@@ -176,6 +176,7 @@ static void _gen_pfc_chain(const struct arch_def *arch,
 			   const struct db_arg_chain_tree *node,
 			   unsigned int lvl, FILE *fds)
 {
+	unsigned int iter;
 	const struct db_arg_chain_tree *c_iter;
 
 	/* get to the start */
@@ -201,13 +202,26 @@ static void _gen_pfc_chain(const struct arch_def *arch,
 		case SCMP_CMP_MASKED_EQ:
 			fprintf(fds, " & 0x%.8x == ", c_iter->mask);
 			break;
+		case SCMP_CMP_IN_SET:
+			fprintf(fds, " in {");
+			for (iter = 0; iter < c_iter->datum_ext; iter++)
+				fprintf(fds, "%s%u", (iter > 0 ? ", " : ""),
+					c_iter->set[iter]);
+			fprintf(fds, "})\n");
+			break;
+		case SCMP_CMP_IN_RANGE:
+			fprintf(fds, " in [%u, %u])\n",
+				c_iter->datum, c_iter->datum_ext);
+			break;
 		case SCMP_CMP_NE:
 		case SCMP_CMP_LT:
 		case SCMP_CMP_LE:
 		default:
 			fprintf(fds, " ??? ");
 		}
-		fprintf(fds, "%u)\n", c_iter->datum);
+		if (c_iter->op != SCMP_CMP_IN_SET &&
+		    c_iter->op != SCMP_CMP_IN_RANGE)
+			fprintf(fds, "%u)\n", c_iter->datum);
 
 		/* true result */
 		if (c_iter->act_t_flg) {
@@ -295,13 +309,14 @@ static int _get_bintree_syscall_num(const struct pfc_sys_list *cur,
 	return 0;
 }
 
-static int _sys_num_sort(struct db_sys_list *syscalls,
+static int _sys_num_sort(const struct db_filter *db,
 			 struct pfc_sys_list **p_head)
 {
+	unsigned int pos;
 	struct pfc_sys_list *p_iter = NULL, *p_new, *p_prev;
 	struct db_sys_list *s_iter;
 
-	db_list_foreach(s_iter, syscalls) {
+	db_syscall_foreach(s_iter, pos, db) {
 		p_new = zmalloc(sizeof(*p_new));
 		if (p_new == NULL) {
 			return -ENOMEM;
@@ -329,13 +344,14 @@ static int _sys_num_sort(struct db_sys_list *syscalls,
 	return 0;
 }
 
-static int _sys_priority_sort(struct db_sys_list *syscalls,
+static int _sys_priority_sort(const struct db_filter *db,
 			      struct pfc_sys_list **p_head)
 {
+	unsigned int pos;
 	struct pfc_sys_list *p_iter = NULL, *p_new, *p_prev;
 	struct db_sys_list *s_iter;
 
-	db_list_foreach(s_iter, syscalls) {
+	db_syscall_foreach(s_iter, pos, db) {
 		p_new = zmalloc(sizeof(*p_new));
 		if (p_new == NULL) {
 			return -ENOMEM;
@@ -363,15 +379,15 @@ static int _sys_priority_sort(struct db_sys_list *syscalls,
 	return 0;
 }
 
-static int _sys_sort(struct db_sys_list *syscalls,
+static int _sys_sort(const struct db_filter *db,
 		     struct pfc_sys_list **p_head,
 		     uint32_t optimize)
 {
 	if (optimize != 2)
-		return _sys_priority_sort(syscalls, p_head);
+		return _sys_priority_sort(db, p_head);
 	else
 		/* sort by number for the binary tree */
-		return _sys_num_sort(syscalls, p_head);
+		return _sys_num_sort(db, p_head);
 }
 
 /**
@@ -394,7 +410,7 @@ static int _gen_pfc_arch(const struct db_filter_col *col,
 	struct pfc_sys_list *p_iter = NULL, *p_head = NULL;
 
 	/* sort the syscall list */
-	rc = _sys_sort(db->syscalls, &p_head, optimize);
+	rc = _sys_sort(db, &p_head, optimize);
 	if (rc < 0)
 		goto arch_return;
 
@@ -457,6 +473,34 @@ arch_return:
 	}
 	return rc;
 }
+/**
+ * Generate a pseudo filter code string representation
+ * @param col the seccomp filter collection
+ * @param fds the file stream to send the output
+ *
+ * This function generates a pseudo filter code representation of the given
+ * filter collection and writes it to the given file stream.
+ *
+ */
+static void _gen_pfc(const struct db_filter_col *col, FILE *fds)
+{
+	unsigned int iter;
+
+	fprintf(fds, "#\n");
+	fprintf(fds, "# pseudo filter code start\n");
+	fprintf(fds, "#\n");
+
+	for (iter = 0; iter < col->filter_cnt; iter++)
+		_gen_pfc_arch(col, col->filters[iter], fds,
+			      col->attr.optimize);
+
+	fprintf(fds, "# invalid architecture action\n");
+	_pfc_action(fds, col->attr.act_badarch);
+	fprintf(fds, "#\n");
+	fprintf(fds, "# pseudo filter code end\n");
+	fprintf(fds, "#\n");
+}
+
 /**
  * Generate a pseudo filter code string representation
  * @param col the seccomp filter collection
@@ -470,7 +514,6 @@ arch_return:
 int gen_pfc_generate(const struct db_filter_col *col, int fd)
 {
 	int newfd;
-	unsigned int iter;
 	FILE *fds;
 
 	newfd = dup(fd);
@@ -482,23 +525,44 @@ int gen_pfc_generate(const struct db_filter_col *col, int fd)
 		return -errno;
 	}
 
-	/* generate the pfc */
-	fprintf(fds, "#\n");
-	fprintf(fds, "# pseudo filter code start\n");
-	fprintf(fds, "#\n");
-
-	for (iter = 0; iter < col->filter_cnt; iter++)
-		_gen_pfc_arch(col, col->filters[iter], fds,
-			      col->attr.optimize);
-
-	fprintf(fds, "# invalid architecture action\n");
-	_pfc_action(fds, col->attr.act_badarch);
-	fprintf(fds, "#\n");
-	fprintf(fds, "# pseudo filter code end\n");
-	fprintf(fds, "#\n");
+	_gen_pfc(col, fds);
 
 	fflush(fds);
 	fclose(fds);
 
 	return 0;
 }
+
+/**
+ * Generate a pseudo filter code string representation in memory
+ * @param col the seccomp filter collection
+ * @param buf the output buffer
+ * @param len the length of the output
+ *
+ * This function generates a pseudo filter code representation of the given
+ * filter collection and returns it in a newly allocated buffer, which is not
+ * NUL terminated and should be released with free().  Returns zero on
+ * success, negative errno values on failure.
+ *
+ */
+int gen_pfc_generate_mem(const struct db_filter_col *col,
+			 char **buf, size_t *len)
+{
+	FILE *fds;
+
+	*buf = NULL;
+	*len = 0;
+	fds = open_memstream(buf, len);
+	if (fds == NULL)
+		return -errno;
+
+	_gen_pfc(col, fds);
+
+	if (fclose(fds) != 0) {
+		free(*buf);
+		*buf = NULL;
+		return -ENOMEM;
+	}
+
+	return 0;
+}
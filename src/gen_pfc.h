@@ -22,8 +22,12 @@
 #ifndef _TRANSLATOR_STR_H
 #define _TRANSLATOR_STR_H
 
+#include <stddef.h>
+
 #include "db.h"
 
 int gen_pfc_generate(const struct db_filter_col *col, int fd);
+int gen_pfc_generate_mem(const struct db_filter_col *col,
+			 char **buf, size_t *len);
 
 #endif
@@ -0,0 +1,318 @@
+/**
+ * Seccomp Notification Dispatcher
+ *
+ * Copyright (c) 2026 The libseccomp Authors
+ * Author: The libseccomp Authors <libseccomp@googlegroups.com>
+ */
+
+/*
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of version 2.1 of the GNU Lesser General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses>.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <seccomp.h>
+
+#include "helper.h"
+#include "notify.h"
+#include "system.h"
+
+struct notify_worker {
+	struct notify_dispatch *disp;
+
+	pthread_t thread;
+	bool thread_valid;
+
+	/* per-thread notification buffers */
+	struct seccomp_notif *req;
+	struct seccomp_notif_resp *resp;
+
+	/* statistics */
+	pthread_mutex_t stats_lock;
+	struct scmp_notify_stats stats;
+};
+
+struct notify_dispatch {
+	int fd;
+	scmp_notify_cb cb;
+	void *data;
+	struct seccomp_notif_sizes sizes;
+
+	/* only one worker at a time waits for and receives a notification,
+	 * see _notify_recv() */
+	pthread_mutex_t recv_lock;
+
+	/* written to once on shutdown and never read, so it stays readable */
+	int stop_pipe[2];
+	bool stopped;
+
+	unsigned int worker_cnt;
+	struct notify_worker workers[];
+};
+
+/**
+ * Wait for and receive a notification
+ * @param worker the worker
+ *
+ * Wait until either a notification is pending on the notification fd or the
+ * dispatcher is stopped.  The kernel only tells us that a notification is
+ * pending, if several workers raced to receive it the losers would block in
+ * the kernel and could not be stopped, so the workers take turns waiting.
+ * Returns zero on success, -ENOENT if the notification went away before it
+ * was received, and -ECANCELED if the worker should exit.
+ *
+ */
+static int _notify_recv(struct notify_worker *worker)
+{
+	int rc;
+	struct notify_dispatch *disp = worker->disp;
+	struct pollfd fds[2];
+
+	fds[0].fd = disp->fd;
+	fds[0].events = POLLIN;
+	fds[1].fd = disp->stop_pipe[0];
+	fds[1].events = POLLIN;
+
+	pthread_mutex_lock(&disp->recv_lock);
+	do {
+		rc = poll(fds, 2, -1);
+	} while (rc < 0 && errno == EINTR);
+	if (rc < 0 || fds[1].revents || !(fds[0].revents & POLLIN)) {
+		/* stopped, or no task can use the filter anymore */
+		rc = -ECANCELED;
+		goto out;
+	}
+
+	/* NOTE: the kernel requires a zeroed request buffer */
+	memset(worker->req, 0, disp->sizes.seccomp_notif);
+	rc = sys_notify_receive(disp->fd, worker->req);
+	if (rc < 0)
+		/* the task was most likely killed while we were waking up */
+		rc = -ENOENT;
+
+out:
+	pthread_mutex_unlock(&disp->recv_lock);
+	return rc;
+}
+
+/**
+ * Notification dispatcher worker thread
+ * @param arg the worker
+ *
+ * Receive notifications, pass them to the callback, and send the responses
+ * until the dispatcher is stopped.
+ *
+ */
+static void *_notify_worker(void *arg)
+{
+	int rc;
+	struct notify_worker *worker = arg;
+	struct notify_dispatch *disp = worker->disp;
+	struct seccomp_notif *req = worker->req;
+	struct seccomp_notif_resp *resp = worker->resp;
+	uint64_t *stat;
+
+	while ((rc = _notify_recv(worker)) != -ECANCELED) {
+		stat = &worker->stats.failed;
+		if (rc == 0) {
+			memset(resp, 0, disp->sizes.seccomp_notif_resp);
+			resp->id = req->id;
+			if ((disp->cb)(req, resp, disp->data) != 0)
+				stat = &worker->stats.skipped;
+			else if (sys_notify_respond(disp->fd, resp) == 0)
+				stat = &worker->stats.responded;
+		}
+
+		pthread_mutex_lock(&worker->stats_lock);
+		if (rc == 0)
+			worker->stats.received++;
+		(*stat)++;
+		pthread_mutex_unlock(&worker->stats_lock);
+	}
+
+	return NULL;
+}
+
+/**
+ * Start a notification dispatcher
+ * @param fd the notification fd
+ * @param threads the number of worker threads
+ * @param cb the notification callback
+ * @param data the callback data
+ * @param disp_ptr the dispatcher
+ *
+ * Allocate a new dispatcher and start its worker threads.  Returns zero on
+ * success, negative values on failure.
+ *
+ */
+int notify_dispatch_start(int fd, unsigned int threads,
+			  scmp_notify_cb cb, void *data,
+			  struct notify_dispatch **disp_ptr)
+{
+	int rc;
+	unsigned int iter;
+	struct notify_dispatch *disp;
+	struct notify_worker *worker;
+	struct seccomp_notif *req;
+	struct seccomp_notif_resp *resp;
+
+	if (fd < 0 || threads == 0 || cb == NULL)
+		return -EINVAL;
+	if (sys_chk_seccomp_action(SCMP_ACT_NOTIFY) != 1)
+		return -EOPNOTSUPP;
+
+	disp = zmalloc(sizeof(*disp) + threads * sizeof(disp->workers[0]));
+	if (disp == NULL)
+		return -ENOMEM;
+	disp->fd = fd;
+	disp->cb = cb;
+	disp->data = data;
+	disp->worker_cnt = threads;
+	disp->stop_pipe[0] = -1;
+	disp->stop_pipe[1] = -1;
+	pthread_mutex_init(&disp->recv_lock, NULL);
+	for (iter = 0; iter < threads; iter++) {
+		worker = &disp->workers[iter];
+		worker->disp = disp;
+		pthread_mutex_init(&worker->stats_lock, NULL);
+	}
+
+	rc = sys_notify_sizes(&disp->sizes);
+	if (rc < 0)
+		goto fail;
+	if (pipe(disp->stop_pipe) < 0) {
+		disp->stop_pipe[0] = -1;
+		disp->stop_pipe[1] = -1;
+		rc = -ECANCELED;
+		goto fail;
+	}
+	fcntl(disp->stop_pipe[0], F_SETFD, FD_CLOEXEC);
+	fcntl(disp->stop_pipe[1], F_SETFD, FD_CLOEXEC);
+	for (iter = 0; iter < threads; iter++) {
+		worker = &disp->workers[iter];
+		rc = sys_notify_alloc(&req, &resp);
+		if (rc < 0)
+			goto fail;
+		worker->req = req;
+		worker->resp = resp;
+	}
+
+	for (iter = 0; iter < threads; iter++) {
+		worker = &disp->workers[iter];
+		if (pthread_create(&worker->thread, NULL,
+				   _notify_worker, worker) != 0) {
+			rc = -ENOMEM;
+			goto fail;
+		}
+		worker->thread_valid = true;
+	}
+
+	*disp_ptr = disp;
+	return 0;
+
+fail:
+	notify_dispatch_release(disp);
+	return rc;
+}
+
+/**
+ * Get the statistics of a notification dispatcher worker
+ * @param disp the dispatcher
+ * @param worker the worker number
+ * @param stats the worker statistics
+ *
+ * Copy the given worker's statistics into @stats.  Returns zero on success,
+ * negative values on failure.
+ *
+ */
+int notify_dispatch_stats(struct notify_dispatch *disp, unsigned int worker,
+			  struct scmp_notify_stats *stats)
+{
+	struct notify_worker *w;
+
+	if (worker >= disp->worker_cnt)
+		return -EINVAL;
+	w = &disp->workers[worker];
+
+	pthread_mutex_lock(&w->stats_lock);
+	*stats = w->stats;
+	pthread_mutex_unlock(&w->stats_lock);
+
+	return 0;
+}
+
+/**
+ * Stop a notification dispatcher
+ * @param disp the dispatcher
+ *
+ * Signal the worker threads to stop and wait for them to finish.
+ *
+ */
+void notify_dispatch_stop(struct notify_dispatch *disp)
+{
+	ssize_t rc;
+	unsigned int iter;
+	struct notify_worker *worker;
+
+	if (disp->stopped)
+		return;
+	disp->stopped = true;
+
+	if (disp->stop_pipe[1] >= 0) {
+		do {
+			rc = write(disp->stop_pipe[1], "", 1);
+		} while (rc < 0 && errno == EINTR);
+	}
+
+	for (iter = 0; iter < disp->worker_cnt; iter++) {
+		worker = &disp->workers[iter];
+		if (worker->thread_valid)
+			pthread_join(worker->thread, NULL);
+		worker->thread_valid = false;
+	}
+}
+
+/**
+ * Release a notification dispatcher
+ * @param disp the dispatcher
+ *
+ * Stop the dispatcher and free all of its resources.
+ *
+ */
+void notify_dispatch_release(struct notify_dispatch *disp)
+{
+	unsigned int iter;
+	struct notify_worker *worker;
+
+	notify_dispatch_stop(disp);
+
+	for (iter = 0; iter < disp->worker_cnt; iter++) {
+		worker = &disp->workers[iter];
+		free(worker->req);
+		free(worker->resp);
+		pthread_mutex_destroy(&worker->stats_lock);
+	}
+	if (disp->stop_pipe[0] >= 0)
+		close(disp->stop_pipe[0]);
+	if (disp->stop_pipe[1] >= 0)
+		close(disp->stop_pipe[1]);
+	pthread_mutex_destroy(&disp->recv_lock);
+	free(disp);
+}
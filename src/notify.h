@@ -0,0 +1,37 @@
+/**
+ * Seccomp Notification Dispatcher
+ *
+ * Copyright (c) 2026 The libseccomp Authors
+ * Author: The libseccomp Authors <libseccomp@googlegroups.com>
+ */
+
+/*
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of version 2.1 of the GNU Lesser General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses>.
+ */
+
+#ifndef _NOTIFY_H
+#define _NOTIFY_H
+
+#include <seccomp.h>
+
+struct notify_dispatch;
+
+int notify_dispatch_start(int fd, unsigned int threads,
+			  scmp_notify_cb cb, void *data,
+			  struct notify_dispatch **disp_ptr);
+int notify_dispatch_stats(struct notify_dispatch *disp, unsigned int worker,
+			  struct scmp_notify_stats *stats);
+void notify_dispatch_stop(struct notify_dispatch *disp);
+void notify_dispatch_release(struct notify_dispatch *disp);
+
+#endif
@@ -30,6 +30,31 @@ cdef extern from "seccomp.h":
         unsigned int micro
 
     ctypedef void* scmp_filter_ctx
+    ctypedef void* scmp_notify_ctx
+
+    cdef struct scmp_cache_stats:
+        uint64_t hits
+        uint64_t misses
+        unsigned int entries
+
+    cdef struct scmp_cost_entry:
+        uint32_t arch
+        int syscall
+        unsigned int instr_min
+        unsigned int instr_max
+
+    cdef struct scmp_cost:
+        unsigned int instr_cnt
+        unsigned int instr_min
+        unsigned int instr_max
+        unsigned int entry_cnt
+        scmp_cost_entry *entries
+
+    cdef struct scmp_notify_stats:
+        uint64_t received
+        uint64_t responded
+        uint64_t skipped
+        uint64_t failed
 
     cdef enum:
         SCMP_ARCH_NATIVE
@@ -63,6 +88,7 @@ cdef extern from "seccomp.h":
         SCMP_FLTATR_CTL_SSB
         SCMP_FLTATR_CTL_OPTIMIZE
         SCMP_FLTATR_API_SYSRAWRC
+        SCMP_FLTATR_CTL_THREADS
 
     cdef enum scmp_compare:
         SCMP_CMP_NE
@@ -72,6 +98,8 @@ cdef extern from "seccomp.h":
         SCMP_CMP_GE
         SCMP_CMP_GT
         SCMP_CMP_MASKED_EQ
+        SCMP_CMP_IN_SET
+        SCMP_CMP_IN_RANGE
 
     cdef enum:
         SCMP_ACT_KILL_PROCESS
@@ -83,6 +111,14 @@ cdef extern from "seccomp.h":
     unsigned int SCMP_ACT_ERRNO(int errno)
     unsigned int SCMP_ACT_TRACE(int value)
 
+    cdef enum:
+        SCMP_LOAD_NNP
+        SCMP_LOAD_TSYNC
+        SCMP_LOAD_LOG
+        SCMP_LOAD_SSB
+        SCMP_LOAD_NEW_LISTENER
+        SCMP_LOAD_SYSRAWRC
+
     ctypedef uint64_t scmp_datum_t
 
     cdef struct scmp_arg_cmp:
@@ -91,6 +127,13 @@ cdef extern from "seccomp.h":
         scmp_datum_t datum_a
         scmp_datum_t datum_b
 
+    cdef struct scmp_rule:
+        uint32_t action
+        int syscall
+        unsigned int arg_cnt
+        const scmp_arg_cmp *arg_array
+        int rc
+
     cdef struct seccomp_data:
         int nr
         uint32_t arch
@@ -114,14 +157,24 @@ cdef extern from "seccomp.h":
         int32_t error
         uint32_t flags
 
+    ctypedef int (*scmp_notify_cb)(const seccomp_notif *req,
+                                   seccomp_notif_resp *resp, void *data)
+
     scmp_version *seccomp_version()
 
     unsigned int seccomp_api_get()
     int seccomp_api_set(unsigned int level)
 
+    int seccomp_cache_stats(scmp_cache_stats *stats)
+    void seccomp_cache_flush()
+
+    int seccomp_cost_estimate(scmp_filter_ctx ctx, scmp_cost **cost)
+    void seccomp_cost_free(scmp_cost *cost)
+
     scmp_filter_ctx seccomp_init(uint32_t def_action)
     int seccomp_reset(scmp_filter_ctx ctx, uint32_t def_action)
     void seccomp_release(scmp_filter_ctx ctx)
+    scmp_filter_ctx seccomp_dup(scmp_filter_ctx ctx)
 
     int seccomp_merge(scmp_filter_ctx ctx_dst, scmp_filter_ctx ctx_src)
 
@@ -132,6 +185,7 @@ cdef extern from "seccomp.h":
     int seccomp_arch_remove(scmp_filter_ctx ctx, int arch_token)
 
     int seccomp_load(scmp_filter_ctx ctx)
+    int seccomp_load_raw(const void *buf, size_t len, uint32_t flags)
 
     int seccomp_attr_get(scmp_filter_ctx ctx,
                          scmp_filter_attr attr, uint32_t* value)
@@ -144,6 +198,8 @@ cdef extern from "seccomp.h":
     int seccomp_syscall_resolve_name(char *name)
     int seccomp_syscall_priority(scmp_filter_ctx ctx,
                                  int syscall, uint8_t priority)
+    int seccomp_syscall_weight(scmp_filter_ctx ctx,
+                               int syscall, uint32_t weight)
 
     int seccomp_rule_add(scmp_filter_ctx ctx, uint32_t action,
                          int syscall, unsigned int arg_cnt, ...)
@@ -157,6 +213,12 @@ cdef extern from "seccomp.h":
                                      uint32_t action, int syscall,
                                      unsigned int arg_cnt,
                                      scmp_arg_cmp *arg_array)
+    int seccomp_rule_add_batch(scmp_filter_ctx ctx,
+                               scmp_rule *rules, unsigned int rule_cnt)
+    int seccomp_rule_remove_array(scmp_filter_ctx ctx,
+                                  uint32_t action, int syscall,
+                                  unsigned int arg_cnt,
+                                  scmp_arg_cmp *arg_array)
 
     int seccomp_notify_alloc(seccomp_notif **req, seccomp_notif_resp **resp)
     void seccomp_notify_free(seccomp_notif *req, seccomp_notif_resp *resp)
@@ -164,9 +226,19 @@ cdef extern from "seccomp.h":
     int seccomp_notify_respond(int fd, seccomp_notif_resp *resp)
     int seccomp_notify_id_valid(int fd, uint64_t id)
     int seccomp_notify_fd(scmp_filter_ctx ctx)
+    int seccomp_notify_dispatch_start(int fd, unsigned int threads,
+                                      scmp_notify_cb cb, void *data,
+                                      scmp_notify_ctx *disp)
+    int seccomp_notify_dispatch_stats(scmp_notify_ctx disp,
+                                      unsigned int worker,
+                                      scmp_notify_stats *stats)
+    void seccomp_notify_dispatch_stop(scmp_notify_ctx disp) nogil
+    void seccomp_notify_dispatch_release(scmp_notify_ctx disp) nogil
 
     int seccomp_export_pfc(scmp_filter_ctx ctx, int fd)
     int seccomp_export_bpf(scmp_filter_ctx ctx, int fd)
+    int seccomp_export_pfc_mem(scmp_filter_ctx ctx, void *buf, size_t *len)
+    int seccomp_export_bpf_mem(scmp_filter_ctx ctx, void *buf, size_t *len)
 
 # kate: syntax python;
 # kate: indent-mode python; space-indent on; indent-width 4; mixedindent off;
@@ -51,6 +51,8 @@ Argument comparison values (see the Arg class):
     GT - arg > datum_a
     GE - arg >= datum_a
     MASKED_EQ - (arg & datum_a) == datum_b
+    IN_SET - arg in datum_a, a list of values
+    IN_RANGE - datum_a <= arg <= datum_b
 
 
 Example:
@@ -83,7 +85,8 @@ __date__ = "3 February 2017"
 from cpython.version cimport PY_MAJOR_VERSION
 from libc.stdint cimport int8_t, int16_t, int32_t, int64_t
 from libc.stdint cimport uint8_t, uint16_t, uint32_t, uint64_t
-from libc.stdlib cimport free
+from libc.stdint cimport uintptr_t
+from libc.stdlib cimport malloc, free
 import errno
 
 cimport libseccomp
@@ -131,6 +134,15 @@ EQ = libseccomp.SCMP_CMP_EQ
 GE = libseccomp.SCMP_CMP_GE
 GT = libseccomp.SCMP_CMP_GT
 MASKED_EQ = libseccomp.SCMP_CMP_MASKED_EQ
+IN_SET = libseccomp.SCMP_CMP_IN_SET
+IN_RANGE = libseccomp.SCMP_CMP_IN_RANGE
+
+LOAD_NNP = libseccomp.SCMP_LOAD_NNP
+LOAD_TSYNC = libseccomp.SCMP_LOAD_TSYNC
+LOAD_LOG = libseccomp.SCMP_LOAD_LOG
+LOAD_SSB = libseccomp.SCMP_LOAD_SSB
+LOAD_NEW_LISTENER = libseccomp.SCMP_LOAD_NEW_LISTENER
+LOAD_SYSRAWRC = libseccomp.SCMP_LOAD_SYSRAWRC
 
 def system_arch():
     """ Return the system architecture value.
@@ -194,6 +206,50 @@ def set_api(unsigned int level):
     elif rc != 0:
         raise RuntimeError(str.format("Library error (errno = {0})", rc))
 
+def load_raw(program, unsigned int flags=0):
+    """ Load a raw BPF program into the Linux Kernel
+
+    Arguments:
+    program - the BPF program, e.g. as written by SyscallFilter.export_bpf()
+    flags - the load flags, e.g. LOAD_*
+
+    Description:
+    Load the BPF program into the Linux Kernel without the need for a
+    SyscallFilter object.  Returns the notification fd if LOAD_NEW_LISTENER
+    is given, zero otherwise.
+    """
+    cdef bytes data = bytes(program)
+    cdef const char *buf = data
+    rc = libseccomp.seccomp_load_raw(buf, len(data), flags)
+    if rc == -errno.EINVAL:
+        raise ValueError("Invalid BPF program or flags")
+    elif rc < 0:
+        raise RuntimeError(str.format("Library error (errno = {0})", rc))
+
+    return rc
+
+def cache_stats():
+    """ Query the BPF program cache statistics
+
+    Description:
+    Returns a tuple of the number of cache hits, the number of cache misses,
+    and the number of programs currently in the cache.
+    """
+    cdef libseccomp.scmp_cache_stats stats
+    rc = libseccomp.seccomp_cache_stats(&stats)
+    if rc != 0:
+        raise RuntimeError(str.format("Library error (errno = {0})", rc))
+
+    return (stats.hits, stats.misses, stats.entries)
+
+def cache_flush():
+    """ Flush the BPF program cache
+
+    Description:
+    Releases all of the cached BPF programs and resets the cache statistics.
+    """
+    libseccomp.seccomp_cache_flush()
+
 cdef class Arch:
     """ Python object representing the SyscallFilter architecture values.
 
@@ -322,7 +378,10 @@ cdef class Attr:
                    0: currently unused
                    1: rules weighted by priority and complexity (DEFAULT)
                    2: binary tree sorted by syscall number
+                   3: search tree over coalesced syscall number ranges
+                   4: search tree over ranges and syscall bitmaps
     API_SYSRAWRC - return the raw syscall codes
+    CTL_THREADS - the number of threads used to generate the filter
     """
     ACT_DEFAULT = libseccomp.SCMP_FLTATR_ACT_DEFAULT
     ACT_BADARCH = libseccomp.SCMP_FLTATR_ACT_BADARCH
@@ -333,11 +392,13 @@ cdef class Attr:
     CTL_SSB = libseccomp.SCMP_FLTATR_CTL_SSB
     CTL_OPTIMIZE = libseccomp.SCMP_FLTATR_CTL_OPTIMIZE
     API_SYSRAWRC = libseccomp.SCMP_FLTATR_API_SYSRAWRC
+    CTL_THREADS = libseccomp.SCMP_FLTATR_CTL_THREADS
 
 cdef class Arg:
     """ Python object representing a SyscallFilter syscall argument.
     """
     cdef libseccomp.scmp_arg_cmp _arg
+    cdef libseccomp.scmp_datum_t *_set
 
     def __cinit__(self, arg, op, datum_a, datum_b = 0):
         """ Initialize the argument comparison.
@@ -345,16 +406,36 @@ cdef class Arg:
         Arguments:
         arg - the argument number, starting at 0
         op - the argument comparison operator, e.g. {NE,LT,LE,...}
-        datum_a - argument value
-        datum_b - argument value, only valid when op == MASKED_EQ
+        datum_a - argument value, a list of values when op == IN_SET
+        datum_b - argument value, only valid when op == MASKED_EQ or
+                  op == IN_RANGE
 
         Description:
         Create an argument comparison object for use with SyscallFilter.
         """
+        self._set = NULL
         self._arg.arg = arg
         self._arg.op = op
-        self._arg.datum_a = datum_a
-        self._arg.datum_b = datum_b
+        if op == IN_SET:
+            self._set = <libseccomp.scmp_datum_t *>malloc(
+                            len(datum_a) * sizeof(libseccomp.scmp_datum_t))
+            if self._set == NULL:
+                raise MemoryError()
+            for i, value in enumerate(datum_a):
+                self._set[i] = value
+            self._arg.datum_a = <uintptr_t>self._set
+            self._arg.datum_b = len(datum_a)
+        else:
+            self._arg.datum_a = datum_a
+            self._arg.datum_b = datum_b
+
+    def __dealloc__(self):
+        """ Destroy the argument comparison.
+
+        Description:
+        Free the IN_SET values.
+        """
+        free(self._set)
 
     cdef libseccomp.scmp_arg_cmp to_c(self):
         """ Convert the object into a C structure.
@@ -579,6 +660,106 @@ cdef class NotificationResponse:
         """
         self._flags = value
 
+cdef int _notify_dispatch_cb(const libseccomp.seccomp_notif *req,
+                             libseccomp.seccomp_notif_resp *resp,
+                             void *data) noexcept with gil:
+    """ Pass a seccomp notification to a NotifyDispatcher handler.
+    """
+    handler = <object>data
+    notify = Notification(req.id, req.pid, req.flags, req.data.nr,
+                          req.data.arch, req.data.instruction_pointer,
+                          [req.data.args[0], req.data.args[1],
+                           req.data.args[2], req.data.args[3],
+                           req.data.args[4], req.data.args[5]])
+    try:
+        response = handler(notify)
+    except Exception:
+        # the syscall must not be left waiting on a response
+        resp.error = -errno.ENOSYS
+        return 0
+    if response is None:
+        return 1
+    resp.val = response.val
+    resp.error = response.error
+    resp.flags = response.flags
+    return 0
+
+cdef class NotifyDispatcher:
+    """ Python object representing a seccomp notification dispatcher.
+    """
+    cdef libseccomp.scmp_notify_ctx _disp
+    cdef object _handler
+    cdef unsigned int _threads
+
+    def __cinit__(self, int fd, handler, unsigned int threads = 1):
+        """ Start the notification dispatcher.
+
+        Arguments:
+        fd - the notification fd
+        handler - the notification handler
+        threads - the number of worker threads
+
+        Description:
+        Start a seccomp notification dispatcher which calls handler with a
+        Notification object for each notification received on fd.  The
+        handler returns the NotificationResponse to send, or None if it
+        responds to the notification itself.  The handler is called from
+        the dispatcher's worker threads.
+        """
+        self._handler = handler
+        self._threads = threads
+        rc = libseccomp.seccomp_notify_dispatch_start(fd, threads,
+                                                      _notify_dispatch_cb,
+                                                      <void *>handler,
+                                                      &self._disp)
+        if rc == -errno.EINVAL:
+            raise ValueError("Invalid notification fd or thread count")
+        elif rc < 0:
+            raise RuntimeError(str.format("Library error (errno = {0})", rc))
+
+    def __dealloc__(self):
+        """ Stops the dispatcher and releases any resources.
+
+        Description:
+        Stops the seccomp notification dispatcher and releases any
+        resources associated with it.  The notification fd is not closed.
+        """
+        if self._disp != NULL:
+            with nogil:
+                libseccomp.seccomp_notify_dispatch_release(self._disp)
+
+    def stats(self, unsigned int worker):
+        """ Query the statistics of a dispatcher worker.
+
+        Arguments:
+        worker - the worker number
+
+        Description:
+        Returns a tuple of the number of notifications received, the number
+        of responses sent, the number of notifications left to the handler,
+        and the number of failed receives and responses of the worker.
+        """
+        cdef libseccomp.scmp_notify_stats stats
+        if worker >= self._threads:
+            raise ValueError("Invalid worker number")
+        rc = libseccomp.seccomp_notify_dispatch_stats(self._disp, worker,
+                                                      &stats)
+        if rc < 0:
+            raise RuntimeError(str.format("Library error (errno = {0})", rc))
+
+        return (stats.received, stats.responded, stats.skipped, stats.failed)
+
+    def stop(self):
+        """ Stop the dispatcher.
+
+        Description:
+        Stops the dispatcher's worker threads and waits for them to finish
+        the notifications they are handling.  The worker statistics remain
+        available.
+        """
+        with nogil:
+            libseccomp.seccomp_notify_dispatch_stop(self._disp)
+
 cdef class SyscallFilter:
     """ Python object representing a seccomp syscall filter. """
     cdef int _defaction
@@ -642,7 +823,8 @@ cdef class SyscallFilter:
         Merges a valid SyscallFilter object with the current SyscallFilter
         object; the passed filter object will be reset on success.  In
         order to successfully merge two seccomp filters they must have the
-        same attribute values and not share any of the same architectures.
+        same attribute values.  The rules for any architectures in both
+        filters are combined, the merge fails if the rules conflict.
         """
         rc = libseccomp.seccomp_merge(self._ctx, filter._ctx)
         if rc != 0:
@@ -650,6 +832,24 @@ cdef class SyscallFilter:
         filter._ctx = NULL
         filter = SyscallFilter(filter._defaction)
 
+    def dup(self):
+        """ Duplicate the SyscallFilter object.
+
+        Description:
+        Returns a new SyscallFilter object with the same attributes,
+        architectures, and rules as the current object.  The two objects
+        share their filter state until one of them is modified.
+        """
+        cdef SyscallFilter filter
+        cdef libseccomp.scmp_filter_ctx ctx
+        ctx = libseccomp.seccomp_dup(self._ctx)
+        if ctx == NULL:
+            raise RuntimeError("Library error")
+        filter = SyscallFilter(self._defaction)
+        libseccomp.seccomp_release(filter._ctx)
+        filter._ctx = ctx
+        return filter
+
     def exist_arch(self, arch):
         """ Check if the seccomp filter contains a given architecture.
 
@@ -780,6 +980,34 @@ cdef class SyscallFilter:
         if rc != 0:
             raise RuntimeError(str.format("Library error (errno = {0})", rc))
 
+    def syscall_weight(self, syscall, weight):
+        """ Set the filter weight of a syscall.
+
+        Arguments:
+        syscall - the syscall name or number
+        weight - the relative frequency of the syscall
+
+        Description:
+        Set the filter weight of the given syscall.  When one of the search
+        tree optimization levels is in use, a syscall with a higher weight
+        will have less overhead in the generated filter code which is loaded
+        into the system.  Weight values can range from 0 to 4294967295
+        inclusive.
+        """
+        if weight < 0 or weight > 4294967295:
+            raise ValueError("Syscall weight must be between 0 and 4294967295")
+        if isinstance(syscall, str):
+            syscall_str = syscall.encode()
+            syscall_num = libseccomp.seccomp_syscall_resolve_name(syscall_str)
+        elif isinstance(syscall, int):
+            syscall_num = syscall
+        else:
+            raise TypeError("Syscall must either be an int or str type")
+        rc = libseccomp.seccomp_syscall_weight(self._ctx,
+                                               syscall_num, weight)
+        if rc != 0:
+            raise RuntimeError(str.format("Library error (errno = {0})", rc))
+
     def add_rule(self, int action, syscall, *args):
         """ Add a new rule to filter.
 
@@ -947,6 +1175,100 @@ cdef class SyscallFilter:
         if rc != 0:
             raise RuntimeError(str.format("Library error (errno = {0})", rc))
 
+    def add_rules(self, rules):
+        """ Add a batch of new rules to filter.
+
+        Arguments:
+        rules - a list of (action, syscall, args) tuples, where args is a
+                list of Arg objects, see add_rule()
+
+        Description:
+        Add all of the given rules to the filter as a single operation; if
+        any of the rules can not be added the filter is left unchanged and
+        an exception identifying the first failing rule is raised.
+        """
+        cdef libseccomp.scmp_rule *c_rules
+        cdef libseccomp.scmp_arg_cmp *c_args
+        cdef Arg arg
+        rules = list(rules)
+        for action, syscall, args in rules:
+            if len(args) > 6:
+                raise RuntimeError("Maximum number of arguments exceeded")
+        c_rules = <libseccomp.scmp_rule *>malloc(
+                                sizeof(libseccomp.scmp_rule) * len(rules) + 1)
+        c_args = <libseccomp.scmp_arg_cmp *>malloc(
+                                sizeof(libseccomp.scmp_arg_cmp) * 6 *
+                                len(rules) + 1)
+        if c_rules == NULL or c_args == NULL:
+            free(c_rules)
+            free(c_args)
+            raise MemoryError()
+        try:
+            for i, (action, syscall, args) in enumerate(rules):
+                if isinstance(syscall, str):
+                    syscall_str = syscall.encode()
+                    syscall_num = \
+                        libseccomp.seccomp_syscall_resolve_name(syscall_str)
+                elif isinstance(syscall, int):
+                    syscall_num = syscall
+                else:
+                    raise TypeError("Syscall must either be an int or str type")
+                for j, arg in enumerate(args):
+                    c_args[i * 6 + j] = arg.to_c()
+                c_rules[i].action = action
+                c_rules[i].syscall = syscall_num
+                c_rules[i].arg_cnt = len(args)
+                c_rules[i].arg_array = &c_args[i * 6]
+                c_rules[i].rc = 0
+            rc = libseccomp.seccomp_rule_add_batch(self._ctx, c_rules,
+                                                   len(rules))
+            if rc != 0:
+                for i in range(len(rules)):
+                    if c_rules[i].rc != 0:
+                        raise RuntimeError(str.format(
+                            "Library error in rule {0} (errno = {1})",
+                            i, c_rules[i].rc))
+                raise RuntimeError(str.format("Library error (errno = {0})",
+                                              rc))
+        finally:
+            free(c_rules)
+            free(c_args)
+
+    def remove_rule(self, int action, syscall, *args):
+        """ Remove a rule from the filter.
+
+        Arguments:
+        action - the rule action
+        syscall - the syscall name or number
+        args - variable number of Arg objects
+
+        Description:
+        Remove a rule previously added to the filter with add_rule() or
+        add_rule_exactly(); the action, syscall and argument comparisons
+        must match those of the rule being removed.  If the same rule was
+        added multiple times only the most recent one is removed.
+        """
+        cdef libseccomp.scmp_arg_cmp c_arg[6]
+        cdef Arg arg
+        if isinstance(syscall, str):
+            syscall_str = syscall.encode()
+            syscall_num = libseccomp.seccomp_syscall_resolve_name(syscall_str)
+        elif isinstance(syscall, int):
+            syscall_num = syscall
+        else:
+            raise TypeError("Syscall must either be an int or str type")
+        if len(args) > 6:
+            raise RuntimeError("Maximum number of arguments exceeded")
+        for i, arg in enumerate(args):
+            c_arg[i] = arg.to_c()
+        rc = libseccomp.seccomp_rule_remove_array(self._ctx, action,
+                                                  syscall_num, len(args),
+                                                  c_arg)
+        if rc == -errno.ENOENT:
+            raise ValueError("No matching rule")
+        elif rc != 0:
+            raise RuntimeError(str.format("Library error (errno = {0})", rc))
+
     def receive_notify(self):
         """ Receive seccomp notifications.
 
@@ -1001,6 +1323,23 @@ cdef class SyscallFilter:
         if rc < 0:
             raise RuntimeError(str.format("Library error (errno = {0})", rc))
 
+    def dispatch_notify(self, handler, threads = 1):
+        """ Dispatch seccomp notifications to a handler.
+
+        Arguments:
+        handler - the notification handler
+        threads - the number of worker threads
+
+        Description:
+        Start a NotifyDispatcher which receives the seccomp notifications,
+        passes each one to handler, and sends the returned response,
+        requires the use of the NOTIFY action.  See NotifyDispatcher.
+        """
+        fd = libseccomp.seccomp_notify_fd(self._ctx)
+        if fd < 0:
+            raise RuntimeError("Notifications not enabled/active")
+        return NotifyDispatcher(fd, handler, threads)
+
     def export_pfc(self, file):
         """ Export the filter in PFC format.
 
@@ -1031,5 +1370,77 @@ cdef class SyscallFilter:
         if rc != 0:
             raise RuntimeError(str.format("Library error (errno = {0})", rc))
 
+    def export_pfc_mem(self):
+        """ Export the filter in PFC format to memory.
+
+        Description:
+        Returns the filter in the Pseudo Filter Code (PFC) format as a
+        string, see export_pfc().
+        """
+        cdef size_t len = 0
+        cdef char *buf
+        rc = libseccomp.seccomp_export_pfc_mem(self._ctx, NULL, &len)
+        if rc != 0:
+            raise RuntimeError(str.format("Library error (errno = {0})", rc))
+        buf = <char *>malloc(len + 1)
+        if buf == NULL:
+            raise MemoryError()
+        try:
+            rc = libseccomp.seccomp_export_pfc_mem(self._ctx, buf, &len)
+            if rc != 0:
+                raise RuntimeError(str.format("Library error (errno = {0})",
+                                              rc))
+            return buf[:len].decode()
+        finally:
+            free(buf)
+
+    def export_bpf_mem(self):
+        """ Export the filter in BPF format to memory.
+
+        Description:
+        Returns the filter in the Berkley Packet Filter (BPF) format as a
+        bytes object, see export_bpf().
+        """
+        cdef size_t len = 0
+        cdef char *buf
+        rc = libseccomp.seccomp_export_bpf_mem(self._ctx, NULL, &len)
+        if rc != 0:
+            raise RuntimeError(str.format("Library error (errno = {0})", rc))
+        buf = <char *>malloc(len + 1)
+        if buf == NULL:
+            raise MemoryError()
+        try:
+            rc = libseccomp.seccomp_export_bpf_mem(self._ctx, buf, &len)
+            if rc != 0:
+                raise RuntimeError(str.format("Library error (errno = {0})",
+                                              rc))
+            return buf[:len]
+        finally:
+            free(buf)
+
+    def cost_estimate(self):
+        """ Estimate the runtime cost of the filter.
+
+        Description:
+        Returns a tuple of the BPF program length, the fewest and the most
+        instructions executed over all of the syscalls, and a list of
+        (arch, syscall, min, max) tuples with the cost of each syscall in
+        each architecture.  The architecture totals are reported with a
+        syscall number of -1.
+        """
+        cdef libseccomp.scmp_cost *cost
+        rc = libseccomp.seccomp_cost_estimate(self._ctx, &cost)
+        if rc != 0:
+            raise RuntimeError(str.format("Library error (errno = {0})", rc))
+
+        entries = []
+        for i in range(cost.entry_cnt):
+            entries.append((cost.entries[i].arch, cost.entries[i].syscall,
+                            cost.entries[i].instr_min,
+                            cost.entries[i].instr_max))
+        result = (cost.instr_cnt, cost.instr_min, cost.instr_max, entries)
+        libseccomp.seccomp_cost_free(cost)
+        return result
+
 # kate: syntax python;
 # kate: indent-mode python; space-indent on; indent-width 4; mixedindent off;
@@ -28,11 +28,17 @@
 #include "arch-x86.h"
 #include "arch-riscv64.h"
 
-/* NOTE: changes to the arch_syscall_table layout may require changes to the
- *       generate_syscalls_perf.sh and arch-syscall-validate scripts */
-struct arch_syscall_table {
+/* NOTE: changes to the arch_syscall_name or arch_syscall_table layouts may
+ *       require changes to the arch-gperf-generate and arch-syscall-validate
+ *       scripts */
+struct arch_syscall_name {
 	int name;
 	int index;
+};
+
+/* NOTE: the arch_syscall_table rows follow the ordering of syscalls.csv */
+struct arch_syscall_table {
+	int name;
 
 	/* each arch listed here must be defined in syscalls.c  */
 	/* NOTE: see the warning above - BEWARE! */
@@ -57,6 +63,8 @@ struct arch_syscall_table {
 /* defined in syscalls.perf.template  */
 int syscall_resolve_name(const char *name, int offset);
 const char *syscall_resolve_num(int num, int offset);
+int syscall_translate(int num, int offset_from, int offset_to);
+const char *syscall_resolve_pnr(int num);
 const struct arch_syscall_def *syscall_iterate(unsigned int spot, int offset);
 
 #endif
@@ -21,6 +21,7 @@
 
 #include <stdlib.h>
 #include <errno.h>
+#include <pthread.h>
 #include <sys/prctl.h>
 
 #define _GNU_SOURCE
@@ -31,6 +32,7 @@
 #include <seccomp.h>
 
 #include "arch.h"
+#include "cache.h"
 #include "db.h"
 #include "gen_bpf.h"
 #include "helper.h"
@@ -40,6 +42,8 @@
  *       our next release we may have to enable the allowlist */
 #define SYSCALL_ALLOWLIST_ENABLE	0
 
+/* NOTE: the support values are -1 until they are either probed or forced,
+ *       see _sys_probe() */
 static int _nr_seccomp = -1;
 static int _support_seccomp_syscall = -1;
 static int _support_seccomp_flag_tsync = -1;
@@ -50,26 +54,23 @@ static int _support_seccomp_flag_spec_allow = -1;
 static int _support_seccomp_flag_new_listener = -1;
 static int _support_seccomp_user_notif = -1;
 static int _support_seccomp_flag_tsync_esrch = -1;
+static struct seccomp_notif_sizes _support_notif_sizes = { 0, 0, 0 };
+
+static pthread_once_t _support_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t _support_lock = PTHREAD_MUTEX_INITIALIZER;
 
 /**
- * Check to see if the seccomp() syscall is supported
+ * Check to see if the seccomp() syscall is supported by the kernel
  *
- * This function attempts to see if the system supports the seccomp() syscall.
+ * This function attempts to see if the kernel supports the seccomp() syscall.
  * Unfortunately, there are a few reasons why this check may fail, including
  * a previously loaded seccomp filter, so it is hard to say for certain.
  * Return one if the syscall is supported, zero otherwise.
  *
  */
-int sys_chk_seccomp_syscall(void)
+static int _sys_chk_seccomp_syscall_kernel(void)
 {
 	int rc;
-	int nr_seccomp;
-
-	/* NOTE: it is reasonably safe to assume that we should be able to call
-	 *       seccomp() when the caller first starts, but we can't rely on
-	 *       it later so we need to cache our findings for use later */
-	if (_support_seccomp_syscall >= 0)
-		return _support_seccomp_syscall;
 
 #if SYSCALL_ALLOWLIST_ENABLE
 	/* architecture allowlist */
@@ -84,28 +85,169 @@ int sys_chk_seccomp_syscall(void)
 	case SCMP_ARCH_RISCV64:
 		break;
 	default:
-		goto unsupported;
+		return 0;
 	}
 #endif
 
-	nr_seccomp = arch_syscall_resolve_name(arch_def_native, "seccomp");
-	if (nr_seccomp < 0)
-		goto unsupported;
-
 	/* this is an invalid call because the second argument is non-zero, but
 	 * depending on the errno value of ENOSYS or EINVAL we can guess if the
 	 * seccomp() syscall is supported or not */
-	rc = syscall(nr_seccomp, SECCOMP_SET_MODE_STRICT, 1, NULL);
+	rc = syscall(_nr_seccomp, SECCOMP_SET_MODE_STRICT, 1, NULL);
 	if (rc < 0 && errno == EINVAL)
-		goto supported;
+		return 1;
 
-unsupported:
-	_support_seccomp_syscall = 0;
 	return 0;
-supported:
-	_nr_seccomp = nr_seccomp;
-	_support_seccomp_syscall = 1;
-	return 1;
+}
+
+/**
+ * Check to see if a seccomp action is supported by the kernel
+ * @param action the seccomp action
+ *
+ * This function checks to see if a seccomp action is supported by the kernel.
+ * Return one if the action is supported, zero otherwise.
+ *
+ */
+static int _sys_chk_seccomp_action_kernel(uint32_t action)
+{
+	if (syscall(_nr_seccomp, SECCOMP_GET_ACTION_AVAIL, 0, &action) == 0)
+		return 1;
+
+	return 0;
+}
+
+/**
+ * Check to see if a seccomp() flag is supported by the kernel
+ * @param flag the seccomp() flag
+ *
+ * This function checks to see if a seccomp() flag is supported by the kernel.
+ * Return one if the flag is supported, zero otherwise.
+ *
+ */
+static int _sys_chk_seccomp_flag_kernel(int flag)
+{
+	/* this is an invalid seccomp(2) call because the last argument
+	 * is NULL, but depending on the errno value of EFAULT we can
+	 * guess if the filter flag is supported or not */
+	if (syscall(_nr_seccomp, SECCOMP_SET_MODE_FILTER, flag, NULL) == -1 &&
+	    errno == EFAULT)
+		return 1;
+
+	return 0;
+}
+
+/**
+ * Probe the kernel for seccomp support
+ *
+ * This function probes the kernel for all of the seccomp features we care
+ * about in a single pass, it is run once per process by _sys_probe_once().
+ * Features which have already been forced, e.g. by seccomp_api_set(), are not
+ * probed so callers can avoid the probes entirely by setting the API level
+ * before any other libseccomp call.
+ *
+ */
+static void _sys_probe(void)
+{
+	pthread_mutex_lock(&_support_lock);
+
+	/* NOTE: it is reasonably safe to assume that we should be able to call
+	 *       seccomp() when the caller first starts, but we can't rely on
+	 *       it later so we need to cache our findings for use later */
+	_nr_seccomp = arch_syscall_resolve_name(arch_def_native, "seccomp");
+	if (_nr_seccomp < 0)
+		_support_seccomp_syscall = 0;
+	else if (_support_seccomp_syscall < 0)
+		_support_seccomp_syscall = _sys_chk_seccomp_syscall_kernel();
+
+	if (_support_seccomp_syscall != 1) {
+		/* nothing else is usable without the seccomp() syscall */
+		if (_support_seccomp_flag_tsync < 0)
+			_support_seccomp_flag_tsync = 0;
+		if (_support_seccomp_flag_log < 0)
+			_support_seccomp_flag_log = 0;
+		if (_support_seccomp_flag_spec_allow < 0)
+			_support_seccomp_flag_spec_allow = 0;
+		if (_support_seccomp_flag_new_listener < 0)
+			_support_seccomp_flag_new_listener = 0;
+		if (_support_seccomp_flag_tsync_esrch < 0)
+			_support_seccomp_flag_tsync_esrch = 0;
+		if (_support_seccomp_action_log < 0)
+			_support_seccomp_action_log = 0;
+		if (_support_seccomp_kill_process < 0)
+			_support_seccomp_kill_process = 0;
+		if (_support_seccomp_user_notif < 0)
+			_support_seccomp_user_notif = 0;
+		goto probe_done;
+	}
+
+	if (_support_seccomp_flag_tsync < 0)
+		_support_seccomp_flag_tsync =
+			_sys_chk_seccomp_flag_kernel(SECCOMP_FILTER_FLAG_TSYNC);
+	if (_support_seccomp_flag_log < 0)
+		_support_seccomp_flag_log =
+			_sys_chk_seccomp_flag_kernel(SECCOMP_FILTER_FLAG_LOG);
+	if (_support_seccomp_flag_spec_allow < 0)
+		_support_seccomp_flag_spec_allow =
+			_sys_chk_seccomp_flag_kernel(SECCOMP_FILTER_FLAG_SPEC_ALLOW);
+	if (_support_seccomp_flag_new_listener < 0)
+		_support_seccomp_flag_new_listener =
+			_sys_chk_seccomp_flag_kernel(SECCOMP_FILTER_FLAG_NEW_LISTENER);
+	if (_support_seccomp_flag_tsync_esrch < 0)
+		_support_seccomp_flag_tsync_esrch =
+			_sys_chk_seccomp_flag_kernel(SECCOMP_FILTER_FLAG_TSYNC_ESRCH);
+	if (_support_seccomp_action_log < 0)
+		_support_seccomp_action_log =
+			_sys_chk_seccomp_action_kernel(SCMP_ACT_LOG);
+	if (_support_seccomp_kill_process < 0)
+		_support_seccomp_kill_process =
+			_sys_chk_seccomp_action_kernel(SCMP_ACT_KILL_PROCESS);
+	if (_support_seccomp_user_notif < 0)
+		_support_seccomp_user_notif =
+			(syscall(_nr_seccomp, SECCOMP_GET_NOTIF_SIZES, 0,
+				 &_support_notif_sizes) == 0 ? 1 : 0);
+
+probe_done:
+	pthread_mutex_unlock(&_support_lock);
+}
+
+/**
+ * Make sure the kernel has been probed for seccomp support
+ *
+ * This function runs _sys_probe() the first time it is called, any other
+ * threads calling it at the same time wait for the probe to finish.
+ *
+ */
+static void _sys_probe_once(void)
+{
+	pthread_once(&_support_once, _sys_probe);
+}
+
+/**
+ * Force a support setting
+ * @param support the support setting
+ * @param enable the intended support state
+ *
+ * This function overrides the given support setting while holding the
+ * support lock so that it is never lost to a concurrent probe.
+ *
+ */
+static void _sys_set_support(int *support, bool enable)
+{
+	pthread_mutex_lock(&_support_lock);
+	*support = (enable ? 1 : 0);
+	pthread_mutex_unlock(&_support_lock);
+}
+
+/**
+ * Check to see if the seccomp() syscall is supported
+ *
+ * This function checks to see if the system supports the seccomp() syscall.
+ * Return one if the syscall is supported, zero otherwise.
+ *
+ */
+int sys_chk_seccomp_syscall(void)
+{
+	_sys_probe_once();
+	return _support_seccomp_syscall;
 }
 
 /**
@@ -118,7 +260,7 @@ supported:
  */
 void sys_set_seccomp_syscall(bool enable)
 {
-	_support_seccomp_syscall = (enable ? 1 : 0);
+	_sys_set_support(&_support_seccomp_syscall, enable);
 }
 
 /**
@@ -131,16 +273,9 @@ void sys_set_seccomp_syscall(bool enable)
  */
 int sys_chk_seccomp_action(uint32_t action)
 {
-	if (action == SCMP_ACT_KILL_PROCESS) {
-		if (_support_seccomp_kill_process < 0) {
-			if (sys_chk_seccomp_syscall() == 1 &&
-			    syscall(_nr_seccomp, SECCOMP_GET_ACTION_AVAIL, 0,
-				    &action) == 0)
-				_support_seccomp_kill_process = 1;
-			else
-				_support_seccomp_kill_process = 0;
-		}
+	_sys_probe_once();
 
+	if (action == SCMP_ACT_KILL_PROCESS) {
 		return _support_seccomp_kill_process;
 	} else if (action == SCMP_ACT_KILL_THREAD) {
 		return 1;
@@ -152,29 +287,10 @@ int sys_chk_seccomp_action(uint32_t action)
 	} else if (action == SCMP_ACT_TRACE(action & 0x0000ffff)) {
 		return 1;
 	} else if (action == SCMP_ACT_LOG) {
-		if (_support_seccomp_action_log < 0) {
-			if (sys_chk_seccomp_syscall() == 1 &&
-			    syscall(_nr_seccomp, SECCOMP_GET_ACTION_AVAIL, 0,
-				    &action) == 0)
-				_support_seccomp_action_log = 1;
-			else
-				_support_seccomp_action_log = 0;
-		}
-
 		return _support_seccomp_action_log;
 	} else if (action == SCMP_ACT_ALLOW) {
 		return 1;
 	} else if (action == SCMP_ACT_NOTIFY) {
-		if (_support_seccomp_user_notif < 0) {
-			struct seccomp_notif_sizes sizes;
-			if (sys_chk_seccomp_syscall() == 1 &&
-			    syscall(_nr_seccomp, SECCOMP_GET_NOTIF_SIZES, 0,
-				    &sizes) == 0)
-				_support_seccomp_user_notif = 1;
-			else
-				_support_seccomp_user_notif = 0;
-		}
-
 		return _support_seccomp_user_notif;
 	}
 
@@ -193,38 +309,17 @@ void sys_set_seccomp_action(uint32_t action, bool enable)
 {
 	switch (action) {
 	case SCMP_ACT_LOG:
-		_support_seccomp_action_log = (enable ? 1 : 0);
+		_sys_set_support(&_support_seccomp_action_log, enable);
 		break;
 	case SCMP_ACT_KILL_PROCESS:
-		_support_seccomp_kill_process = (enable ? 1 : 0);
+		_sys_set_support(&_support_seccomp_kill_process, enable);
 		break;
 	case SCMP_ACT_NOTIFY:
-		_support_seccomp_user_notif = (enable ? 1 : 0);
+		_sys_set_support(&_support_seccomp_user_notif, enable);
 		break;
 	}
 }
 
-/**
- * Check to see if a seccomp() flag is supported by the kernel
- * @param flag the seccomp() flag
- *
- * This function checks to see if a seccomp() flag is supported by the kernel.
- * Return one if the flag is supported, zero otherwise.
- *
- */
-static int _sys_chk_seccomp_flag_kernel(int flag)
-{
-	/* this is an invalid seccomp(2) call because the last argument
-	 * is NULL, but depending on the errno value of EFAULT we can
-	 * guess if the filter flag is supported or not */
-	if (sys_chk_seccomp_syscall() == 1 &&
-	    syscall(_nr_seccomp, SECCOMP_SET_MODE_FILTER, flag, NULL) == -1 &&
-	    errno == EFAULT)
-		return 1;
-
-	return 0;
-}
-
 /**
  * Check to see if a seccomp() flag is supported
  * @param flag the seccomp() flag
@@ -236,30 +331,18 @@ static int _sys_chk_seccomp_flag_kernel(int flag)
  */
 int sys_chk_seccomp_flag(int flag)
 {
+	_sys_probe_once();
+
 	switch (flag) {
 	case SECCOMP_FILTER_FLAG_TSYNC:
-		if (_support_seccomp_flag_tsync < 0)
-			_support_seccomp_flag_tsync = _sys_chk_seccomp_flag_kernel(flag);
-
 		return _support_seccomp_flag_tsync;
 	case SECCOMP_FILTER_FLAG_LOG:
-		if (_support_seccomp_flag_log < 0)
-			_support_seccomp_flag_log = _sys_chk_seccomp_flag_kernel(flag);
-
 		return _support_seccomp_flag_log;
 	case SECCOMP_FILTER_FLAG_SPEC_ALLOW:
-		if (_support_seccomp_flag_spec_allow < 0)
-			_support_seccomp_flag_spec_allow = _sys_chk_seccomp_flag_kernel(flag);
-
 		return _support_seccomp_flag_spec_allow;
 	case SECCOMP_FILTER_FLAG_NEW_LISTENER:
-		if (_support_seccomp_flag_new_listener < 0)
-			_support_seccomp_flag_new_listener = _sys_chk_seccomp_flag_kernel(flag);
-
 		return _support_seccomp_flag_new_listener;
 	case SECCOMP_FILTER_FLAG_TSYNC_ESRCH:
-		if (_support_seccomp_flag_tsync_esrch < 0)
-			_support_seccomp_flag_tsync_esrch = _sys_chk_seccomp_flag_kernel(flag);
 		return _support_seccomp_flag_tsync_esrch;
 	}
 
@@ -279,23 +362,51 @@ void sys_set_seccomp_flag(int flag, bool enable)
 {
 	switch (flag) {
 	case SECCOMP_FILTER_FLAG_TSYNC:
-		_support_seccomp_flag_tsync = (enable ? 1 : 0);
+		_sys_set_support(&_support_seccomp_flag_tsync, enable);
 		break;
 	case SECCOMP_FILTER_FLAG_LOG:
-		_support_seccomp_flag_log = (enable ? 1 : 0);
+		_sys_set_support(&_support_seccomp_flag_log, enable);
 		break;
 	case SECCOMP_FILTER_FLAG_SPEC_ALLOW:
-		_support_seccomp_flag_spec_allow = (enable ? 1 : 0);
+		_sys_set_support(&_support_seccomp_flag_spec_allow, enable);
 		break;
 	case SECCOMP_FILTER_FLAG_NEW_LISTENER:
-		_support_seccomp_flag_new_listener = (enable ? 1 : 0);
+		_sys_set_support(&_support_seccomp_flag_new_listener, enable);
 		break;
 	case SECCOMP_FILTER_FLAG_TSYNC_ESRCH:
-		_support_seccomp_flag_tsync_esrch = (enable ? 1 : 0);
+		_sys_set_support(&_support_seccomp_flag_tsync_esrch, enable);
 		break;
 	}
 }
 
+/**
+ * Install a BPF program in the kernel
+ * @param prgm the BPF program
+ * @param nnp set NO_NEW_PRIVS if true
+ * @param flgs the seccomp() flags
+ *
+ * Set NO_NEW_PRIVS if requested and then load the BPF program into the kernel
+ * using seccomp() if available, prctl() otherwise; @flgs must be zero if the
+ * seccomp() syscall is not available.  Returns the result of the kernel call,
+ * on error the kernel error code is left in errno.
+ *
+ */
+static int _sys_filter_install(const struct bpf_program *prgm, bool nnp,
+			       int flgs)
+{
+	int rc;
+
+	if (nnp) {
+		rc = prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0);
+		if (rc < 0)
+			return rc;
+	}
+
+	if (sys_chk_seccomp_syscall() == 1)
+		return syscall(_nr_seccomp, SECCOMP_SET_MODE_FILTER, flgs, prgm);
+	return prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, prgm);
+}
+
 /**
  * Loads the filter into the kernel
  * @param col the filter collection
@@ -310,40 +421,35 @@ void sys_set_seccomp_flag(int flag, bool enable)
 int sys_filter_load(struct db_filter_col *col, bool rawrc)
 {
 	int rc;
-	bool tsync_notify;
+	int flgs = 0;
+	bool tsync_notify, listener;
 	struct bpf_program *prgm = NULL;
 
-	rc = gen_bpf_generate(col, &prgm);
+	rc = cache_bpf_generate(col, &prgm);
 	if (rc < 0)
 		return rc;
 
-	/* attempt to set NO_NEW_PRIVS */
-	if (col->attr.nnp_enable) {
-		rc = prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0);
-		if (rc < 0)
-			goto filter_load_out;
-	}
-
-	tsync_notify = (_support_seccomp_flag_tsync_esrch > 0);
+	tsync_notify =
+		(sys_chk_seccomp_flag(SECCOMP_FILTER_FLAG_TSYNC_ESRCH) == 1);
+	listener = (sys_chk_seccomp_action(SCMP_ACT_NOTIFY) == 1);
 
 	/* load the filter into the kernel */
 	if (sys_chk_seccomp_syscall() == 1) {
-		int flgs = 0;
 		if (tsync_notify) {
 			if (col->attr.tsync_enable)
 				flgs |= SECCOMP_FILTER_FLAG_TSYNC | \
 					SECCOMP_FILTER_FLAG_TSYNC_ESRCH;
-			if (_support_seccomp_user_notif > 0)
+			if (listener)
 				flgs |= SECCOMP_FILTER_FLAG_NEW_LISTENER;
 		} else if (col->attr.tsync_enable)
 			flgs |= SECCOMP_FILTER_FLAG_TSYNC;
-		else if (_support_seccomp_user_notif > 0)
+		else if (listener)
 			flgs |= SECCOMP_FILTER_FLAG_NEW_LISTENER;
 		if (col->attr.log_enable)
 			flgs |= SECCOMP_FILTER_FLAG_LOG;
 		if (col->attr.spec_allow)
 			flgs |= SECCOMP_FILTER_FLAG_SPEC_ALLOW;
-		rc = syscall(_nr_seccomp, SECCOMP_SET_MODE_FILTER, flgs, prgm);
+		rc = _sys_filter_install(prgm, col->attr.nnp_enable, flgs);
 		if (tsync_notify && rc > 0) {
 			/* return 0 on NEW_LISTENER success, but save the fd */
 			col->notify_fd = rc;
@@ -352,15 +458,14 @@ int sys_filter_load(struct db_filter_col *col, bool rawrc)
 			/* always return -ESRCH if we fail to sync threads */
 			errno = ESRCH;
 			rc = -errno;
-		} else if (rc > 0 && _support_seccomp_user_notif > 0) {
+		} else if (rc > 0 && listener) {
 			/* return 0 on NEW_LISTENER success, but save the fd */
 			col->notify_fd = rc;
 			rc = 0;
 		}
 	} else
-		rc = prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, prgm);
+		rc = _sys_filter_install(prgm, col->attr.nnp_enable, flgs);
 
-filter_load_out:
 	/* cleanup and return */
 	gen_bpf_release(prgm);
 	if (rc == -ESRCH)
@@ -370,6 +475,99 @@ filter_load_out:
 	return rc;
 }
 
+/**
+ * Loads a raw BPF program into the kernel
+ * @param prgm the BPF program
+ * @param flags the load flags, SCMP_LOAD_*
+ *
+ * This function loads the given BPF program into the kernel as-is.  If
+ * SCMP_LOAD_NEW_LISTENER is given the notification fd is returned on success,
+ * otherwise zero is returned on success.  Returns negative values on error.
+ *
+ */
+int sys_filter_load_raw(const struct bpf_program *prgm, uint32_t flags)
+{
+	int rc;
+	int flgs = 0;
+
+	if (flags & SCMP_LOAD_TSYNC) {
+		flgs |= SECCOMP_FILTER_FLAG_TSYNC;
+		/* the kernel can only report the notification fd if it
+		 * reports thread sync failures with ESRCH */
+		if (flags & SCMP_LOAD_NEW_LISTENER)
+			flgs |= SECCOMP_FILTER_FLAG_TSYNC_ESRCH;
+	}
+	if (flags & SCMP_LOAD_LOG)
+		flgs |= SECCOMP_FILTER_FLAG_LOG;
+	if (flags & SCMP_LOAD_SSB)
+		flgs |= SECCOMP_FILTER_FLAG_SPEC_ALLOW;
+	if (flags & SCMP_LOAD_NEW_LISTENER)
+		flgs |= SECCOMP_FILTER_FLAG_NEW_LISTENER;
+
+	/* make sure the kernel supports all of the flags */
+	if (flgs != 0 && sys_chk_seccomp_syscall() != 1)
+		return -EOPNOTSUPP;
+	if ((flgs & SECCOMP_FILTER_FLAG_TSYNC) &&
+	    sys_chk_seccomp_flag(SECCOMP_FILTER_FLAG_TSYNC) != 1)
+		return -EOPNOTSUPP;
+	if ((flgs & SECCOMP_FILTER_FLAG_TSYNC_ESRCH) &&
+	    sys_chk_seccomp_flag(SECCOMP_FILTER_FLAG_TSYNC_ESRCH) != 1)
+		return -EOPNOTSUPP;
+	if ((flgs & SECCOMP_FILTER_FLAG_LOG) &&
+	    sys_chk_seccomp_flag(SECCOMP_FILTER_FLAG_LOG) != 1)
+		return -EOPNOTSUPP;
+	if ((flgs & SECCOMP_FILTER_FLAG_SPEC_ALLOW) &&
+	    sys_chk_seccomp_flag(SECCOMP_FILTER_FLAG_SPEC_ALLOW) != 1)
+		return -EOPNOTSUPP;
+	if ((flgs & SECCOMP_FILTER_FLAG_NEW_LISTENER) &&
+	    sys_chk_seccomp_flag(SECCOMP_FILTER_FLAG_NEW_LISTENER) != 1)
+		return -EOPNOTSUPP;
+
+	rc = _sys_filter_install(prgm, (flags & SCMP_LOAD_NNP), flgs);
+	if (rc > 0 && !(flags & SCMP_LOAD_NEW_LISTENER)) {
+		/* TSYNC failed, the kernel returned the thread id */
+		return -ESRCH;
+	} else if (rc < 0 && (flags & SCMP_LOAD_TSYNC) && errno == ESRCH)
+		return -ESRCH;
+	else if (rc < 0)
+		return ((flags & SCMP_LOAD_SYSRAWRC) ? -errno : -ECANCELED);
+
+	return rc;
+}
+
+/**
+ * Get the size of the notification request/response structures
+ * @param sizes the structure sizes
+ *
+ * This function returns the size of the notification request/response
+ * structures used by the currently running kernel.  It returns zero on
+ * success, and negative values on failure.
+ *
+ */
+int sys_notify_sizes(struct seccomp_notif_sizes *sizes)
+{
+	int rc = 0;
+
+	if (sys_chk_seccomp_syscall() != 1)
+		return -EOPNOTSUPP;
+
+	/* NOTE: the sizes are only probed if the notification support was
+	 *       forced instead of probed */
+	pthread_mutex_lock(&_support_lock);
+	if (_support_notif_sizes.seccomp_notif == 0 &&
+	    _support_notif_sizes.seccomp_notif_resp == 0)
+		rc = syscall(_nr_seccomp, SECCOMP_GET_NOTIF_SIZES, 0,
+			     &_support_notif_sizes);
+	*sizes = _support_notif_sizes;
+	pthread_mutex_unlock(&_support_lock);
+	if (rc < 0)
+		return -ECANCELED;
+	if (sizes->seccomp_notif == 0 || sizes->seccomp_notif_resp == 0)
+		return -EFAULT;
+
+	return 0;
+}
+
 /**
  * Allocate a pair of notification request/response structures
  * @param req the request location
@@ -384,18 +582,11 @@ int sys_notify_alloc(struct seccomp_notif **req,
 		     struct seccomp_notif_resp **resp)
 {
 	int rc;
-	static struct seccomp_notif_sizes sizes = { 0, 0, 0 };
-
-	if (_support_seccomp_syscall <= 0)
-		return -EOPNOTSUPP;
+	struct seccomp_notif_sizes sizes;
 
-	if (sizes.seccomp_notif == 0 && sizes.seccomp_notif_resp == 0) {
-		rc = syscall(__NR_seccomp, SECCOMP_GET_NOTIF_SIZES, 0, &sizes);
-		if (rc < 0)
-			return -ECANCELED;
-	}
-	if (sizes.seccomp_notif == 0 || sizes.seccomp_notif_resp == 0)
-		return -EFAULT;
+	rc = sys_notify_sizes(&sizes);
+	if (rc < 0)
+		return rc;
 
 	if (req) {
 		*req = zmalloc(sizes.seccomp_notif);
@@ -427,7 +618,7 @@ int sys_notify_alloc(struct seccomp_notif **req,
  */
 int sys_notify_receive(int fd, struct seccomp_notif *req)
 {
-	if (_support_seccomp_user_notif <= 0)
+	if (sys_chk_seccomp_action(SCMP_ACT_NOTIFY) != 1)
 		return -EOPNOTSUPP;
 
 	if (ioctl(fd, SECCOMP_IOCTL_NOTIF_RECV, req) < 0)
@@ -448,7 +639,7 @@ int sys_notify_receive(int fd, struct seccomp_notif *req)
  */
 int sys_notify_respond(int fd, struct seccomp_notif_resp *resp)
 {
-	if (_support_seccomp_user_notif <= 0)
+	if (sys_chk_seccomp_action(SCMP_ACT_NOTIFY) != 1)
 		return -EOPNOTSUPP;
 
 	if (ioctl(fd, SECCOMP_IOCTL_NOTIF_SEND, resp) < 0)
@@ -467,7 +658,7 @@ int sys_notify_respond(int fd, struct seccomp_notif_resp *resp)
  */
 int sys_notify_id_valid(int fd, uint64_t id)
 {
-	if (_support_seccomp_user_notif <= 0)
+	if (sys_chk_seccomp_action(SCMP_ACT_NOTIFY) != 1)
 		return -EOPNOTSUPP;
 
 	if (ioctl(fd, SECCOMP_IOCTL_NOTIF_ID_VALID, &id) < 0)
@@ -34,6 +34,7 @@
 #define MAX_ERRNO		4095
 
 struct db_filter_col;
+struct bpf_program;
 
 #ifdef HAVE_LINUX_SECCOMP_H
 
@@ -192,7 +193,9 @@ int sys_chk_seccomp_flag(int flag);
 void sys_set_seccomp_flag(int flag, bool enable);
 
 int sys_filter_load(struct db_filter_col *col, bool rawrc);
+int sys_filter_load_raw(const struct bpf_program *prgm, uint32_t flags);
 
+int sys_notify_sizes(struct seccomp_notif_sizes *sizes);
 int sys_notify_alloc(struct seccomp_notif **req,
 		     struct seccomp_notif_resp **resp);
 int sys_notify_receive(int fd, struct seccomp_notif *req);
@@ -0,0 +1,68 @@
+#!/usr/bin/env python
+
+#
+# Seccomp Library test program
+#
+# Copyright (c) 2026 The libseccomp Authors
+# Author: The libseccomp Authors <libseccomp@googlegroups.com>
+#
+
+#
+# This library is free software; you can redistribute it and/or modify it
+# under the terms of version 2.1 of the GNU Lesser General Public License as
+# published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+# for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library; if not, see <http://www.gnu.org/licenses>.
+#
+
+import argparse
+import sys
+
+import util
+
+from seccomp import *
+
+def test(args):
+    f = SyscallFilter(KILL)
+    f.remove_arch(Arch())
+    f.add_arch(Arch("x86_64"))
+    f.add_arch(Arch("x32"))
+    f.add_arch(Arch("x86"))
+    f.add_arch(Arch("aarch64"))
+    f.set_attr(Attr.CTL_OPTIMIZE, 3)
+    # a run of adjacent syscalls on most arches
+    f.add_rule(ALLOW, "read")
+    f.add_rule(ALLOW, "write")
+    f.add_rule(ALLOW, "open")
+    f.add_rule(ALLOW, "close")
+    f.add_rule(ALLOW, "stat")
+    f.add_rule(ALLOW, "fstat")
+    f.add_rule(ALLOW, "lstat")
+    f.add_rule(ALLOW, "poll")
+    f.add_rule(ALLOW, "lseek")
+    # a different action in the middle of a run
+    f.add_rule(ERRNO(5), "mmap")
+    f.add_rule(ALLOW, "mprotect")
+    f.add_rule(ALLOW, "munmap")
+    f.add_rule(ALLOW, "brk")
+    # argument filtering breaks a run
+    f.add_rule(ALLOW, "rt_sigaction", Arg(0, EQ, 1))
+    f.add_rule(ALLOW, "rt_sigprocmask")
+    # isolated syscalls
+    f.add_rule(ALLOW, "getpid")
+    f.add_rule(ERRNO(6), "kill")
+    f.add_rule(ALLOW, "exit_group")
+    return f
+
+args = util.get_opt()
+ctx = test(args)
+util.filter_output(args, ctx)
+
+# kate: syntax python;
+# kate: indent-mode python; space-indent on; indent-width 4; mixedindent off;
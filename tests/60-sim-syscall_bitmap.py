@@ -0,0 +1,66 @@
+#!/usr/bin/env python
+
+#
+# Seccomp Library test program
+#
+# Copyright (c) 2026 The libseccomp Authors
+# Author: The libseccomp Authors <libseccomp@googlegroups.com>
+#
+
+#
+# This library is free software; you can redistribute it and/or modify it
+# under the terms of version 2.1 of the GNU Lesser General Public License as
+# published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+# for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library; if not, see <http://www.gnu.org/licenses>.
+#
+
+import argparse
+import sys
+
+import util
+
+from seccomp import *
+
+def test(args):
+    f = SyscallFilter(KILL)
+    f.remove_arch(Arch())
+    f.add_arch(Arch("x86_64"))
+    f.add_arch(Arch("aarch64"))
+    f.set_attr(Attr.CTL_OPTIMIZE, 4)
+    # a sparse group of syscalls sharing the same action on x86_64
+    f.add_rule(ALLOW, "read")
+    f.add_rule(ALLOW, "open")
+    f.add_rule(ALLOW, "stat")
+    f.add_rule(ALLOW, "lstat")
+    f.add_rule(ALLOW, "lseek")
+    f.add_rule(ALLOW, "mprotect")
+    f.add_rule(ALLOW, "brk")
+    f.add_rule(ALLOW, "rt_sigprocmask")
+    f.add_rule(ALLOW, "pread64")
+    f.add_rule(ALLOW, "readv")
+    f.add_rule(ALLOW, "access")
+    f.add_rule(ALLOW, "sched_yield")
+    f.add_rule(ALLOW, "mincore")
+    f.add_rule(ALLOW, "shmget")
+    f.add_rule(ALLOW, "shmctl")
+    # exceptions within the group
+    f.add_rule(ERRNO(1), "ioctl")
+    f.add_rule(ALLOW, "rt_sigaction", Arg(0, EQ, 1))
+    # too few syscalls to justify a bitmap
+    f.add_rule(ALLOW, "dup")
+    f.add_rule(ALLOW, "getpid")
+    return f
+
+args = util.get_opt()
+ctx = test(args)
+util.filter_output(args, ctx)
+
+# kate: syntax python;
+# kate: indent-mode python; space-indent on; indent-width 4; mixedindent off;
@@ -0,0 +1,71 @@
+#!/usr/bin/env python
+
+#
+# Seccomp Library test program
+#
+# Copyright (c) 2026 The libseccomp Authors
+# Author: The libseccomp Authors <libseccomp@googlegroups.com>
+#
+
+#
+# This library is free software; you can redistribute it and/or modify it
+# under the terms of version 2.1 of the GNU Lesser General Public License as
+# published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+# for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library; if not, see <http://www.gnu.org/licenses>.
+#
+
+import argparse
+import sys
+
+import util
+
+from seccomp import *
+
+def test(args):
+    f = SyscallFilter(KILL)
+    f.remove_arch(Arch())
+    f.add_arch(Arch("x86_64"))
+    f.add_arch(Arch("aarch64"))
+    f.set_attr(Attr.CTL_OPTIMIZE, 3)
+    # a syscall profile, weights can be set before the rules are added
+    f.syscall_weight("read", 900000)
+    f.syscall_weight("write", 700000)
+    f.syscall_weight("futex", 500000)
+    f.syscall_weight("epoll_wait", 400000)
+    f.add_rule(ALLOW, "read")
+    f.add_rule(ALLOW, "write")
+    f.add_rule(ALLOW, "close")
+    f.add_rule(ALLOW, "fstat")
+    f.add_rule(ALLOW, "mmap")
+    f.add_rule(ALLOW, "munmap")
+    f.add_rule(ALLOW, "brk")
+    f.add_rule(ALLOW, "rt_sigaction")
+    f.add_rule(ALLOW, "rt_sigprocmask")
+    f.add_rule(ALLOW, "getpid")
+    f.add_rule(ALLOW, "futex")
+    f.add_rule(ALLOW, "epoll_wait")
+    f.add_rule(ALLOW, "epoll_ctl")
+    f.add_rule(ALLOW, "accept4")
+    f.add_rule(ALLOW, "sendto")
+    f.add_rule(ALLOW, "recvfrom")
+    f.add_rule(ALLOW, "exit_group")
+    f.add_rule(ERRNO(1), "ioctl")
+    # ... or after the rules are added
+    f.syscall_weight("recvfrom", 1000)
+    f.syscall_weight("sendto", 1000)
+    f.syscall_weight("ioctl", 10)
+    return f
+
+args = util.get_opt()
+ctx = test(args)
+util.filter_output(args, ctx)
+
+# kate: syntax python;
+# kate: indent-mode python; space-indent on; indent-width 4; mixedindent off;
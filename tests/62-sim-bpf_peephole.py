@@ -0,0 +1,55 @@
+#!/usr/bin/env python
+
+#
+# Seccomp Library test program
+#
+# Copyright (c) 2026 The libseccomp Authors
+# Author: The libseccomp Authors <libseccomp@googlegroups.com>
+#
+
+#
+# This library is free software; you can redistribute it and/or modify it
+# under the terms of version 2.1 of the GNU Lesser General Public License as
+# published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+# for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library; if not, see <http://www.gnu.org/licenses>.
+#
+
+import argparse
+import sys
+
+import util
+
+from seccomp import *
+
+def test(args):
+    f = SyscallFilter(KILL)
+    f.remove_arch(Arch())
+    f.add_arch(Arch("x86_64"))
+    f.add_arch(Arch("x86"))
+    f.add_arch(Arch("aarch64"))
+    f.set_attr(Attr.CTL_OPTIMIZE, 3)
+    # argument chains which share accumulator loads
+    f.add_rule(ALLOW, "read", Arg(0, EQ, 0))
+    f.add_rule(ALLOW, "read", Arg(0, EQ, 1), Arg(1, NE, 0))
+    f.add_rule(ALLOW, "write", Arg(0, EQ, 1))
+    f.add_rule(ERRNO(1), "write", Arg(0, EQ, 2))
+    f.add_rule(ALLOW, "openat", Arg(2, MASKED_EQ, 0x3, 0))
+    f.add_rule(ALLOW, "close")
+    # duplicate actions scattered through the filter
+    f.add_rule(ERRNO(1), "ioctl")
+    f.add_rule(ERRNO(1), "kill")
+    return f
+
+args = util.get_opt()
+ctx = test(args)
+util.filter_output(args, ctx)
+
+# kate: syntax python;
+# kate: indent-mode python; space-indent on; indent-width 4; mixedindent off;
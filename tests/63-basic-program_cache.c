@@ -0,0 +1,171 @@
+/**
+ * Seccomp Library test program
+ *
+ * Copyright (c) 2026 The libseccomp Authors
+ * Author: The libseccomp Authors <libseccomp@googlegroups.com>
+ */
+
+/*
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of version 2.1 of the GNU Lesser General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses>.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <seccomp.h>
+
+static scmp_filter_ctx filter_build(void)
+{
+	int rc;
+	scmp_filter_ctx ctx;
+
+	ctx = seccomp_init(SCMP_ACT_KILL);
+	if (ctx == NULL)
+		return NULL;
+
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(read), 1,
+			      SCMP_A0(SCMP_CMP_EQ, 0));
+	if (rc != 0)
+		goto fail;
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(write), 0);
+	if (rc != 0)
+		goto fail;
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ERRNO(EPERM), SCMP_SYS(open), 0);
+	if (rc != 0)
+		goto fail;
+
+	return ctx;
+
+fail:
+	seccomp_release(ctx);
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	int rc;
+	int fd;
+	uint64_t probes;
+	struct scmp_cache_stats stats;
+	scmp_filter_ctx ctx1 = NULL, ctx2 = NULL;
+
+	fd = open("/dev/null", O_WRONLY);
+	if (fd < 0)
+		return -1;
+
+	rc = seccomp_cache_stats(NULL);
+	if (rc != -EINVAL) {
+		rc = -2;
+		goto out;
+	}
+
+	seccomp_cache_flush();
+	rc = seccomp_cache_stats(&stats);
+	if (rc != 0)
+		goto out;
+	if (stats.hits != 0 || stats.misses != 0 || stats.entries != 0 ||
+	    stats.hash_probes != 0 || stats.hash_collisions != 0) {
+		rc = -3;
+		goto out;
+	}
+
+	ctx1 = filter_build();
+	ctx2 = filter_build();
+	if (ctx1 == NULL || ctx2 == NULL) {
+		rc = -ENOMEM;
+		goto out;
+	}
+
+	/* the first export generates the program */
+	rc = seccomp_export_bpf(ctx1, fd);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_cache_stats(&stats);
+	if (rc != 0)
+		goto out;
+	if (stats.hits != 0 || stats.misses != 1 || stats.entries != 1) {
+		rc = -4;
+		goto out;
+	}
+	/* generating the program probes the block hash table */
+	if (stats.hash_probes == 0 ||
+	    stats.hash_collisions > stats.hash_probes) {
+		rc = -5;
+		goto out;
+	}
+	probes = stats.hash_probes;
+
+	/* an identical filter in a different context is a hit */
+	rc = seccomp_export_bpf(ctx2, fd);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_cache_stats(&stats);
+	if (rc != 0)
+		goto out;
+	if (stats.hits != 1 || stats.misses != 1 || stats.entries != 1 ||
+	    stats.hash_probes != probes) {
+		rc = -6;
+		goto out;
+	}
+
+	/* changing a rule invalidates the key */
+	rc = seccomp_rule_add(ctx2, SCMP_ACT_ALLOW, SCMP_SYS(close), 0);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_export_bpf(ctx2, fd);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_cache_stats(&stats);
+	if (rc != 0)
+		goto out;
+	if (stats.hits != 1 || stats.misses != 2 || stats.entries != 2 ||
+	    stats.hash_probes <= probes) {
+		rc = -7;
+		goto out;
+	}
+
+	/* changing an attribute invalidates the key */
+	rc = seccomp_attr_set(ctx1, SCMP_FLTATR_CTL_OPTIMIZE, 2);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_export_bpf(ctx1, fd);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_cache_stats(&stats);
+	if (rc != 0)
+		goto out;
+	if (stats.hits != 1 || stats.misses != 3 || stats.entries != 3) {
+		rc = -8;
+		goto out;
+	}
+
+	/* the flush empties the cache */
+	seccomp_cache_flush();
+	rc = seccomp_export_bpf(ctx1, fd);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_cache_stats(&stats);
+	if (rc != 0)
+		goto out;
+	if (stats.hits != 0 || stats.misses != 1 || stats.entries != 1) {
+		rc = -9;
+		goto out;
+	}
+
+out:
+	seccomp_release(ctx1);
+	seccomp_release(ctx2);
+	close(fd);
+	return (rc < 0 ? -rc : rc);
+}
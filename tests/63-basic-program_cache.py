@@ -0,0 +1,82 @@
+#!/usr/bin/env python
+
+#
+# Seccomp Library test program
+#
+# Copyright (c) 2026 The libseccomp Authors
+# Author: The libseccomp Authors <libseccomp@googlegroups.com>
+#
+
+#
+# This library is free software; you can redistribute it and/or modify it
+# under the terms of version 2.1 of the GNU Lesser General Public License as
+# published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+# for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library; if not, see <http://www.gnu.org/licenses>.
+#
+
+import argparse
+import errno
+import sys
+
+import util
+
+from seccomp import *
+
+def filter_build():
+    f = SyscallFilter(KILL)
+    f.add_rule(ALLOW, "read", Arg(0, EQ, 0))
+    f.add_rule(ALLOW, "write")
+    f.add_rule(ERRNO(errno.EPERM), "open")
+    return f
+
+def test():
+    null = open("/dev/null", "w")
+
+    cache_flush()
+    if cache_stats() != (0, 0, 0):
+        raise RuntimeError("Failed flushing the program cache")
+
+    f1 = filter_build()
+    f2 = filter_build()
+
+    # the first export generates the program
+    f1.export_bpf(null)
+    if cache_stats() != (0, 1, 1):
+        raise RuntimeError("Failed caching the program")
+
+    # an identical filter in a different context is a hit
+    f2.export_bpf(null)
+    if cache_stats() != (1, 1, 1):
+        raise RuntimeError("Failed finding the cached program")
+
+    # changing a rule invalidates the key
+    f2.add_rule(ALLOW, "close")
+    f2.export_bpf(null)
+    if cache_stats() != (1, 2, 2):
+        raise RuntimeError("Failed invalidating the key on a rule change")
+
+    # changing an attribute invalidates the key
+    f1.set_attr(Attr.CTL_OPTIMIZE, 2)
+    f1.export_bpf(null)
+    if cache_stats() != (1, 3, 3):
+        raise RuntimeError("Failed invalidating the key on an attribute change")
+
+    # the flush empties the cache
+    cache_flush()
+    f1.export_bpf(null)
+    if cache_stats() != (0, 1, 1):
+        raise RuntimeError("Failed flushing the program cache")
+
+    null.close()
+
+test()
+
+# kate: syntax python;
+# kate: indent-mode python; space-indent on; indent-width 4; mixedindent off;
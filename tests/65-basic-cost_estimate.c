@@ -0,0 +1,124 @@
+/**
+ * Seccomp Library test program
+ *
+ * Copyright (c) 2026 The libseccomp Authors
+ * Author: The libseccomp Authors <libseccomp@googlegroups.com>
+ */
+
+/*
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of version 2.1 of the GNU Lesser General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses>.
+ */
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <seccomp.h>
+
+int main(int argc, char *argv[])
+{
+	int rc;
+	unsigned int iter;
+	struct scmp_cost *cost = NULL;
+	struct scmp_cost_entry *entry;
+	scmp_filter_ctx ctx = NULL;
+
+	ctx = seccomp_init(SCMP_ACT_KILL);
+	if (ctx == NULL)
+		return ENOMEM;
+
+	rc = seccomp_arch_remove(ctx, SCMP_ARCH_NATIVE);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_arch_add(ctx, SCMP_ARCH_X86_64);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_arch_add(ctx, SCMP_ARCH_AARCH64);
+	if (rc != 0)
+		goto out;
+
+	rc = seccomp_cost_estimate(ctx, NULL);
+	if (rc != -EINVAL) {
+		rc = -1;
+		goto out;
+	}
+
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(read), 0);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(write), 1,
+			      SCMP_A0(SCMP_CMP_EQ, STDOUT_FILENO));
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(close), 0);
+	if (rc != 0)
+		goto out;
+
+	rc = seccomp_cost_estimate(ctx, &cost);
+	if (rc != 0)
+		goto out;
+
+	/* two architectures, each with three syscalls */
+	if (cost->entry_cnt != 8) {
+		rc = -2;
+		goto out;
+	}
+	for (iter = 0; iter < cost->entry_cnt; iter++) {
+		entry = &cost->entries[iter];
+		if (entry->instr_min == 0 ||
+		    entry->instr_min > entry->instr_max ||
+		    entry->instr_max > cost->instr_cnt) {
+			rc = -3;
+			goto out;
+		}
+		if (entry->instr_min < cost->instr_min ||
+		    entry->instr_max > cost->instr_max) {
+			rc = -4;
+			goto out;
+		}
+	}
+	entry = &cost->entries[0];
+	if (entry->arch != SCMP_ARCH_X86_64 ||
+	    entry->syscall != __NR_SCMP_ERROR) {
+		rc = -5;
+		goto out;
+	}
+	entry = &cost->entries[4];
+	if (entry->arch != SCMP_ARCH_AARCH64 ||
+	    entry->syscall != __NR_SCMP_ERROR) {
+		rc = -6;
+		goto out;
+	}
+
+	/* x86_64: read(0), write(1), close(3) */
+	entry = &cost->entries[1];
+	if (entry->syscall != 0 || entry->instr_min != entry->instr_max) {
+		rc = -7;
+		goto out;
+	}
+	entry = &cost->entries[2];
+	if (entry->syscall != 1 || entry->instr_min == entry->instr_max) {
+		rc = -8;
+		goto out;
+	}
+	entry = &cost->entries[3];
+	if (entry->syscall != 3 || entry->instr_min != entry->instr_max) {
+		rc = -9;
+		goto out;
+	}
+
+	rc = 0;
+out:
+	seccomp_cost_free(cost);
+	seccomp_release(ctx);
+	return (rc < 0 ? -rc : rc);
+}
@@ -0,0 +1,65 @@
+#!/usr/bin/env python
+
+#
+# Seccomp Library test program
+#
+# Copyright (c) 2026 The libseccomp Authors
+# Author: The libseccomp Authors <libseccomp@googlegroups.com>
+#
+
+#
+# This library is free software; you can redistribute it and/or modify it
+# under the terms of version 2.1 of the GNU Lesser General Public License as
+# published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+# for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library; if not, see <http://www.gnu.org/licenses>.
+#
+
+import argparse
+import sys
+
+import util
+
+from seccomp import *
+
+def test():
+    f = SyscallFilter(KILL)
+    f.remove_arch(Arch())
+    f.add_arch(Arch("x86_64"))
+    f.add_arch(Arch("aarch64"))
+    f.add_rule(ALLOW, "read")
+    f.add_rule(ALLOW, "write", Arg(0, EQ, sys.stdout.fileno()))
+    f.add_rule(ALLOW, "close")
+
+    instr_cnt, instr_min, instr_max, entries = f.cost_estimate()
+
+    # two architectures, each with three syscalls
+    if len(entries) != 8:
+        raise RuntimeError("Failed estimating the cost of each syscall")
+    for arch, syscall, e_min, e_max in entries:
+        if e_min == 0 or e_min > e_max or e_max > instr_cnt:
+            raise RuntimeError("Invalid syscall cost")
+        if e_min < instr_min or e_max > instr_max:
+            raise RuntimeError("Invalid filter cost")
+    if entries[0][0:2] != (Arch.X86_64, -1) or \
+       entries[4][0:2] != (Arch.AARCH64, -1):
+        raise RuntimeError("Failed reporting the architecture totals")
+
+    # x86_64: read(0), write(1), close(3)
+    if entries[1][1] != 0 or entries[1][2] != entries[1][3]:
+        raise RuntimeError("Invalid read() cost")
+    if entries[2][1] != 1 or entries[2][2] == entries[2][3]:
+        raise RuntimeError("Invalid write() cost")
+    if entries[3][1] != 3 or entries[3][2] != entries[3][3]:
+        raise RuntimeError("Invalid close() cost")
+
+test()
+
+# kate: syntax python;
+# kate: indent-mode python; space-indent on; indent-width 4; mixedindent off;
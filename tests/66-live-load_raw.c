@@ -0,0 +1,123 @@
+/**
+ * Seccomp Library test program
+ *
+ * Copyright (c) 2026 The libseccomp Authors
+ * Author: The libseccomp Authors <libseccomp@googlegroups.com>
+ */
+
+/*
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of version 2.1 of the GNU Lesser General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses>.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <seccomp.h>
+
+#include "util.h"
+
+static unsigned char buf[64 * 1024];
+
+int main(int argc, char *argv[])
+{
+	int rc;
+	ssize_t len;
+	FILE *file = NULL;
+	scmp_filter_ctx ctx = NULL;
+
+	rc = util_action_parse(argv[1]);
+	if (rc != SCMP_ACT_ALLOW) {
+		rc = 1;
+		goto out;
+	}
+
+	rc = util_trap_install();
+	if (rc != 0)
+		goto out;
+
+	ctx = seccomp_init(SCMP_ACT_TRAP);
+	if (ctx == NULL)
+		return ENOMEM;
+
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(open), 0);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(openat), 0);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(write), 0);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(close), 0);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(rt_sigreturn), 0);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(exit_group), 0);
+	if (rc != 0)
+		goto out;
+
+	/* build the program ahead of time */
+	file = tmpfile();
+	if (file == NULL) {
+		rc = -errno;
+		goto out;
+	}
+	rc = seccomp_export_bpf(ctx, fileno(file));
+	if (rc != 0)
+		goto out;
+	seccomp_release(ctx);
+	ctx = NULL;
+	len = pread(fileno(file), buf, sizeof(buf), 0);
+	if (len <= 0) {
+		rc = -EIO;
+		goto out;
+	}
+	fclose(file);
+	file = NULL;
+
+	/* invalid programs and flags */
+	rc = seccomp_load_raw(NULL, len, 0);
+	if (rc != -EINVAL) {
+		rc = -1;
+		goto out;
+	}
+	rc = seccomp_load_raw(buf, len - 1, 0);
+	if (rc != -EINVAL) {
+		rc = -1;
+		goto out;
+	}
+	rc = seccomp_load_raw(buf, len, 0x80000000);
+	if (rc != -EINVAL) {
+		rc = -1;
+		goto out;
+	}
+
+	rc = seccomp_load_raw(buf, len, SCMP_LOAD_NNP);
+	if (rc != 0)
+		goto out;
+
+	rc = util_file_write("/dev/null");
+	if (rc != 0)
+		goto out;
+
+	rc = 160;
+
+out:
+	if (file != NULL)
+		fclose(file);
+	seccomp_release(ctx);
+	return (rc < 0 ? -rc : rc);
+}
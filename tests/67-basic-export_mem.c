@@ -0,0 +1,159 @@
+/**
+ * Seccomp Library test program
+ *
+ * Copyright (c) 2026 The libseccomp Authors
+ * Author: The libseccomp Authors <libseccomp@googlegroups.com>
+ */
+
+/*
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of version 2.1 of the GNU Lesser General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses>.
+ */
+
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <seccomp.h>
+
+/**
+ * Compare the in-memory export with the file export
+ * @param ctx the filter context
+ * @param bpf export BPF if true, PFC otherwise
+ *
+ * Returns zero if both exports are identical, negative values otherwise.
+ *
+ */
+static int export_cmp(scmp_filter_ctx ctx, int bpf)
+{
+	int rc;
+	size_t len, len_small;
+	ssize_t len_file;
+	char *buf = NULL, *buf_file = NULL;
+	FILE *file = NULL;
+
+	/* query the size */
+	len = 0;
+	rc = (bpf ? seccomp_export_bpf_mem(ctx, NULL, &len) :
+		    seccomp_export_pfc_mem(ctx, NULL, &len));
+	if (rc != 0)
+		goto out;
+	if (len == 0) {
+		rc = -1;
+		goto out;
+	}
+
+	buf = malloc(len);
+	buf_file = malloc(len + 1);
+	if (buf == NULL || buf_file == NULL) {
+		rc = -ENOMEM;
+		goto out;
+	}
+
+	/* a short buffer must be rejected and the size reported */
+	len_small = len - 1;
+	rc = (bpf ? seccomp_export_bpf_mem(ctx, buf, &len_small) :
+		    seccomp_export_pfc_mem(ctx, buf, &len_small));
+	if (rc != -ERANGE || len_small != len) {
+		rc = -2;
+		goto out;
+	}
+
+	rc = (bpf ? seccomp_export_bpf_mem(ctx, buf, &len) :
+		    seccomp_export_pfc_mem(ctx, buf, &len));
+	if (rc != 0)
+		goto out;
+
+	file = tmpfile();
+	if (file == NULL) {
+		rc = -errno;
+		goto out;
+	}
+	rc = (bpf ? seccomp_export_bpf(ctx, fileno(file)) :
+		    seccomp_export_pfc(ctx, fileno(file)));
+	if (rc != 0)
+		goto out;
+	len_file = pread(fileno(file), buf_file, len + 1, 0);
+	if (len_file < 0 || (size_t)len_file != len ||
+	    memcmp(buf, buf_file, len) != 0) {
+		rc = -3;
+		goto out;
+	}
+
+	rc = 0;
+out:
+	if (file != NULL)
+		fclose(file);
+	free(buf);
+	free(buf_file);
+	return rc;
+}
+
+int main(int argc, char *argv[])
+{
+	int rc;
+	size_t len;
+	scmp_filter_ctx ctx = NULL;
+
+	ctx = seccomp_init(SCMP_ACT_KILL);
+	if (ctx == NULL)
+		return ENOMEM;
+
+	rc = seccomp_export_bpf_mem(ctx, NULL, NULL);
+	if (rc != -EINVAL) {
+		rc = -1;
+		goto out;
+	}
+	rc = seccomp_export_pfc_mem(ctx, NULL, NULL);
+	if (rc != -EINVAL) {
+		rc = -1;
+		goto out;
+	}
+
+	rc = seccomp_arch_add(ctx, SCMP_ARCH_X86);
+	if (rc != 0 && rc != -EEXIST)
+		goto out;
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(read), 0);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(write), 1,
+			      SCMP_A0(SCMP_CMP_EQ, STDOUT_FILENO));
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ERRNO(EPERM), SCMP_SYS(close), 0);
+	if (rc != 0)
+		goto out;
+
+	rc = export_cmp(ctx, 1);
+	if (rc != 0)
+		goto out;
+	rc = export_cmp(ctx, 0);
+	if (rc != 0)
+		goto out;
+
+	/* a BPF program is a whole number of instructions */
+	rc = seccomp_export_bpf_mem(ctx, NULL, &len);
+	if (rc != 0)
+		goto out;
+	if (len % 8 != 0) {
+		rc = -4;
+		goto out;
+	}
+
+	rc = 0;
+out:
+	seccomp_release(ctx);
+	return (rc < 0 ? -rc : rc);
+}
@@ -0,0 +1,58 @@
+#!/usr/bin/env python
+
+#
+# Seccomp Library test program
+#
+# Copyright (c) 2026 The libseccomp Authors
+# Author: The libseccomp Authors <libseccomp@googlegroups.com>
+#
+
+#
+# This library is free software; you can redistribute it and/or modify it
+# under the terms of version 2.1 of the GNU Lesser General Public License as
+# published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+# for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library; if not, see <http://www.gnu.org/licenses>.
+#
+
+import argparse
+import os
+import sys
+import tempfile
+
+import util
+
+from seccomp import *
+
+def test():
+    f = SyscallFilter(KILL)
+    f.add_rule(ALLOW, "read")
+    f.add_rule(ALLOW, "write", Arg(0, EQ, sys.stdout.fileno()))
+    f.add_rule(ERRNO(1), "close")
+
+    bpf = f.export_bpf_mem()
+    if len(bpf) == 0 or len(bpf) % 8 != 0:
+        raise RuntimeError("Invalid BPF program length")
+    with tempfile.TemporaryFile() as tmp:
+        f.export_bpf(tmp)
+        tmp.seek(0)
+        if tmp.read() != bpf:
+            raise RuntimeError("BPF memory export differs from file export")
+
+    pfc = f.export_pfc_mem()
+    with tempfile.TemporaryFile() as tmp:
+        f.export_pfc(tmp)
+        tmp.seek(0)
+        if tmp.read().decode() != pfc:
+            raise RuntimeError("PFC memory export differs from file export")
+
+test()
+
+# kate: syntax python;
+# kate: indent-mode python; space-indent on; indent-width 4; mixedindent off;
@@ -0,0 +1,123 @@
+/**
+ * Seccomp Library test program
+ *
+ * Copyright (c) 2026 The libseccomp Authors
+ * Author: The libseccomp Authors <libseccomp@googlegroups.com>
+ */
+
+/*
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of version 2.1 of the GNU Lesser General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses>.
+ */
+
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <seccomp.h>
+
+static char buf_a[64 * 1024], buf_b[64 * 1024];
+
+int main(int argc, char *argv[])
+{
+	int rc;
+	size_t len_a, len_b;
+	scmp_filter_ctx ctx_a = NULL, ctx_b = NULL;
+	struct scmp_arg_cmp arg_fd = SCMP_A0(SCMP_CMP_EQ, STDOUT_FILENO);
+	struct scmp_rule rules[] = {
+		{ SCMP_ACT_ALLOW, SCMP_SYS(read), 0, NULL, 0 },
+		{ SCMP_ACT_ALLOW, SCMP_SYS(write), 1, &arg_fd, 0 },
+		{ SCMP_ACT_ERRNO(EPERM), SCMP_SYS(close), 0, NULL, 0 },
+	};
+	struct scmp_rule rules_bad[] = {
+		{ SCMP_ACT_ALLOW, SCMP_SYS(open), 0, NULL, 0 },
+		{ SCMP_ACT_KILL, SCMP_SYS(openat), 0, NULL, 0 },
+		{ SCMP_ACT_ALLOW, SCMP_SYS(fstat), 1, NULL, 0 },
+	};
+
+	ctx_a = seccomp_init(SCMP_ACT_KILL);
+	if (ctx_a == NULL)
+		return ENOMEM;
+	ctx_b = seccomp_init(SCMP_ACT_KILL);
+	if (ctx_b == NULL) {
+		rc = ENOMEM;
+		goto out;
+	}
+
+	/* the batch must match the rules added one at a time */
+	rc = seccomp_rule_add_batch(ctx_a, rules, 3);
+	if (rc != 0)
+		goto out;
+	if (rules[0].rc != 0 || rules[1].rc != 0 || rules[2].rc != 0) {
+		rc = -1;
+		goto out;
+	}
+	rc = seccomp_rule_add(ctx_b, SCMP_ACT_ALLOW, SCMP_SYS(read), 0);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx_b, SCMP_ACT_ALLOW, SCMP_SYS(write), 1,
+			      SCMP_A0(SCMP_CMP_EQ, STDOUT_FILENO));
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx_b, SCMP_ACT_ERRNO(EPERM), SCMP_SYS(close), 0);
+	if (rc != 0)
+		goto out;
+
+	len_a = sizeof(buf_a);
+	rc = seccomp_export_bpf_mem(ctx_a, buf_a, &len_a);
+	if (rc != 0)
+		goto out;
+	len_b = sizeof(buf_b);
+	rc = seccomp_export_bpf_mem(ctx_b, buf_b, &len_b);
+	if (rc != 0)
+		goto out;
+	if (len_a != len_b || memcmp(buf_a, buf_b, len_a) != 0) {
+		rc = -2;
+		goto out;
+	}
+
+	/* a failed batch must report the bad rules and change nothing */
+	rc = seccomp_rule_add_batch(ctx_a, rules_bad, 3);
+	if (rc != -EACCES) {
+		rc = -3;
+		goto out;
+	}
+	if (rules_bad[0].rc != 0 ||
+	    rules_bad[1].rc != -EACCES || rules_bad[2].rc != -EINVAL) {
+		rc = -4;
+		goto out;
+	}
+	len_b = sizeof(buf_b);
+	rc = seccomp_export_bpf_mem(ctx_a, buf_b, &len_b);
+	if (rc != 0)
+		goto out;
+	if (len_a != len_b || memcmp(buf_a, buf_b, len_a) != 0) {
+		rc = -5;
+		goto out;
+	}
+
+	rc = seccomp_rule_add_batch(ctx_a, NULL, 1);
+	if (rc != -EINVAL) {
+		rc = -6;
+		goto out;
+	}
+	rc = seccomp_rule_add_batch(ctx_a, NULL, 0);
+	if (rc != 0)
+		goto out;
+
+	rc = 0;
+out:
+	seccomp_release(ctx_a);
+	seccomp_release(ctx_b);
+	return (rc < 0 ? -rc : rc);
+}
@@ -0,0 +1,56 @@
+#!/usr/bin/env python
+
+#
+# Seccomp Library test program
+#
+# Copyright (c) 2026 The libseccomp Authors
+# Author: The libseccomp Authors <libseccomp@googlegroups.com>
+#
+
+#
+# This library is free software; you can redistribute it and/or modify it
+# under the terms of version 2.1 of the GNU Lesser General Public License as
+# published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+# for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library; if not, see <http://www.gnu.org/licenses>.
+#
+
+import argparse
+import sys
+
+import util
+
+from seccomp import *
+
+def test():
+    f = SyscallFilter(KILL)
+    f.add_rules([(ALLOW, "read", []),
+                 (ALLOW, "write", [Arg(0, EQ, sys.stdout.fileno())]),
+                 (ERRNO(1), "close", [])])
+    g = SyscallFilter(KILL)
+    g.add_rule(ALLOW, "read")
+    g.add_rule(ALLOW, "write", Arg(0, EQ, sys.stdout.fileno()))
+    g.add_rule(ERRNO(1), "close")
+    bpf = f.export_bpf_mem()
+    if bpf != g.export_bpf_mem():
+        raise RuntimeError("Batch rules differ from individual rules")
+
+    try:
+        f.add_rules([(ALLOW, "open", []), (KILL, "openat", [])])
+    except RuntimeError:
+        pass
+    else:
+        raise RuntimeError("Failed to reject a bad rule")
+    if bpf != f.export_bpf_mem():
+        raise RuntimeError("Failed batch modified the filter")
+
+test()
+
+# kate: syntax python;
+# kate: indent-mode python; space-indent on; indent-width 4; mixedindent off;
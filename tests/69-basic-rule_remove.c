@@ -0,0 +1,298 @@
+/**
+ * Seccomp Library test program
+ *
+ * Copyright (c) 2026 The libseccomp Authors
+ * Author: The libseccomp Authors <libseccomp@googlegroups.com>
+ */
+
+/*
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of version 2.1 of the GNU Lesser General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses>.
+ */
+
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <seccomp.h>
+
+static char buf_a[64 * 1024], buf_b[64 * 1024];
+
+/**
+ * Setup the architectures and syscall priorities of a filter
+ * @param ctx the filter context
+ *
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int filter_setup(scmp_filter_ctx ctx)
+{
+	int rc;
+
+	rc = seccomp_arch_remove(ctx, SCMP_ARCH_NATIVE);
+	if (rc != 0)
+		return rc;
+	rc = seccomp_arch_add(ctx, SCMP_ARCH_X86_64);
+	if (rc != 0)
+		return rc;
+	/* x86 multiplexes the socket syscalls */
+	rc = seccomp_arch_add(ctx, SCMP_ARCH_X86);
+	if (rc != 0)
+		return rc;
+	rc = seccomp_arch_add(ctx, SCMP_ARCH_AARCH64);
+	if (rc != 0)
+		return rc;
+
+	return seccomp_syscall_priority(ctx, SCMP_SYS(read), 100);
+}
+
+/**
+ * Compare two filters
+ * @param ctx_a the first filter context
+ * @param ctx_b the second filter context
+ *
+ * Returns zero if the filters generate the same BPF, negative values
+ * otherwise.
+ *
+ */
+static int filter_cmp(scmp_filter_ctx ctx_a, scmp_filter_ctx ctx_b)
+{
+	int rc;
+	size_t len_a = sizeof(buf_a), len_b = sizeof(buf_b);
+
+	rc = seccomp_export_bpf_mem(ctx_a, buf_a, &len_a);
+	if (rc != 0)
+		return rc;
+	rc = seccomp_export_bpf_mem(ctx_b, buf_b, &len_b);
+	if (rc != 0)
+		return rc;
+	if (len_a != len_b || memcmp(buf_a, buf_b, len_a) != 0)
+		return -1;
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	int rc;
+	scmp_filter_ctx ctx_a = NULL, ctx_b = NULL;
+
+	ctx_a = seccomp_init(SCMP_ACT_KILL);
+	if (ctx_a == NULL)
+		return ENOMEM;
+	ctx_b = seccomp_init(SCMP_ACT_KILL);
+	if (ctx_b == NULL) {
+		rc = ENOMEM;
+		goto out;
+	}
+	rc = filter_setup(ctx_a);
+	if (rc != 0)
+		goto out;
+	rc = filter_setup(ctx_b);
+	if (rc != 0)
+		goto out;
+
+	/* build a filter and remove some of its rules */
+	rc = seccomp_rule_add(ctx_a, SCMP_ACT_ALLOW, SCMP_SYS(read), 1,
+			      SCMP_A0(SCMP_CMP_EQ, STDIN_FILENO));
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx_a, SCMP_ACT_ALLOW, SCMP_SYS(read), 0);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx_a, SCMP_ACT_ALLOW, SCMP_SYS(socket), 1,
+			      SCMP_A0(SCMP_CMP_EQ, AF_INET));
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx_a, SCMP_ACT_ALLOW, SCMP_SYS(socket), 1,
+			      SCMP_A0(SCMP_CMP_EQ, AF_UNIX));
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx_a, SCMP_ACT_ERRNO(EPERM), SCMP_SYS(close), 0);
+	if (rc != 0)
+		goto out;
+	/* rules which share the start of their argument chains */
+	rc = seccomp_rule_add(ctx_a, SCMP_ACT_ALLOW, SCMP_SYS(dup3), 2,
+			      SCMP_A0(SCMP_CMP_EQ, 1), SCMP_A1(SCMP_CMP_EQ, 2));
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx_a, SCMP_ACT_ALLOW, SCMP_SYS(dup3), 2,
+			      SCMP_A0(SCMP_CMP_EQ, 1), SCMP_A1(SCMP_CMP_EQ, 3));
+	if (rc != 0)
+		goto out;
+	/* rules which make other rules redundant */
+	rc = seccomp_rule_add(ctx_a, SCMP_ACT_ALLOW, SCMP_SYS(fcntl), 2,
+			      SCMP_A0(SCMP_CMP_EQ, 3), SCMP_A1(SCMP_CMP_EQ, 1));
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx_a, SCMP_ACT_ALLOW, SCMP_SYS(fcntl), 1,
+			      SCMP_A1(SCMP_CMP_EQ, 1));
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx_a, SCMP_ACT_ALLOW, SCMP_SYS(fcntl), 1,
+			      SCMP_A1(SCMP_CMP_EQ, 2));
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx_a, SCMP_ACT_ALLOW, SCMP_SYS(fcntl), 2,
+			      SCMP_A0(SCMP_CMP_EQ, 4), SCMP_A1(SCMP_CMP_EQ, 2));
+	if (rc != 0)
+		goto out;
+	/* rules with different actions and 64-bit comparisons */
+	rc = seccomp_rule_add(ctx_a, SCMP_ACT_ERRNO(EPERM), SCMP_SYS(lseek), 1,
+			      SCMP_A1(SCMP_CMP_GT, 0x100000000ULL));
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx_a, SCMP_ACT_ALLOW, SCMP_SYS(lseek), 2,
+			      SCMP_A0(SCMP_CMP_EQ, 0), SCMP_A1(SCMP_CMP_LT, 16));
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx_a, SCMP_ACT_ALLOW, SCMP_SYS(lseek), 1,
+			      SCMP_A2(SCMP_CMP_EQ, SEEK_SET));
+	if (rc != 0)
+		goto out;
+
+	rc = seccomp_rule_remove(ctx_a, SCMP_ACT_ALLOW, SCMP_SYS(read), 0);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_remove(ctx_a, SCMP_ACT_ALLOW, SCMP_SYS(socket), 1,
+				 SCMP_A0(SCMP_CMP_EQ, AF_UNIX));
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_remove(ctx_a, SCMP_ACT_ALLOW, SCMP_SYS(dup3), 2,
+				 SCMP_A0(SCMP_CMP_EQ, 1),
+				 SCMP_A1(SCMP_CMP_EQ, 2));
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_remove(ctx_a, SCMP_ACT_ALLOW, SCMP_SYS(fcntl), 1,
+				 SCMP_A1(SCMP_CMP_EQ, 1));
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_remove(ctx_a, SCMP_ACT_ALLOW, SCMP_SYS(fcntl), 1,
+				 SCMP_A1(SCMP_CMP_EQ, 2));
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_remove(ctx_a, SCMP_ACT_ERRNO(EPERM), SCMP_SYS(lseek),
+				 1, SCMP_A1(SCMP_CMP_GT, 0x100000000ULL));
+	if (rc != 0)
+		goto out;
+
+	/* build the same filter without the removed rules */
+	rc = seccomp_rule_add(ctx_b, SCMP_ACT_ALLOW, SCMP_SYS(read), 1,
+			      SCMP_A0(SCMP_CMP_EQ, STDIN_FILENO));
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx_b, SCMP_ACT_ALLOW, SCMP_SYS(socket), 1,
+			      SCMP_A0(SCMP_CMP_EQ, AF_INET));
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx_b, SCMP_ACT_ERRNO(EPERM), SCMP_SYS(close), 0);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx_b, SCMP_ACT_ALLOW, SCMP_SYS(dup3), 2,
+			      SCMP_A0(SCMP_CMP_EQ, 1), SCMP_A1(SCMP_CMP_EQ, 3));
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx_b, SCMP_ACT_ALLOW, SCMP_SYS(fcntl), 2,
+			      SCMP_A0(SCMP_CMP_EQ, 3), SCMP_A1(SCMP_CMP_EQ, 1));
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx_b, SCMP_ACT_ALLOW, SCMP_SYS(fcntl), 2,
+			      SCMP_A0(SCMP_CMP_EQ, 4), SCMP_A1(SCMP_CMP_EQ, 2));
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx_b, SCMP_ACT_ALLOW, SCMP_SYS(lseek), 2,
+			      SCMP_A0(SCMP_CMP_EQ, 0), SCMP_A1(SCMP_CMP_LT, 16));
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx_b, SCMP_ACT_ALLOW, SCMP_SYS(lseek), 1,
+			      SCMP_A2(SCMP_CMP_EQ, SEEK_SET));
+	if (rc != 0)
+		goto out;
+
+	rc = filter_cmp(ctx_a, ctx_b);
+	if (rc != 0) {
+		rc = -1;
+		goto out;
+	}
+
+	/* removing a rule that doesn't exist must fail */
+	rc = seccomp_rule_remove(ctx_a, SCMP_ACT_ALLOW, SCMP_SYS(read), 0);
+	if (rc != -ENOENT) {
+		rc = -2;
+		goto out;
+	}
+	rc = seccomp_rule_remove(ctx_a, SCMP_ACT_ALLOW, SCMP_SYS(close), 0);
+	if (rc != -ENOENT) {
+		rc = -3;
+		goto out;
+	}
+
+	/* the action is checked just like when adding a rule */
+	rc = seccomp_rule_remove(ctx_a, SCMP_ACT_ERRNO(0xffff),
+				 SCMP_SYS(close), 0);
+	if (rc != -EINVAL) {
+		rc = -4;
+		goto out;
+	}
+	rc = seccomp_rule_remove(ctx_a, SCMP_ACT_KILL, SCMP_SYS(close), 0);
+	if (rc != -EACCES) {
+		rc = -5;
+		goto out;
+	}
+
+	/* the filter must still be usable after the removal */
+	rc = seccomp_rule_add(ctx_a, SCMP_ACT_ALLOW, SCMP_SYS(write), 0);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx_b, SCMP_ACT_ALLOW, SCMP_SYS(write), 0);
+	if (rc != 0)
+		goto out;
+	rc = filter_cmp(ctx_a, ctx_b);
+	if (rc != 0) {
+		rc = -6;
+		goto out;
+	}
+
+	/* a failed rule add rolls back to the shadow transaction, which must
+	 * track both the removed and the added rules */
+	rc = seccomp_rule_remove(ctx_a, SCMP_ACT_ALLOW, SCMP_SYS(write), 0);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_remove(ctx_b, SCMP_ACT_ALLOW, SCMP_SYS(write), 0);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx_a, SCMP_ACT_ALLOW, SCMP_SYS(getpid), 0);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx_b, SCMP_ACT_ALLOW, SCMP_SYS(getpid), 0);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx_a, SCMP_ACT_ERRNO(EPERM), SCMP_SYS(dup3), 2,
+			      SCMP_A0(SCMP_CMP_EQ, 1), SCMP_A1(SCMP_CMP_EQ, 3));
+	if (rc != -EEXIST) {
+		rc = -7;
+		goto out;
+	}
+	rc = filter_cmp(ctx_a, ctx_b);
+	if (rc != 0) {
+		rc = -8;
+		goto out;
+	}
+
+	rc = 0;
+out:
+	seccomp_release(ctx_a);
+	seccomp_release(ctx_b);
+	return (rc < 0 ? -rc : rc);
+}
@@ -0,0 +1,53 @@
+#!/usr/bin/env python
+
+#
+# Seccomp Library test program
+#
+# Copyright (c) 2026 The libseccomp Authors
+# Author: The libseccomp Authors <libseccomp@googlegroups.com>
+#
+
+#
+# This library is free software; you can redistribute it and/or modify it
+# under the terms of version 2.1 of the GNU Lesser General Public License as
+# published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+# for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library; if not, see <http://www.gnu.org/licenses>.
+#
+
+import argparse
+import sys
+
+import util
+
+from seccomp import *
+
+def test():
+    f = SyscallFilter(KILL)
+    f.add_rule(ALLOW, "read", Arg(0, EQ, sys.stdin.fileno()))
+    f.add_rule(ALLOW, "read")
+    f.add_rule(ERRNO(1), "close")
+    f.remove_rule(ALLOW, "read")
+    g = SyscallFilter(KILL)
+    g.add_rule(ALLOW, "read", Arg(0, EQ, sys.stdin.fileno()))
+    g.add_rule(ERRNO(1), "close")
+    if f.export_bpf_mem() != g.export_bpf_mem():
+        raise RuntimeError("Failed removing the rule")
+
+    try:
+        f.remove_rule(ALLOW, "read")
+    except ValueError:
+        pass
+    else:
+        raise RuntimeError("Failed to reject a missing rule")
+
+test()
+
+# kate: syntax python;
+# kate: indent-mode python; space-indent on; indent-width 4; mixedindent off;
@@ -0,0 +1,333 @@
+/**
+ * Seccomp Library test program
+ *
+ * Copyright (c) 2026 The libseccomp Authors
+ * Author: The libseccomp Authors <libseccomp@googlegroups.com>
+ */
+
+/*
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of version 2.1 of the GNU Lesser General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses>.
+ */
+
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <seccomp.h>
+
+#define THREAD_CNT	8
+#define BUF_SIZE	(64 * 1024)
+
+static char buf_a[BUF_SIZE], buf_b[BUF_SIZE];
+
+struct variant {
+	scmp_filter_ctx base;
+	int syscall;
+	char *bpf;
+	size_t bpf_len;
+	int rc;
+};
+
+static pthread_barrier_t barrier;
+
+/**
+ * Build the base filter
+ *
+ * Returns a filter context on success, NULL on failure.
+ *
+ */
+static scmp_filter_ctx filter_base(void)
+{
+	int rc;
+	scmp_filter_ctx ctx;
+
+	ctx = seccomp_init(SCMP_ACT_KILL);
+	if (ctx == NULL)
+		return NULL;
+
+	rc = seccomp_arch_remove(ctx, SCMP_ARCH_NATIVE);
+	if (rc != 0)
+		goto fail;
+	rc = seccomp_arch_add(ctx, SCMP_ARCH_X86_64);
+	if (rc != 0)
+		goto fail;
+	rc = seccomp_arch_add(ctx, SCMP_ARCH_X86);
+	if (rc != 0)
+		goto fail;
+	rc = seccomp_arch_add(ctx, SCMP_ARCH_AARCH64);
+	if (rc != 0)
+		goto fail;
+
+	rc = seccomp_syscall_priority(ctx, SCMP_SYS(read), 100);
+	if (rc != 0)
+		goto fail;
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(read), 1,
+			      SCMP_A0(SCMP_CMP_EQ, STDIN_FILENO));
+	if (rc != 0)
+		goto fail;
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(write), 1,
+			      SCMP_A0(SCMP_CMP_EQ, STDOUT_FILENO));
+	if (rc != 0)
+		goto fail;
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ERRNO(EPERM), SCMP_SYS(close), 0);
+	if (rc != 0)
+		goto fail;
+
+	return ctx;
+
+fail:
+	seccomp_release(ctx);
+	return NULL;
+}
+
+/**
+ * Compare two filters
+ * @param ctx_a the first filter context
+ * @param ctx_b the second filter context
+ *
+ * Returns zero if the filters generate the same BPF, negative values
+ * otherwise.
+ *
+ */
+static int filter_cmp(scmp_filter_ctx ctx_a, scmp_filter_ctx ctx_b)
+{
+	int rc;
+	size_t len_a = sizeof(buf_a), len_b = sizeof(buf_b);
+
+	rc = seccomp_export_bpf_mem(ctx_a, buf_a, &len_a);
+	if (rc != 0)
+		return rc;
+	rc = seccomp_export_bpf_mem(ctx_b, buf_b, &len_b);
+	if (rc != 0)
+		return rc;
+	if (len_a != len_b || memcmp(buf_a, buf_b, len_a) != 0)
+		return -1;
+
+	return 0;
+}
+
+/**
+ * Build a variant of a base filter
+ * @param base the base filter context
+ * @param syscall the syscall allowed by the variant
+ *
+ * Returns a filter context on success, NULL on failure.
+ *
+ */
+static scmp_filter_ctx filter_variant(scmp_filter_ctx base, int syscall)
+{
+	scmp_filter_ctx ctx;
+
+	ctx = seccomp_dup(base);
+	if (ctx == NULL)
+		return NULL;
+	if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, syscall, 0) != 0 ||
+	    seccomp_rule_remove(ctx, SCMP_ACT_ERRNO(EPERM),
+				SCMP_SYS(close), 0) != 0) {
+		seccomp_release(ctx);
+		return NULL;
+	}
+
+	return ctx;
+}
+
+/**
+ * Derive a variant of the base filter in its own thread
+ * @param arg the variant
+ *
+ */
+static void *variant_main(void *arg)
+{
+	struct variant *v = arg;
+	scmp_filter_ctx ctx;
+	size_t len = BUF_SIZE;
+	char *buf;
+
+	buf = malloc(BUF_SIZE);
+	if (buf == NULL) {
+		v->rc = -ENOMEM;
+		return NULL;
+	}
+
+	/* start all of the threads at once to race on the shared filters */
+	pthread_barrier_wait(&barrier);
+
+	v->rc = -ENOMEM;
+	ctx = filter_variant(v->base, v->syscall);
+	if (ctx != NULL) {
+		v->rc = seccomp_export_bpf_mem(ctx, buf, &len);
+		seccomp_release(ctx);
+	}
+	if (v->rc == 0 &&
+	    (len != v->bpf_len || memcmp(buf, v->bpf, len) != 0))
+		v->rc = -EFAULT;
+
+	free(buf);
+	return NULL;
+}
+
+/**
+ * Derive variants of a base filter concurrently
+ *
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int filter_threads(void)
+{
+	int rc = 0;
+	unsigned int iter;
+	scmp_filter_ctx base, ctx;
+	struct variant v[THREAD_CNT];
+	pthread_t threads[THREAD_CNT];
+
+	memset(v, 0, sizeof(v));
+	base = filter_base();
+	if (base == NULL)
+		return -ENOMEM;
+
+	/* generate the expected filters up front */
+	for (iter = 0; iter < THREAD_CNT && rc == 0; iter++) {
+		v[iter].base = base;
+		v[iter].syscall = SCMP_SYS(getpid) + iter;
+		v[iter].bpf_len = BUF_SIZE;
+		v[iter].bpf = malloc(BUF_SIZE);
+		ctx = filter_variant(base, v[iter].syscall);
+		if (v[iter].bpf == NULL || ctx == NULL)
+			rc = -ENOMEM;
+		else
+			rc = seccomp_export_bpf_mem(ctx, v[iter].bpf,
+						    &v[iter].bpf_len);
+		seccomp_release(ctx);
+	}
+	if (rc != 0)
+		goto out;
+
+	rc = pthread_barrier_init(&barrier, NULL, THREAD_CNT);
+	if (rc != 0) {
+		rc = -rc;
+		goto out;
+	}
+	for (iter = 0; iter < THREAD_CNT; iter++) {
+		rc = pthread_create(&threads[iter], NULL,
+				    variant_main, &v[iter]);
+		if (rc != 0)
+			/* we can't safely continue without the barrier */
+			abort();
+	}
+	for (iter = 0; iter < THREAD_CNT; iter++) {
+		pthread_join(threads[iter], NULL);
+		if (v[iter].rc != 0 && rc == 0)
+			rc = v[iter].rc;
+	}
+	pthread_barrier_destroy(&barrier);
+
+out:
+	for (iter = 0; iter < THREAD_CNT; iter++)
+		free(v[iter].bpf);
+	seccomp_release(base);
+	return rc;
+}
+
+int main(int argc, char *argv[])
+{
+	int rc;
+	scmp_filter_ctx ctx = NULL, ctx_dup = NULL, ctx_ref = NULL;
+
+	ctx = filter_base();
+	if (ctx == NULL)
+		return ENOMEM;
+	ctx_ref = filter_base();
+	if (ctx_ref == NULL) {
+		rc = ENOMEM;
+		goto out;
+	}
+
+	/* an unmodified duplicate matches the original */
+	ctx_dup = seccomp_dup(ctx);
+	if (ctx_dup == NULL) {
+		rc = ENOMEM;
+		goto out;
+	}
+	rc = filter_cmp(ctx, ctx_dup);
+	if (rc != 0) {
+		rc = -1;
+		goto out;
+	}
+
+	/* modifying the duplicate leaves the original alone */
+	rc = seccomp_rule_add(ctx_dup, SCMP_ACT_ALLOW, SCMP_SYS(getpid), 0);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_syscall_priority(ctx_dup, SCMP_SYS(close), 200);
+	if (rc != 0)
+		goto out;
+	rc = filter_cmp(ctx, ctx_ref);
+	if (rc != 0) {
+		rc = -2;
+		goto out;
+	}
+
+	/* modifying the original leaves the duplicate alone */
+	rc = seccomp_rule_add(ctx_ref, SCMP_ACT_ALLOW, SCMP_SYS(getpid), 0);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_syscall_priority(ctx_ref, SCMP_SYS(close), 200);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_remove(ctx, SCMP_ACT_ERRNO(EPERM), SCMP_SYS(close), 0);
+	if (rc != 0)
+		goto out;
+	rc = filter_cmp(ctx_dup, ctx_ref);
+	if (rc != 0) {
+		rc = -3;
+		goto out;
+	}
+
+	/* the duplicate outlives the original */
+	seccomp_release(ctx);
+	ctx = seccomp_dup(ctx_dup);
+	if (ctx == NULL) {
+		rc = ENOMEM;
+		goto out;
+	}
+	seccomp_release(ctx_dup);
+	ctx_dup = NULL;
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(exit), 0);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx_ref, SCMP_ACT_ALLOW, SCMP_SYS(exit), 0);
+	if (rc != 0)
+		goto out;
+	rc = filter_cmp(ctx, ctx_ref);
+	if (rc != 0) {
+		rc = -4;
+		goto out;
+	}
+
+	/* variants of a base filter can be derived from different threads */
+	rc = filter_threads();
+	if (rc != 0) {
+		rc = -5;
+		goto out;
+	}
+
+	rc = 0;
+out:
+	seccomp_release(ctx);
+	seccomp_release(ctx_dup);
+	seccomp_release(ctx_ref);
+	return (rc < 0 ? -rc : rc);
+}
@@ -0,0 +1,51 @@
+#!/usr/bin/env python
+
+#
+# Seccomp Library test program
+#
+# Copyright (c) 2026 The libseccomp Authors
+# Author: The libseccomp Authors <libseccomp@googlegroups.com>
+#
+
+#
+# This library is free software; you can redistribute it and/or modify it
+# under the terms of version 2.1 of the GNU Lesser General Public License as
+# published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+# for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library; if not, see <http://www.gnu.org/licenses>.
+#
+
+import argparse
+import sys
+
+import util
+
+from seccomp import *
+
+def test():
+    f = SyscallFilter(KILL)
+    f.add_rule(ALLOW, "read", Arg(0, EQ, sys.stdin.fileno()))
+    f.add_rule(ERRNO(1), "close")
+    g = f.dup()
+    if f.export_bpf_mem() != g.export_bpf_mem():
+        raise RuntimeError("Failed duplicating the filter")
+    g.add_rule(ALLOW, "write")
+    h = SyscallFilter(KILL)
+    h.add_rule(ALLOW, "read", Arg(0, EQ, sys.stdin.fileno()))
+    h.add_rule(ERRNO(1), "close")
+    if f.export_bpf_mem() != h.export_bpf_mem():
+        raise RuntimeError("Failed isolating the original filter")
+    h.add_rule(ALLOW, "write")
+    if g.export_bpf_mem() != h.export_bpf_mem():
+        raise RuntimeError("Failed modifying the duplicate filter")
+
+test()
+
+# kate: syntax python;
+# kate: indent-mode python; space-indent on; indent-width 4; mixedindent off;
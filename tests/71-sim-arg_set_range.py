@@ -0,0 +1,55 @@
+#!/usr/bin/env python
+
+#
+# Seccomp Library test program
+#
+# Copyright (c) 2026 The libseccomp Authors
+# Author: The libseccomp Authors <libseccomp@googlegroups.com>
+#
+
+#
+# This library is free software; you can redistribute it and/or modify it
+# under the terms of version 2.1 of the GNU Lesser General Public License as
+# published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+# for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library; if not, see <http://www.gnu.org/licenses>.
+#
+
+import argparse
+import sys
+
+import util
+
+from seccomp import *
+
+def test(args):
+    f = SyscallFilter(KILL)
+    f.remove_arch(Arch())
+    f.add_arch(Arch("x86_64"))
+    f.add_arch(Arch("x86"))
+    f.add_arch(Arch("aarch64"))
+    # two runs of values, added out of order and with a duplicate
+    ioctl_set = []
+    for i in range(20):
+        ioctl_set += [0x5450 + i, 0x5401 + i]
+    ioctl_set.append(0x5401)
+    f.add_rule(ALLOW, "ioctl", Arg(1, IN_SET, ioctl_set))
+    f.add_rule(ALLOW, "socket", Arg(0, IN_SET, [16, 1, 10, 2]))
+    f.add_rule(ALLOW, "fcntl", Arg(0, EQ, 1), Arg(1, IN_SET, [3, 1, 2]))
+    f.add_rule(ALLOW, "read", Arg(0, IN_RANGE, 0, 2))
+    f.add_rule(ERRNO(1), "write", Arg(0, IN_RANGE, 10, 20))
+    f.add_rule(ALLOW, "write", Arg(0, IN_RANGE, 1, 2))
+    return f
+
+args = util.get_opt()
+ctx = test(args)
+util.filter_output(args, ctx)
+
+# kate: syntax python;
+# kate: indent-mode python; space-indent on; indent-width 4; mixedindent off;
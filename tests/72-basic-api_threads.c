@@ -0,0 +1,80 @@
+/**
+ * Seccomp Library test program
+ *
+ * Copyright (c) 2026 The libseccomp Authors
+ * Author: The libseccomp Authors <libseccomp@googlegroups.com>
+ */
+
+/*
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of version 2.1 of the GNU Lesser General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses>.
+ */
+
+
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <seccomp.h>
+
+#define THREAD_CNT	8
+
+static pthread_barrier_t barrier;
+
+static void *thread_main(void *arg)
+{
+	unsigned int *api = arg;
+	scmp_filter_ctx ctx;
+
+	/* start all of the threads at once to race the kernel probes */
+	pthread_barrier_wait(&barrier);
+
+	ctx = seccomp_init(SCMP_ACT_KILL);
+	if (ctx == NULL)
+		return NULL;
+	*api = seccomp_api_get();
+	seccomp_release(ctx);
+
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	int rc;
+	unsigned int iter;
+	unsigned int api[THREAD_CNT] = { 0 };
+	pthread_t threads[THREAD_CNT];
+
+	rc = pthread_barrier_init(&barrier, NULL, THREAD_CNT);
+	if (rc != 0)
+		return rc;
+
+	for (iter = 0; iter < THREAD_CNT; iter++) {
+		rc = pthread_create(&threads[iter], NULL,
+				    thread_main, &api[iter]);
+		if (rc != 0)
+			return rc;
+	}
+	for (iter = 0; iter < THREAD_CNT; iter++)
+		pthread_join(threads[iter], NULL);
+	pthread_barrier_destroy(&barrier);
+
+	/* every thread must see the same api level */
+	for (iter = 0; iter < THREAD_CNT; iter++) {
+		if (api[iter] < 1 || api[iter] != api[0])
+			return -1;
+	}
+	if (seccomp_api_get() != api[0])
+		return -2;
+
+	return 0;
+}
@@ -0,0 +1,59 @@
+#!/usr/bin/env python
+
+#
+# Seccomp Library test program
+#
+# Copyright (c) 2026 The libseccomp Authors
+# Author: The libseccomp Authors <libseccomp@googlegroups.com>
+#
+
+#
+# This library is free software; you can redistribute it and/or modify it
+# under the terms of version 2.1 of the GNU Lesser General Public License as
+# published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+# for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library; if not, see <http://www.gnu.org/licenses>.
+#
+
+import argparse
+import sys
+import threading
+
+import util
+
+from seccomp import *
+
+THREAD_CNT = 8
+
+def thread_main(barrier, api, idx):
+    # start all of the threads at once to race the kernel probes
+    barrier.wait()
+    f = SyscallFilter(KILL)
+    api[idx] = get_api()
+
+def test():
+    barrier = threading.Barrier(THREAD_CNT)
+    api = [0] * THREAD_CNT
+    threads = [threading.Thread(target=thread_main, args=(barrier, api, i))
+               for i in range(THREAD_CNT)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+
+    # every thread must see the same api level
+    if api[0] < 1 or api.count(api[0]) != THREAD_CNT:
+        raise RuntimeError("Threads saw different API levels")
+    if get_api() != api[0]:
+        raise RuntimeError("Failed getting the API level")
+
+test()
+
+# kate: syntax python;
+# kate: indent-mode python; space-indent on; indent-width 4; mixedindent off;
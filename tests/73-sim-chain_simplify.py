@@ -0,0 +1,52 @@
+#!/usr/bin/env python
+
+#
+# Seccomp Library test program
+#
+# Copyright (c) 2026 The libseccomp Authors
+# Author: The libseccomp Authors <libseccomp@googlegroups.com>
+#
+
+#
+# This library is free software; you can redistribute it and/or modify it
+# under the terms of version 2.1 of the GNU Lesser General Public License as
+# published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+# for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library; if not, see <http://www.gnu.org/licenses>.
+#
+import argparse
+import sys
+
+import util
+
+from seccomp import *
+
+def test(args):
+    f = SyscallFilter(KILL)
+    f.remove_arch(Arch())
+    f.add_arch(Arch("x86_64"))
+    f.add_arch(Arch("x86"))
+    f.add_arch(Arch("aarch64"))
+    # both branches take the same action
+    f.add_rule(ALLOW, "read", Arg(0, EQ, 1))
+    f.add_rule(ALLOW, "read", Arg(0, NE, 1))
+    # both branches lead to the same argument chain
+    f.add_rule(ERRNO(1), "fcntl", Arg(0, EQ, 1), Arg(1, EQ, 2))
+    f.add_rule(ERRNO(1), "fcntl", Arg(0, NE, 1), Arg(1, EQ, 2))
+    # comparisons which are always true
+    f.add_rule(ERRNO(2), "write", Arg(0, MASKED_EQ, 0, 0), Arg(1, EQ, 3))
+    f.add_rule(ALLOW, "close", Arg(0, GE, 0))
+    return f
+
+args = util.get_opt()
+ctx = test(args)
+util.filter_output(args, ctx)
+
+# kate: syntax python;
+# kate: indent-mode python; space-indent on; indent-width 4; mixedindent off;
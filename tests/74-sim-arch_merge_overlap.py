@@ -0,0 +1,70 @@
+#!/usr/bin/env python
+
+#
+# Seccomp Library test program
+#
+# Copyright (c) 2026 The libseccomp Authors
+# Author: The libseccomp Authors <libseccomp@googlegroups.com>
+#
+
+#
+# This library is free software; you can redistribute it and/or modify it
+# under the terms of version 2.1 of the GNU Lesser General Public License as
+# published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+# for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library; if not, see <http://www.gnu.org/licenses>.
+#
+import argparse
+import sys
+
+import util
+
+from seccomp import *
+
+def test(args):
+    f = SyscallFilter(KILL)
+    f.remove_arch(Arch())
+    f.add_arch(Arch("x86_64"))
+    f.add_arch(Arch("x86"))
+    f.add_rule(ALLOW, "read", Arg(0, EQ, 0))
+    f.add_rule(ALLOW, "write", Arg(0, EQ, 1))
+    f.add_rule(ALLOW, "close")
+    # a fragment with a conflicting rule can't be merged
+    frag = SyscallFilter(KILL)
+    frag.remove_arch(Arch())
+    frag.add_arch(Arch("x86_64"))
+    frag.add_rule(ALLOW, "open")
+    frag.add_rule(ERRNO(3), "write", Arg(0, EQ, 1))
+    try:
+        f.merge(frag)
+    except RuntimeError:
+        pass
+    else:
+        raise RuntimeError("Merged a conflicting filter")
+    # a fragment with overlapping architectures and syscalls
+    frag = SyscallFilter(KILL)
+    frag.remove_arch(Arch())
+    frag.add_arch(Arch("x86_64"))
+    frag.add_arch(Arch("x86"))
+    frag.add_arch(Arch("aarch64"))
+    frag.add_rule(ALLOW, "read", Arg(0, EQ, 0))
+    frag.add_rule(ALLOW, "write", Arg(0, EQ, 2))
+    frag.add_rule(ERRNO(1), "openat", Arg(2, MASKED_EQ, 0x3, 0x1))
+    frag.add_rule(ALLOW, "socket")
+    f.merge(frag)
+    # rules added after the merge
+    f.add_rule(ERRNO(2), "openat", Arg(2, MASKED_EQ, 0x3, 0x2))
+    return f
+
+args = util.get_opt()
+ctx = test(args)
+util.filter_output(args, ctx)
+
+# kate: syntax python;
+# kate: indent-mode python; space-indent on; indent-width 4; mixedindent off;
@@ -0,0 +1,162 @@
+/**
+ * Seccomp Library test program
+ *
+ * Copyright (c) 2026 The libseccomp Authors
+ * Author: The libseccomp Authors <libseccomp@googlegroups.com>
+ */
+
+/*
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of version 2.1 of the GNU Lesser General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses>.
+ */
+
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <seccomp.h>
+#include <signal.h>
+#include <syscall.h>
+#include <errno.h>
+#include <stdlib.h>
+
+#include "util.h"
+
+#define MAGIC		0x1122334455667788UL
+#define THREADS		4
+#define CHILDREN	8
+#define CALLS		64
+
+static int notify_cb(const struct seccomp_notif *req,
+		     struct seccomp_notif_resp *resp, void *data)
+{
+	int fd = *(int *)data;
+
+	if (req->data.nr == SCMP_SYS(getpid)) {
+		resp->val = MAGIC;
+		return 0;
+	}
+
+	/* respond ourselves and tell the dispatcher to skip it */
+	resp->error = -EPERM;
+	seccomp_notify_respond(fd, resp);
+	return 1;
+}
+
+static int child(void)
+{
+	int iter;
+
+	for (iter = 0; iter < CALLS; iter++) {
+		if (syscall(SCMP_SYS(getpid)) != MAGIC)
+			return 1;
+		if (syscall(SCMP_SYS(getppid)) != -1 || errno != EPERM)
+			return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	int rc, fd = -1, status;
+	unsigned int iter;
+	uint64_t received = 0, responded = 0, skipped = 0;
+	struct scmp_notify_stats stats;
+	scmp_filter_ctx ctx = NULL;
+	scmp_notify_ctx disp = NULL;
+	pid_t pids[CHILDREN] = { 0 };
+
+	ctx = seccomp_init(SCMP_ACT_ALLOW);
+	if (ctx == NULL)
+		return ENOMEM;
+
+	rc = seccomp_rule_add(ctx, SCMP_ACT_NOTIFY, SCMP_SYS(getpid), 0);
+	if (rc)
+		goto out;
+	rc = seccomp_rule_add(ctx, SCMP_ACT_NOTIFY, SCMP_SYS(getppid), 0);
+	if (rc)
+		goto out;
+
+	rc  = seccomp_load(ctx);
+	if (rc < 0)
+		goto out;
+
+	rc = seccomp_notify_fd(ctx);
+	if (rc < 0)
+		goto out;
+	fd = rc;
+
+	rc = seccomp_notify_dispatch_start(fd, THREADS, notify_cb, &fd, &disp);
+	if (rc < 0)
+		goto out;
+
+	for (iter = 0; iter < CHILDREN; iter++) {
+		pids[iter] = fork();
+		if (pids[iter] == 0)
+			exit(child());
+		else if (pids[iter] < 0) {
+			rc = -errno;
+			goto out;
+		}
+	}
+
+	for (iter = 0; iter < CHILDREN; iter++) {
+		if (waitpid(pids[iter], &status, 0) != pids[iter]) {
+			rc = -EFAULT;
+			goto out;
+		}
+		pids[iter] = 0;
+		if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+			rc = -EFAULT;
+			goto out;
+		}
+	}
+
+	seccomp_notify_dispatch_stop(disp);
+	for (iter = 0; iter < THREADS; iter++) {
+		rc = seccomp_notify_dispatch_stats(disp, iter, &stats);
+		if (rc < 0)
+			goto out;
+		if (stats.failed != 0) {
+			rc = -EFAULT;
+			goto out;
+		}
+		received += stats.received;
+		responded += stats.responded;
+		skipped += stats.skipped;
+	}
+	if (received != 2 * CHILDREN * CALLS ||
+	    responded != CHILDREN * CALLS || skipped != CHILDREN * CALLS) {
+		rc = -EFAULT;
+		goto out;
+	}
+	rc = seccomp_notify_dispatch_stats(disp, THREADS, &stats);
+	if (rc != -EINVAL) {
+		rc = -EFAULT;
+		goto out;
+	}
+	rc = 0;
+
+out:
+	for (iter = 0; iter < CHILDREN; iter++) {
+		if (pids[iter] > 0)
+			kill(pids[iter], SIGKILL);
+	}
+	seccomp_notify_dispatch_release(disp);
+	if (fd >= 0)
+		close(fd);
+	seccomp_release(ctx);
+
+	if (rc != 0)
+		return (rc < 0 ? -rc : rc);
+	return 160;
+}
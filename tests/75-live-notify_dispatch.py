@@ -0,0 +1,87 @@
+#!/usr/bin/env python
+
+#
+# Seccomp Library test program
+#
+# Copyright (c) 2026 The libseccomp Authors
+# Author: The libseccomp Authors <libseccomp@googlegroups.com>
+#
+
+#
+# This library is free software; you can redistribute it and/or modify it
+# under the terms of version 2.1 of the GNU Lesser General Public License as
+# published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+# for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library; if not, see <http://www.gnu.org/licenses>.
+#
+
+import argparse
+import errno
+import os
+import sys
+
+import util
+
+from seccomp import *
+
+def test():
+    magic = os.getuid() + 1
+    children = 4
+    calls = 16
+    f = SyscallFilter(ALLOW)
+    f.add_rule(NOTIFY, "getuid")
+    f.add_rule(NOTIFY, "getppid")
+    f.load()
+
+    def handler(notify):
+        if notify.syscall == resolve_syscall(Arch(), "getuid"):
+            return NotificationResponse(notify, magic, 0, 0)
+        # respond ourselves and tell the dispatcher to skip it
+        f.respond_notify(NotificationResponse(notify, 0, -errno.EPERM, 0))
+        return None
+
+    disp = f.dispatch_notify(handler, 2)
+    pids = []
+    for i in range(children):
+        pid = os.fork()
+        if pid == 0:
+            for j in range(calls):
+                if os.getuid() != magic:
+                    os._exit(1)
+                try:
+                    os.getppid()
+                    os._exit(1)
+                except PermissionError:
+                    pass
+            os._exit(0)
+        pids.append(pid)
+    for pid in pids:
+        wpid, rc = os.waitpid(pid, 0)
+        if os.WIFEXITED(rc) == 0:
+            raise RuntimeError("Child process error")
+        if os.WEXITSTATUS(rc) != 0:
+            raise RuntimeError("Child process error")
+    disp.stop()
+    received, responded, skipped, failed = 0, 0, 0, 0
+    for worker in range(2):
+        stats = disp.stats(worker)
+        received += stats[0]
+        responded += stats[1]
+        skipped += stats[2]
+        failed += stats[3]
+    if received != 2 * children * calls or failed != 0:
+        raise RuntimeError("Dispatcher statistics failed")
+    if responded != children * calls or skipped != children * calls:
+        raise RuntimeError("Dispatcher statistics failed")
+    quit(160)
+
+test()
+
+# kate: syntax python;
+# kate: indent-mode python; space-indent on; indent-width 4; mixedindent off;
@@ -41,6 +41,7 @@
  */
 struct sim_state {
 	uint32_t acc;
+	uint32_t x;
 	uint32_t temp[BPF_SCRATCH_SIZE];
 };
 
@@ -187,12 +188,23 @@ static void bpf_execute(const struct bpf_program *prg,
 			} else
 				exit_error(ERANGE, ip_c);
 			break;
+		case BPF_LD+BPF_W+BPF_IMM:
+			state.acc = k;
+			break;
+		case BPF_MISC+BPF_TAX:
+			state.x = state.acc;
+			break;
 		case BPF_ALU+BPF_OR+BPF_K:
 			state.acc |= k;
 			break;
 		case BPF_ALU+BPF_AND+BPF_K:
 			state.acc &= k;
 			break;
+		case BPF_ALU+BPF_RSH+BPF_X:
+			if (state.x >= 32)
+				exit_error(ERANGE, ip_c);
+			state.acc >>= state.x;
+			break;
 		case BPF_JMP+BPF_JA:
 			ip += k;
 			break;
@@ -214,6 +226,12 @@ static void bpf_execute(const struct bpf_program *prg,
 			else
 				ip += jf;
 			break;
+		case BPF_JMP+BPF_JSET+BPF_K:
+			if (state.acc & k)
+				ip += jt;
+			else
+				ip += jf;
+			break;
 		case BPF_RET+BPF_K:
 			end_action(k, ip_c);
 			break;